@@ -38,6 +38,9 @@ struct Material : public virtual kpi::IObject {
   virtual void setXluPass(bool b) = 0;
 
   virtual std::pair<std::string, std::string> generateShaders() const = 0;
+  // Materials with equal keys generate the same shaders, so may share a
+  // program.
+  virtual std::string getShaderKey() const = 0;
 
   virtual void setMegaState(librii::gfx::MegaState& state) const = 0;
   virtual void configure(PixelOcclusion occlusion,
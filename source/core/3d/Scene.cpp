@@ -3,17 +3,24 @@
 #endif
 #include "i3dmodel.hpp"
 #include <algorithm>                       // std::min
+#include <numeric>                         // std::iota
+#include <set>
 #include <core/3d/gl.hpp>                  // glClearColor
 #include <core/3d/renderer/SceneState.hpp> // SceneState
 #include <core/3d/renderer/SceneTree.hpp>
 #include <core/util/gui.hpp>           // ImGui::GetStyle()
+#include <core/util/parallel.hpp>      // util::ParallelFor
+#include <core/util/profiler.hpp>      // RII_PROFILE_SCOPE
 #include <librii/gl/Compiler.hpp>      // PacketParams
 #include <librii/gl/EnumConverter.hpp> // setGlState
+#include <librii/glhelper/ShaderCache.hpp>
 #include <librii/glhelper/UBOBuilder.hpp>
 #include <librii/mtx/TexMtx.hpp>
 #include <plugins/gc/Export/IndexedPolygon.hpp>
+#include <plugins/gc/Export/MatrixPalette.hpp>
 #include <plugins/gc/Export/Material.hpp>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace riistudio::lib3d {
 
@@ -31,42 +38,84 @@ struct VertexBufferTenant {
     idx_ofs = static_cast<u32>(vbo_builder.mIndices.size());
     poly.propagate(mdl, mp_id, vbo_builder);
     idx_size = static_cast<u32>(vbo_builder.mIndices.size()) - idx_ofs;
+    positions = poly.calcPositionBound(
+        reinterpret_cast<const libcube::Model&>(mdl), mp_id);
   }
   u32 idx_ofs;
   u32 idx_size;
+  // Bounds of the uploaded positions, before the position matrices apply
+  std::optional<librii::math::AABB> positions;
 };
 
 struct ShaderUser {
-  ShaderUser(librii::glhelper::ShaderProgram&& shader) {
-    mImpl = std::make_unique<Impl>(std::move(shader));
+  //! @param cache Programs shared by materials with equal shader keys.
+  //! @param dirty Set when the material switches programs, as draws
+  //!              referencing the old program must be rebuilt.
+  ShaderUser(const lib3d::Material& mat, librii::glhelper::ShaderCache& cache,
+             bool* dirty) {
+    mImpl = std::make_unique<Impl>(cache, dirty);
+    attach(mat);
   }
 
-  auto& getProgram() { return mImpl->mProgram; }
-  void attachToMaterial(const lib3d::Material& mat) {
+  const auto& getProgram() const { return mImpl->mEntry->program; }
+  //! Observe `mat`, unless already observing it. A material that took the
+  //! address of a deleted one starts without observers.
+  void attach(const lib3d::Material& mat) {
+    if (std::find(mat.observers.begin(), mat.observers.end(), mImpl.get()) !=
+        mat.observers.end())
+      return;
+    mImpl->resolve(mat);
     mat.observers.push_back(mImpl.get());
   }
 
 private:
   // IObservers should be heap allocated
   struct Impl : public IObserver {
-    Impl(librii::glhelper::ShaderProgram&& program)
-        : mProgram(std::move(program)) {}
+    Impl(librii::glhelper::ShaderCache& cache, bool* dirty)
+        : mCache(cache), mDirty(dirty) {}
+
+    librii::glhelper::ShaderCache& mCache;
+    const librii::glhelper::ShaderCache::Entry* mEntry = nullptr;
+    bool* mDirty;
+
+    // Look up (or compile) the program for the material's current state.
+    // Returns whether the material now uses a different program.
+    bool resolve(const lib3d::Material& mat) {
+      std::string key = mat.getShaderKey();
+      // Hand-edited pixel shaders are only shared with identical edits.
+      if (mat.applyCacheAgain)
+        key += mat.cachedPixelShader;
+
+      const auto* entry = mCache.find(key);
+      if (entry == nullptr) {
+        RII_PROFILE_SCOPE("Generate shader");
+        const auto shader_sources = mat.generateShaders();
+        entry = &mCache.emplace(key, shader_sources.first,
+                                mat.applyCacheAgain ? mat.cachedPixelShader
+                                                    : shader_sources.second);
+      }
+      if (!mat.applyCacheAgain)
+        mat.cachedPixelShader = entry->fragment + "\n\n // End of shader";
+
+      if (entry->program.getError()) {
+        mat.isShaderError = true;
+        mat.shaderError = entry->program.getErrorDesc();
+        // Keep drawing with the last working program.
+        if (mEntry != nullptr)
+          return false;
+      } else {
+        mat.isShaderError = false;
+      }
 
-    librii::glhelper::ShaderProgram mProgram;
+      const bool changed = entry != mEntry;
+      mEntry = entry;
+      return changed;
+    }
 
     void update(lib3d::Material* _mat) final {
       DebugReport("Recompiling shader for %s..\n", _mat->getName().c_str());
-      const auto shader_sources = _mat->generateShaders();
-      librii::glhelper::ShaderProgram new_shader(
-          shader_sources.first, _mat->applyCacheAgain ? _mat->cachedPixelShader
-                                                      : shader_sources.second);
-      if (new_shader.getError()) {
-        _mat->isShaderError = true;
-        _mat->shaderError = new_shader.getErrorDesc();
-        return;
-      }
-      mProgram = std::move(new_shader);
-      _mat->isShaderError = false;
+      if (resolve(*_mat))
+        *mDirty = true;
     }
   };
   std::unique_ptr<Impl> mImpl;
@@ -85,6 +134,58 @@ public:
     return std::hash<std::string>()(name.string) ^ name.mprim_index;
   }
 };
+struct Node {
+  const lib3d::Scene& scene;
+  const lib3d::Model& model;
+  const libcube::MatrixPalette& palette;
+  u64 bone_id;
+  const lib3d::Material& mat;
+  const lib3d::Polygon& poly;
+};
+
+// GL state queried once per program rather than once per draw
+struct ProgramInfo {
+  llvm::SmallVector<SceneNode::UniformMin, 4> uniform_mins;
+};
+
+// A draw collected on the main thread, to be built into a SceneNode on any.
+struct DrawItem {
+  Node node;
+  u32 mp_id;
+  const VertexBufferTenant* tenant;
+  u32 shader_id;
+  const ProgramInfo* program;
+};
+
+// Identifies a draw across rebuilds, so that a draw whose inputs were not
+// edited keeps its node.
+struct DrawKey {
+  const lib3d::Model* model;
+  const lib3d::Material* mat;
+  const lib3d::Polygon* poly;
+  u64 bone_id;
+  u32 mp_id;
+  u32 shader_id;
+
+  DrawKey(const DrawItem& item)
+      : model(&item.node.model), mat(&item.node.mat), poly(&item.node.poly),
+        bone_id(item.node.bone_id), mp_id(item.mp_id),
+        shader_id(item.shader_id) {}
+  bool operator==(const DrawKey&) const = default;
+};
+
+struct DrawKeyHash {
+  std::size_t operator()(const DrawKey& key) const {
+    std::size_t h = std::hash<const void*>()(key.model);
+    for (const std::size_t x :
+         {std::hash<const void*>()(key.mat), std::hash<const void*>()(key.poly),
+          std::hash<u64>()(key.bone_id), std::hash<u32>()(key.mp_id),
+          std::hash<u32>()(key.shader_id)})
+      h = h * 31 + x;
+    return h;
+  }
+};
+
 struct SceneImpl::Internal {
   librii::glhelper::VBOBuilder mVboBuilder;
   // Maps mesh names -> slots of mVboBuilder
@@ -94,10 +195,36 @@ struct SceneImpl::Internal {
   // Maps texture names -> slots of mTextures
   std::map<std::string, u32> mTexIdMap;
 
-  // Maps material name -> Shader
+  // Programs shared by every material with the same shader key. Declared
+  // before mMatToShader, which references it.
+  librii::glhelper::ShaderCache mShaders;
+
+  // Maps material (by kpi::EditKey) -> Shader
+  // Each material observes its own entry; names may repeat across models.
   // Each entry is heap allocated so we shouldnt have to worry about dangling
   // references.
-  std::map<std::string, ShaderUser> mMatToShader;
+  std::map<const void*, ShaderUser> mMatToShader;
+
+  // Bone and draw matrices of each model, by index, updated once per frame
+  std::vector<libcube::MatrixPalette> mPalettes;
+
+  // Maps program id -> its uniform block sizes
+  std::unordered_map<u32, ProgramInfo> mPrograms;
+
+  // Draws of the retained draw list, in draw list order
+  std::vector<DrawItem> mDrawItems;
+  // Where the node of each draw item went: {translucent, index in the pass}
+  std::vector<std::pair<bool, u32>> mNodeSlots;
+
+  // The draw list itself is retained by the SceneState. Record the material of
+  // each node so camera-dependent uniforms can be patched without a rebuild.
+  std::vector<const lib3d::Material*> mOpaqueMaterials;
+  std::vector<const lib3d::Material*> mTranslucentMaterials;
+  // Camera the retained uniforms were computed with
+  glm::mat4 mViewMtx{1.0f};
+  glm::mat4 mProjMtx{1.0f};
+  // Set when a material switches programs. Its draws are then gathered again.
+  bool mDrawListDirty = false;
 
   void buildVertexBuffer(const Model& model) {
     for (auto& mesh : model.getMeshes()) {
@@ -115,6 +242,38 @@ struct SceneImpl::Internal {
     }
   }
 
+  const ProgramInfo& getProgramInfo(u32 shader_id) {
+    auto [it, inserted] = mPrograms.try_emplace(shader_id);
+    if (!inserted)
+      return it->second;
+
+    for (u32 i = 0; i < 3; ++i) {
+      int query_min;
+      glGetActiveUniformBlockiv(shader_id, i, GL_UNIFORM_BLOCK_DATA_SIZE,
+                                &query_min);
+      it->second.uniform_mins.push_back(
+          {.binding_point = i, .min_size = static_cast<u32>(query_min)});
+    }
+
+    // WebGL doesn't support binding=n in the shader
+#ifdef __EMSCRIPTEN__
+    glUniformBlockBinding(
+        shader_id, glGetUniformBlockIndex(shader_id, "ub_SceneParams"), 0);
+    glUniformBlockBinding(
+        shader_id, glGetUniformBlockIndex(shader_id, "ub_MaterialParams"), 1);
+    glUniformBlockBinding(
+        shader_id, glGetUniformBlockIndex(shader_id, "ub_PacketParams"), 2);
+#endif // __EMSCRIPTEN__
+
+    const s32 samplerIds[] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+    glUseProgram(shader_id);
+    u32 uTexLoc = glGetUniformLocation(shader_id, "u_Texture");
+    glUniform1iv(uTexLoc, 8, samplerIds);
+
+    return it->second;
+  }
+
   void buildTextures(const Scene& host) {
     for (auto& tex : host.getTextures()) {
       if (mTexIdMap.contains(tex.getName()))
@@ -128,6 +287,48 @@ struct SceneImpl::Internal {
 SceneImpl::SceneImpl() = default;
 SceneImpl::~SceneImpl() = default;
 
+static librii::gl::UniformSceneParams MakeSceneParams(glm::mat4 view_matrix,
+                                                      glm::mat4 proj_matrix) {
+  glm::mat4 model_matrix{1.0f};
+
+  librii::gl::UniformSceneParams scene;
+  scene.projection = model_matrix * view_matrix * proj_matrix;
+  scene.Misc0 = {};
+  return scene;
+}
+
+static void SetTexMatrices(librii::gl::UniformMaterialParams& out,
+                           const libcube::GCMaterialData& data,
+                           glm::mat4 view_matrix, glm::mat4 proj_matrix) {
+  glm::mat4 model_matrix{1.0f};
+
+  for (int i = 0; i < data.texMatrices.size(); ++i) {
+    out.TexMtx[i] = glm::transpose(
+        data.texMatrices[i].compute(model_matrix, view_matrix * proj_matrix));
+  }
+}
+
+// Patch the camera-dependent uniforms of a retained node in place.
+static void UpdateSceneNodeCamera(SceneNode& node, const lib3d::Material& mat,
+                                  glm::mat4 view_matrix,
+                                  glm::mat4 proj_matrix) {
+  const auto& data =
+      reinterpret_cast<const libcube::IGCMaterial&>(mat).getMaterialData();
+
+  for (auto& uniform : node.uniform_data) {
+    if (uniform.binding_point == 0) {
+      const auto scene = MakeSceneParams(view_matrix, proj_matrix);
+      memcpy(uniform.raw_data.data(), &scene, sizeof(scene));
+    } else if (uniform.binding_point == 1 && !data.texMatrices.empty()) {
+      // The raw data is not suitably aligned to be accessed in place
+      librii::gl::UniformMaterialParams tmp;
+      memcpy(&tmp, uniform.raw_data.data(), sizeof(tmp));
+      SetTexMatrices(tmp, data, view_matrix, proj_matrix);
+      memcpy(uniform.raw_data.data(), &tmp, sizeof(tmp));
+    }
+  }
+}
+
 void SceneImpl::prepare(SceneState& state, const kpi::INode& _host,
                         glm::mat4 v_mtx, glm::mat4 p_mtx) {
   auto& host = *dynamic_cast<const Scene*>(&_host);
@@ -142,28 +343,64 @@ void SceneImpl::prepare(SceneState& state, const kpi::INode& _host,
     mImpl->buildTextures(host);
   }
 
-  for (auto& model : host.getModels())
-    gather(state.getBuffers(), model, host, v_mtx, p_mtx);
-}
+  // Retained draws hold their matrices, so moving a bone rebuilds them.
+  // Palettes of deleted models are dropped; a palette whose model was
+  // replaced sees a new bone set and binds it again. Bones only move through
+  // edits, so frames without any skip the palettes, and only a rebuild or an
+  // edit to the model itself looks for a new bone set or draw matrices.
+  const auto models = host.getModels();
+  mImpl->mPalettes.resize(models.size());
+  std::unordered_set<const lib3d::Model*> moved;
+  if (state.needsRebuild() || !state.getEdited().empty()) {
+    for (std::size_t i = 0; i < models.size(); ++i) {
+      const bool relink = state.needsRebuild() ||
+                          state.getEdited().contains(kpi::EditKey(models[i]));
+      if (mImpl->mPalettes[i].update(
+              reinterpret_cast<const libcube::Model&>(models[i]), relink))
+        moved.insert(&models[i]);
+    }
+  }
 
-librii::math::AABB CalcPolyBound(const lib3d::Polygon& poly,
-                                 const lib3d::Bone& bone,
-                                 const lib3d::Model& mdl) {
-  auto mdl_mtx = bone.calcSrtMtx(&mdl);
+  if (state.needsRebuild()) {
+    mImpl->mDrawItems.clear();
+    {
+      RII_PROFILE_SCOPE("Gather draws");
+      gather(host);
+    }
+    RII_PROFILE_SCOPE("Build draws");
+    std::vector<SceneNode> nodes(mImpl->mDrawItems.size());
+    std::vector<u32> stale(nodes.size());
+    std::iota(stale.begin(), stale.end(), 0);
+    buildDraws(state.getBuffers(), nodes, stale, v_mtx, p_mtx);
+    state.markRebuilt();
+  } else {
+    if (!state.getEdited().empty() || !moved.empty() ||
+        mImpl->mDrawListDirty) {
+      RII_PROFILE_SCOPE("Update draws");
+      // Kept nodes still hold the last frame's camera, patched below.
+      updateDraws(state, host, moved, mImpl->mViewMtx, mImpl->mProjMtx);
+    }
+    if (v_mtx != mImpl->mViewMtx || p_mtx != mImpl->mProjMtx)
+      updateCamera(state, v_mtx, p_mtx);
+  }
+  mImpl->mDrawListDirty = false;
 
-  auto nmax = mdl_mtx * glm::vec4(poly.getBounds().max, 0.0f);
-  auto nmin = mdl_mtx * glm::vec4(poly.getBounds().min, 0.0f);
+  mImpl->mViewMtx = v_mtx;
+  mImpl->mProjMtx = p_mtx;
+}
 
-  return {nmin, nmax};
+void SceneImpl::updateCamera(SceneState& state, glm::mat4 v_mtx,
+                             glm::mat4 p_mtx) {
+  auto& buffers = state.getBuffers();
+  for (std::size_t i = 0; i < buffers.opaque.nodes.size(); ++i)
+    UpdateSceneNodeCamera(buffers.opaque.nodes[i], *mImpl->mOpaqueMaterials[i],
+                          v_mtx, p_mtx);
+  for (std::size_t i = 0; i < buffers.translucent.nodes.size(); ++i)
+    UpdateSceneNodeCamera(buffers.translucent.nodes[i],
+                          *mImpl->mTranslucentMaterials[i], v_mtx, p_mtx);
+  state.markUniformsDirty();
 }
 
-struct Node {
-  const lib3d::Scene& scene;
-  const lib3d::Model& model;
-  const lib3d::Bone& bone;
-  const lib3d::Material& mat;
-  const lib3d::Polygon& poly;
-};
 template <typename T>
 SceneNode::UniformData pushUniform(u32 binding_point, const T& data) {
   const u8* pack_begin = reinterpret_cast<const u8*>(&data);
@@ -172,19 +409,20 @@ SceneNode::UniformData pushUniform(u32 binding_point, const T& data) {
   return SceneNode::UniformData{.binding_point = binding_point,
                                 .raw_data = {pack_begin, pack_end}};
 }
-void MakeSceneNode(SceneNode& out, VertexBufferTenant& tenant,
-                   librii::glhelper::VBOBuilder& v,
-                   const std::map<std::string, u32>& tex_id_map, Node node,
-                   librii::glhelper::ShaderProgram& prog, u32 mp_id,
+// Only reads the document and the renderer's lookup tables; issues no GL calls,
+// so draws may be built concurrently.
+void MakeSceneNode(SceneNode& out, const DrawItem& item, u32 vao_id,
+                   const std::map<std::string, u32>& tex_id_map,
                    glm::mat4 view_matrix, glm::mat4 proj_matrix) {
-  glm::mat4 model_matrix{1.0f};
+  const Node& node = item.node;
+  const u32 mp_id = item.mp_id;
+  const VertexBufferTenant& tenant = *item.tenant;
 
-  out.vao_id = v.getGlId();
-  out.bound = CalcPolyBound(node.poly, node.bone, node.model);
+  out.vao_id = vao_id;
 
   //
   node.mat.setMegaState(out.mega_state);
-  out.shader_id = prog.getId();
+  out.shader_id = item.shader_id;
 
   // draw
   out.glBeginMode = GL_TRIANGLES;
@@ -223,25 +461,10 @@ void MakeSceneNode(SceneNode& out, VertexBufferTenant& tenant,
     out.texture_objects.push_back(obj);
   }
 
-  {
-    int query_min;
+  out.uniform_mins = item.program->uniform_mins;
 
-    for (u32 i = 0; i < 3; ++i) {
-      glGetActiveUniformBlockiv(out.shader_id, i, GL_UNIFORM_BLOCK_DATA_SIZE,
-                                &query_min);
-      out.uniform_mins.push_back(
-          {.binding_point = i, .min_size = static_cast<u32>(query_min)});
-    }
-  }
-
-  {
-    librii::gl::UniformSceneParams scene;
-
-    scene.projection = model_matrix * view_matrix * proj_matrix;
-    scene.Misc0 = {};
-
-    out.uniform_data.emplace_back(pushUniform(0, scene));
-  }
+  out.uniform_data.emplace_back(
+      pushUniform(0, MakeSceneParams(view_matrix, proj_matrix)));
 
   {
     const auto& data = reinterpret_cast<const libcube::IGCMaterial&>(node.mat)
@@ -249,11 +472,7 @@ void MakeSceneNode(SceneNode& out, VertexBufferTenant& tenant,
 
     librii::gl::UniformMaterialParams tmp{};
     librii::gl::setUniformsFromMaterial(tmp, data);
-
-    for (int i = 0; i < data.texMatrices.size(); ++i) {
-      tmp.TexMtx[i] = glm::transpose(
-          data.texMatrices[i].compute(model_matrix, view_matrix * proj_matrix));
-    }
+    SetTexMatrices(tmp, data, view_matrix, proj_matrix);
     for (int i = 0; i < data.samplers.size(); ++i) {
       if (data.samplers[i].mTexture.empty())
         continue;
@@ -280,58 +499,30 @@ void MakeSceneNode(SceneNode& out, VertexBufferTenant& tenant,
     const auto& ipoly =
         reinterpret_cast<const libcube::IndexedPolygon&>(node.poly);
 
-    const auto mtx = ipoly.getPosMtx(
-        reinterpret_cast<const libcube::Model&>(node.model), mp_id);
-    for (int p = 0; p < std::min<std::size_t>(10, mtx.size()); ++p) {
+    std::array<glm::mat4, std::size(pack.posMtx)> scratch;
+    const auto mtx = ipoly.getPosMtx(node.palette, mp_id, scratch);
+    for (std::size_t p = 0; p < mtx.size(); ++p) {
       pack.posMtx[p] = glm::transpose(mtx[p]);
     }
 
-    out.uniform_data.push_back(pushUniform(2, pack));
-  }
-
-  {
-
-    // WebGL doesn't support binding=n in the shader
-#ifdef __EMSCRIPTEN__
-    glUniformBlockBinding(
-        shader_id, glGetUniformBlockIndex(shader_id, "ub_SceneParams"), 0);
-    glUniformBlockBinding(
-        shader_id, glGetUniformBlockIndex(shader_id, "ub_MaterialParams"), 1);
-    glUniformBlockBinding(
-        shader_id, glGetUniformBlockIndex(shader_id, "ub_PacketParams"), 2);
-#endif // __EMSCRIPTEN__
-
-    const s32 samplerIds[] = {0, 1, 2, 3, 4, 5, 6, 7};
+    // Draws without positions are never culled.
+    out.has_bound = tenant.positions.has_value();
+    if (out.has_bound) {
+      out.bound = libcube::IndexedPolygon::transformPositionBound(
+          *tenant.positions, mtx);
+    }
 
-    glUseProgram(out.shader_id);
-    u32 uTexLoc = glGetUniformLocation(out.shader_id, "u_Texture");
-    glUniform1iv(uTexLoc, 8, samplerIds);
+    out.uniform_data.push_back(pushUniform(2, pack));
   }
 }
 
-void pushDisplay(VertexBufferTenant& tenant,
-                 librii::glhelper::VBOBuilder& vbo_builder, Node node,
-                 riistudio::lib3d::SceneBuffers& output, u32 mp_id,
-                 const std::map<std::string, u32>& tex_id_map,
-                 librii::glhelper::ShaderProgram& shader, glm::mat4 v_mtx,
-                 glm::mat4 p_mtx) {
-
-  SceneNode mnode;
-  MakeSceneNode(mnode, tenant, vbo_builder, tex_id_map, node, shader, mp_id,
-                v_mtx, p_mtx);
-
-  auto& nodebuf = node.mat.isXluPass() ? output.translucent : output.opaque;
-
-  nodebuf.nodes.push_back(std::move(mnode));
-}
-
-void SceneImpl::gatherBoneRecursive(SceneBuffers& output, u64 boneId,
-                                    const lib3d::Model& root,
-                                    const lib3d::Scene& scene, glm::mat4 v_mtx,
-                                    glm::mat4 p_mtx) {
+void SceneImpl::gatherBoneRecursive(u64 boneId, const lib3d::Model& root,
+                                    const lib3d::Scene& scene,
+                                    std::size_t model_index) {
   auto bones = root.getBones();
   auto polys = root.getMeshes();
   auto mats = root.getMaterials();
+  const auto& palette = mImpl->mPalettes[model_index];
 
   const auto& pBone = bones[boneId];
   const u64 nDisplay = pBone.getNumDisplays();
@@ -344,47 +535,163 @@ void SceneImpl::gatherBoneRecursive(SceneBuffers& output, u64 boneId,
     const auto& poly =
         reinterpret_cast<const libcube::IndexedPolygon&>(polys[display.polyId]);
 
-    if (!mImpl->mMatToShader.contains(mat.getName())) {
-      const auto shader_sources = mat.generateShaders();
-
-      mImpl->mMatToShader.emplace(
-          mat.getName(), librii::glhelper::ShaderProgram{
-                             shader_sources.first, shader_sources.second});
-      mImpl->mMatToShader.at(mat.getName()).attachToMaterial(mat);
+    auto shader = mImpl->mMatToShader.find(kpi::EditKey(mat));
+    if (shader == mImpl->mMatToShader.end()) {
+      shader = mImpl->mMatToShader
+                   .emplace(kpi::EditKey(mat),
+                            ShaderUser{mat, mImpl->mShaders,
+                                       &mImpl->mDrawListDirty})
+                   .first;
+    } else {
+      shader->second.attach(mat);
     }
+    const u32 shader_id = shader->second.getProgram().getId();
+    const ProgramInfo& program = mImpl->getProgramInfo(shader_id);
 
     for (u32 i = 0; i < poly.getMeshData().mMatrixPrimitives.size(); ++i) {
       if (!poly.isVisible())
         continue;
 
       MeshName mesh_name{.string = poly.getName(), .mprim_index = i};
-      Node node{
-          .scene = scene,
-          .model = root,
-          .bone = pBone,
-          .mat = mat,
-          .poly = poly,
-      };
-      pushDisplay(mImpl->mTenants.at(mesh_name), mImpl->mVboBuilder, node,
-                  output, i, mImpl->mTexIdMap,
-                  mImpl->mMatToShader.at(mat.getName()).getProgram(), v_mtx,
-                  p_mtx);
+      mImpl->mDrawItems.push_back(DrawItem{
+          .node = Node{.scene = scene,
+                       .model = root,
+                       .palette = palette,
+                       .bone_id = boneId,
+                       .mat = mat,
+                       .poly = poly},
+          .mp_id = i,
+          .tenant = &mImpl->mTenants.at(mesh_name),
+          .shader_id = shader_id,
+          .program = &program,
+      });
     }
   }
 
   for (u64 i = 0; i < pBone.getNumChildren(); ++i)
-    gatherBoneRecursive(output, pBone.getChild(i), root, scene, v_mtx, p_mtx);
+    gatherBoneRecursive(pBone.getChild(i), root, scene, model_index);
 }
 
-void SceneImpl::gather(SceneBuffers& output, const lib3d::Model& root,
-                       const lib3d::Scene& scene, glm::mat4 v_mtx,
-                       glm::mat4 p_mtx) {
-  if (root.getMaterials().empty() || root.getMeshes().empty() ||
-      root.getBones().empty())
-    return;
+void SceneImpl::gather(const lib3d::Scene& scene) {
+  const auto models = scene.getModels();
+  for (std::size_t i = 0; i < models.size(); ++i) {
+    const auto& root = models[i];
+    if (root.getMaterials().empty() || root.getMeshes().empty() ||
+        root.getBones().empty())
+      continue;
+
+    // Assumes root at zero
+    gatherBoneRecursive(0, root, scene, i);
+  }
+}
 
-  // Assumes root at zero
-  gatherBoneRecursive(output, 0, root, scene, v_mtx, p_mtx);
+void SceneImpl::updateDraws(SceneState& state, const lib3d::Scene& host,
+                            const std::unordered_set<const Model*>& moved,
+                            glm::mat4 v_mtx, glm::mat4 p_mtx) {
+  const auto& edited = state.getEdited();
+  auto isEdited = [&](const auto& obj) {
+    return edited.contains(kpi::EditKey(obj));
+  };
+  std::set<std::string> edited_textures;
+  for (auto& tex : host.getTextures()) {
+    if (isEdited(tex))
+      edited_textures.insert(tex.getName());
+  }
+  auto isStale = [&](const DrawItem& item) {
+    const Node& node = item.node;
+    if (moved.contains(&node.model) || isEdited(node.model) ||
+        isEdited(node.mat) || isEdited(node.poly) ||
+        isEdited(node.model.getBones()[node.bone_id]))
+      return true;
+    const auto& data = reinterpret_cast<const libcube::IGCMaterial&>(node.mat)
+                           .getMaterialData();
+    for (const auto& sampler : data.samplers) {
+      if (edited_textures.contains(sampler.mTexture))
+        return true;
+    }
+    return false;
+  };
+
+  // Take the retained nodes, indexed by draw item
+  auto& buffers = state.getBuffers();
+  std::vector<DrawItem> old_items = std::move(mImpl->mDrawItems);
+  std::vector<SceneNode> old_nodes(old_items.size());
+  std::unordered_map<DrawKey, u32, DrawKeyHash> reusable;
+  for (u32 i = 0; i < old_items.size(); ++i) {
+    const auto [xlu, index] = mImpl->mNodeSlots[i];
+    old_nodes[i] =
+        std::move((xlu ? buffers.translucent : buffers.opaque).nodes[index]);
+    if (!isStale(old_items[i]))
+      reusable.try_emplace(DrawKey(old_items[i]), i);
+  }
+  buffers.opaque.nodes.clear();
+  buffers.translucent.nodes.clear();
+
+  // Edits may add or remove draws (e.g. bone displays), so gather them again.
+  // This is cheap next to building them.
+  mImpl->mDrawItems.clear();
+  gather(host);
+
+  std::vector<SceneNode> nodes(mImpl->mDrawItems.size());
+  std::vector<u32> stale;
+  for (u32 i = 0; i < nodes.size(); ++i) {
+    const auto found = reusable.find(DrawKey(mImpl->mDrawItems[i]));
+    if (found == reusable.end()) {
+      stale.push_back(i);
+      continue;
+    }
+    nodes[i] = std::move(old_nodes[found->second]);
+    // Repeated draws each need a node of their own.
+    reusable.erase(found);
+  }
+  buildDraws(buffers, nodes, stale, v_mtx, p_mtx);
+  state.markDrawsChanged();
+}
+
+void SceneImpl::buildDraws(SceneBuffers& output, std::vector<SceneNode>& nodes,
+                           const std::vector<u32>& stale, glm::mat4 v_mtx,
+                           glm::mat4 p_mtx) {
+  const auto& items = mImpl->mDrawItems;
+  assert(nodes.size() == items.size());
+
+  // Each node only depends on its own item, so the result is the same for any
+  // number of threads. Below a few chunks, handing them out costs more than
+  // it saves.
+  constexpr std::size_t ChunkSize = 64;
+  constexpr std::size_t MinParallelDraws = 4 * ChunkSize;
+  const u32 vao_id = mImpl->mVboBuilder.getGlId();
+  auto buildRange = [&](std::size_t begin, std::size_t end) {
+    RII_PROFILE_SCOPE("Build draw chunk");
+    for (std::size_t i = begin; i < end; ++i) {
+      const u32 item = stale[i];
+      nodes[item] = {};
+      MakeSceneNode(nodes[item], items[item], vao_id, mImpl->mTexIdMap, v_mtx,
+                    p_mtx);
+    }
+  };
+  const auto num_chunks = (stale.size() + ChunkSize - 1) / ChunkSize;
+  util::ParallelFor(
+      static_cast<u32>(num_chunks),
+      [&](u32 chunk) {
+        buildRange(chunk * ChunkSize,
+                   std::min((chunk + 1) * ChunkSize, stale.size()));
+      },
+      stale.size() >= MinParallelDraws);
+
+  output.opaque.nodes.clear();
+  output.translucent.nodes.clear();
+  mImpl->mOpaqueMaterials.clear();
+  mImpl->mTranslucentMaterials.clear();
+  mImpl->mNodeSlots.clear();
+  for (std::size_t i = 0; i < items.size(); ++i) {
+    const auto& mat = items[i].node.mat;
+    const bool xlu = mat.isXluPass();
+    auto& pass = xlu ? output.translucent : output.opaque;
+    mImpl->mNodeSlots.emplace_back(xlu, static_cast<u32>(pass.nodes.size()));
+    pass.nodes.push_back(std::move(nodes[i]));
+    (xlu ? mImpl->mTranslucentMaterials : mImpl->mOpaqueMaterials)
+        .push_back(&mat);
+  }
 }
 
 } // namespace riistudio::lib3d
@@ -7,7 +7,8 @@
 #include <core/3d/renderer/GlTexture.hpp>
 #include <core/kpi/Node2.hpp> // kpi::Collection
 #include <librii/glhelper/VBOBuilder.hpp>
-#include <memory> // std::shared_ptr
+#include <memory>        // std::shared_ptr
+#include <unordered_set> // std::unordered_set
 
 namespace riistudio::lib3d {
 
@@ -36,12 +37,26 @@ struct SceneImpl : public IDrawable {
   void prepare(SceneState& state, const kpi::INode& host, glm::mat4 v_mtx,
                glm::mat4 p_mtx) override;
 
-  void gatherBoneRecursive(SceneBuffers& output, u64 boneId,
-                           const lib3d::Model& root, const lib3d::Scene& scn,
-                           glm::mat4 v_mtx, glm::mat4 p_mtx);
+  // Collect the draws of every model. Resolves (and may compile) shaders, so
+  // this runs on the GL thread.
+  void gather(const lib3d::Scene& scene);
+  void gatherBoneRecursive(u64 boneId, const lib3d::Model& root,
+                           const lib3d::Scene& scn, std::size_t model_index);
 
-  void gather(SceneBuffers& output, const lib3d::Model& root,
-              const lib3d::Scene& scene, glm::mat4 v_mtx, glm::mat4 p_mtx);
+  // Build the draws at the indices `stale` of the collected draws, in
+  // parallel, then place all of `nodes` into `output`. The draw order is the
+  // order they were collected in.
+  void buildDraws(SceneBuffers& output, std::vector<SceneNode>& nodes,
+                  const std::vector<u32>& stale, glm::mat4 v_mtx,
+                  glm::mat4 p_mtx);
+  // Gather the draws again after edits reported to `state`, keeping the nodes
+  // of draws none of whose inputs were edited. `moved` are the models whose
+  // bone matrices changed.
+  void updateDraws(SceneState& state, const lib3d::Scene& host,
+                   const std::unordered_set<const lib3d::Model*>& moved,
+                   glm::mat4 v_mtx, glm::mat4 p_mtx);
+  // Patch the camera-dependent uniforms of the retained draws.
+  void updateCamera(SceneState& state, glm::mat4 v_mtx, glm::mat4 p_mtx);
 
 private:
   struct Internal;
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <core/3d/renderer/SceneTree.hpp> // TextureObj
+#include <core/common.h>
+#include <librii/gfx/MegaState.hpp> // MegaState
+#include <optional>
+#include <unordered_map>
+
+namespace riistudio::lib3d {
+
+//! Shadow copy of the GL state touched by scene draws.
+//!
+//! Each setter records the new state and returns whether it differs from the
+//! current one: the caller only needs to issue GL calls when it does. No GL
+//! calls are made here.
+//!
+class GlStateTracker {
+public:
+  struct Stats {
+    u32 draws = 0;
+    // Number of changes issued / skipped as redundant
+    u32 program_binds = 0, program_skips = 0;
+    u32 vao_binds = 0, vao_skips = 0;
+    u32 texture_binds = 0, texture_skips = 0;
+    u32 state_changes = 0, state_skips = 0;
+  };
+
+  //! Forget the current state. Call whenever GL may have been modified behind
+  //! our back (e.g. at the start of a frame).
+  void reset() {
+    mProgram.reset();
+    mVao.reset();
+    for (auto& unit : mUnits)
+      unit.reset();
+    mImageParams.clear();
+    mMegaState.reset();
+  }
+
+  //! Reset the statistics.
+  void resetStats() { mStats = {}; }
+  const Stats& getStats() const { return mStats; }
+
+  void onDraw() { ++mStats.draws; }
+
+  bool setProgram(u32 id) {
+    return update(mProgram, id, mStats.program_binds, mStats.program_skips);
+  }
+  bool setVertexArray(u32 id) {
+    return update(mVao, id, mStats.vao_binds, mStats.vao_skips);
+  }
+  bool setMegaState(const librii::gfx::MegaState& state) {
+    return update(mMegaState, state, mStats.state_changes, mStats.state_skips);
+  }
+
+  //! Sampler parameters live on the texture object rather than the unit, so
+  //! a texture bound to several units with different parameters must be
+  //! reconfigured even if the unit itself did not change.
+  bool setTexture(const TextureObj& obj) {
+    if (obj.active_id >= mUnits.size()) {
+      ++mStats.texture_binds;
+      return true;
+    }
+
+    auto& unit = mUnits[obj.active_id];
+    const auto params = mImageParams.find(obj.image_id);
+    if (unit == obj && params != mImageParams.end() && params->second == obj) {
+      ++mStats.texture_skips;
+      return false;
+    }
+
+    unit = obj;
+    mImageParams[obj.image_id] = obj;
+    ++mStats.texture_binds;
+    return true;
+  }
+
+private:
+  template <typename T>
+  static bool update(std::optional<T>& current, const T& next, u32& changes,
+                     u32& skips) {
+    if (current == next) {
+      ++skips;
+      return false;
+    }
+    current = next;
+    ++changes;
+    return true;
+  }
+
+  std::optional<u32> mProgram;
+  std::optional<u32> mVao;
+  std::array<std::optional<TextureObj>, 8> mUnits;
+  std::unordered_map<u32, TextureObj> mImageParams;
+  std::optional<librii::gfx::MegaState> mMegaState;
+
+  Stats mStats;
+};
+
+} // namespace riistudio::lib3d
@@ -2,7 +2,10 @@
 #define NOMINMAX
 #endif
 #include "SceneState.hpp"
+#include <algorithm>
 #include <core/3d/gl.hpp>
+#include <numeric>
+#include <rsl/RadixSort.hpp>
 #include <plugins/j3d/Shape.hpp> // Hack
 #include <vendor/glm/matrix.hpp>
 
@@ -10,29 +13,133 @@ namespace riistudio::lib3d {
 
 librii::math::AABB SceneState::computeBounds() {
   librii::math::AABB bound;
-  // TODO
   bound.min = {0.0f, 0.0f, 0.0f};
   bound.max = {0.0f, 0.0f, 0.0f};
 
-  mTree.forEachNode([&](SceneNode& node) { bound.expandBound(node.bound); });
+  bool first = true;
+  mTree.forEachNode([&](SceneNode& node) {
+    if (!node.has_bound)
+      return;
+    if (first)
+      bound = node.bound;
+    else
+      bound.expandBound(node.bound);
+    first = false;
+  });
 
   return bound;
 }
 
+// Nodes without a bound are left out of the hierarchy and listed in
+// `unbounded` instead.
+static void BuildBvh(SceneState::CullHierarchy& out, const DrawBuffer& buffer) {
+  std::vector<librii::math::AABB> bounds;
+  out.bounded.clear();
+  out.unbounded.clear();
+  for (u32 i = 0; i < buffer.nodes.size(); ++i) {
+    if (buffer.nodes[i].has_bound) {
+      bounds.push_back(buffer.nodes[i].bound);
+      out.bounded.push_back(i);
+    } else {
+      out.unbounded.push_back(i);
+    }
+  }
+  out.bvh.build(bounds);
+}
+
+static bool IsSmallFeature(const librii::math::AABB& bound,
+                           const glm::vec3& eye, float min_ratio) {
+  const glm::vec3 center = (bound.min + bound.max) * 0.5f;
+  const float radius = glm::distance(bound.min, bound.max) * 0.5f;
+  const float dist = glm::distance(center, eye);
+
+  return dist > radius && radius < dist * min_ratio;
+}
+
+void SceneState::cull(const glm::mat4& view_proj, const glm::vec3& eye,
+                      const CullSettings& settings) {
+  if (mBvhDirty) {
+    BuildBvh(mOpaqueBvh, mTree.opaque);
+    BuildBvh(mTranslucentBvh, mTree.translucent);
+    mBvhDirty = false;
+  }
+
+  const auto frustum = librii::math::Frustum::FromMatrix(view_proj);
+
+  mSortKeys.clear();
+
+  std::vector<u32> indices;
+  const auto cullBuffer = [&](DrawBuffer& buffer, const CullHierarchy& bvh,
+                              bool translucent) {
+    indices.clear();
+    if (settings.frustum) {
+      bvh.bvh.query(frustum,
+                    [&](u32 i) { indices.push_back(bvh.bounded[i]); });
+      indices.insert(indices.end(), bvh.unbounded.begin(),
+                     bvh.unbounded.end());
+      // Keep the draw order of the pass
+      std::sort(indices.begin(), indices.end());
+    } else {
+      indices.resize(buffer.nodes.size());
+      std::iota(indices.begin(), indices.end(), 0);
+    }
+
+    for (u32 i : indices) {
+      auto& node = buffer.nodes[i];
+      if (settings.min_feature_ratio > 0.0f && node.has_bound &&
+          IsSmallFeature(node.bound, eye, settings.min_feature_ratio))
+        continue;
+      const float depth =
+          glm::distance((node.bound.min + node.bound.max) * 0.5f, eye);
+      mSortKeys.emplace_back(MakeSortKey(node, translucent, depth), &node);
+    }
+  };
+  cullBuffer(mTree.opaque, mOpaqueBvh, false);
+  cullBuffer(mTree.translucent, mTranslucentBvh, true);
+
+  rsl::radix_sort(mSortKeys, mSortScratch);
+
+  std::vector<SceneNode*> visible(mSortKeys.size());
+  for (std::size_t i = 0; i < mSortKeys.size(); ++i)
+    visible[i] = mSortKeys[i].second;
+
+  // The UBO is indexed by draw: a new selection needs new uniforms.
+  if (!mCulled || visible != mVisible) {
+    mVisible = std::move(visible);
+    mUniformsDirty = true;
+  }
+  mCulled = true;
+}
+
 void SceneState::buildUniformBuffers() {
+  if (!mCulled) {
+    // Nothing was culled: draw everything
+    mVisible.clear();
+    mTree.forEachNode([&](SceneNode& node) { mVisible.push_back(&node); });
+    mCulled = true;
+    mUniformsDirty = true;
+  }
+
+  if (!mUniformsDirty)
+    return;
+  mUniformsDirty = false;
+
   mUboBuilder.clear();
 
-  mTree.forEachNode([&](SceneNode& node) {
-    buildUniformBufferReplacement(node, mUboBuilder);
-  });
+  for (auto* node : mVisible)
+    buildUniformBufferReplacement(*node, mUboBuilder);
+
+  mUboBuilder.submit();
 }
 
 void SceneState::draw() {
-  mUboBuilder.submit();
+  // ImGui and others also draw with GL between our frames.
+  mStateTracker.reset();
+  mStateTracker.resetStats();
 
   u32 i = 0;
-  mTree.forEachNode(
-      [&](SceneNode& node) { drawReplacement(node, mUboBuilder, i++); });
+  for (auto* node : mVisible)
+    drawReplacement(*node, mUboBuilder, i++, mStateTracker);
 
   glBindVertexArray(0);
   glUseProgram(0);
@@ -1,10 +1,14 @@
 #pragma once
 
-#include <core/3d/renderer/GlTexture.hpp> // GlTexture
-#include <core/3d/renderer/SceneTree.hpp> // SceneBuffers
-#include <librii/glhelper/UBOBuilder.hpp> // DelegatedUBOBuilder
-#include <librii/glhelper/VBOBuilder.hpp> // VBOBuilder
-#include <librii/math/aabb.hpp>           // AABB
+#include <core/3d/renderer/GlStateTracker.hpp> // GlStateTracker
+#include <core/3d/renderer/GlTexture.hpp>      // GlTexture
+#include <core/3d/renderer/SceneTree.hpp>      // SceneBuffers
+#include <librii/glhelper/UBOBuilder.hpp>      // DelegatedUBOBuilder
+#include <librii/glhelper/VBOBuilder.hpp>      // VBOBuilder
+#include <librii/math/aabb.hpp>                // AABB
+#include <librii/math/bvh.hpp>                 // BVH
+#include <librii/math/frustum.hpp>             // Frustum
+#include <unordered_set>                       // std::unordered_set
 
 namespace riistudio::lib3d {
 
@@ -16,22 +20,99 @@ public:
   // Compute the composite bounding box (in model space)
   librii::math::AABB computeBounds();
 
-  // Build the UBO. Typically called every frame.
+  struct CullSettings {
+    bool frustum = true;
+    // Skip draws whose bounding sphere is smaller than this fraction of their
+    // distance to the eye. 0 disables small feature culling.
+    float min_feature_ratio = 0.0f;
+  };
+
+  // Select the nodes to draw this frame and sort them by MakeSortKey().
+  // `view_proj` is the combined projection * view matrix, `eye` the camera
+  // position.
+  void cull(const glm::mat4& view_proj, const glm::vec3& eye,
+            const CullSettings& settings);
+
+  // Build and upload the UBO. Typically called every frame; does nothing if
+  // no uniform data changed since the last call.
   void buildUniformBuffers();
 
   // Draw the model to the screen. You'll want to clear it first.
   void draw();
 
+  // Bind and state change counts of the last draw() call.
+  const GlStateTracker::Stats& getDrawStats() const {
+    return mStateTracker.getStats();
+  }
+  // Uniform bytes uploaded by the last buildUniformBuffers() that did work.
+  const librii::glhelper::DelegatedUBOBuilder::Stats& getUniformStats() const {
+    return mUboBuilder.getStats();
+  }
+
   // Direct access to attached renderables.
   SceneBuffers& getBuffers() { return mTree; }
 
+  // Drop the retained draw list. The next IDrawable::prepare() rebuilds it.
   void invalidate() {
     mTree.opaque.nodes.clear();
     mTree.translucent.nodes.clear();
+    mNeedsRebuild = true;
+    mUniformsDirty = true;
+    mBvhDirty = true;
+    mVisible.clear();
+    mCulled = false;
   }
 
+  // Report an object written since the last prepare(), by its kpi::EditKey().
+  // Only the draws depending on it are rebuilt.
+  void markEdited(const void* key) { mEdited.insert(key); }
+  const std::unordered_set<const void*>& getEdited() const { return mEdited; }
+
+  // Does the draw list need to be rebuilt from the document?
+  bool needsRebuild() const { return mNeedsRebuild; }
+  // Called by the drawable once the draw list has been rebuilt.
+  void markRebuilt() {
+    mNeedsRebuild = false;
+    mEdited.clear();
+  }
+  // Called by the drawable after replacing some of the retained draws.
+  void markDrawsChanged() {
+    mEdited.clear();
+    mUniformsDirty = true;
+    mBvhDirty = true;
+    mVisible.clear();
+    mCulled = false;
+  }
+  // Called when the uniform data of retained nodes was patched in place.
+  void markUniformsDirty() { mUniformsDirty = true; }
+
+  // Bounds of the nodes of a pass, for culling
+  struct CullHierarchy {
+    librii::math::BVH bvh;
+    // DrawBuffer::nodes index of each box of `bvh`
+    std::vector<u32> bounded;
+    // Nodes without a bound, which are always drawn
+    std::vector<u32> unbounded;
+  };
+
 private:
   SceneBuffers mTree;
+  bool mNeedsRebuild = true;
+  std::unordered_set<const void*> mEdited;
+  bool mUniformsDirty = true;
+
+  // One hierarchy per pass
+  CullHierarchy mOpaqueBvh;
+  CullHierarchy mTranslucentBvh;
+  bool mBvhDirty = true;
+
+  // Nodes drawn this frame, in draw order
+  std::vector<SceneNode*> mVisible;
+  bool mCulled = false;
+  // Reused by the sort
+  std::vector<std::pair<u64, SceneNode*>> mSortKeys, mSortScratch;
+
+  GlStateTracker mStateTracker;
 
   librii::glhelper::DelegatedUBOBuilder mUboBuilder;
 };
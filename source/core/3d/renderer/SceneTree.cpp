@@ -8,7 +8,9 @@
 #include <librii/glhelper/UBOBuilder.hpp>
 #include <plugins/gc/Export/Scene.hpp>
 
+#include "GlStateTracker.hpp"
 #include "SceneState.hpp"
+#include <bit>
 
 namespace riistudio::lib3d {
 
@@ -24,15 +26,55 @@ void useTexObj(const TextureObj& obj) {
 
 void drawReplacement(const SceneNode& node,
                      librii::glhelper::DelegatedUBOBuilder& ubo_builder,
-                     u32 draw_index) {
-  librii::gl::setGlState(node.mega_state);
-  glUseProgram(node.shader_id);
-  glBindVertexArray(node.vao_id);
+                     u32 draw_index, GlStateTracker& state) {
+  if (state.setMegaState(node.mega_state))
+    librii::gl::setGlState(node.mega_state);
+  if (state.setProgram(node.shader_id))
+    glUseProgram(node.shader_id);
+  if (state.setVertexArray(node.vao_id))
+    glBindVertexArray(node.vao_id);
   ubo_builder.use(draw_index);
-  for (auto& obj : node.texture_objects)
-    useTexObj(obj);
+  for (auto& obj : node.texture_objects) {
+    if (state.setTexture(obj))
+      useTexObj(obj);
+  }
+  state.onDraw();
   glDrawElements(node.glBeginMode, node.vertex_count, node.glVertexDataType,
                  node.indices);
 }
 
+// FNV-1a, folded to 16 bits
+static u16 HashWords(const u32* words, std::size_t count) {
+  u32 hash = 2166136261u;
+  for (std::size_t i = 0; i < count; ++i) {
+    hash ^= words[i];
+    hash *= 16777619u;
+  }
+  return static_cast<u16>(hash ^ (hash >> 16));
+}
+
+u64 MakeSortKey(const SceneNode& node, bool translucent, float depth) {
+  static_assert(sizeof(TextureObj) % sizeof(u32) == 0);
+  static_assert(sizeof(librii::gfx::MegaState) % sizeof(u32) == 0);
+
+  const u64 program = static_cast<u16>(node.shader_id);
+  const u64 textures =
+      HashWords(reinterpret_cast<const u32*>(node.texture_objects.data()),
+                node.texture_objects.size() * sizeof(TextureObj) / 4);
+  const u64 mega_state =
+      HashWords(reinterpret_cast<const u32*>(&node.mega_state),
+                sizeof(node.mega_state) / 4);
+  // For non-negative floats, the bit pattern orders like the value.
+  const u64 depth_bits =
+      std::bit_cast<u32>(std::max(depth, 0.0f)) & 0x7FFF'FFFF;
+
+  if (translucent) {
+    return (u64(1) << 63) | ((~depth_bits & 0x7FFF'FFFF) << 32) |
+           (program << 16) | textures;
+  }
+
+  return (program << 47) | (mega_state << 31) | (textures << 15) |
+         (depth_bits >> 16);
+}
+
 } // namespace riistudio::lib3d
@@ -23,6 +23,8 @@ struct TextureObj {
   u32 glMagFilter;
   u32 glWrapU;
   u32 glWrapV;
+
+  bool operator==(const TextureObj&) const = default;
 };
 
 void useTexObj(const TextureObj& obj);
@@ -50,6 +52,8 @@ struct SceneNode {
   // Note: Model-space
   // virtual void expandBound(librii::math::AABB& bound) = 0;
   librii::math::AABB bound;
+  // Whether `bound` holds the node. Nodes without one are never culled.
+  bool has_bound = false;
 
   struct UniformData {
     //! Binding pointer to insert the data at
@@ -77,9 +81,22 @@ struct SceneNode {
   // buildUniformBuffer(librii::glhelper::DelegatedUBOBuilder& ubo_builder) = 0;
 };
 
+class GlStateTracker;
+
+// Issue the draw, skipping state already set according to `state`.
 void drawReplacement(const SceneNode& node,
                      librii::glhelper::DelegatedUBOBuilder& ubo_builder,
-                     u32 draw_index);
+                     u32 draw_index, GlStateTracker& state);
+
+// Packed 64-bit key ordering draws to minimize state changes.
+//
+// Opaque:      [63] 0 | [62:47] program | [46:31] mega state | [30:15] textures
+//              | [14:0] depth, front to back
+// Translucent: [63] 1 | [62:32] depth, back to front | [31:16] program
+//              | [15:0] textures
+//
+// `depth` is the (non-negative) distance from the eye to the node.
+u64 MakeSortKey(const SceneNode& node, bool translucent, float depth);
 
 inline void buildUniformBufferReplacement(
     SceneNode& node, librii::glhelper::DelegatedUBOBuilder& ubo_builder) {
@@ -88,12 +105,8 @@ inline void buildUniformBufferReplacement(
   }
 
   for (auto& command : node.uniform_data) {
-    // TODO: Remove this bloat
-    static std::vector<u8> scratch;
-    scratch.resize(command.raw_data.size());
-    memcpy(scratch.data(), command.raw_data.data(), scratch.size());
-
-    ubo_builder.push(command.binding_point, scratch);
+    ubo_builder.push(command.binding_point,
+                     {command.raw_data.data(), command.raw_data.size()});
   }
 }
 
@@ -74,8 +74,9 @@ std::vector<std::string> GetChildrenOfType(const std::string& type) {
   const auto hnd = kpi::ReflectionMesh::getInstance()->lookupInfo(type);
 
   for (int i = 0; i < hnd.getNumChildren(); ++i) {
-    out.push_back(hnd.getChild(i).getName());
-    for (const auto& str : GetChildrenOfType(hnd.getChild(i).getName()))
+    const std::string child(hnd.getChild(i).getName());
+    out.push_back(child);
+    for (const auto& str : GetChildrenOfType(child))
       out.push_back(str);
   }
   return out;
@@ -36,6 +36,9 @@ public:
   void redo() { mHistory.redo(*mState.get()); }
   //! Get the number of commits past the original state.
   std::size_t cursor() const { return mHistory.cursor(); }
+  //! Get a counter that changes whenever the document is committed or rolled
+  //! back.
+  std::size_t revision() const { return mHistory.revision(); }
   //! Get the total number of commits stored. With calls to `undo`, this may be
   //! greater than `cursor()`.
   std::size_t size() const { return mHistory.size(); }
@@ -1,20 +1,39 @@
 #pragma once
 
 #include "Memento.hpp"
+#include <map>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace kpi {
 
+//! Identifies an object to History::markEdited() however it is referred to:
+//! the address of the most derived object.
+template <typename T> const void* EditKey(const T& obj) {
+  if constexpr (std::is_polymorphic_v<T>)
+    return dynamic_cast<const void*>(&obj);
+  else
+    return &obj;
+}
+
 class History {
 public:
   void commit(const IMementoOriginator& doc) {
+    ++mUntrackedRevision;
+    mEdits.clear();
+    commitMarked(doc);
+  }
+  //! Commit writes that were all reported with markEdited(). Views that
+  //! previewed them need not refresh anything else.
+  void commitMarked(const IMementoOriginator& doc) {
     if (history_cursor >= 0)
       root_history.erase(root_history.begin() + history_cursor + 1,
                          root_history.end());
     root_history.push_back(setNext(
         doc, root_history.empty() ? nullptr : root_history.back().get()));
     ++history_cursor;
+    ++mRevision;
     onCommit(doc);
   }
   void undo(IMementoOriginator& doc) {
@@ -31,6 +50,25 @@ public:
   }
   std::size_t cursor() const { return history_cursor; }
   std::size_t size() const { return root_history.size(); }
+  //! Incremented whenever the document changes through this history (commit,
+  //! undo or redo). Views may compare it to know when cached data is stale.
+  std::size_t revision() const { return mRevision; }
+  //! Incremented by changes not reported with markEdited(): undo, redo and
+  //! plain commits. Views must then refresh everything.
+  std::size_t untrackedRevision() const { return mUntrackedRevision; }
+
+  //! Report a write to `obj`, committed or not, e.g. while a slider is held.
+  template <typename T> void markEdited(const T& obj) {
+    mEdits[EditKey(obj)] = ++mEditSerial;
+  }
+  //! Serial of the last markEdited(); pass it to forEachEditSince() later.
+  u64 editSerial() const { return mEditSerial; }
+  //! Calls `f(key)` with the EditKey() of each object marked after `serial`.
+  template <typename F> void forEachEditSince(u64 serial, F f) const {
+    for (const auto& [key, edit_serial] : mEdits)
+      if (edit_serial > serial)
+        f(key);
+  }
 
   struct Observer {
     virtual ~Observer() = default;
@@ -47,6 +85,12 @@ private:
   // We don't ever expose history to anyone -- only the current document
   std::vector<std::shared_ptr<const IMemento>> root_history;
   signed history_cursor = -1;
+  std::size_t mRevision = 0;
+  std::size_t mUntrackedRevision = 0;
+  // Objects marked since the last untracked change -> serial of their last
+  // edit. Cleared by untracked changes, which may free the objects.
+  std::map<const void*, u64> mEdits;
+  u64 mEditSerial = 0;
   std::set<Observer*> mObservers;
 
   void onCommit(const IMementoOriginator& doc) {
@@ -54,6 +98,9 @@ private:
       observer->onCommit();
   }
   void onRollback(IMementoOriginator& doc) {
+    ++mRevision;
+    ++mUntrackedRevision;
+    mEdits.clear();
     for (auto& observer : mObservers)
       observer->beforeRollback();
     rollback(doc, *root_history[history_cursor].get());
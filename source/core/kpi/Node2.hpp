@@ -441,6 +441,9 @@ void nextFolder(OutT& out, const InT& in, const OldT* old) {
     for (int i = 0; i < in.size(); ++i) {
       if (i < last.size() && should_set(last[i].get(), &in[i])) {
         out[i] = set_m<record_t>(last[i].get(), in[i]);
+      } else if (i < last.size()) {
+        // Unchanged: share the immutable record with the previous state
+        out[i] = last[i];
       } else {
         out[i] = std::make_shared<const record_t>(in[i]);
       }
@@ -41,7 +41,8 @@ public:
   void postUpdate() { bCommitPosted = true; }
   void consumeUpdate(kpi::History& history, kpi::INode& doc) {
     assert(bCommitPosted);
-    history.commit(doc);
+    // Posted by PropertyDelegate::property(), which marks what it writes
+    history.commitMarked(doc);
     bCommitPosted = false;
   }
   void handleUpdates(kpi::History& history, kpi::INode& doc) {
@@ -60,7 +61,10 @@ public:
   void commit(const char* changeName) {
     ((void)changeName);
 
-    mHistory.commit(mTransientRoot);
+    // Views write to the affected objects directly before committing.
+    for (T* it : mAffected)
+      mHistory.markEdited(*it);
+    mHistory.commitMarked(mTransientRoot);
   }
 
   template <typename U, typename TGet, typename TSet>
@@ -71,6 +75,8 @@ public:
     for (T* it : mAffected) {
       if (!(get(*it) == after)) {
         set(*it, after);
+        // Lets the viewport preview the write before it is committed
+        mHistory.markEdited(*it);
       }
     }
 
@@ -6,7 +6,7 @@ namespace kpi {
 ReflectionMesh ReflectionMesh::sInstance;
 
 struct DataMeshImpl : public kpi::DataMesh {
-  kpi::InternalClassMirror* get(const std::string& id) override {
+  kpi::InternalClassMirror* get(std::string_view id) override {
     const auto found = mClasses.find(id);
     if (found == mClasses.end())
       return nullptr;
@@ -43,11 +43,19 @@ struct DataMeshImpl : public kpi::DataMesh {
           {std::string(cmd.base), cmd.translation});
       mToInsert.pop();
     }
+
+    // The hierarchy is frozen from here on: link parents directly so casts
+    // walk pointers instead of looking up type names.
+    for (auto& [id, mirror] : mClasses) {
+      for (auto& parent : mirror.mParents)
+        parent.mirror = get(parent.parent);
+    }
   }
 
 private:
   // File states and interfaces -- hierarchy.
-  std::map<std::string, kpi::InternalClassMirror> mClasses;
+  // std::map never relocates its nodes, so cached mirror pointers stay valid.
+  std::map<std::string, kpi::InternalClassMirror, std::less<>> mClasses;
   std::queue<kpi::MirrorEntry> mToInsert;
 };
 
@@ -55,26 +63,29 @@ ReflectionMesh::ReflectionMesh()
     : mDataMesh(std::make_unique<DataMeshImpl>()) {}
 
 ReflectionMesh::ReflectionInfoHandle
-ReflectionMesh::lookupInfo(std::string info) {
+ReflectionMesh::lookupInfo(std::string_view info) {
   return ReflectionInfoHandle(&getDataMesh(), info);
 }
-void ReflectionMesh::findParentOfType(std::vector<void*>& out, void* in,
-                                      const std::string& info,
-                                      const std::string& key) {
-  auto hnd = ReflectionInfoHandle(&getDataMesh(), info);
-
+static void FindParentOfType(std::vector<void*>& out, char* in,
+                             const ReflectionMesh::ReflectionInfoHandle& hnd,
+                             std::string_view key) {
   for (int i = 0; i < hnd.getNumParents(); ++i) {
     auto parent = hnd.getParent(i);
     assert(hnd.getName() != parent.getName());
+    char* new_ = in + hnd.getTranslationForParent(i);
     if (parent.getName() == key) {
-      char* new_ = reinterpret_cast<char*>(in) + hnd.getTranslationForParent(i);
       if (std::find(out.begin(), out.end(), (void*)new_) == out.end())
         out.push_back(new_);
     } else
-      findParentOfType(
-          out, reinterpret_cast<char*>(in) + hnd.getTranslationForParent(i),
-          parent.getName(), key);
+      FindParentOfType(out, new_, parent, key);
   }
 }
 
+void ReflectionMesh::findParentOfType(std::vector<void*>& out, void* in,
+                                      std::string_view info,
+                                      std::string_view key) {
+  FindParentOfType(out, reinterpret_cast<char*>(in),
+                   ReflectionInfoHandle(&getDataMesh(), info), key);
+}
+
 } // namespace kpi
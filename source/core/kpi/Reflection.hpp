@@ -37,6 +37,8 @@ struct InternalClassMirror {
   struct Entry {
     const std::string parent;
     int translation;
+    //! Resolved by DataMesh::compute(); avoids a name lookup per cast.
+    InternalClassMirror* mirror = nullptr;
 
     void* cast(void* base) const { return (char*)base + translation; }
   };
@@ -46,7 +48,7 @@ struct InternalClassMirror {
 
 struct DataMesh {
   virtual ~DataMesh() = default;
-  virtual kpi::InternalClassMirror* get(const std::string& id) = 0;
+  virtual kpi::InternalClassMirror* get(std::string_view id) = 0;
   virtual void declare(const std::string& id, kpi::RichName name) = 0;
   virtual void enqueueHierarchy(kpi::MirrorEntry entry) = 0;
   virtual void compute() = 0;
@@ -68,7 +70,7 @@ public:
     bool valid() const { return mMirror != nullptr && mMesh != nullptr; }
     operator bool() const { return valid(); }
 
-    std::string getName() const {
+    std::string_view getName() const {
       if (!valid())
         return "";
       return mMirror->derived;
@@ -81,7 +83,10 @@ public:
     ReflectionInfoHandle getParent(int index) const {
       if (!valid() || index > mMirror->mParents.size())
         return {};
-      return ReflectionInfoHandle(mMesh, mMirror->mParents[index].parent);
+      const auto& entry = mMirror->mParents[index];
+      if (entry.mirror != nullptr)
+        return ReflectionInfoHandle(entry.mirror, mMesh);
+      return ReflectionInfoHandle(mMesh, entry.parent);
     }
     int getNumChildren() const {
       if (!valid())
@@ -111,7 +116,7 @@ public:
     }
 
   public:
-    ReflectionInfoHandle(DataMesh* mesh, const std::string& id) {
+    ReflectionInfoHandle(DataMesh* mesh, std::string_view id) {
       auto* info = mesh->get(id);
       if (info == nullptr) {
         // DebugReport("Type %s has no info...\n", id.c_str());
@@ -130,16 +135,14 @@ public:
         : mMesh(mesh), mMirror(mirror) {}
   };
 
-  virtual ReflectionInfoHandle lookupInfo(std::string info);
+  virtual ReflectionInfoHandle lookupInfo(std::string_view info);
   virtual void findParentOfType(std::vector<void*>& out, void* in,
-                                const std::string& info,
-                                const std::string& key);
+                                std::string_view info, std::string_view key);
 
   template <typename TDst, typename TDynamic>
   inline std::vector<TDst*> findParentOfType(TDynamic&& type) {
     std::vector<void*> out;
-    findParentOfType(out, type.mBase, std::string(type.mType),
-                     std::string(TDst::TypeInfo.namespacedId));
+    findParentOfType(out, type.mBase, type.mType, TDst::TypeInfo.namespacedId);
 
     std::vector<TDst*> dst;
     for (void* e : out)
@@ -4,6 +4,8 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <typeindex>
+#include <unordered_map>
 #include <vector>
 
 namespace kpi {
@@ -15,12 +17,20 @@ class RichNameManager {
     template <bool addS> struct Component {
       std::string sg, pl;
 
-      std::string getSingular() const { return !sg.empty() ? sg : "?"; }
-      std::string getPlural() const {
+      const std::string& getSingular() const { return singular; }
+      const std::string& getPlural() const { return plural; }
+
+      // Names are queried every frame: build them once at registration.
+      void resolve() {
+        singular = !sg.empty() ? sg : "?";
         if (pl.empty() && sg.empty())
-          return "?";
-        return pl.empty() ? (addS ? sg + "s" : sg) : pl;
+          plural = "?";
+        else
+          plural = pl.empty() ? (addS ? sg + "s" : sg) : pl;
       }
+
+    private:
+      std::string singular = "?", plural = "?";
     };
     Component<false> icon;
     Component<true> name;
@@ -54,29 +64,33 @@ public:
       entry->icon.pl = icon_pl;
     if (!name_pl.empty())
       entry->name.pl = name_pl;
+    entry->icon.resolve();
+    entry->name.resolve();
     mEntries.push_back(std::move(entry));
+    mCache.clear();
     return *this;
   }
 
   struct EntryDelegate {
-    std::string getIconSingular() const {
-      return entry != nullptr ? entry->icon.getSingular() : "?";
+    const std::string& getIconSingular() const {
+      return entry != nullptr ? entry->icon.getSingular() : sUnknown;
     }
-    std::string getIconPlural() const {
-      return entry != nullptr ? entry->icon.getPlural() : "?";
+    const std::string& getIconPlural() const {
+      return entry != nullptr ? entry->icon.getPlural() : sUnknown;
     }
 
-    std::string getNameSingular() const {
-      return entry != nullptr ? entry->name.getSingular() : "?";
+    const std::string& getNameSingular() const {
+      return entry != nullptr ? entry->name.getSingular() : sUnknown;
     }
-    std::string getNamePlural() const {
-      return entry != nullptr ? entry->name.getPlural() : "?";
+    const std::string& getNamePlural() const {
+      return entry != nullptr ? entry->name.getPlural() : sUnknown;
     }
 
     bool hasEntry() const { return entry != nullptr; }
 
   private:
     const IEntry* entry = nullptr;
+    static inline const std::string sUnknown = "?";
 
   public:
     EntryDelegate(const IEntry* _entry) : entry(_entry) {}
@@ -89,13 +103,25 @@ public:
 
 private:
   inline const IEntry* getEntry(const IObject* node) const {
+    if (node == nullptr)
+      return nullptr;
+
+    // The matching entry only depends on the dynamic type of the node, so the
+    // linear dynamic_cast search runs once per type rather than once per call.
+    const std::type_index type = typeid(*node);
+    if (const auto cached = mCache.find(type); cached != mCache.end())
+      return cached->second;
+
     const auto found =
         std::find_if(mEntries.begin(), mEntries.end(),
                      [&](const auto& x) { return x->isInDomain(node); });
-    return found == mEntries.end() ? nullptr : found->get();
+    const IEntry* entry = found == mEntries.end() ? nullptr : found->get();
+    mCache.emplace(type, entry);
+    return entry;
   }
 
   std::vector<std::unique_ptr<IEntry>> mEntries;
+  mutable std::unordered_map<std::type_index, const IEntry*> mCache;
 };
 
 } // namespace kpi
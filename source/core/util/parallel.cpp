@@ -0,0 +1,135 @@
+#include "parallel.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace riistudio::util {
+
+namespace {
+
+// Threads ParallelFor may use on this thread, counting it
+thread_local u32 tMaxThreads = std::numeric_limits<u32>::max();
+
+class WorkerPool {
+public:
+  explicit WorkerPool(u32 num_workers) {
+    for (u32 i = 0; i < num_workers; ++i)
+      mWorkers.emplace_back([this] { work(); });
+  }
+  ~WorkerPool() {
+    {
+      std::unique_lock lock(mMutex);
+      mStop = true;
+    }
+    mWake.notify_all();
+    for (auto& worker : mWorkers)
+      worker.join();
+  }
+
+  // Runs `task` over [0, count) on the caller and up to `max_helpers` workers
+  void run(u32 count, const std::function<void(u32)>& task, u32 max_helpers) {
+    Job job{.task = task, .count = count, .max_helpers = max_helpers};
+    std::unique_lock lock(mMutex);
+    mJobs.push_back(&job);
+    mWake.notify_all();
+    while (job.next < job.count)
+      runOne(job, lock);
+    mDone.wait(lock, [&] { return job.finished(); });
+  }
+
+private:
+  struct Job {
+    const std::function<void(u32)>& task;
+    u32 count;
+    u32 max_helpers;
+    // Guarded by mMutex
+    u32 next = 0;
+    u32 done = 0;
+    u32 helpers = 0;
+
+    // Once true, no worker touches the job again and its owner may return.
+    bool finished() const { return done == count && helpers == 0; }
+  };
+
+  // Claims and runs an index of `job`. Called with `lock` held; the job is
+  // only touched under it.
+  void runOne(Job& job, std::unique_lock<std::mutex>& lock) {
+    const u32 i = job.next++;
+    if (job.next == job.count)
+      mJobs.erase(std::find(mJobs.begin(), mJobs.end(), &job));
+    lock.unlock();
+    job.task(i);
+    lock.lock();
+    if (++job.done == job.count)
+      mDone.notify_all();
+  }
+
+  // A job that still has indices and room for another worker
+  Job* findJob() {
+    for (Job* job : mJobs) {
+      if (job->helpers < job->max_helpers)
+        return job;
+    }
+    return nullptr;
+  }
+
+  void work() {
+    // Tasks that call ParallelFor themselves run it serially, as the workers
+    // they would wait on may all be busy.
+    tMaxThreads = 1;
+    std::unique_lock lock(mMutex);
+    while (true) {
+      Job* job = nullptr;
+      mWake.wait(lock, [&] { return mStop || (job = findJob()) != nullptr; });
+      if (mStop)
+        return;
+      ++job->helpers;
+      while (job->next < job->count)
+        runOne(*job, lock);
+      if (--job->helpers == 0 && job->finished())
+        mDone.notify_all();
+    }
+  }
+
+  std::mutex mMutex;
+  std::condition_variable mWake;
+  std::condition_variable mDone;
+  std::deque<Job*> mJobs;
+  bool mStop = false;
+  std::vector<std::thread> mWorkers;
+};
+
+u32 NumWorkers() {
+  const u32 num_cores = std::thread::hardware_concurrency();
+  // With two cores or fewer, the caller is better off alone.
+  return num_cores > 2 ? num_cores - 1 : 0;
+}
+
+} // namespace
+
+ParallelLimit::ParallelLimit(u32 num_threads) : mPrevious(tMaxThreads) {
+  tMaxThreads = std::min(tMaxThreads, std::max(num_threads, 1u));
+}
+ParallelLimit::~ParallelLimit() { tMaxThreads = mPrevious; }
+
+void ParallelFor(u32 count, const std::function<void(u32)>& task,
+                 bool parallel) {
+  static const u32 num_workers = NumWorkers();
+  const u32 max_helpers = std::min(num_workers, tMaxThreads - 1);
+  if (!parallel || count <= 1 || max_helpers == 0) {
+    for (u32 i = 0; i < count; ++i)
+      task(i);
+    return;
+  }
+
+  static WorkerPool pool(num_workers);
+  // Tasks run by the caller must not wait on the workers either.
+  ParallelLimit nested(1);
+  pool.run(count, task, max_helpers);
+}
+
+} // namespace riistudio::util
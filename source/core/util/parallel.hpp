@@ -0,0 +1,38 @@
+#pragma once
+
+#include <core/common.h>
+#include <functional>
+
+namespace riistudio::util {
+
+// Below this many bytes, a section decodes faster on one thread than it takes
+// to hand it to the workers.
+constexpr u32 MinParallelDecodeBytes = 64 * 1024;
+
+// Limits ParallelFor calls made on this thread to `num_threads` threads,
+// counting the caller, while in scope. 1 makes them serial: e.g. in batch
+// jobs, which already run one per core.
+class ParallelLimit {
+public:
+  explicit ParallelLimit(u32 num_threads);
+  ~ParallelLimit();
+
+  ParallelLimit(const ParallelLimit&) = delete;
+  ParallelLimit& operator=(const ParallelLimit&) = delete;
+
+private:
+  u32 mPrevious;
+};
+
+// Calls `task(i)` for every i in [0, count), returning once all calls are
+// done. The calls are shared between the caller and a set of worker threads,
+// one per core less one, created on first use and asleep while idle. Calls
+// may run in any order, so each must only write state of its own index.
+//
+// Runs serially when `parallel` is false -- callers pass whether the work is
+// worth handing out -- on machines with two cores or fewer, and when called
+// from within another ParallelFor.
+void ParallelFor(u32 count, const std::function<void(u32)>& task,
+                 bool parallel = true);
+
+} // namespace riistudio::util
@@ -0,0 +1,169 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+
+namespace riistudio::util {
+
+namespace {
+
+// Per thread. At a dozen events per frame, this holds ~20s of frames.
+constexpr u64 RingSize = 1 << 14;
+
+// Only the owning thread writes. Fields are atomic so a concurrent snapshot
+// is well-defined; torn events are detected through the head index instead.
+struct Ring {
+  struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<u64> begin_ns{0};
+    std::atomic<u64> end_ns{0};
+  };
+  std::array<Slot, RingSize> slots;
+  // Number of events ever written
+  std::atomic<u64> head{0};
+  u32 thread_id = 0;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // Rings outlive their threads, so short-lived workers still show up.
+  std::vector<std::unique_ptr<Ring>> rings;
+};
+
+Registry& GetRegistry() {
+  static Registry sRegistry;
+  return sRegistry;
+}
+
+const auto sEpoch = std::chrono::steady_clock::now();
+
+Ring& GetThreadRing() {
+  // Registration locks once per thread; recording never does.
+  thread_local Ring* tRing = [] {
+    auto& registry = GetRegistry();
+    std::scoped_lock lock(registry.mutex);
+    auto& ring = registry.rings.emplace_back(std::make_unique<Ring>());
+    ring->thread_id = static_cast<u32>(registry.rings.size() - 1);
+    return ring.get();
+  }();
+  return *tRing;
+}
+
+} // namespace
+
+u64 ProfilerNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - sEpoch)
+      .count();
+}
+
+void ProfilerRecord(const char* name, u64 begin_ns, u64 end_ns) {
+  auto& ring = GetThreadRing();
+  const u64 head = ring.head.load(std::memory_order_relaxed);
+  auto& slot = ring.slots[head % RingSize];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+  slot.end_ns.store(end_ns, std::memory_order_relaxed);
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<ProfileThread> ProfilerCollect(double seconds) {
+  const u64 now = ProfilerNow();
+  const u64 window = static_cast<u64>(seconds * 1e9);
+  const u64 since = now > window ? now - window : 0;
+
+  std::vector<ProfileThread> result;
+  auto& registry = GetRegistry();
+  std::scoped_lock lock(registry.mutex);
+  for (const auto& ring : registry.rings) {
+    ProfileThread thread{.thread_id = ring->thread_id};
+
+    const u64 head = ring->head.load(std::memory_order_acquire);
+    const u64 first = head > RingSize ? head - RingSize : 0;
+    for (u64 i = first; i < head; ++i) {
+      const auto& slot = ring->slots[i % RingSize];
+      thread.events.push_back(
+          {.name = slot.name.load(std::memory_order_relaxed),
+           .begin_ns = slot.begin_ns.load(std::memory_order_relaxed),
+           .end_ns = slot.end_ns.load(std::memory_order_relaxed)});
+    }
+
+    // Drop whatever the owner overwrote while we were copying. It may also be
+    // writing event `new_head`, whose slot is that of `new_head - RingSize`.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const u64 new_head = ring->head.load(std::memory_order_relaxed);
+    const u64 valid = new_head + 1 > RingSize ? new_head + 1 - RingSize : 0;
+    if (valid > first) {
+      const u64 torn = std::min(valid - first, head - first);
+      thread.events.erase(thread.events.begin(),
+                          thread.events.begin() + torn);
+    }
+
+    std::erase_if(thread.events, [&](const ProfileEvent& e) {
+      return e.end_ns < since;
+    });
+    if (!thread.events.empty())
+      result.push_back(std::move(thread));
+  }
+  return result;
+}
+
+std::vector<ProfileStat> ProfilerStats(double seconds) {
+  // Names are literals, but the same literal may have several addresses.
+  std::vector<std::pair<const char*, float>> samples;
+  for (const auto& thread : ProfilerCollect(seconds)) {
+    for (const auto& e : thread.events)
+      samples.emplace_back(e.name, (e.end_ns - e.begin_ns) / 1e6f);
+  }
+  std::sort(samples.begin(), samples.end(), [](auto& l, auto& r) {
+    const int cmp = std::strcmp(l.first, r.first);
+    return cmp != 0 ? cmp < 0 : l.second < r.second;
+  });
+
+  std::vector<ProfileStat> stats;
+  for (std::size_t begin = 0; begin < samples.size();) {
+    std::size_t end = begin + 1;
+    while (end < samples.size() &&
+           std::strcmp(samples[end].first, samples[begin].first) == 0)
+      ++end;
+
+    const std::size_t count = end - begin;
+    auto percentile = [&](float p) {
+      const auto rank = static_cast<std::size_t>(p * (count - 1) + 0.5f);
+      return samples[begin + rank].second;
+    };
+    stats.push_back({.name = samples[begin].first,
+                     .count = static_cast<u32>(count),
+                     .p50 = percentile(0.50f),
+                     .p90 = percentile(0.90f),
+                     .p99 = percentile(0.99f),
+                     .max = samples[end - 1].second});
+    begin = end;
+  }
+  return stats;
+}
+
+std::string ProfilerChromeTrace(double seconds) {
+  nlohmann::json events = nlohmann::json::array();
+  for (const auto& thread : ProfilerCollect(seconds)) {
+    for (const auto& e : thread.events) {
+      // Complete events; timestamps are in microseconds.
+      events.push_back({{"name", e.name},
+                        {"ph", "X"},
+                        {"ts", e.begin_ns / 1000.0},
+                        {"dur", (e.end_ns - e.begin_ns) / 1000.0},
+                        {"pid", 0},
+                        {"tid", thread.thread_id}});
+    }
+  }
+  nlohmann::json trace = {{"traceEvents", std::move(events)},
+                          {"displayTimeUnit", "ms"}};
+  return trace.dump();
+}
+
+} // namespace riistudio::util
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <core/common.h>
+#include <string>
+#include <vector>
+
+namespace riistudio::util {
+
+// Scoped CPU timers for profiling editing sessions.
+//
+// Every thread records into its own fixed-size ring buffer, so recording
+// takes no locks and old events are overwritten. Readers take snapshots of
+// all threads' rings; events overwritten while being copied are discarded.
+//
+// Names must be string literals (or otherwise outlive the profiler).
+
+struct ProfileEvent {
+  const char* name;
+  // Nanoseconds since the profiler started
+  u64 begin_ns;
+  u64 end_ns;
+};
+
+struct ProfileThread {
+  u32 thread_id = 0;
+  std::vector<ProfileEvent> events{}; // In order of completion
+};
+
+// Current time on the profiler's clock
+u64 ProfilerNow();
+
+void ProfilerRecord(const char* name, u64 begin_ns, u64 end_ns);
+
+class ProfileScope {
+public:
+  explicit ProfileScope(const char* name)
+      : mName(name), mBegin(ProfilerNow()) {}
+  ~ProfileScope() { ProfilerRecord(mName, mBegin, ProfilerNow()); }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+  const char* mName;
+  u64 mBegin;
+};
+
+#define RII_PROFILE_SCOPE_(name, line)                                         \
+  ::riistudio::util::ProfileScope _rii_profile_##line(name)
+#define RII_PROFILE_SCOPE__(name, line) RII_PROFILE_SCOPE_(name, line)
+// Time the rest of the enclosing scope
+#define RII_PROFILE_SCOPE(name) RII_PROFILE_SCOPE__(name, __LINE__)
+
+// Events of every thread that ended within the last `seconds`
+std::vector<ProfileThread> ProfilerCollect(double seconds);
+
+struct ProfileStat {
+  const char* name;
+  u32 count;
+  // Milliseconds
+  float p50, p90, p99, max;
+};
+
+// Duration percentiles per name over the last `seconds`, sorted by name
+std::vector<ProfileStat> ProfilerStats(double seconds);
+
+// The last `seconds` as Chrome trace event JSON (chrome://tracing, Perfetto)
+std::string ProfilerChromeTrace(double seconds);
+
+} // namespace riistudio::util
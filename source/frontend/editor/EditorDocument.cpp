@@ -1,5 +1,6 @@
 #include "EditorDocument.hpp"
 #include <core/api.hpp>                    // SpawnExporter
+#include <core/util/profiler.hpp>          // RII_PROFILE_SCOPE
 #include <oishii/reader/binary_reader.hxx> // oishii::BinaryReader
 #include <oishii/writer/binary_writer.hxx> // oishii::Writer
 #include <plate/Platform.hpp>              // plate::Platform
@@ -7,11 +8,7 @@
 namespace riistudio::frontend {
 
 EditorDocument::EditorDocument(FileData&& data) {
-  // TODO: Not ideal..
-  std::vector<u8> vec(data.mLen);
-  memcpy(vec.data(), data.mData.get(), data.mLen);
-
-  oishii::DataProvider provider(std::move(vec), data.mPath);
+  oishii::DataProvider provider(std::move(data.mData), data.mLen, data.mPath);
   oishii::BinaryReader reader(provider.slice());
   auto importer = SpawnImporter(data.mPath, provider.slice());
 
@@ -45,6 +42,7 @@ EditorDocument::EditorDocument(FileData&& data) {
                            std::string(message_body));
   };
   kpi::IOTransaction transaction{getRoot(), provider.slice(), message_handler};
+  RII_PROFILE_SCOPE("Import");
   importer.second->read_(transaction);
 }
 EditorDocument::EditorDocument(std::unique_ptr<kpi::INode> state,
@@ -52,21 +50,27 @@ EditorDocument::EditorDocument(std::unique_ptr<kpi::INode> state,
     : kpi::Document<kpi::INode>(std::move(state)), mFilePath(path) {}
 EditorDocument ::~EditorDocument() {}
 
-void EditorDocument::save() { saveAs(mFilePath); }
-void EditorDocument::saveAs(const std::string_view _path) {
+void EditorDocument::save(const libcube::ExportOptions& options) {
+  saveAs(mFilePath, options);
+}
+void EditorDocument::saveAs(const std::string_view _path,
+                            const libcube::ExportOptions& options) {
   std::string path(_path);
   if (path.ends_with(".bdl")) {
     path.resize(path.size() - 4);
     path += ".bmd";
   }
+  RII_PROFILE_SCOPE("Export");
   oishii::Writer writer(0);
 
-  auto ex = SpawnExporter(getRoot());
-  if (!ex) {
+  if (!mExporter)
+    mExporter = SpawnExporter(getRoot());
+  if (!mExporter) {
     DebugReport("Failed to spawn exporter.\n");
     return;
   }
-  ex->write_(getRoot(), writer);
+  libcube::SetExportOptions(*mExporter, options);
+  mExporter->write_(getRoot(), writer);
 
   plate::Platform::writeFile({writer.getDataBlockStart(), writer.getBufSize()},
                              path);
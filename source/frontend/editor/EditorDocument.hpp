@@ -1,13 +1,14 @@
 #pragma once
 
 #include "EditorImporter.hpp"
-#include <core/kpi/Document.hpp>         // kpi::Document, kpi::INode
-#include <core/kpi/Plugins.hpp>          // kpi::IOMessageClass
-#include <frontend/file_host.hpp>        // FileData
-#include <memory>                        // std::unique_ptr
-#include <string>                        // std::string
-#include <string_view>                   // std::string_view
-#include <vendor/llvm/ADT/SmallVector.h> // llvm::SmallVector
+#include <core/kpi/Document.hpp>               // kpi::Document, kpi::INode
+#include <core/kpi/Plugins.hpp>                // kpi::IOMessageClass
+#include <frontend/file_host.hpp>              // FileData
+#include <memory>                              // std::unique_ptr
+#include <plugins/gc/Export/ExportOptions.hpp> // libcube::ExportOptions
+#include <string>                              // std::string
+#include <string_view>                         // std::string_view
+#include <vendor/llvm/ADT/SmallVector.h>       // llvm::SmallVector
 
 namespace riistudio::frontend {
 
@@ -21,14 +22,18 @@ public:
   ~EditorDocument();
 
   //! Save to the original location.
-  void save();
+  void save(const libcube::ExportOptions& options);
   //! Save to the specified location.
-  void saveAs(const std::string_view path);
+  void saveAs(const std::string_view path,
+              const libcube::ExportOptions& options);
 
   std::string_view getPath() const { return mFilePath; }
 
 private:
   std::string mFilePath;
+  // Kept between saves, so that a save only rewrites what was edited since the
+  // last one.
+  std::unique_ptr<kpi::IBinarySerializer> mExporter;
 
 protected:
   llvm::SmallVector<Message, 16> mMessages;
@@ -1,5 +1,6 @@
 #include "EditorImporter.hpp"
 #include <core/api.hpp>
+#include <core/util/profiler.hpp>
 #include <oishii/data_provider.hxx>
 
 // TODO
@@ -8,11 +9,9 @@
 namespace riistudio::frontend {
 
 EditorImporter::EditorImporter(FileData&& data, kpi::INode* _fileState)
-    : fileState(_fileState) { // TODO: Not ideal..
-  std::vector<u8> vec(data.mLen);
-  memcpy(vec.data(), data.mData.get(), data.mLen);
-
-  provider = std::make_unique<oishii::DataProvider>(std::move(vec), data.mPath);
+    : fileState(_fileState) {
+  provider = std::make_unique<oishii::DataProvider>(std::move(data.mData),
+                                                    data.mLen, data.mPath);
   auto [_data_id, _importer] = SpawnImporter(data.mPath, provider->slice());
   data_id = std::move(_data_id);
   mDeserializer = std::move(_importer);
@@ -112,7 +111,10 @@ kpi::TransactionState EditorImporter::transact() {
     messageHandler(message_class, domain, message_body);
   };
   assert(transaction.has_value());
-  mDeserializer->read_(*transaction);
+  {
+    RII_PROFILE_SCOPE("Import");
+    mDeserializer->read_(*transaction);
+  }
   transaction->callback = fn;
   return transaction->state;
 }
@@ -22,7 +22,7 @@ void EditorWindow::init() {
   attachWindow(MakeHistoryList(getHistory(), getRoot()));
   attachWindow(MakeOutliner(getRoot(), mActive, *this));
   if (dynamic_cast<lib3d::Scene*>(&getRoot()) != nullptr)
-    attachWindow(MakeViewportRenderer(getRoot()));
+    attachWindow(MakeViewportRenderer(getRoot(), getHistory()));
 }
 
 EditorWindow::EditorWindow(std::unique_ptr<kpi::INode> state,
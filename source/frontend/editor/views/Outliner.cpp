@@ -10,6 +10,8 @@
 
 #include <plugins/gc/Export/Scene.hpp>
 
+#include <unordered_map> // std::unordered_map
+
 namespace riistudio::frontend {
 
 struct GenericCollectionOutliner : public StudioWindow {
@@ -45,15 +47,23 @@ struct GenericCollectionOutliner : public StudioWindow {
 #endif
   using TFilter = ImTFilter;
 
-  //! @brief Return the number of resources in the source that pass the filter.
-  //!
-  std::size_t calcNumFiltered(const kpi::ICollection& sampler,
-                              const TFilter* filter = nullptr) const noexcept;
+  //! Per-folder data derived from the document and the filter. Rebuilt only
+  //! when the filter text or the document revision changes, so a frame does
+  //! not have to query every object of every folder.
+  struct FolderCache {
+    //! Display name of each object ("TODO" names are replaced).
+    std::vector<std::string> names;
+    //! Indices of the objects that are drawn, in order.
+    std::vector<int> filtered;
+    //! "<header> (<number of resources>)"
+    std::string title;
+    //! Does any drawn object host folders of its own?
+    bool has_hosts = false;
+  };
 
-  //! @brief Format the title in the "<header> (<number of resources>)" format.
+  //! @brief Get the cached folder data, rebuilding it if necessary.
   //!
-  std::string formatTitle(const kpi::ICollection& sampler,
-                          const TFilter* filter = nullptr) const;
+  const FolderCache& getFolderCache(const kpi::ICollection& sampler);
 
   void drawFolder(kpi::ICollection& sampler, const kpi::INode& host,
                   const std::string& key) noexcept;
@@ -69,6 +79,10 @@ private:
   EditorWindow& ed;
 
   kpi::IObject* activeModal = nullptr;
+
+  std::unordered_map<const kpi::ICollection*, FolderCache> mFolderCache;
+  // Document revision the cache was built against
+  std::size_t mCachedRevision = 0;
 };
 
 GenericCollectionOutliner::GenericCollectionOutliner(kpi::INode& host,
@@ -78,36 +92,45 @@ GenericCollectionOutliner::GenericCollectionOutliner(kpi::INode& host,
   setClosable(false);
 }
 
-std::size_t GenericCollectionOutliner::calcNumFiltered(
-    const kpi::ICollection& sampler, const TFilter* filter) const noexcept {
-  // If no data, empty
-  if (sampler.size() == 0)
-    return 0;
-
-  // If we don't have a filter, everything is included.
-  if (!filter)
-    return sampler.size();
+const GenericCollectionOutliner::FolderCache&
+GenericCollectionOutliner::getFolderCache(const kpi::ICollection& sampler) {
+  auto [it, inserted] = mFolderCache.try_emplace(&sampler);
+  FolderCache& cache = it->second;
+  // Guards against mutations that did not go through the history.
+  if (!inserted && cache.names.size() == sampler.size())
+    return cache;
 
+  cache = {};
+  cache.names.reserve(sampler.size());
   std::size_t nPass = 0;
-
-  for (u32 i = 0; i < sampler.size(); ++i)
-    if (filter->test(sampler.atObject(i)->getName().c_str()))
+  for (int i = 0; i < sampler.size(); ++i) {
+    const auto& nodeAt = *sampler.atObject(i);
+    std::string cur_name = nodeAt.getName();
+    const bool passes = mFilter.test(cur_name);
+    if (passes)
       ++nPass;
 
-  return nPass;
-}
+    const auto rich = kpi::RichNameManager::getInstance().getRich(&nodeAt);
+    if (cur_name == "TODO")
+      cur_name = rich.getNameSingular() + " #" + std::to_string(i);
+    cache.names.push_back(std::move(cur_name));
 
-std::string
-GenericCollectionOutliner::formatTitle(const kpi::ICollection& sampler,
-                                       const TFilter* filter) const {
-  if (sampler.size() == 0)
-    return "";
-  const auto rich =
-      kpi::RichNameManager::getInstance().getRich(sampler.atObject(0));
-  const std::string icon_plural = rich.getIconPlural();
-  const std::string exposed_name = rich.getNamePlural();
-  return std::string(icon_plural + "  " + exposed_name + " (" +
-                     std::to_string(calcNumFiltered(sampler, filter)) + ")");
+    const bool is_host = dynamic_cast<const kpi::INode*>(&nodeAt) != nullptr;
+    if ((!is_host && !passes) || !rich.hasEntry())
+      continue;
+
+    cache.filtered.push_back(i);
+    cache.has_hosts |= is_host;
+  }
+
+  if (sampler.size() != 0) {
+    const auto rich =
+        kpi::RichNameManager::getInstance().getRich(sampler.atObject(0));
+    cache.title = rich.getIconPlural() + "  " + rich.getNamePlural() + " (" +
+                  std::to_string(nPass) + ")";
+  }
+
+  return cache;
 }
 
 // For models and bones we disable "add new" functionality for some reason
@@ -124,8 +147,9 @@ void GenericCollectionOutliner::drawFolder(kpi::ICollection& sampler,
       kpi::RichNameManager::getInstance().getRich(sampler.atObject(0));
   if (!rich.hasEntry())
     return;
+  const FolderCache& cache = getFolderCache(sampler);
   ImGui::SetNextItemOpen(true, ImGuiCond_Once);
-  const bool opened = ImGui::TreeNode(formatTitle(sampler, &mFilter).c_str());
+  const bool opened = ImGui::TreeNode(cache.title.c_str());
   if (CanCreateNew(key)) {
     const auto local_id = reinterpret_cast<u64>(&sampler);
     const auto id_str = std::string("MCtx") + std::to_string(local_id);
@@ -150,7 +174,7 @@ void GenericCollectionOutliner::drawFolder(kpi::ICollection& sampler,
 
   // A filter tree for multi selection. Prevents inclusion of unfiltered data
   // with SHIFT clicks.
-  std::vector<int> filtered;
+  const std::vector<int>& filtered = cache.filtered;
 
   int justSelectedId = -1;
   // Relative to filter vector.
@@ -160,33 +184,21 @@ void GenericCollectionOutliner::drawFolder(kpi::ICollection& sampler,
   // Prevent resetting when SHIFT is unpressed with arrow keys.
   bool thereWasAClick = false;
 
-  // Draw the tree
-  for (int i = 0; i < sampler.size(); ++i) {
+  const int icon_size = 24;
+
+  const auto drawRow = [&](std::size_t filteredIdx) {
+    const int i = filtered[filteredIdx];
     auto& nodeAt = *sampler.atObject(i);
-    std::string cur_name = nodeAt.getName();
+    const std::string& cur_name = cache.names[i];
 
     auto* as_host = dynamic_cast<kpi::INode*>(&nodeAt);
 
-    if (as_host == nullptr && !mFilter.test(cur_name))
-      continue;
-
     const auto rich = kpi::RichNameManager::getInstance().getRich(&nodeAt);
 
-    if (!rich.hasEntry())
-      continue;
-
-    if (cur_name == "TODO") {
-      cur_name = rich.getNameSingular() + " #" + std::to_string(i);
-    }
-
-    filtered.push_back(i);
-
     // Whether or not this node is already selected.
     // Selections from other windows will carry over.
     bool curNodeSelected = sampler.isSelected(i);
 
-    const int icon_size = 24;
-
     ImGui::Selectable(std::to_string(i).c_str(), curNodeSelected,
                       ImGuiSelectableFlags_None, {0, icon_size});
     if (ImGui::BeginPopupContextItem(("Ctx" + std::to_string(i)).c_str())) {
@@ -262,11 +274,27 @@ void GenericCollectionOutliner::drawFolder(kpi::ICollection& sampler,
         // clicks followed by shift clicks
         justSelectedAlreadySelected = curNodeSelected;
         justSelectedId = i;
-        justSelectedFilteredIdx = filtered.size() - 1;
+        justSelectedFilteredIdx = filteredIdx;
       }
 
       ImGui::TreePop();
     }
+  };
+
+  // Draw the tree
+  if (cache.has_hosts) {
+    // Rows expand to their own folders: heights vary, so draw everything.
+    for (std::size_t f = 0; f < filtered.size(); ++f)
+      drawRow(f);
+  } else {
+    // Leaf rows all have the same height: only draw the visible ones.
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(filtered.size()));
+    while (clipper.Step()) {
+      for (int f = clipper.DisplayStart; f < clipper.DisplayEnd; ++f)
+        drawRow(f);
+    }
+    clipper.End();
   }
   ImGui::TreePop();
 
@@ -344,7 +372,11 @@ void GenericCollectionOutliner::drawRecursive(kpi::INode& host) noexcept {
 
 void GenericCollectionOutliner::draw_() noexcept {
   // activeModal = nullptr;
-  mFilter.Draw();
+  const bool filter_changed = mFilter.Draw();
+  if (filter_changed || mCachedRevision != ed.getDocument().revision()) {
+    mFolderCache.clear();
+    mCachedRevision = ed.getDocument().revision();
+  }
   drawRecursive((kpi::INode&)mHost);
 
   if (activeModal != nullptr)
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <core/kpi/History.hpp>             // kpi::History
 #include <core/kpi/Node.hpp>                // kpi::IDocumentNode
 #include <frontend/editor/StudioWindow.hpp> // StudioWindow
 
 namespace riistudio::frontend {
 
-std::unique_ptr<StudioWindow> MakeViewportRenderer(const kpi::INode& host);
+std::unique_ptr<StudioWindow> MakeViewportRenderer(const kpi::INode& host,
+                                                   const kpi::History& history);
 
 } // namespace riistudio::frontend
@@ -4,11 +4,13 @@
 #include "Renderer.hpp"
 #include <core/3d/gl.hpp>    // glPolygonMode
 #include <core/util/gui.hpp> // ImGui::BeginMenuBar
+#include <core/util/profiler.hpp> // RII_PROFILE_SCOPE
 #include <frontend/root.hpp> // RootWindow
 
 namespace riistudio::frontend {
 
-Renderer::Renderer(lib3d::IDrawable* root) : mRoot(root) {}
+Renderer::Renderer(lib3d::IDrawable* root, const kpi::History* history)
+    : mRoot(root), mHistory(history) {}
 Renderer::~Renderer() {}
 
 void Renderer::render(u32 width, u32 height, bool& showCursor) {
@@ -22,6 +24,7 @@ void Renderer::render(u32 width, u32 height, bool& showCursor) {
   if (mRoot->reinit) {
     mRoot->reinit = false;
     // TODO: Regen VBOs and such
+    mSceneState.invalidate();
   }
 
   drawMenuBar();
@@ -33,6 +36,52 @@ void Renderer::render(u32 width, u32 height, bool& showCursor) {
   if (!rend)
     return;
 
+  RII_PROFILE_SCOPE("Render");
+
+  glm::mat4 projMtx, viewMtx;
+  {
+    RII_PROFILE_SCOPE("Camera update");
+    updateCamera(width, height, projMtx, viewMtx);
+  }
+
+  // The draw list is retained across frames. Property editors mark what they
+  // write, committed or not, and only the draws depending on it are rebuilt.
+  // Other changes (undo, redo, adding or deleting nodes) rebuild everything.
+  if (mHistory == nullptr ||
+      mHistory->untrackedRevision() != mDrawListRevision) {
+    mSceneState.invalidate();
+    if (mHistory != nullptr)
+      mDrawListRevision = mHistory->untrackedRevision();
+  } else if (mHistory->editSerial() != mEditSerial) {
+    mHistory->forEachEditSince(
+        mEditSerial, [&](const void* key) { mSceneState.markEdited(key); });
+  }
+  if (mHistory != nullptr)
+    mEditSerial = mHistory->editSerial();
+  {
+    RII_PROFILE_SCOPE("Prepare");
+    mRoot->prepare(mSceneState, *dynamic_cast<kpi::INode*>(mRoot), projMtx,
+                   viewMtx);
+  }
+  {
+    RII_PROFILE_SCOPE("Cull");
+    mSceneState.cull(projMtx * viewMtx, mCameraController.mCamera.getPosition(),
+                     mCullSettings);
+  }
+  {
+    RII_PROFILE_SCOPE("Build uniforms");
+    mSceneState.buildUniformBuffers();
+  }
+
+  clearGlScreen();
+  {
+    RII_PROFILE_SCOPE("Draw");
+    mSceneState.draw();
+  }
+}
+
+void Renderer::updateCamera(u32 width, u32 height, glm::mat4& projMtx,
+                            glm::mat4& viewMtx) {
   if (ImGui::IsWindowFocused()) {
     const auto input_state = buildInputState();
     mCameraController.move(1.0f / ImGui::GetIO().Framerate, combo_choice_cam,
@@ -48,16 +97,7 @@ void Renderer::render(u32 width, u32 height, bool& showCursor) {
 
   updateCameraController(mSceneState.computeBounds());
 
-  glm::mat4 projMtx, viewMtx;
   mCameraController.mCamera.calcMatrices(width, height, projMtx, viewMtx);
-
-  mSceneState.invalidate();
-  mRoot->prepare(mSceneState, *dynamic_cast<kpi::INode*>(mRoot), projMtx,
-                 viewMtx);
-  mSceneState.buildUniformBuffers();
-
-  clearGlScreen();
-  mSceneState.draw();
 }
 
 void Renderer::drawMenuBar() {
@@ -69,6 +109,26 @@ void Renderer::drawMenuBar() {
     }
     if (ImGui::BeginMenu("Rendering")) {
       ImGui::Checkbox("Render", &rend);
+      ImGui::Checkbox("Frustum culling", &mCullSettings.frustum);
+      bool cull_small = mCullSettings.min_feature_ratio > 0.0f;
+      if (ImGui::Checkbox("Small feature culling", &cull_small))
+        mCullSettings.min_feature_ratio = cull_small ? 0.002f : 0.0f;
+
+      const auto& stats = mSceneState.getDrawStats();
+      ImGui::Separator();
+      ImGui::Text("Draws: %u", stats.draws);
+      ImGui::Text("Program binds: %u (%u skipped)", stats.program_binds,
+                  stats.program_skips);
+      ImGui::Text("VAO binds: %u (%u skipped)", stats.vao_binds,
+                  stats.vao_skips);
+      ImGui::Text("Texture binds: %u (%u skipped)", stats.texture_binds,
+                  stats.texture_skips);
+      ImGui::Text("Blend/depth state: %u (%u skipped)", stats.state_changes,
+                  stats.state_skips);
+      const auto& ubo_stats = mSceneState.getUniformStats();
+      ImGui::Text("Uniforms: %u bytes (%u of %u blocks shared)",
+                  ubo_stats.uploaded_bytes, ubo_stats.shared_blocks,
+                  ubo_stats.blocks);
 #ifdef RII_NATIVE_GL_WIREFRAME
       ImGui::Checkbox("Wireframe", &wireframe);
 #endif
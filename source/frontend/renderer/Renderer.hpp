@@ -3,6 +3,7 @@
 #include <core/3d/i3dmodel.hpp>
 #include <core/3d/renderer/SceneState.hpp>
 #include <core/common.h>
+#include <core/kpi/History.hpp>
 #include <core/kpi/Node.hpp>
 #include <frontend/renderer/CameraController.hpp>
 #include <glm/mat4x4.hpp>
@@ -14,7 +15,9 @@ struct SceneState;
 
 class Renderer {
 public:
-  Renderer(lib3d::IDrawable* root);
+  //! @param history Used to detect document changes. If null, the draw list
+  //!                is rebuilt every frame.
+  Renderer(lib3d::IDrawable* root, const kpi::History* history = nullptr);
   ~Renderer();
   void render(u32 width, u32 height, bool& hideCursor);
   void prepare(const kpi::INode& host, glm::mat4 v_mtx, glm::mat4 p_mtx) {
@@ -25,6 +28,9 @@ public:
 
   void drawMenuBar();
   void updateCameraController(const librii::math::AABB& bounding_box);
+  // Apply input to the camera and compute its matrices for this frame
+  void updateCamera(u32 width, u32 height, glm::mat4& projMtx,
+                    glm::mat4& viewMtx);
   void setGlWireframe(bool wireframe) const;
   void clearGlScreen() const;
 
@@ -33,12 +39,18 @@ private:
   lib3d::SceneState mSceneState;
 
   lib3d::IDrawable* mRoot = nullptr;
+  const kpi::History* mHistory = nullptr;
+  // Untracked revision of the document the retained draw list was built from
+  std::size_t mDrawListRevision = 0;
+  // Last edit passed on to the scene state
+  u64 mEditSerial = 0;
   CameraController mCameraController;
   CameraController::ControllerType combo_choice_cam =
       CameraController::ControllerType::WASD_Minecraft;
 
   // Render settings
   bool rend = true;
+  lib3d::SceneState::CullSettings mCullSettings;
 #ifdef RII_NATIVE_GL_WIREFRAME
   bool wireframe = false;
 #endif
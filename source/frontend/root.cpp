@@ -6,6 +6,7 @@
 #include <frontend/editor/EditorWindow.hpp>
 #include <frontend/widgets/fps.hpp>
 #include <frontend/widgets/fullscreen.hpp>
+#include <frontend/widgets/profiler.hpp>
 #include <frontend/widgets/theme_editor.hpp>
 #include <fstream>
 #include <imgui_markdown.h>
@@ -127,6 +128,21 @@ void RootWindow::draw() {
 
         mThemeUpdated |= DrawThemeEditor(mCurTheme, mFontGlobalScale, nullptr);
 
+        ImGui::Checkbox("Profiler", &bProfiler);
+
+        if (ImGui::BeginMenu("Vertex Quantization")) {
+          // Largest error when saving float buffers as fixed point
+          auto& tolerance = mExportOptions.quantize;
+          ImGui::TextUnformatted("Maximum error (0: keep floats)");
+          ImGui::InputFloat("Position", &tolerance.position, 0.0f, 0.0f, "%g");
+          ImGui::InputFloat("Normal", &tolerance.normal, 0.0f, 0.0f, "%g");
+          ImGui::InputFloat("UV", &tolerance.texcoord, 0.0f, 0.0f, "%g");
+          tolerance.position = std::max(tolerance.position, 0.0f);
+          tolerance.normal = std::max(tolerance.normal, 0.0f);
+          tolerance.texcoord = std::max(tolerance.texcoord, 0.0f);
+          ImGui::EndMenu();
+        }
+
 #ifdef BUILD_DEBUG
         ImGui::Checkbox("ImGui Demo", &bDemo);
 #endif
@@ -136,6 +152,8 @@ void RootWindow::draw() {
 
       if (bDemo)
         ImGui::ShowDemoWindow(&bDemo);
+      if (bProfiler)
+        DrawProfiler(&bProfiler);
 
       ImGui::SameLine(ImGui::GetWindowWidth() - 60);
       DrawFps();
@@ -223,7 +241,7 @@ void RootWindow::save(const std::string& path) {
   EditorWindow* ed =
       getActive() ? dynamic_cast<EditorWindow*>(getActive()) : nullptr;
   if (ed != nullptr)
-    ed->saveAs(path);
+    ed->saveAs(path, mExportOptions);
 }
 void RootWindow::saveAs() {
   std::vector<std::string> filters;
@@ -10,6 +10,7 @@
 
 #include <frontend/editor/ImporterWindow.hpp>
 #include <frontend/updater/updater.hpp>
+#include <plugins/gc/Export/ExportOptions.hpp>
 
 namespace riistudio::frontend {
 
@@ -37,7 +38,10 @@ private:
   u32 dockspace_id = 0;
   bool vsync = true;
   bool bDemo = false;
+  bool bProfiler = false;
   float mFontGlobalScale = 1.0f;
+  // Settings > Vertex Quantization
+  libcube::ExportOptions mExportOptions;
 
   std::queue<std::string> mAttachEditorsQueue;
   ThemeManager mTheme;
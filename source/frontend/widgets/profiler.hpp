@@ -0,0 +1,63 @@
+#pragma once
+
+#include <core/util/gui.hpp>      // ImGui::Begin
+#include <core/util/profiler.hpp> // ProfilerStats
+#include <pfd/portable-file-dialogs.h>
+#include <plate/Platform.hpp> // plate::Platform
+
+namespace riistudio {
+
+// Rolling timings of the profiled stages, and Chrome trace export.
+inline void DrawProfiler(bool* open) {
+  if (!ImGui::Begin("Profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  static float window_s = 5.0f;
+  ImGui::SliderFloat("Window (s)", &window_s, 1.0f, 20.0f, "%.0f");
+
+  const auto stats = util::ProfilerStats(window_s);
+  if (ImGui::BeginTable("Stages", 6, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Stage");
+    ImGui::TableSetupColumn("Count");
+    ImGui::TableSetupColumn("p50 (ms)");
+    ImGui::TableSetupColumn("p90 (ms)");
+    ImGui::TableSetupColumn("p99 (ms)");
+    ImGui::TableSetupColumn("Max (ms)");
+    ImGui::TableAutoHeaders();
+    for (const auto& stat : stats) {
+      ImGui::TableNextRow();
+      ImGui::TableSetColumnIndex(0);
+      ImGui::TextUnformatted(stat.name);
+      ImGui::TableSetColumnIndex(1);
+      ImGui::Text("%u", stat.count);
+      int column = 2;
+      for (float ms : {stat.p50, stat.p90, stat.p99, stat.max}) {
+        ImGui::TableSetColumnIndex(column++);
+        ImGui::Text("%.3f", ms);
+      }
+    }
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Export Chrome trace")) {
+    // Taken before the dialog, which blocks for as long as it is open
+    const auto trace = util::ProfilerChromeTrace(window_s);
+    auto path = pfd::save_file("Export trace", "",
+                               {"Trace Files", "*.json", "All Files", "*"})
+                    .result();
+    if (!path.empty()) {
+      if (!path.ends_with(".json"))
+        path.append(".json");
+      plate::Platform::writeFile(
+          {reinterpret_cast<const u8*>(trace.data()), trace.size()}, path);
+    }
+  }
+  ImGui::SameLine();
+  ImGui::TextDisabled("Open in chrome://tracing or ui.perfetto.dev");
+
+  ImGui::End();
+}
+
+} // namespace riistudio
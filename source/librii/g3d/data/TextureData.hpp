@@ -2,6 +2,7 @@
 
 #include <core/common.h>
 #include <librii/gx.h>
+#include <rsl/CowVector.hpp>
 #include <string>
 #include <vector>
 
@@ -19,7 +20,7 @@ struct TextureData {
   f32 maxLod{1.0f};
 
   std::string sourcePath;
-  std::vector<u8> data = std::vector<u8>(
+  rsl::cow_vector<u8> data = rsl::cow_vector<u8>(
       librii::gx::computeImageSize(width, height, format, number_of_images));
 
   bool operator==(const TextureData& rhs) const = default;
@@ -1,8 +1,10 @@
+#include <cstdio>
 #include <glfw/glfw3.h>
 #include <librii/gl/Compiler.hpp>
 #include <llvm/Support/Error.h>
 #include <rsl/StringBuilder.hpp>
 #include <string_view>
+#include <unordered_map>
 
 namespace librii::gl {
 
@@ -52,6 +54,135 @@ getVertexAttribGenDef(VertexAttribute vtxAttrib) {
   return {*it, it - vtxAttributeGenDefs.begin()};
 }
 
+// Packs material state into a compact byte string, for use as a hash key.
+class KeyWriter {
+public:
+  explicit KeyWriter(std::string& out) : mOut(out) {}
+
+  // Values almost always fit in a byte; larger ones are escaped so distinct
+  // states never share an encoding.
+  template <typename T>
+  requires(std::is_integral_v<T> || std::is_enum_v<T>) void put(T value) {
+    const u32 word = static_cast<u32>(value);
+    if (word < 0xFF) {
+      mOut += static_cast<char>(word);
+      return;
+    }
+    mOut += static_cast<char>(0xFF);
+    for (int i = 0; i < 4; ++i)
+      mOut += static_cast<char>((word >> (i * 8)) & 0xFF);
+  }
+
+  void put(const gx::ChannelControl& chan) {
+    put(chan.enabled);
+    put(chan.Ambient);
+    put(chan.Material);
+    put(chan.lightMask);
+    put(chan.diffuseFn);
+    put(chan.attenuationFn);
+  }
+  void put(const gx::TexCoordGen& gen) {
+    put(gen.func);
+    put(gen.sourceParam);
+    put(gen.matrix);
+    put(gen.normalize);
+    put(gen.postMatrix);
+  }
+  void put(const gx::IndirectStage& ind) {
+    put(ind.scale.U);
+    put(ind.scale.V);
+    put(ind.order.refMap);
+    put(ind.order.refCoord);
+  }
+  void put(const gx::SwapTableEntry& swap) {
+    put(swap.r);
+    put(swap.g);
+    put(swap.b);
+    put(swap.a);
+  }
+  void put(const gx::TevStage& stage) {
+    put(stage.rasOrder);
+    put(stage.texMap);
+    put(stage.texCoord);
+    put(stage.rasSwap);
+    put(stage.texMapSwap);
+
+    const auto& color = stage.colorStage;
+    put(color.constantSelection);
+    put(color.a);
+    put(color.b);
+    put(color.c);
+    put(color.d);
+    put(color.formula);
+    put(color.bias);
+    put(color.scale);
+    put(color.clamp);
+    put(color.out);
+
+    const auto& alpha = stage.alphaStage;
+    put(alpha.a);
+    put(alpha.b);
+    put(alpha.c);
+    put(alpha.d);
+    put(alpha.formula);
+    put(alpha.constantSelection);
+    put(alpha.bias);
+    put(alpha.scale);
+    put(alpha.clamp);
+    put(alpha.out);
+
+    const auto& ind = stage.indirectStage;
+    put(ind.indStageSel);
+    put(ind.format);
+    put(ind.bias);
+    put(ind.matrix);
+    put(ind.wrapU);
+    put(ind.wrapV);
+    put(ind.addPrev);
+    put(ind.utcLod);
+    put(ind.alpha);
+  }
+
+private:
+  std::string& mOut;
+};
+
+// Generated code for parts of a shader, memoised by their packed state. Real
+// files repeat a handful of TEV stages, tex gens and channel setups across
+// hundreds of materials.
+class SnippetCache {
+public:
+  // Calls `generate` only if `key` has not been seen before. The result is
+  // valid until the next call.
+  template <typename F>
+  std::string_view get(std::string_view key, F&& generate) {
+    if (auto it = mSnippets.find(key); it != mSnippets.end())
+      return it->second;
+    // Snippets are small, but the number of distinct states is unbounded.
+    if (mSnippets.size() >= MaxSnippets)
+      mSnippets.clear();
+    return mSnippets.emplace(key, generate()).first->second;
+  }
+
+private:
+  struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const {
+      return std::hash<std::string_view>{}(s);
+    }
+  };
+  static constexpr std::size_t MaxSnippets = 4096;
+  std::unordered_map<std::string, std::string, Hash, std::equal_to<>>
+      mSnippets;
+};
+
+// Per thread, so materials may be compiled concurrently.
+static thread_local SnippetCache sTevStageSnippets;
+static thread_local SnippetCache sTexGenSnippets;
+static thread_local SnippetCache sLightChannelSnippets;
+// Scratch storage for snippet keys
+static thread_local std::string sSnippetKey;
+
 std::string generateBindingsDefinition(bool postTexMtxBlock, bool lightsBlock) {
 #ifdef __EMSCRIPTEN__
   return std::string(R"(
@@ -137,12 +268,12 @@ public:
     switch (chan.Material) {
     case ColorSource::Vertex:
       builder += "a_Color";
-      builder += std::to_string(i);
+      builder.appendInt(i);
       break;
     case ColorSource::Register:
       builder += "u_ColorMatReg[";
-      builder += std::to_string(i);
-      builder += "]";
+      builder.appendInt(i);
+      builder += ']';
       break;
     }
     return llvm::Error::success();
@@ -153,12 +284,12 @@ public:
     switch (chan.Ambient) {
     case ColorSource::Vertex:
       builder += "a_Color";
-      builder += std::to_string(i);
+      builder.appendInt(i);
       break;
     case ColorSource::Register:
       builder += "u_ColorAmbReg[";
-      builder += std::to_string(i);
-      builder += "]";
+      builder.appendInt(i);
+      builder += ']';
       break;
     }
     return llvm::Error::success();
@@ -315,9 +446,20 @@ public:
 
     int i = 0;
     for (const auto& chan : ctrl) {
-      llvm::cantFail(generateLightChannel(builder, chan,
-                                          "v_Color" + std::to_string(i), i));
-      builder += "\n";
+      sSnippetKey.clear();
+      KeyWriter key(sSnippetKey);
+      key.put(i);
+      key.put(chan.colorChannel);
+      key.put(chan.alphaChannel);
+
+      builder += sLightChannelSnippets.get(sSnippetKey, [&] {
+        std::array<char, 1024 * 16> buf;
+        StringBuilder snippet(buf.data(), buf.size());
+        llvm::cantFail(generateLightChannel(snippet, chan,
+                                            "v_Color" + std::to_string(i), i));
+        return snippet.str();
+      });
+      builder += '\n';
       ++i;
     }
 
@@ -327,7 +469,7 @@ public:
   // Matrix
   llvm::Error generateMulPntMatrixStatic(StringBuilder& builder,
                                          gx::PostTexMatrix pnt,
-                                         const std::string& src) {
+                                         std::string_view src) {
     // TODO
     if (pnt == gx::PostTexMatrix::Identity ||
         (int)pnt == (int)gx::TexMatrix::Identity) {
@@ -339,7 +481,7 @@ public:
     if (pnt >= gx::PostTexMatrix::Matrix0) {
       const int pnMtxIdx = (((int)pnt - (int)gx::PostTexMatrix::Matrix0)) / 3;
       builder += "(u_PosMtx[";
-      builder += std::to_string(pnMtxIdx);
+      builder.appendInt(pnMtxIdx);
       builder += "] * ";
       builder += src;
       builder += ")";
@@ -349,7 +491,7 @@ public:
     if ((int)pnt >= (int)gx::TexMatrix::TexMatrix0) {
       const int texMtxIdx = (((int)pnt - (int)gx::TexMatrix::TexMatrix0)) / 3;
       builder += "(u_TexMtx[";
-      builder += std::to_string(texMtxIdx);
+      builder.appendInt(texMtxIdx);
       builder += "] * ";
       builder += src;
       builder += ")";
@@ -364,6 +506,15 @@ public:
                                           const std::string& src) {
     return "(GetPosTexMatrix(" + attrStr + ") * " + src + ")";
   }
+  void generateMulPntMatrixDynamic(StringBuilder& builder,
+                                   std::string_view attrStr,
+                                   std::string_view src) {
+    builder += "(GetPosTexMatrix(";
+    builder += attrStr;
+    builder += ") * ";
+    builder += src;
+    builder += ')';
+  }
   std::string generateTexMtxIdxAttr(int index) {
     switch (index) {
     case 0:
@@ -527,22 +678,30 @@ public:
            generateTexGenPost(texCoordGen, id) + ";\n";
   }
 
-  std::string generateTexGens() {
-    std::string out;
+  void generateTexGens(StringBuilder& builder) {
     const auto& tgs = mMaterial.texGens;
-    for (int i = 0; i < tgs.size(); ++i)
-      out += generateTexGen(tgs[i], i);
-    return out;
+    for (int i = 0; i < tgs.size(); ++i) {
+      sSnippetKey.clear();
+      KeyWriter key(sSnippetKey);
+      key.put(i);
+      key.put(tgs[i]);
+      key.put(useTexMtxIdx[i]);
+
+      builder += sTexGenSnippets.get(sSnippetKey,
+                                     [&] { return generateTexGen(tgs[i], i); });
+    }
   }
 
-  std::string generateTexCoordGetters() {
-    std::string out;
+  void generateTexCoordGetters(StringBuilder& builder) {
     for (int i = 0; i < mMaterial.texGens.size(); ++i) {
-      const std::string is = std::to_string(i);
-      out += "vec2 ReadTexCoord" + is + "() { return v_TexCoord" + is +
-             ".xy / v_TexCoord" + is + ".z; }\n";
+      builder += "vec2 ReadTexCoord";
+      builder.appendInt(i);
+      builder += "() { return v_TexCoord";
+      builder.appendInt(i);
+      builder += ".xy / v_TexCoord";
+      builder.appendInt(i);
+      builder += ".z; }\n";
     }
-    return out;
   }
 
   // IndTex
@@ -570,19 +729,23 @@ public:
     }
   }
 
-  std::string
-  generateIndTexStageScale(const gx::TevStage::IndirectStage& stage,
-                           const gx::IndirectTextureScalePair& scale,
-                           const gx::IndOrder& mIndOrder) {
-    const std::string baseCoord =
-        "ReadTexCoord" + std::to_string(mIndOrder.refCoord) + "()";
+  void generateIndTexStageScale(StringBuilder& builder,
+                                const gx::TevStage::IndirectStage& stage,
+                                const gx::IndirectTextureScalePair& scale,
+                                const gx::IndOrder& mIndOrder) {
+    builder += "ReadTexCoord";
+    builder.appendInt(mIndOrder.refCoord);
+    builder += "()";
 
     if (scale.U == gx::IndirectTextureScalePair::Selection::x_1 &&
         scale.V == gx::IndirectTextureScalePair::Selection::x_1)
-      return baseCoord;
-    else
-      return baseCoord + " * vec2(" + generateIndTexStageScaleN(scale.U) +
-             ", " + generateIndTexStageScaleN(scale.V) + ")";
+      return;
+
+    builder += " * vec2(";
+    builder += generateIndTexStageScaleN(scale.U);
+    builder += ", ";
+    builder += generateIndTexStageScaleN(scale.V);
+    builder += ')';
   }
 
   std::string generateTextureSample(u32 index, const std::string& coord) {
@@ -591,7 +754,7 @@ public:
            ", TextureLODBias(" + idx_str + "))";
   }
 
-  void generateIndTexStage(std::string& out, u32 indTexStageIndex) {
+  void generateIndTexStage(StringBuilder& out, u32 indTexStageIndex) {
     const auto& stage = mMaterial.mStages[indTexStageIndex].indirectStage;
 
     const auto scale = indTexStageIndex >= mMaterial.indirectStages.size()
@@ -602,17 +765,22 @@ public:
                            : mMaterial.indirectStages[indTexStageIndex].order;
 
     out += "vec3 t_IndTexCoord";
-    out += std::to_string(indTexStageIndex);
+    out.appendInt(indTexStageIndex);
     out += " = ";
 
     out += "255.0 * ";
-    out += generateTextureSample(order.refMap,
-                                 generateIndTexStageScale(stage, scale, order));
+    // See generateTextureSample()
+    out += "texture(u_Texture[";
+    out.appendInt(order.refMap);
+    out += "], ";
+    generateIndTexStageScale(out, stage, scale, order);
+    out += ", TextureLODBias(";
+    out.appendInt(order.refMap);
+    out += "))";
     out += ".abg;\n";
   }
 
-  std::string generateIndTexStages() {
-    std::string out;
+  void generateIndTexStages(StringBuilder& out) {
     auto& matData = mMaterial;
 
     for (std::size_t i = 0; i < matData.indirectStages.size(); ++i) {
@@ -623,7 +791,6 @@ public:
 
       generateIndTexStage(out, i);
     }
-    return out;
   }
 
   // TEV
@@ -1138,13 +1305,26 @@ public:
   llvm::Error generateTevStage(StringBuilder& builder, u32 tevStageIndex) {
     const auto& stage = mMaterial.mStages[tevStageIndex];
 
-    builder += "\n\n    //\n    // TEV Stage ";
-    builder += std::to_string(tevStageIndex);
-    builder += "\n    //\n";
-    builder += generateTevTexCoord(stage);
-    builder += generateTevInputs(stage);
-    builder += generateColorOp(stage);
-    builder += generateAlphaOp(stage);
+    // Everything the stage's code depends on
+    sSnippetKey.clear();
+    KeyWriter key(sSnippetKey);
+    key.put(tevStageIndex);
+    key.put(stage);
+    key.put(mMaterial.mSwapTable[stage.texMapSwap]);
+    key.put(mMaterial.mSwapTable[stage.rasSwap]);
+    key.put(mMaterial.texGens.size());
+    key.put(mMaterial.mStages.size());
+
+    builder += sTevStageSnippets.get(sSnippetKey, [&] {
+      std::string out = "\n\n    //\n    // TEV Stage ";
+      out += std::to_string(tevStageIndex);
+      out += "\n    //\n";
+      out += generateTevTexCoord(stage);
+      out += generateTevInputs(stage);
+      out += generateColorOp(stage);
+      out += generateAlphaOp(stage);
+      return out;
+    });
 
     return llvm::Error::success();
   }
@@ -1165,10 +1345,15 @@ public:
     const auto alphaReg = generateTevRegister(lastTevStage.alphaStage.out);
 
     if (colorReg == alphaReg) {
-      builder += "    vec4 t_TevOutput = " + colorReg + ";\n";
+      builder += "    vec4 t_TevOutput = ";
+      builder += colorReg;
+      builder += ";\n";
     } else {
-      builder += "    vec4 t_TevOutput = vec4(" + colorReg + ".rgb, " +
-                 alphaReg + ".a);\n";
+      builder += "    vec4 t_TevOutput = vec4(";
+      builder += colorReg;
+      builder += ".rgb, ";
+      builder += alphaReg;
+      builder += ".a);\n";
     }
 
     return llvm::Error::success();
@@ -1177,7 +1362,9 @@ public:
   llvm::Error generateAlphaTestCompare(StringBuilder& builder,
                                        gx::Comparison compare,
                                        float reference) {
-    const auto ref = std::to_string(static_cast<f32>(reference));
+    // Formatted as std::to_string would
+    char ref[32];
+    snprintf(ref, sizeof(ref), "%f", static_cast<f32>(reference));
     switch (compare) {
     case gx::Comparison::NEVER:
       builder += "false";
@@ -1287,8 +1474,8 @@ public:
     for (const auto& attr : vtxAttributeGenDefs) {
       // if (attr.format != GL_FLOAT) continue;
       builder += "layout(location = ";
-      builder += std::to_string(i);
-      builder += ")";
+      builder.appendInt(i);
+      builder += ')';
 
       builder += " in ";
       llvm::cantFail(
@@ -1305,7 +1492,7 @@ public:
     // Default to using pnmtxidx.
     const auto src = "vec4(a_Position, 1.0)";
     if (usePnMtxIdx) {
-      builder += generateMulPntMatrixDynamic("uint(a_PnMtxIdx)", src);
+      generateMulPntMatrixDynamic(builder, "uint(a_PnMtxIdx)", src);
     } else {
       if (auto err = generateMulPntMatrixStatic(
               builder, gx::PostTexMatrix::Matrix0, src))
@@ -1319,7 +1506,7 @@ public:
     // Default to using pnmtxidx.
     const auto src = "vec4(a_Normal, 0.0)";
     if (usePnMtxIdx)
-      builder += generateMulPntMatrixDynamic("uint(a_PnMtxIdx)", src);
+      generateMulPntMatrixDynamic(builder, "uint(a_PnMtxIdx)", src);
     else if (auto err = generateMulPntMatrixStatic(
                  builder, gx::PostTexMatrix::Matrix0, src))
       return err;
@@ -1327,7 +1514,7 @@ public:
     return llvm::Error::success();
   }
 
-  llvm::Expected<std::string> generateVert() {
+  llvm::Expected<std::string> generateVert(std::string_view header) {
     const std::string_view varying_vert =
         R"(out vec3 v_Position;
 out vec4 v_Color0;
@@ -1344,23 +1531,24 @@ out vec3 v_TexCoord7;
 
     std::array<char, 1024 * 64> vert_buf;
     StringBuilder vert(vert_buf.data(), vert_buf.size());
+    vert += header;
     vert += varying_vert;
     if (auto err = generateVertAttributeDefs(vert); err)
       return std::move(err);
     vert += "mat4x3 GetPosTexMatrix(uint t_MtxIdx) {\n"
-            "    if (t_MtxIdx == " +
-            std::to_string((int)gx::TexMatrix::Identity) +
-            "u)\n"
+            "    if (t_MtxIdx == ";
+    vert.appendInt((int)gx::TexMatrix::Identity);
+    vert += "u)\n"
             "        return mat4x3(1.0);\n"
-            "    else if (t_MtxIdx >= " +
-            std::to_string((int)gx::TexMatrix::TexMatrix0) +
-            "u)\n"
-            "        return u_TexMtx[(t_MtxIdx - " +
-            std::to_string((int)gx::TexMatrix::TexMatrix0) +
-            "u) / 3u];\n"
+            "    else if (t_MtxIdx >= ";
+    vert.appendInt((int)gx::TexMatrix::TexMatrix0);
+    vert += "u)\n"
+            "        return u_TexMtx[(t_MtxIdx - ";
+    vert.appendInt((int)gx::TexMatrix::TexMatrix0);
+    vert += "u) / 3u];\n"
             "    else\n"
             "        return u_PosMtx[t_MtxIdx / 3u];\n"
-            "}\n" +
+            "}\n"
             R"(
 float ApplyAttenuation(vec3 t_Coeff, float t_Value) {
     return dot(t_Coeff, vec3(1.0, t_Value, t_Value*t_Value));
@@ -1387,14 +1575,14 @@ float ApplyAttenuation(vec3 t_Coeff, float t_Value) {
             "    v_Color0 = a_Color0;\n";
     if (auto err = generateLightChannels(vert); err)
       return std::move(err);
-    vert += generateTexGens();
+    generateTexGens(vert);
     vert += "gl_Position = (u_Projection * vec4(t_Position, 1.0));\n"
             "}\n";
 
-    return vert_buf.data();
+    return vert.str();
   }
 
-  llvm::Expected<std::string> generateFrag() {
+  llvm::Expected<std::string> generateFrag(std::string_view header) {
     constexpr std::string_view varying_frag =
         R"(in vec3 v_Position;
 in vec4 v_Color0;
@@ -1412,8 +1600,9 @@ out vec4 fragOut;
 
     std::array<char, 1024 * 64> frag_buf;
     StringBuilder frag(frag_buf.data(), frag_buf.size());
+    frag += header;
     frag += varying_frag;
-    frag += generateTexCoordGetters();
+    generateTexCoordGetters(frag);
     frag += R"(
 float TextureLODBias(int index) { return u_SceneTextureLODBias + u_TextureParams[index].w; }
 vec2 TextureInvScale(int index) { return 1.0 / u_TextureParams[index].xy; }
@@ -1442,7 +1631,7 @@ void main() {
     vec4 t_Color1    = u_Color[2];
     vec4 t_Color2    = u_Color[3];
 )";
-    frag += generateIndTexStages();
+    generateIndTexStages(frag);
     frag +=
         R"(
     vec2 t_TexCoord = vec2(0.0, 0.0);
@@ -1455,12 +1644,19 @@ void main() {
     frag += "    fragOut = t_PixelOut;\n"
             "}\n";
 
-    return frag_buf.data();
+    return frag.str();
   }
 
   std::string generateBoth() {
-    const auto bindingsDefinition =
-        generateBindingsDefinition(hasPostTexMtxBlock, hasLightsBlock);
+    // Only depends on two flags, so is generated once.
+    static const std::array<std::string, 4> sBindingsDefinitions{
+        generateBindingsDefinition(false, false),
+        generateBindingsDefinition(false, true),
+        generateBindingsDefinition(true, false),
+        generateBindingsDefinition(true, true)};
+    const auto& bindingsDefinition =
+        sBindingsDefinitions[(hasPostTexMtxBlock ? 2 : 0) +
+                             (hasLightsBlock ? 1 : 0)];
 
 #if __EMSCRIPTEN__
     const std::string version = "#version 300 es";
@@ -1468,22 +1664,30 @@ void main() {
     const std::string version = "#version 440";
 #endif
 
-    return version + "\n// " + mName + "\nprecision mediump float;\n" +
-           bindingsDefinition;
+    std::string both;
+    both.reserve(version.size() + mName.size() + bindingsDefinition.size() +
+                 64);
+    both += version;
+    both += "\n// ";
+    both += mName;
+    both += "\nprecision mediump float;\n";
+    both += bindingsDefinition;
+    return both;
   }
 
   std::optional<std::pair<std::string, std::string>> generateShaders() {
-    auto both = generateBoth();
+    const auto both = generateBoth();
 
-    auto vert = generateVert();
+    auto vert = generateVert(both);
     if (auto err = vert.takeError(); err)
       return std::nullopt;
 
-    auto frag = generateFrag();
+    auto frag = generateFrag(both);
     if (auto err = frag.takeError(); err)
       return std::nullopt;
 
-    return std::pair<std::string, std::string>{both + *vert, both + *frag};
+    return std::pair<std::string, std::string>{std::move(*vert),
+                                               std::move(*frag)};
   }
 
   const gx::LowLevelGxMaterial& mMaterial;
@@ -1505,13 +1709,44 @@ void main() {
   std::string mName;
 };
 
+std::string MakeShaderKey(const gx::LowLevelGxMaterial& mat) {
+  std::string out;
+  out.reserve(64 + mat.mStages.size() * 32);
+  KeyWriter key(out);
+
+  // Every field GXProgram reads must be encoded here.
+  key.put(mat.colorChanControls.size());
+  for (const auto& chan : mat.colorChanControls)
+    key.put(chan);
+  key.put(mat.texGens.size());
+  for (const auto& gen : mat.texGens)
+    key.put(gen);
+  key.put(mat.indirectStages.size());
+  for (const auto& ind : mat.indirectStages)
+    key.put(ind);
+  for (const auto& swap : mat.mSwapTable)
+    key.put(swap);
+  key.put(mat.mStages.size());
+  for (const auto& stage : mat.mStages)
+    key.put(stage);
+
+  const auto& alpha_test = mat.alphaCompare;
+  key.put(alpha_test.compLeft);
+  key.put(alpha_test.refLeft);
+  key.put(alpha_test.op);
+  key.put(alpha_test.compRight);
+  key.put(alpha_test.refRight);
+
+  return out;
+}
+
 std::optional<GlShaderPair> compileShader(const gx::LowLevelGxMaterial& mat,
                                           std::string_view name) {
   GXProgram program(mat, name);
   auto compiled = program.generateShaders();
   if (!compiled)
     return std::nullopt;
-  return GlShaderPair{compiled->first, compiled->second};
+  return GlShaderPair{std::move(compiled->first), std::move(compiled->second)};
 }
 
 } // namespace librii::gl
@@ -108,6 +108,11 @@ struct GlShaderPair {
   std::string fragment;
 };
 
+// Canonical encoding of the material state shader generation depends on.
+// Materials with equal keys compile to the same program (save for the name
+// comment), so programs may be shared through it.
+std::string MakeShaderKey(const gx::LowLevelGxMaterial& mat);
+
 std::optional<GlShaderPair> compileShader(const gx::LowLevelGxMaterial& mat,
                                           std::string_view name);
 
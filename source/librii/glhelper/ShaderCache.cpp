@@ -2,19 +2,20 @@
 
 namespace librii::glhelper {
 
-std::map<std::pair<std::string, std::string>, std::unique_ptr<ShaderProgram>>
-    ShaderCache::mShaders;
-
-ShaderProgram& ShaderCache::compile(const std::string& vert,
-                                    const std::string& frag) {
-  const auto key = std::pair<std::string, std::string>(vert, frag);
+const ShaderCache::Entry* ShaderCache::find(const std::string& key) const {
   const auto found = mShaders.find(key);
-  if (found != mShaders.end())
-    return *found->second.get();
-  auto new_program = std::make_unique<ShaderProgram>(vert, frag);
-  ShaderProgram& ref = *new_program.get();
-  mShaders.emplace(key, std::move(new_program));
-  return ref;
+  if (found == mShaders.end())
+    return nullptr;
+  return found->second.get();
+}
+
+const ShaderCache::Entry& ShaderCache::emplace(const std::string& key,
+                                               const std::string& vert,
+                                               const std::string& frag) {
+  auto& entry = mShaders[key];
+  if (entry == nullptr)
+    entry = std::make_unique<Entry>(Entry{ShaderProgram{vert, frag}, frag});
+  return *entry;
 }
 
 } // namespace librii::glhelper
@@ -1,20 +1,34 @@
 #pragma once
 
 #include <librii/glhelper/ShaderProgram.hpp>
-#include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 namespace librii::glhelper {
 
-struct ShaderCache {
-  static ShaderProgram& compile(const std::string& vert,
-                                const std::string& frag);
+// Shares linked programs between users with equal keys.
+//
+// Keys are opaque byte strings chosen by the caller; they should be much
+// smaller than the sources they stand for. Programs that fail to link are
+// cached as well, so broken shaders are not recompiled on every lookup.
+class ShaderCache {
+public:
+  struct Entry {
+    ShaderProgram program;
+    // Kept for display
+    std::string fragment;
+  };
+
+  const Entry* find(const std::string& key) const;
+  const Entry& emplace(const std::string& key, const std::string& vert,
+                       const std::string& frag);
+
+  std::size_t size() const { return mShaders.size(); }
 
 private:
-  static std::map<std::pair<std::string, std::string>,
-                  std::unique_ptr<ShaderProgram>>
-      mShaders;
+  // Entries are heap allocated so references survive rehashing.
+  std::unordered_map<std::string, std::unique_ptr<Entry>> mShaders;
 };
 
 } // namespace librii::glhelper
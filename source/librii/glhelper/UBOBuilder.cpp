@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <core/3d/gl.hpp>
 #include <cstdio>
+#include <cstring>
+#include <llvm/Support/xxhash.h>
 
 namespace librii::glhelper {
 
@@ -9,13 +11,11 @@ namespace librii::glhelper {
 // Basic UBOBuilder
 //
 UBOBuilder::UBOBuilder() {
-#if !defined(_WIN32)
-  uniformStride = 1024; // TODO: This is really for emscripten, perhaps there is
-                        // a fixed value or proper way to query this.
-#else
   glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformStride);
-  printf("UBOBuilder: Buffer offset alignment: %i\n", uniformStride);
-#endif
+  if (uniformStride <= 0) {
+    // Never observed, but the spec maximum is always safe.
+    uniformStride = 256;
+  }
 
 #ifdef DEBUG
   // This allows for GPU-agnostic dump analysis.
@@ -25,91 +25,104 @@ UBOBuilder::UBOBuilder() {
   // on a Nvidia GPU.
   uniformStride = std::max(uniformStride, 256);
 #endif
-
-  glGenBuffers(1, &UBO);
 }
 
-UBOBuilder::~UBOBuilder() { glDeleteBuffers(1, &UBO); }
-
 //
 // Advanced UBOBuilder
 //
 
-void DelegatedUBOBuilder::submit() {
-  const auto blob_size = calcBlobSize();
-  mCoalesced.resize(blob_size);
-  mCoalescedOffsets.clear();
-
-  u32 cursor = 0;
-  for (const auto& binding_point_collection : mData) {
-    // If there is no data, add a null entry
-    if (binding_point_collection.empty()) {
-      mCoalescedOffsets.push_back({.offset = cursor, .stride = 0});
-      continue;
-    }
-
-    // This assumes the size of each binding point entry is the same
-    const std::size_t entry_size = binding_point_collection[0].size();
-    const auto entry_stride = static_cast<u32>(roundUniformUp(entry_size));
-
-    mCoalescedOffsets.push_back(
-        {.offset = cursor, .stride = static_cast<u32>(entry_stride)});
-
-    for (const auto& binding_point_entry : binding_point_collection) {
-      assert(binding_point_entry.size() == entry_size &&
-             "Uniforms differ in size across the binding point");
-
-      mCoalesced.insert_bytes(cursor, binding_point_entry.data(),
-                              binding_point_entry.size());
-      cursor += entry_stride;
-    }
+DelegatedUBOBuilder::~DelegatedUBOBuilder() {
+  for (u32 buffer : mRing) {
+    if (buffer != 0)
+      glDeleteBuffers(1, &buffer);
   }
+}
 
-  assert(cursor == blob_size && cursor == mCoalesced.size());
-
-  glBindBuffer(GL_UNIFORM_BUFFER, getUboId());
-  glBufferData(GL_UNIFORM_BUFFER, blob_size, NULL, GL_STATIC_DRAW);
-  glBufferSubData(GL_UNIFORM_BUFFER, 0, blob_size, mCoalesced.data());
+void DelegatedUBOBuilder::submit() {
+  mStats = mPending;
+  mStats.uploaded_bytes = static_cast<u32>(mArena.size());
+
+  if (mArena.empty())
+    return;
+
+  // Do not overwrite the buffer the previous frames may still be reading.
+  mRingIndex = (mRingIndex + 1) % RingSize;
+  u32& buffer = mRing[mRingIndex];
+  u32& capacity = mRingCapacity[mRingIndex];
+  if (buffer == 0)
+    glGenBuffers(1, &buffer);
+
+  glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+  if (capacity < mArena.size()) {
+    capacity = std::max(static_cast<u32>(mArena.size()), capacity * 2);
+    glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+  }
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, mArena.size(), mArena.data());
 }
 
 // Use the data at each binding point
 void DelegatedUBOBuilder::use(u32 idx) const {
-  for (int i = 0; i < mData.size(); ++i) {
-    const auto& ofs = mCoalescedOffsets[i];
-
-    const auto range_offset = ofs.offset + ofs.stride * idx;
-    const auto range_size = ofs.stride * (mData[i].size() - idx);
-
-    assert(range_offset % getUniformAlignment() == 0);
-    if (range_size == 0)
+  for (u32 i = 0; i < mBindingPoints.size(); ++i) {
+    const auto& binding_point = mBindingPoints[i];
+    if (idx >= binding_point.offsets.size())
       continue;
 
-    assert(range_offset < mCoalesced.size());
-    glBindBufferRange(GL_UNIFORM_BUFFER, i, getUboId(), range_offset,
-                      range_size);
+    const u32 offset = binding_point.offsets[idx];
+    assert(offset % getUniformAlignment() == 0);
+    assert(offset + binding_point.block_size <= mArena.size());
+    glBindBufferRange(GL_UNIFORM_BUFFER, i, mRing[mRingIndex], offset,
+                      binding_point.block_size);
   }
 }
 
-void DelegatedUBOBuilder::push(u32 binding_point, const std::vector<u8>& data) {
-  auto& bound_data = getTempData(binding_point).emplace_back(data);
+void DelegatedUBOBuilder::push(u32 binding_point_id,
+                               std::span<const u8> data) {
+  auto& binding_point = getBindingPoint(binding_point_id);
 
-  assert(mMinSizes.size() > binding_point);
-  if (mMinSizes[binding_point] > 1024 * 1024 * 1024) {
+  if (binding_point.min_size > 1024 * 1024 * 1024) {
     assert(!"Invalid minimum size. Likely a shader compilation error earlier.");
     abort();
   }
-  if (bound_data.size() < mMinSizes[binding_point])
-    bound_data.resize(mMinSizes[binding_point]);
+  const u32 size =
+      std::max(static_cast<u32>(data.size()), binding_point.min_size);
+  assert((binding_point.block_size == 0 || binding_point.block_size == size) &&
+         "Uniforms differ in size across the binding point");
+  binding_point.block_size = size;
+  ++mPending.blocks;
+
+  const u64 hash = llvm::xxHash64(llvm::ArrayRef<u8>(data.data(), data.size()));
+  if (auto found = binding_point.written.find(hash);
+      found != binding_point.written.end() &&
+      memcmp(mArena.data() + found->second, data.data(), data.size()) == 0) {
+    binding_point.offsets.push_back(found->second);
+    ++mPending.shared_blocks;
+    return;
+  }
+
+  const u32 offset = roundUniformUp(static_cast<u32>(mArena.size()));
+  // Padding and the tail of blocks shorter than the minimum stay zeroed.
+  mArena.resize(offset + size);
+  memcpy(mArena.data() + offset, data.data(), data.size());
+
+  binding_point.offsets.push_back(offset);
+  binding_point.written.emplace(hash, offset);
 }
-void DelegatedUBOBuilder::clear() { mData.clear(); }
 
-void DelegatedUBOBuilder::setBlockMin(u32 binding_point, u32 min) {
-  if (binding_point >= mMinSizes.size()) {
-    mMinSizes.resize(binding_point + 1);
-    mMinSizes[binding_point] = roundUniformUp(min);
+void DelegatedUBOBuilder::clear() {
+  mArena.clear();
+  for (auto& binding_point : mBindingPoints) {
+    binding_point.offsets.clear();
+    binding_point.written.clear();
   }
+  mPending = {};
+}
+
+void DelegatedUBOBuilder::setBlockMin(u32 binding_point_id, u32 min) {
+  auto& binding_point = getBindingPoint(binding_point_id);
+  if (binding_point.min_size == 0)
+    binding_point.min_size = min;
 
-  assert(mMinSizes[binding_point] == roundUniformUp(min));
+  assert(binding_point.min_size == min);
 }
 
 } // namespace librii::glhelper
@@ -1,16 +1,16 @@
 #pragma once
 
+#include <array>
 #include <core/common.h>
-#include <map>
-#include <memory>
-#include <tuple>
+#include <span>
+#include <unordered_map>
 #include <vector>
 
 namespace librii::glhelper {
 
 struct UBOBuilder {
   UBOBuilder();
-  ~UBOBuilder();
+  ~UBOBuilder() = default;
 
   u32 roundUniformUp(u32 ofs) const {
     auto res = roundUp(ofs, uniformStride);
@@ -25,103 +25,75 @@ struct UBOBuilder {
     return res;
   }
   int getUniformAlignment() const { return uniformStride; }
-  u32 getUboId() const { return UBO; }
 
 private:
   int uniformStride = 0;
-  u32 UBO;
 };
 
-// A write-only binary object.
-class Blob {
-public:
-  Blob() = default;
-  Blob(std::vector<u8>&& data) : mData(std::move(data)) {}
-  Blob(const std::vector<u8>& data) : mData(data) {}
-  Blob(Blob&& blob) : Blob(std::move(blob.mData)) {}
-
-  std::size_t size() const { return mData.size(); }
-  void resize(std::size_t size) { mData.resize(size); }
-  void clear() { mData.clear(); }
-
-  const u8* data() const { return mData.data(); }
-
-  void insert_bytes(std::size_t begin, const u8* bytes,
-                    std::size_t byte_count) {
-    if (begin + byte_count > mData.size()) {
-      assert(!"insert_bytes: range is out of bounds");
-      return;
-    }
-
-    memcpy(mData.data() + begin, bytes, byte_count);
-  }
-
-private:
-  std::vector<u8> mData;
-};
-
-// Prototype -- we can do this much more efficiently
+// Streams per-draw uniform blocks through a frame-linear arena.
+//
+// Each push() writes its block in place, exactly once, at the uniform offset
+// alignment. A block identical to one already pushed to the same binding
+// point this frame is shared instead of stored again. submit() uploads the
+// arena to the next buffer of a small ring; buffers are only reallocated when
+// they need to grow.
 class DelegatedUBOBuilder : public UBOBuilder {
 public:
   DelegatedUBOBuilder() = default;
-  ~DelegatedUBOBuilder() = default;
+  ~DelegatedUBOBuilder();
 
   void submit();
 
   // Use the data at each binding point
   void use(u32 idx) const;
 
-  void push(u32 binding_point, const std::vector<u8>& data);
+  void push(u32 binding_point, std::span<const u8> data);
 
   template <typename T> void tpush(u32 binding_point, const T& data) {
-    std::vector<u8> tmp(sizeof(T));
-    *reinterpret_cast<T*>(tmp.data()) = data;
-    push(binding_point, tmp);
-  }
-  void reset(u32 binding_point) {
-    // Check if the binding point has been set
-    if (mData.size() > binding_point)
-      return;
-
-    if (!mData[binding_point].empty()) {
-      mData[binding_point][mData[binding_point].size() - 1].clear();
-    }
+    push(binding_point, {reinterpret_cast<const u8*>(&data), sizeof(T)});
   }
 
   void setBlockMin(u32 binding_point, u32 min);
 
   void clear();
 
-private:
-  // Indices as binding ids
-  std::vector<std::vector<Blob>> mData;
-
-  std::vector<u32> mMinSizes;
-
-  // Recomputed each submit
-  Blob mCoalesced;
-  struct CoalescedEntry {
-    u32 offset = 0;
-    u32 stride = 0;
+  struct Stats {
+    u32 uploaded_bytes = 0;
+    u32 blocks = 0;
+    // Blocks that reused an identical block rather than being stored
+    u32 shared_blocks = 0;
   };
-  std::vector<CoalescedEntry> mCoalescedOffsets;
+  // Statistics of the last submit()
+  const Stats& getStats() const { return mStats; }
 
-  std::vector<Blob>& getTempData(u32 binding_point) {
-    if (binding_point >= mData.size())
-      return mData.emplace_back();
+private:
+  std::vector<u8> mArena;
+
+  struct BindingPoint {
+    // Arena offset of the block of each draw
+    std::vector<u32> offsets;
+    // Size bound for each draw
+    u32 block_size = 0;
+    // Minimum size reported by the shader
+    u32 min_size = 0;
+    // Content hash -> arena offset, for blocks pushed this frame
+    std::unordered_map<u64, u32> written;
+  };
+  std::vector<BindingPoint> mBindingPoints;
 
-    return mData[binding_point];
+  BindingPoint& getBindingPoint(u32 binding_point) {
+    if (binding_point >= mBindingPoints.size())
+      mBindingPoints.resize(binding_point + 1);
+    return mBindingPoints[binding_point];
   }
 
-  std::size_t calcBlobSize() const {
-    std::size_t size = 0;
-    for (const auto& binding_point_collection : mData) {
-      for (const auto& binding_point_entry : binding_point_collection)
-        size += roundUniformUp(binding_point_entry.size());
-    }
-    // printf("DelegatedUBOBuilder: Final size: %u\n", static_cast<u32>(size));
-    return size;
-  }
+  static constexpr std::size_t RingSize = 3;
+  std::array<u32, RingSize> mRing{};
+  std::array<u32, RingSize> mRingCapacity{};
+  std::size_t mRingIndex = 0;
+
+  Stats mStats;
+  Stats mPending;
 };
 
 } // namespace librii::glhelper
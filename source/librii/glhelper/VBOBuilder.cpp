@@ -17,29 +17,54 @@ VBOBuilder::~VBOBuilder() {
   glDeleteVertexArrays(1, &VAO);
 }
 void VBOBuilder::build() {
-  std::vector<std::pair<VAOEntry, u32>> mAttribStack; // desc : offset
-
-  for (const auto& bind : mPropogating) {
-    mAttribStack.emplace_back(bind.second.descriptor, mData.size());
+  struct Attrib {
+    const VertexArray* stream;
+    u32 offset;
+  };
+  std::vector<Attrib> attribs;
+  u32 stride = 0;
+  for (const auto& stream : mPropogating) {
+    // Binding points below the highest one used need not have an attribute.
+    if (stream.descriptor.name == nullptr) {
+      assert(stream.data.empty() && "Vertex data without a descriptor");
+      continue;
+    }
+    assert(stream.element_size == 0 ||
+           stream.element_size == stream.descriptor.size);
+    attribs.push_back({&stream, stride});
+    stride += stream.descriptor.size;
+  }
 
-    for (const u8 e : bind.second.data)
-      push(e);
+  // Interleave. Attributes never set for a vertex stay zero.
+  std::vector<u8> data(static_cast<std::size_t>(mNumVertices) * stride, 0);
+  for (const auto& attrib : attribs) {
+    const u32 size = attrib.stream->descriptor.size;
+    const std::size_t count = attrib.stream->data.size() / size;
+    for (std::size_t i = 0; i < count; ++i) {
+      std::memcpy(data.data() + i * stride + attrib.offset,
+                  attrib.stream->data.data() + i * size, size);
+    }
   }
 
+  DebugReport("VBO: %u vertices (%u before welding), %u triangles, ACMR %.3f "
+              "-> %.3f, stride %u\n",
+              mNumVertices, mStats.input_vertices, mStats.triangles,
+              mStats.acmr_before, mStats.acmr_after, stride);
+
   glBindVertexArray(VAO);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBuf);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, mIndices.size() * 4, mIndices.data(),
                GL_STATIC_DRAW);
 
   glBindBuffer(GL_ARRAY_BUFFER, mPositionBuf);
-  glBufferData(GL_ARRAY_BUFFER, mData.size(), mData.data(), GL_STATIC_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
   glBindVertexArray(VAO);
 
   auto vertexAttribPointer = [&](GLuint index, GLint size, GLenum type,
                                  GLboolean normalized, GLsizei stride,
                                  const void* pointer) {
     DebugReport("Index: %u, size: %i, stride: %i, ofs: %u\n", index, size,
-                stride, (u32)pointer);
+                stride, (u32)(uintptr_t)pointer);
 
     assert(stride != 0);
 
@@ -50,17 +75,12 @@ void VBOBuilder::build() {
       exit(1);
   };
 
-  for (const auto& attrib : mAttribStack) {
-    // TODO: Hack
-    if (attrib.first.name == nullptr)
-      continue;
-    assert(attrib.first.format == GL_FLOAT);
-    vertexAttribPointer(attrib.first.binding_point, attrib.first.size / 4,
-                        GL_FLOAT, GL_FALSE, attrib.first.size,
-                        reinterpret_cast<void*>(attrib.second));
-    // glVertexAttribPointer(attrib.first.binding_point, attrib.first.size,
-    // attrib.first.format, GL_FALSE, attrib.first.size, (void*)attrib.second);
-    glEnableVertexAttribArray(attrib.first.binding_point);
+  for (const auto& attrib : attribs) {
+    const auto& desc = attrib.stream->descriptor;
+    assert(desc.format == GL_FLOAT);
+    vertexAttribPointer(desc.binding_point, desc.size / 4, GL_FLOAT, GL_FALSE,
+                        stride, reinterpret_cast<void*>(attrib.offset));
+    glEnableVertexAttribArray(desc.binding_point);
   }
 
   mPropogating.clear();
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <core/common.h>
-#include <map>
+#include <cstring>
 #include <memory>
 #include <tuple>
 #include <vector>
@@ -18,45 +18,91 @@ struct VAOEntry {
   u32 size;   // (of element / stride)
 };
 
-// WIP..
+// Collects vertices attribute by attribute, then uploads them interleaved.
+//
+// Vertices are shared between all attributes: vertex `i` is the `i`th element
+// of every stream. Attributes a vertex does not set are zero.
 struct VBOBuilder {
   VBOBuilder();
   ~VBOBuilder();
 
-  std::vector<u8> mData;
+  // Triangle list, indexing vertices
   std::vector<u32> mIndices;
 
   struct VertexArray {
-    VAOEntry descriptor;
+    VAOEntry descriptor{};
     std::vector<u8> data;
+    u32 element_size = 0;
   };
 
-  // binding_point : data
-  std::map<u32, VertexArray> mPropogating;
+  // Indexed by binding point. Only streams with a descriptor are uploaded.
+  std::vector<VertexArray> mPropogating;
 
-  void build();
+  void setDescriptor(u32 binding_point, const VAOEntry& descriptor) {
+    getStream(binding_point).descriptor = descriptor;
+  }
 
+  // Start a new vertex. Returns its index.
+  u32 beginVertex() { return mNumVertices++; }
+  u32 getNumVertices() const { return mNumVertices; }
+
+  // Set an attribute of the last vertex begun.
   template <typename T> void pushData(u32 binding_point, const T& data) {
-    auto& attrib_buf = mPropogating[binding_point];
-    const std::size_t begin = attrib_buf.data.size();
-    attrib_buf.data.resize(attrib_buf.data.size() + sizeof(T));
-    *reinterpret_cast<T*>(attrib_buf.data.data() + begin) = data;
+    assert(mNumVertices > 0);
+    auto& attrib_buf = getStream(binding_point);
+    assert(attrib_buf.element_size == 0 ||
+           attrib_buf.element_size == sizeof(T));
+    attrib_buf.element_size = sizeof(T);
+
+    // Earlier vertices may not have set this attribute.
+    const std::size_t begin = (mNumVertices - 1) * sizeof(T);
+    assert(attrib_buf.data.size() <= begin);
+    attrib_buf.data.resize(begin + sizeof(T));
+    std::memcpy(attrib_buf.data.data() + begin, &data, sizeof(T));
   }
 
+  struct Stats {
+    // Triangle corners submitted, before welding identical vertices
+    u32 input_vertices = 0;
+    u32 triangles = 0;
+    // Average cache miss ratio of the submitted and the optimized order,
+    // weighted by triangle count.
+    float acmr_before = 0.0f;
+    float acmr_after = 0.0f;
+  };
+  const Stats& getStats() const { return mStats; }
+  void recordMesh(u32 input_vertices, u32 triangles, float acmr_before,
+                  float acmr_after) {
+    const u32 total = mStats.triangles + triangles;
+    if (total == 0)
+      return;
+    const auto mix = [&](float avg, float value) {
+      return (avg * mStats.triangles + value * triangles) / total;
+    };
+    mStats.acmr_before = mix(mStats.acmr_before, acmr_before);
+    mStats.acmr_after = mix(mStats.acmr_after, acmr_after);
+    mStats.input_vertices += input_vertices;
+    mStats.triangles = total;
+  }
+
+  void build();
+
   void bind();
   void unbind();
   u32 getGlId() const { return VAO; }
 
 private:
+  VertexArray& getStream(u32 binding_point) {
+    if (binding_point >= mPropogating.size())
+      mPropogating.resize(binding_point + 1);
+    return mPropogating[binding_point];
+  }
+
+  u32 mNumVertices = 0;
+  Stats mStats;
+
   u32 VAO;
   u32 mPositionBuf, mIndexBuf;
-
-private:
-  template <typename T> void push(const T& data) {
-    const std::size_t begin = mData.size();
-    mData.resize(mData.size() + sizeof(T));
-    *reinterpret_cast<T*>(mData.data() + begin) = data;
-  }
 };
 
 } // namespace librii::glhelper
@@ -0,0 +1,231 @@
+#include "VertexCache.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <librii/gpu/Stripify.hpp>
+#include <unordered_map>
+#include <vector>
+
+namespace librii::glhelper {
+
+namespace {
+
+constexpr int CacheSize = 32;
+
+// Scoring constants from the paper
+constexpr float CacheDecayPower = 1.5f;
+constexpr float LastTriScore = 0.75f;
+constexpr float ValenceBoostScale = 2.0f;
+constexpr float ValenceBoostPower = 0.5f;
+
+struct VertexScores {
+  std::array<float, CacheSize> cache;
+  std::array<float, 64> valence;
+
+  VertexScores() {
+    for (int i = 0; i < CacheSize; ++i) {
+      if (i < 3) {
+        // The last triangle's vertices score the same regardless of order, so
+        // it is not preferred to repeat it.
+        cache[i] = LastTriScore;
+        continue;
+      }
+      const float scaler = 1.0f / (CacheSize - 3);
+      cache[i] = std::pow(1.0f - (i - 3) * scaler, CacheDecayPower);
+    }
+    valence[0] = 0.0f;
+    for (std::size_t i = 1; i < valence.size(); ++i)
+      valence[i] = ValenceBoostScale * std::pow(float(i), -ValenceBoostPower);
+  }
+
+  float score(int cache_pos, u32 remaining) const {
+    // No triangles left to draw with this vertex
+    if (remaining == 0)
+      return -1.0f;
+    float result = cache_pos < 0 ? 0.0f : cache[cache_pos];
+    result += remaining < valence.size()
+                  ? valence[remaining]
+                  : ValenceBoostScale *
+                        std::pow(float(remaining), -ValenceBoostPower);
+    return result;
+  }
+};
+
+} // namespace
+
+void OptimizeVertexCache(std::span<u32> indices, u32 num_verts) {
+  static const VertexScores sScores;
+
+  const std::size_t num_tris = indices.size() / 3;
+  if (num_tris < 2)
+    return;
+
+  // Triangles adjacent to each vertex, as ranges of `adjacency`
+  std::vector<u32> offsets(num_verts + 1, 0);
+  for (u32 idx : indices)
+    ++offsets[idx + 1];
+  for (u32 v = 0; v < num_verts; ++v)
+    offsets[v + 1] += offsets[v];
+  std::vector<u32> adjacency(indices.size());
+  {
+    std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < indices.size(); ++i)
+      adjacency[fill[indices[i]]++] = static_cast<u32>(i / 3);
+  }
+
+  // Per vertex: triangles not yet emitted (first `remaining` of its range)
+  std::vector<u32> remaining(num_verts);
+  std::vector<int> cache_pos(num_verts, -1);
+  std::vector<float> vertex_score(num_verts);
+  for (u32 v = 0; v < num_verts; ++v) {
+    remaining[v] = offsets[v + 1] - offsets[v];
+    vertex_score[v] = sScores.score(-1, remaining[v]);
+  }
+
+  std::vector<float> tri_score(num_tris);
+  std::vector<bool> emitted(num_tris, false);
+  for (std::size_t t = 0; t < num_tris; ++t) {
+    tri_score[t] = vertex_score[indices[t * 3]] +
+                   vertex_score[indices[t * 3 + 1]] +
+                   vertex_score[indices[t * 3 + 2]];
+  }
+
+  std::vector<u32> output;
+  output.reserve(indices.size());
+
+  // Room for the cache plus the three vertices being added
+  std::array<u32, CacheSize + 3> cache;
+  int cache_count = 0;
+
+  std::size_t best = 0;
+  for (std::size_t t = 1; t < num_tris; ++t)
+    if (tri_score[t] > tri_score[best])
+      best = t;
+  // Triangles before this have all been emitted; used when the cache runs dry.
+  std::size_t scan = 0;
+
+  for (std::size_t n = 0; n < num_tris; ++n) {
+    if (best == num_tris) {
+      while (emitted[scan])
+        ++scan;
+      best = scan;
+      for (std::size_t t = scan + 1; t < num_tris; ++t)
+        if (!emitted[t] && tri_score[t] > tri_score[best])
+          best = t;
+    }
+
+    emitted[best] = true;
+    const u32* tri = &indices[best * 3];
+    output.insert(output.end(), tri, tri + 3);
+
+    // Remove the triangle from its vertices' pending lists
+    for (int i = 0; i < 3; ++i) {
+      const u32 v = tri[i];
+      u32* begin = &adjacency[offsets[v]];
+      u32* end = begin + remaining[v];
+      std::iter_swap(std::find(begin, end, static_cast<u32>(best)), end - 1);
+      --remaining[v];
+    }
+
+    // Move the triangle's vertices to the front of the LRU cache
+    std::array<u32, CacheSize + 3> new_cache;
+    int new_count = 0;
+    for (int i = 0; i < 3; ++i)
+      new_cache[new_count++] = tri[i];
+    for (int i = 0; i < cache_count; ++i) {
+      const u32 v = cache[i];
+      if (v != tri[0] && v != tri[1] && v != tri[2])
+        new_cache[new_count++] = v;
+    }
+    // Vertices pushed out of the cache
+    for (int i = CacheSize; i < new_count; ++i) {
+      const u32 v = new_cache[i];
+      cache_pos[v] = -1;
+      vertex_score[v] = sScores.score(-1, remaining[v]);
+    }
+    cache_count = std::min(new_count, CacheSize);
+    cache = new_cache;
+
+    // Rescore what is cached, and pick the next triangle among theirs
+    for (int i = 0; i < cache_count; ++i) {
+      const u32 v = cache[i];
+      cache_pos[v] = i;
+      vertex_score[v] = sScores.score(i, remaining[v]);
+    }
+    best = num_tris;
+    float best_score = -1.0f;
+    for (int i = 0; i < cache_count; ++i) {
+      const u32 v = cache[i];
+      for (u32 j = 0; j < remaining[v]; ++j) {
+        const u32 t = adjacency[offsets[v] + j];
+        const float score = vertex_score[indices[t * 3]] +
+                            vertex_score[indices[t * 3 + 1]] +
+                            vertex_score[indices[t * 3 + 2]];
+        tri_score[t] = score;
+        if (score > best_score) {
+          best_score = score;
+          best = t;
+        }
+      }
+    }
+  }
+
+  std::copy(output.begin(), output.end(), indices.begin());
+}
+
+float CalcACMR(std::span<const u32> indices, u32 num_verts, u32 cache_size) {
+  if (indices.size() < 3)
+    return 0.0f;
+
+  // Time each vertex entered the cache; a FIFO only evicts by age.
+  std::vector<u32> entered(num_verts, 0);
+  u32 misses = 0;
+  for (u32 idx : indices) {
+    if (entered[idx] != 0 && misses - entered[idx] < cache_size)
+      continue;
+    ++misses;
+    entered[idx] = misses;
+  }
+  return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+WeldedTriangles WeldTriangles(const gx::MatrixPrimitive& mprim,
+                              u32 attributes) {
+  WeldedTriangles out;
+  std::unordered_map<gx::IndexedVertex, u32, gx::IndexedVertexHash> welded;
+  auto weld = [&](const gx::IndexedVertex& vtx) -> u32 {
+    gx::IndexedVertex key{};
+    for (u32 i = 0; i < (u32)gx::VertexAttribute::Max; ++i) {
+      if (attributes & (1 << i))
+        key[(gx::VertexAttribute)i] = vtx[(gx::VertexAttribute)i];
+    }
+    const auto [it, inserted] =
+        welded.emplace(key, static_cast<u32>(out.vertices.size()));
+    if (inserted)
+      out.vertices.push_back(key);
+    return it->second;
+  };
+  for (const auto& prim : mprim.mPrimitives) {
+    gpu::ForEachTriangle(prim, [&](const auto& a, const auto& b,
+                                   const auto& c) {
+      out.num_corners += 3;
+      const u32 ia = weld(a), ib = weld(b), ic = weld(c);
+      // Degenerate triangles (common in strips) rasterize nothing.
+      if (ia == ib || ib == ic || ia == ic)
+        return;
+      out.indices.insert(out.indices.end(), {ia, ib, ic});
+    });
+  }
+
+  const u32 num_verts = static_cast<u32>(out.vertices.size());
+  out.acmr_before = CalcACMR(out.indices, num_verts);
+  std::vector<u32> optimized = out.indices;
+  OptimizeVertexCache(optimized, num_verts);
+  const float acmr = CalcACMR(optimized, num_verts);
+  if (acmr <= out.acmr_before)
+    out.indices = std::move(optimized);
+  out.acmr_after = std::min(acmr, out.acmr_before);
+  return out;
+}
+
+} // namespace librii::glhelper
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <core/common.h>
+#include <librii/gx.h>
+#include <span>
+#include <vector>
+
+namespace librii::glhelper {
+
+//! Reorder the triangles of an indexed triangle list for post-transform vertex
+//! cache locality (Tom Forsyth, "Linear-Speed Vertex Cache Optimisation").
+//!
+//! Each triangle keeps its vertex order, so winding is preserved.
+//!
+//! @param indices   Triangle list; reordered in place.
+//! @param num_verts One past the largest index.
+//!
+void OptimizeVertexCache(std::span<u32> indices, u32 num_verts);
+
+//! Average cache miss ratio: vertex shader invocations per triangle, modelled
+//! as a FIFO cache of `cache_size` entries. Ranges from ~0.5 (ideal) to 3.0.
+//!
+float CalcACMR(std::span<const u32> indices, u32 num_verts,
+               u32 cache_size = 32);
+
+//! Triangle list of a matrix primitive, as it is uploaded.
+struct WeldedTriangles {
+  //! Distinct vertices. Attributes that were not compared are zero.
+  std::vector<gx::IndexedVertex> vertices;
+  //! Triangle list indexing `vertices`, in vertex cache order
+  std::vector<u32> indices;
+  //! Triangle corners read, before welding and dropping degenerates
+  u32 num_corners = 0;
+  float acmr_before = 0.0f;
+  float acmr_after = 0.0f;
+};
+
+//! Weld the triangles of a matrix primitive into an indexed triangle list.
+//!
+//! Corners are the same vertex when the attributes in `attributes` (a vertex
+//! descriptor bitfield) match. Triangles that weld to fewer than three
+//! vertices are dropped. The list is then optimized for the vertex cache,
+//! unless that would raise its ACMR.
+//!
+WeldedTriangles WeldTriangles(const gx::MatrixPrimitive& mprim,
+                              u32 attributes);
+
+} // namespace librii::glhelper
@@ -1,50 +1,180 @@
 #include "DLMesh.hpp"
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <utility>
 
 namespace librii::gpu {
 
 // This is always BE
 constexpr oishii::EndianSelect CmdProcEndian = oishii::EndianSelect::Big;
 
-static llvm::Expected<u16> ProcessAttr(
-    oishii::BinaryReader& reader,
-    const std::map<gx::VertexAttribute, gx::VertexAttributeType>& attribstypes,
-    gx::VertexAttribute a, u32 vi) {
-  u16 val = 0;
-
-  switch (attribstypes.at(a)) {
-  case gx::VertexAttributeType::None:
-    break;
-  case gx::VertexAttributeType::Byte:
-    val = reader.read<u8, CmdProcEndian, true>();
-    assert(val != 0xff);
-    break;
-  case gx::VertexAttributeType::Short:
-    val = reader.read<u16, CmdProcEndian, true>();
-    if (val == 0xffff) {
-      printf("Index: %u, Attribute: %x\n", vi, (u32)a);
-      reader.warnAt("Disabled vertex", reader.tell() - 2, reader.tell());
+namespace {
+
+constexpr u32 NumAttributes = (u32)gx::VertexAttribute::Max;
+
+constexpr u32 Bit(gx::VertexAttribute attr) { return 1u << (u32)attr; }
+
+struct FixedLayout {
+  // Attributes in the vertex
+  u32 present;
+  // Of those, the 16-bit ones
+  u32 wide;
+};
+
+// Layouts decoded by code of their own: 16-bit indices, optionally after a
+// position matrix index.
+constexpr auto FixedLayouts = [] {
+  using VA = gx::VertexAttribute;
+  constexpr u32 P = Bit(VA::Position), N = Bit(VA::Normal),
+                C = Bit(VA::Color0), T0 = Bit(VA::TexCoord0),
+                T1 = Bit(VA::TexCoord1);
+  constexpr u32 sets[] = {P,          P | T0,         P | T0 | T1,
+                          P | N,      P | N | T0,     P | N | T0 | T1,
+                          P | C,      P | C | T0,     P | N | C,
+                          P | N | C | T0};
+  std::array<FixedLayout, std::size(sets) * 2> layouts{};
+  for (std::size_t i = 0; i < std::size(sets); ++i) {
+    layouts[i * 2] = {sets[i], sets[i]};
+    layouts[i * 2 + 1] = {sets[i] | Bit(VA::PositionNormalMatrixIndex),
+                          sets[i]};
+  }
+  return layouts;
+}();
+
+template <u32 Present, u32 Wide, u32 A>
+inline void DecodeAttribute(const u8*& data, gx::IndexedVertex& out,
+                            VertexLayout::Indices& largest) {
+  if constexpr ((Present & (1u << A)) != 0) {
+    u16 val;
+    if constexpr ((Wide & (1u << A)) != 0) {
+      val = static_cast<u16>((data[0] << 8) | data[1]);
+      data += 2;
+    } else {
+      val = data[0];
+      data += 1;
+    }
+    out[static_cast<gx::VertexAttribute>(A)] = val;
+    largest[A] = std::max(largest[A], val);
+  }
+}
+
+template <u32 Present, u32 Wide>
+void DecodeFixed(const VertexLayout&, const u8* data, u32 count,
+                 gx::IndexedVertex* out, VertexLayout::Indices& largest) {
+  [&]<u32... A>(std::integer_sequence<u32, A...>) {
+    for (u32 v = 0; v < count; ++v)
+      (DecodeAttribute<Present, Wide, A>(data, out[v], largest), ...);
+  }(std::make_integer_sequence<u32, NumAttributes>{});
+}
+
+void DecodeGeneric(const VertexLayout& layout, const u8* data, u32 count,
+                   gx::IndexedVertex* out, VertexLayout::Indices& largest) {
+  for (u32 v = 0; v < count; ++v) {
+    for (u32 i = 0; i < layout.num_attributes; ++i) {
+      const auto& attr = layout.attributes[i];
+      u16 val = 0;
+      if (attr.size == 2)
+        val = static_cast<u16>((data[attr.offset] << 8) |
+                               data[attr.offset + 1]);
+      else if (attr.size == 1)
+        val = data[attr.offset];
+      out[v][attr.attr] = val;
+      auto& max = largest[(u32)attr.attr];
+      max = std::max(max, val);
     }
-    assert(val != 0xffff);
-    break;
-  case gx::VertexAttributeType::Direct:
-    if (a != gx::VertexAttribute::PositionNormalMatrixIndex &&
-        a != gx::VertexAttribute::Texture0MatrixIndex &&
-        a != gx::VertexAttribute::Texture1MatrixIndex) {
+    data += layout.stride;
+  }
+}
 
+template <std::size_t... I>
+constexpr auto MakeFixedDecoders(std::index_sequence<I...>) {
+  return std::array<VertexLayout::Decoder, sizeof...(I)>{
+      &DecodeFixed<FixedLayouts[I].present, FixedLayouts[I].wide>...};
+}
+constexpr auto FixedDecoders =
+    MakeFixedDecoders(std::make_index_sequence<FixedLayouts.size()>{});
+
+} // namespace
+
+llvm::Expected<VertexLayout>
+MakeVertexLayout(const gx::VertexDescriptor& descriptor) {
+  VertexLayout layout;
+  u32 present = 0, wide = 0;
+  bool empty_attributes = false;
+  for (u32 a = 0; a < NumAttributes; ++a) {
+    if (!(descriptor.mBitfield & (1 << a)))
+      continue;
+    const auto attr = static_cast<gx::VertexAttribute>(a);
+    const auto found = descriptor.mAttributes.find(attr);
+    if (found == descriptor.mAttributes.end())
       return llvm::createStringError(std::errc::executable_format_error,
-                                     "Direct vertex data is unsupported.");
+                                     "Unknown vertex attribute format.");
+
+    u8 size = 0;
+    switch (found->second) {
+    case gx::VertexAttributeType::None:
+      empty_attributes = true;
+      break;
+    case gx::VertexAttributeType::Byte:
+      size = 1;
+      break;
+    case gx::VertexAttributeType::Short:
+      size = 2;
+      wide |= 1u << a;
+      break;
+    case gx::VertexAttributeType::Direct:
+      if (attr != gx::VertexAttribute::PositionNormalMatrixIndex &&
+          attr != gx::VertexAttribute::Texture0MatrixIndex &&
+          attr != gx::VertexAttribute::Texture1MatrixIndex) {
+
+        return llvm::createStringError(std::errc::executable_format_error,
+                                       "Direct vertex data is unsupported.");
+      }
+      // As PNM indices are always direct, we
+      // still use them in an all-indexed vertex
+      size = 1;
+      layout.direct |= 1u << a;
+      break;
+    default:
+      return llvm::createStringError(std::errc::executable_format_error,
+                                     "Unknown vertex attribute format.");
     }
-    // As PNM indices are always direct, we
-    // still use them in an all-indexed vertex
-    val = reader.read<u8, CmdProcEndian, true>();
-    assert(val != 0xff);
-    break;
-  default:
-    return llvm::createStringError(std::errc::executable_format_error,
-                                   "Unknown vertex attribute format.");
+    if (size != 0)
+      present |= 1u << a;
+    layout.attributes[layout.num_attributes++] = {
+        attr, static_cast<u8>(layout.stride), size};
+    layout.stride += size;
   }
 
-  return val;
+  layout.decoder = &DecodeGeneric;
+  // Attributes enabled without data still count as used, which only the
+  // generic decoder tracks.
+  for (std::size_t i = 0; !empty_attributes && i < FixedLayouts.size(); ++i) {
+    if (FixedLayouts[i].present == present && FixedLayouts[i].wide == wide)
+      layout.decoder = FixedDecoders[i];
+  }
+  return layout;
+}
+
+llvm::Expected<VertexLayout::Indices> ReadVertices(oishii::BinaryReader& reader,
+                                                   const VertexLayout& layout,
+                                                   gx::IndexedPrimitive& prim) {
+  const u32 count = static_cast<u32>(prim.mVertices.size());
+  const u64 size = static_cast<u64>(count) * layout.stride;
+  if (reader.tell() + size > reader.endpos()) {
+    return llvm::createStringError(
+        std::errc::executable_format_error,
+        "Vertex data runs past the end of the file.");
+  }
+
+  VertexLayout::Indices largest{};
+  if (count != 0) {
+    layout.decoder(layout, reader.getStreamStart() + reader.tell(), count,
+                   prim.mVertices.data(), largest);
+  }
+  reader.seekSet(reader.tell() + static_cast<u32>(size));
+  return largest;
 }
 
 llvm::Error
@@ -54,6 +184,14 @@ DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
                       std::map<gx::VertexBufferAttribute, u32>* optUsageMap) {
   oishii::Jump<oishii::Whence::Set> g(reader, start);
 
+  // Errors are only reported once a vertex is read.
+  std::optional<VertexLayout> layout;
+  std::string layoutError;
+  if (auto layoutOrErr = MakeVertexLayout(descriptor))
+    layout = *layoutOrErr;
+  else
+    layoutError = llvm::toString(layoutOrErr.takeError());
+
   const u32 end = reader.tell() + size;
   while (reader.tell() < end) {
     const u8 tag = reader.readUnaligned<u8>();
@@ -71,25 +209,39 @@ DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
     u16 nVerts = reader.readUnaligned<u16, CmdProcEndian>();
     auto& prim = delegate.addIndexedPrimitive(
         gx::DecodeDrawPrimitiveCommand(tag), nVerts);
+    if (nVerts == 0)
+      continue;
+    if (!layout) {
+      return llvm::createStringError(std::errc::executable_format_error, "%s",
+                                     layoutError.c_str());
+    }
 
-    for (u16 vi = 0; vi < nVerts; ++vi) {
-      for (int a = 0; a < (int)gx::VertexAttribute::Max; ++a) {
-        if (descriptor.mBitfield & (1 << a)) {
-          const auto attr = static_cast<gx::VertexAttribute>(a);
-          const auto attr_buf = static_cast<gx::VertexBufferAttribute>(a);
-
-          auto valOrErr = ProcessAttr(reader, descriptor.mAttributes, attr, vi);
-          if (auto e = valOrErr.takeError())
-            return e;
-
-          const u16 val = *valOrErr;
-
-          prim.mVertices[vi][attr] = val;
-
-          if (optUsageMap && (*optUsageMap)[attr_buf] <= val)
-            (*optUsageMap)[attr_buf] = val;
+    const u32 vtxStart = reader.tell();
+    auto largestOrErr = ReadVertices(reader, *layout, prim);
+    if (auto e = largestOrErr.takeError())
+      return e;
+    const auto& largest = *largestOrErr;
+
+    for (u32 i = 0; i < layout->num_attributes; ++i) {
+      const auto& attr = layout->attributes[i];
+      const u16 val = largest[(u32)attr.attr];
+
+      // All ones disables a vertex.
+      const u16 disabled = attr.size == 2 ? 0xffff : 0xff;
+      if (attr.size != 0 && val == disabled) {
+        for (u16 vi = 0; vi < nVerts; ++vi) {
+          const u32 pos = vtxStart + vi * layout->stride + attr.offset;
+          if (attr.size == 2 && prim.mVertices[vi][attr.attr] == 0xffff) {
+            printf("Index: %u, Attribute: %x\n", vi, (u32)attr.attr);
+            reader.warnAt("Disabled vertex", pos, pos + 2);
+          }
         }
+        assert(!"Disabled vertex");
       }
+
+      const auto attr_buf = static_cast<gx::VertexBufferAttribute>(attr.attr);
+      if (optUsageMap && (*optUsageMap)[attr_buf] <= val)
+        (*optUsageMap)[attr_buf] = val;
     }
   }
 
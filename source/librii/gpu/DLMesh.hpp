@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <librii/gx.h>
 #include <llvm/Support/Error.h>
 #include <map>
@@ -12,6 +13,44 @@ struct IMeshDLDelegate {
                                                     u16 nVerts) = 0;
 };
 
+// Where each attribute of a vertex lies in a display list. Worked out once per
+// vertex descriptor, so that vertices are decoded without looking it up.
+struct VertexLayout {
+  using Indices = std::array<u16, (u32)gx::VertexAttribute::Max>;
+  // Reads `count` vertices, the largest index of each attribute going to
+  // `largest`.
+  using Decoder = void (*)(const VertexLayout& layout, const u8* data,
+                           u32 count, gx::IndexedVertex* out,
+                           Indices& largest);
+
+  struct Attribute {
+    gx::VertexAttribute attr;
+    // Bytes into the vertex
+    u8 offset;
+    // 0 for attributes enabled without data
+    u8 size;
+  };
+  std::array<Attribute, (u32)gx::VertexAttribute::Max> attributes;
+  u32 num_attributes = 0;
+  // Bytes per vertex
+  u32 stride = 0;
+  // Attributes stored directly rather than indexed: only matrix indices.
+  u32 direct = 0;
+
+  Decoder decoder = nullptr;
+};
+
+// Fails on direct vertex data other than matrix indices, or on unknown types.
+llvm::Expected<VertexLayout>
+MakeVertexLayout(const gx::VertexDescriptor& descriptor);
+
+// Reads the vertices of a draw command into `prim`, already sized to hold
+// them, advancing the reader past them. Returns the largest index of each
+// attribute.
+llvm::Expected<VertexLayout::Indices> ReadVertices(oishii::BinaryReader& reader,
+                                                   const VertexLayout& layout,
+                                                   gx::IndexedPrimitive& prim);
+
 llvm::Error
 DecodeMeshDisplayList(oishii::BinaryReader& reader, u32 start, u32 size,
                       IMeshDLDelegate& delegate,
@@ -0,0 +1,253 @@
+#include "PalettePartition.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <optional>
+#include <unordered_map>
+
+namespace librii::gpu {
+
+namespace {
+
+// Triangles with the same set of draw matrices
+struct Cluster {
+  std::array<u16, 3> matrices;
+  u32 num_matrices;
+  std::vector<u32> triangles;
+};
+
+struct Bin {
+  std::vector<u16> matrices;
+  std::vector<u32> clusters;
+};
+
+std::vector<Cluster> GatherClusters(std::span<const u16> corner_matrices) {
+  std::vector<Cluster> clusters;
+  std::unordered_map<u64, u32> lookup;
+  const u32 num_tris = static_cast<u32>(corner_matrices.size() / 3);
+  for (u32 t = 0; t < num_tris; ++t) {
+    std::array<u16, 3> set{corner_matrices[t * 3], corner_matrices[t * 3 + 1],
+                           corner_matrices[t * 3 + 2]};
+    std::sort(set.begin(), set.end());
+    const u32 num_matrices =
+        static_cast<u32>(std::unique(set.begin(), set.end()) - set.begin());
+    // Pad with the first matrix, so each set has one key.
+    for (u32 i = num_matrices; i < 3; ++i)
+      set[i] = set[0];
+    const u64 key = u64(set[0]) | (u64(set[1]) << 16) | (u64(set[2]) << 32);
+    const auto [it, inserted] =
+        lookup.try_emplace(key, static_cast<u32>(clusters.size()));
+    if (inserted)
+      clusters.push_back({set, num_matrices, {}});
+    clusters[it->second].triangles.push_back(t);
+  }
+  return clusters;
+}
+
+// Packs clusters into bins of at most `palette_size` matrices, each time
+// adding the cluster that needs the fewest new matrices.
+//
+// Only two kinds of cluster can be the best fit: those sharing a matrix with
+// the bin, found through the clusters of each matrix, and the narrowest
+// cluster sharing none, found in clusters bucketed by width.
+std::vector<Bin> PackClusters(const std::vector<Cluster>& clusters,
+                              u32 palette_size, u32 num_matrices) {
+  // Clusters of each width, in input order
+  std::array<std::vector<u32>, 4> by_width;
+  // Clusters using each matrix
+  std::vector<std::vector<u32>> by_matrix(num_matrices);
+  for (u32 c = 0; c < clusters.size(); ++c) {
+    by_width[clusters[c].num_matrices].push_back(c);
+    for (u32 i = 0; i < clusters[c].num_matrices; ++i)
+      by_matrix[clusters[c].matrices[i]].push_back(c);
+  }
+  std::vector<u8> packed(clusters.size(), 0);
+  // Packed clusters are skipped lazily.
+  std::array<std::size_t, 4> width_cursor{};
+  auto firstOfWidth = [&](u32 width) -> std::optional<u32> {
+    auto& cursor = width_cursor[width];
+    const auto& bucket = by_width[width];
+    while (cursor < bucket.size() && packed[bucket[cursor]])
+      ++cursor;
+    if (cursor == bucket.size())
+      return std::nullopt;
+    return bucket[cursor];
+  };
+
+  std::vector<Bin> bins;
+  std::vector<u8> in_bin(num_matrices, 0);
+  // Matrices each cluster shares with the bin
+  std::vector<u8> shared(clusters.size(), 0);
+  // Clusters sharing any, packed or not
+  std::vector<u32> touching;
+  std::size_t num_packed = 0;
+
+  while (num_packed < clusters.size()) {
+    // Seed with the widest cluster left, as it is the hardest to place.
+    std::optional<u32> seed;
+    for (u32 width = 3; width > 0 && !seed; --width)
+      seed = firstOfWidth(width);
+    assert(seed);
+
+    auto& bin = bins.emplace_back();
+    auto add = [&](u32 c) {
+      packed[c] = 1;
+      ++num_packed;
+      bin.clusters.push_back(c);
+      for (u32 i = 0; i < clusters[c].num_matrices; ++i) {
+        const u16 mtx = clusters[c].matrices[i];
+        if (in_bin[mtx])
+          continue;
+        in_bin[mtx] = 1;
+        bin.matrices.push_back(mtx);
+        for (const u32 other : by_matrix[mtx]) {
+          if (shared[other]++ == 0)
+            touching.push_back(other);
+        }
+      }
+    };
+    add(*seed);
+
+    for (;;) {
+      std::optional<u32> best;
+      u32 best_new = 0, best_shared = 0;
+      auto consider = [&](u32 c) {
+        const u32 num_new = clusters[c].num_matrices - shared[c];
+        if (bin.matrices.size() + num_new > palette_size)
+          return;
+        if (!best || num_new < best_new ||
+            (num_new == best_new &&
+             (shared[c] > best_shared ||
+              (shared[c] == best_shared && c < *best)))) {
+          best = c;
+          best_new = num_new;
+          best_shared = shared[c];
+        }
+      };
+      for (const u32 c : touching) {
+        if (!packed[c])
+          consider(c);
+      }
+      for (u32 width = 1; width <= 3; ++width) {
+        if (const auto c = firstOfWidth(width))
+          consider(*c);
+      }
+      if (!best)
+        break;
+      add(*best);
+    }
+
+    for (const u16 mtx : bin.matrices)
+      in_bin[mtx] = 0;
+    for (const u32 c : touching)
+      shared[c] = 0;
+    touching.clear();
+  }
+  return bins;
+}
+
+} // namespace
+
+std::vector<PaletteGroup>
+PartitionMatrixPalette(std::span<const u16> corner_matrices, u32 palette_size) {
+  assert(palette_size >= 3);
+  const auto clusters = GatherClusters(corner_matrices);
+  u32 num_matrices = 0;
+  for (const u16 mtx : corner_matrices)
+    num_matrices = std::max<u32>(num_matrices, mtx + 1);
+  auto bins = PackClusters(clusters, palette_size, num_matrices);
+
+  // Draw next the bin that finds the most of its matrices already loaded.
+  std::vector<PaletteGroup> groups;
+  std::vector<u16> slots;
+  std::vector<s32> slot_of(num_matrices, -1);
+  std::vector<u8> drawn(bins.size(), 0);
+  for (std::size_t n = 0; n < bins.size(); ++n) {
+    std::size_t next = bins.size();
+    u32 next_loaded = 0;
+    for (std::size_t b = 0; b < bins.size(); ++b) {
+      if (drawn[b])
+        continue;
+      u32 loaded = 0;
+      for (const u16 mtx : bins[b].matrices)
+        loaded += slot_of[mtx] >= 0;
+      if (next == bins.size() || loaded > next_loaded) {
+        next = b;
+        next_loaded = loaded;
+      }
+    }
+    drawn[next] = 1;
+    const auto& bin = bins[next];
+
+    // Slots not holding a matrix of this bin may be overwritten.
+    std::vector<u8> needed(slots.size(), 0);
+    for (const u16 mtx : bin.matrices) {
+      if (slot_of[mtx] >= 0)
+        needed[slot_of[mtx]] = 1;
+    }
+    std::size_t free_slot = 0;
+    for (const u16 mtx : bin.matrices) {
+      if (slot_of[mtx] >= 0)
+        continue;
+      std::size_t slot = slots.size();
+      if (slots.size() < palette_size) {
+        // Fill empty slots before evicting anything.
+        slots.push_back(mtx);
+        needed.push_back(1);
+      } else {
+        // The bin fits the palette, so some slot is not needed.
+        while (needed[free_slot])
+          ++free_slot;
+        slot = free_slot;
+        slot_of[slots[slot]] = -1;
+        slots[slot] = mtx;
+        needed[slot] = 1;
+      }
+      slot_of[mtx] = static_cast<s32>(slot);
+    }
+
+    auto& group = groups.emplace_back();
+    group.slots.assign(slots.begin(), slots.end());
+    for (const u32 c : bin.clusters) {
+      group.triangles.insert(group.triangles.end(),
+                             clusters[c].triangles.begin(),
+                             clusters[c].triangles.end());
+    }
+    std::sort(group.triangles.begin(), group.triangles.end());
+  }
+  return groups;
+}
+
+std::vector<gx::MatrixPrimitive>
+MakeSkinnedPrimitives(std::span<const gx::IndexedVertex> vertices,
+                      u32 palette_size) {
+  constexpr auto PNM = gx::VertexAttribute::PositionNormalMatrixIndex;
+  std::vector<u16> corner_matrices(vertices.size());
+  for (std::size_t i = 0; i < vertices.size(); ++i)
+    corner_matrices[i] = vertices[i][PNM];
+
+  std::vector<gx::MatrixPrimitive> mprims;
+  for (const auto& group :
+       PartitionMatrixPalette(corner_matrices, palette_size)) {
+    auto& mp = mprims.emplace_back();
+    mp.mCurrentMatrix = -1;
+    mp.mDrawMatrixIndices.assign(group.slots.begin(), group.slots.end());
+
+    auto& tris = mp.mPrimitives.emplace_back();
+    tris.mType = gx::PrimitiveType::Triangles;
+    tris.mVertices.reserve(group.triangles.size() * 3);
+    for (const u32 t : group.triangles) {
+      for (u32 i = t * 3; i < t * 3 + 3; ++i) {
+        auto vtx = vertices[i];
+        const auto slot = std::find(group.slots.begin(), group.slots.end(),
+                                    corner_matrices[i]);
+        // PNMTXIDX addresses matrix memory in rows; matrices are three rows.
+        vtx[PNM] = static_cast<u16>((slot - group.slots.begin()) * 3);
+        tris.mVertices.push_back(vtx);
+      }
+    }
+  }
+  return mprims;
+}
+
+} // namespace librii::gpu
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <core/common.h>
+#include <librii/gx.h>
+#include <span>
+#include <vector>
+
+namespace librii::gpu {
+
+// Position matrices GX can address through PNMTXIDX
+constexpr u32 MaxPaletteSize = 10;
+
+struct PaletteGroup {
+  // Draw matrix loaded into each slot. A slot keeps its matrix from the
+  // previous group unless the slot is needed for a new one.
+  std::vector<u16> slots;
+  // Triangles drawn with this palette, in input order
+  std::vector<u32> triangles;
+};
+
+// Splits a skinned triangle list into groups whose draw matrices fit a
+// matrix palette, in the order they should be drawn.
+//
+// Triangles using the same matrices are kept together and packed so that
+// each group shares as many matrices as it can. Groups are then ordered so
+// that matrices already loaded stay in their slots.
+//
+// corner_matrices holds the draw matrix of every corner, three per triangle.
+std::vector<PaletteGroup>
+PartitionMatrixPalette(std::span<const u16> corner_matrices,
+                       u32 palette_size = MaxPaletteSize);
+
+// Splits a triangle list whose PNMTXIDX holds draw matrix indices into
+// matrix primitives, each with a palette and PNMTXIDX pointing into it.
+std::vector<gx::MatrixPrimitive>
+MakeSkinnedPrimitives(std::span<const gx::IndexedVertex> vertices,
+                      u32 palette_size = MaxPaletteSize);
+
+} // namespace librii::gpu
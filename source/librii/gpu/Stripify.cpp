@@ -0,0 +1,285 @@
+#include "Stripify.hpp"
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace librii::gpu {
+
+namespace {
+
+// GX takes a 16-bit vertex count per primitive.
+constexpr std::size_t MaxPrimitiveVertices = 0xFFFF;
+
+using Triangle = std::array<u32, 3>;
+
+class Stripifier {
+public:
+  Stripifier(std::vector<Triangle> tris) : mTris(std::move(tris)) {
+    buildEdges();
+  }
+
+  // Strips and fans as vertex sequences, and the triangles left over
+  void run(std::vector<std::pair<gx::PrimitiveType, std::vector<u32>>>& prims,
+           std::vector<u32>& leftover);
+
+private:
+  static u64 edgeKey(u32 from, u32 to) { return (u64(from) << 32) | to; }
+
+  void buildEdges();
+  bool isFree(u32 tri) const {
+    return !mUsed[tri] && mTrialStamp[tri] != mTrial;
+  }
+  // An unused triangle with the directed edge from -> to, preferring the one
+  // with the fewest free neighbours. Returns {triangle, third vertex}.
+  std::pair<s64, u32> findNext(u32 from, u32 to) const;
+  // Longest strip (or fan) starting with `tri` rotated by `rot`.
+  void extend(u32 tri, int rot, bool fan, std::vector<u32>& seq,
+              std::vector<u32>& seq_tris);
+  void markUsed(u32 tri);
+
+  std::vector<Triangle> mTris;
+  std::vector<u8> mUsed;
+  // Neighbours not yet used
+  std::vector<u32> mFreeNeighbours;
+  // Triangles holding each directed edge, as ranges of mEdgeTris
+  std::unordered_map<u64, std::pair<u32, u32>> mEdges;
+  std::vector<u32> mEdgeTris;
+  // Triangles taken by the strip currently being tried
+  std::vector<u32> mTrialStamp;
+  u32 mTrial = 0;
+};
+
+void Stripifier::buildEdges() {
+  const u32 num_tris = static_cast<u32>(mTris.size());
+  std::vector<std::pair<u64, u32>> edges;
+  edges.reserve(num_tris * 3);
+  for (u32 t = 0; t < num_tris; ++t) {
+    const auto& tri = mTris[t];
+    for (int i = 0; i < 3; ++i)
+      edges.emplace_back(edgeKey(tri[i], tri[(i + 1) % 3]), t);
+  }
+  std::sort(edges.begin(), edges.end());
+  mEdgeTris.reserve(edges.size());
+  for (std::size_t i = 0; i < edges.size();) {
+    const u64 key = edges[i].first;
+    const u32 begin = static_cast<u32>(mEdgeTris.size());
+    for (; i < edges.size() && edges[i].first == key; ++i)
+      mEdgeTris.push_back(edges[i].second);
+    mEdges.emplace(key, std::make_pair(begin, (u32)mEdgeTris.size()));
+  }
+
+  mUsed.assign(num_tris, 0);
+  mTrialStamp.assign(num_tris, ~0u);
+  mFreeNeighbours.assign(num_tris, 0);
+  for (u32 t = 0; t < num_tris; ++t) {
+    const auto& tri = mTris[t];
+    for (int i = 0; i < 3; ++i) {
+      const auto it = mEdges.find(edgeKey(tri[(i + 1) % 3], tri[i]));
+      if (it != mEdges.end())
+        mFreeNeighbours[t] += it->second.second - it->second.first;
+    }
+  }
+}
+
+std::pair<s64, u32> Stripifier::findNext(u32 from, u32 to) const {
+  const auto it = mEdges.find(edgeKey(from, to));
+  if (it == mEdges.end())
+    return {-1, 0};
+  s64 best = -1;
+  u32 third = 0;
+  for (u32 i = it->second.first; i < it->second.second; ++i) {
+    const u32 t = mEdgeTris[i];
+    if (!isFree(t))
+      continue;
+    if (best >= 0 && mFreeNeighbours[t] >= mFreeNeighbours[best])
+      continue;
+    best = t;
+    const auto& tri = mTris[t];
+    for (int j = 0; j < 3; ++j) {
+      if (tri[j] == from && tri[(j + 1) % 3] == to)
+        third = tri[(j + 2) % 3];
+    }
+  }
+  return {best, third};
+}
+
+void Stripifier::extend(u32 tri, int rot, bool fan, std::vector<u32>& seq,
+                        std::vector<u32>& seq_tris) {
+  ++mTrial;
+  const auto& first = mTris[tri];
+  seq = {first[rot], first[(rot + 1) % 3], first[(rot + 2) % 3]};
+  seq_tris = {tri};
+  mTrialStamp[tri] = mTrial;
+
+  while (seq.size() < MaxPrimitiveVertices) {
+    const std::size_t n = seq.size();
+    // The next triangle of a strip is flipped when it starts at an odd index.
+    std::pair<s64, u32> next;
+    if (fan)
+      next = findNext(seq[0], seq[n - 1]);
+    else if ((n - 2) % 2 == 0)
+      next = findNext(seq[n - 2], seq[n - 1]);
+    else
+      next = findNext(seq[n - 1], seq[n - 2]);
+    if (next.first < 0)
+      break;
+    seq.push_back(next.second);
+    seq_tris.push_back(static_cast<u32>(next.first));
+    mTrialStamp[next.first] = mTrial;
+  }
+}
+
+void Stripifier::markUsed(u32 t) {
+  mUsed[t] = 1;
+  const auto& tri = mTris[t];
+  for (int i = 0; i < 3; ++i) {
+    const auto it = mEdges.find(edgeKey(tri[(i + 1) % 3], tri[i]));
+    if (it == mEdges.end())
+      continue;
+    for (u32 j = it->second.first; j < it->second.second; ++j)
+      --mFreeNeighbours[mEdgeTris[j]];
+  }
+}
+
+void Stripifier::run(
+    std::vector<std::pair<gx::PrimitiveType, std::vector<u32>>>& prims,
+    std::vector<u32>& leftover) {
+  const u32 num_tris = static_cast<u32>(mTris.size());
+
+  // Start from the triangles with the fewest free neighbours, so that strips
+  // do not strand them. Buckets are refreshed lazily.
+  constexpr u32 NumBuckets = 4;
+  std::array<std::vector<u32>, NumBuckets> buckets;
+  auto bucketOf = [&](u32 t) { return std::min(mFreeNeighbours[t], 3u); };
+  for (u32 t = num_tris; t-- > 0;)
+    buckets[bucketOf(t)].push_back(t);
+
+  std::vector<u32> seq, seq_tris, best_seq, best_tris;
+  std::vector<u32> lone;
+  gx::PrimitiveType best_type = gx::PrimitiveType::TriangleStrip;
+  for (;;) {
+    s64 start = -1;
+    for (u32 b = 0; b < NumBuckets && start < 0; ++b) {
+      while (!buckets[b].empty()) {
+        const u32 t = buckets[b].back();
+        buckets[b].pop_back();
+        if (mUsed[t])
+          continue;
+        if (bucketOf(t) != b) {
+          buckets[bucketOf(t)].push_back(t);
+          continue;
+        }
+        start = t;
+        break;
+      }
+    }
+    if (start < 0)
+      break;
+
+    best_seq.clear();
+    for (bool fan : {false, true}) {
+      for (int rot = 0; rot < 3; ++rot) {
+        extend(static_cast<u32>(start), rot, fan, seq, seq_tris);
+        if (seq.size() > best_seq.size()) {
+          std::swap(seq, best_seq);
+          std::swap(seq_tris, best_tris);
+          best_type = fan ? gx::PrimitiveType::TriangleFan
+                          : gx::PrimitiveType::TriangleStrip;
+        }
+      }
+    }
+
+    for (const u32 t : best_tris) {
+      markUsed(t);
+      // Neighbours may now belong in a lower bucket.
+      const auto& tri = mTris[t];
+      for (int i = 0; i < 3; ++i) {
+        const auto it = mEdges.find(edgeKey(tri[(i + 1) % 3], tri[i]));
+        if (it == mEdges.end())
+          continue;
+        for (u32 j = it->second.first; j < it->second.second; ++j) {
+          if (!mUsed[mEdgeTris[j]])
+            buckets[bucketOf(mEdgeTris[j])].push_back(mEdgeTris[j]);
+        }
+      }
+    }
+    if (best_tris.size() == 1)
+      lone.push_back(best_tris[0]);
+    else
+      prims.emplace_back(best_type, best_seq);
+  }
+
+  // Lone triangles keep their original order.
+  std::sort(lone.begin(), lone.end());
+  for (const u32 t : lone)
+    leftover.insert(leftover.end(), mTris[t].begin(), mTris[t].end());
+}
+
+} // namespace
+
+void StripifyTriangles(gx::MatrixPrimitive& mprim) {
+  std::vector<gx::IndexedVertex> verts;
+  std::unordered_map<gx::IndexedVertex, u32, gx::IndexedVertexHash> welded;
+  auto weld = [&](const gx::IndexedVertex& v) {
+    const auto [it, inserted] =
+        welded.emplace(v, static_cast<u32>(verts.size()));
+    if (inserted)
+      verts.push_back(v);
+    return it->second;
+  };
+
+  std::vector<gx::IndexedPrimitive> kept;
+  std::vector<Triangle> tris;
+  // Degenerate triangles cannot be shared by strips; they are drawn as is.
+  std::vector<gx::IndexedVertex> degenerate;
+  for (auto& prim : mprim.mPrimitives) {
+    if (prim.mType != gx::PrimitiveType::Triangles) {
+      kept.push_back(std::move(prim));
+      continue;
+    }
+    ForEachTriangle(prim, [&](const gx::IndexedVertex& a,
+                              const gx::IndexedVertex& b,
+                              const gx::IndexedVertex& c) {
+      if (a == b || b == c || a == c) {
+        degenerate.insert(degenerate.end(), {a, b, c});
+        return;
+      }
+      tris.push_back({weld(a), weld(b), weld(c)});
+    });
+  }
+  if (tris.empty() && degenerate.empty())
+    return;
+
+  std::vector<std::pair<gx::PrimitiveType, std::vector<u32>>> prims;
+  std::vector<u32> leftover;
+  Stripifier(std::move(tris)).run(prims, leftover);
+
+  mprim.mPrimitives = std::move(kept);
+  for (const auto& [type, seq] : prims) {
+    auto& prim = mprim.mPrimitives.emplace_back(type, seq.size());
+    for (std::size_t i = 0; i < seq.size(); ++i)
+      prim.mVertices[i] = verts[seq[i]];
+  }
+
+  std::vector<gx::IndexedVertex> list;
+  list.reserve(leftover.size() + degenerate.size());
+  for (const u32 idx : leftover)
+    list.push_back(verts[idx]);
+  list.insert(list.end(), degenerate.begin(), degenerate.end());
+  // Lists are split at the last whole triangle under the vertex limit.
+  constexpr std::size_t ListChunk = MaxPrimitiveVertices / 3 * 3;
+  for (std::size_t i = 0; i < list.size(); i += ListChunk) {
+    const std::size_t count = std::min(ListChunk, list.size() - i);
+    auto& prim = mprim.mPrimitives.emplace_back();
+    prim.mType = gx::PrimitiveType::Triangles;
+    prim.mVertices.assign(list.begin() + i, list.begin() + i + count);
+  }
+}
+
+void StripifyTriangles(gx::MeshData& mesh) {
+  for (auto& mprim : mesh.mMatrixPrimitives)
+    StripifyTriangles(mprim);
+}
+
+} // namespace librii::gpu
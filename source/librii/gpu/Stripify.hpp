@@ -0,0 +1,46 @@
+#pragma once
+
+#include <librii/gx.h>
+
+namespace librii::gpu {
+
+// Calls f(a, b, c) for every triangle of a primitive, in the winding it is
+// rasterized with. Primitives other than triangles are skipped.
+template <typename F>
+void ForEachTriangle(const gx::IndexedPrimitive& prim, F&& f) {
+  const auto& v = prim.mVertices;
+  if (v.size() < 3)
+    return;
+  switch (prim.mType) {
+  case gx::PrimitiveType::Triangles:
+    for (std::size_t i = 0; i + 2 < v.size(); i += 3)
+      f(v[i], v[i + 1], v[i + 2]);
+    break;
+  case gx::PrimitiveType::TriangleStrip:
+    // Every other triangle is flipped to keep the winding.
+    for (std::size_t i = 2; i < v.size(); ++i) {
+      if (i & 1)
+        f(v[i - 1], v[i - 2], v[i]);
+      else
+        f(v[i - 2], v[i - 1], v[i]);
+    }
+    break;
+  case gx::PrimitiveType::TriangleFan:
+    for (std::size_t i = 2; i < v.size(); ++i)
+      f(v[0], v[i - 1], v[i]);
+    break;
+  default:
+    break;
+  }
+}
+
+// Rewrites the triangle lists of a matrix primitive as strips and fans.
+//
+// Strips never leave the matrix primitive they start in, so every vertex
+// keeps its matrix palette. Triangles keep their winding. Triangles that join
+// no strip or fan are drawn as one list after them. Other primitives are left
+// as they are.
+void StripifyTriangles(gx::MatrixPrimitive& mprim);
+void StripifyTriangles(gx::MeshData& mesh);
+
+} // namespace librii::gpu
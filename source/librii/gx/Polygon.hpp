@@ -3,6 +3,7 @@
 #include <array>
 #include <librii/gx/Vertex.hpp>
 #include <map>
+#include <rsl/CowVector.hpp>
 #include <tuple>
 #include <vector>
 
@@ -56,9 +57,21 @@ private:
   std::array<u16, (u64)VertexAttribute::Max> indices;
 };
 
+struct IndexedVertexHash {
+  std::size_t operator()(const IndexedVertex& vtx) const {
+    // FNV-1a
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < (u32)VertexAttribute::Max; ++i) {
+      hash ^= vtx[static_cast<VertexAttribute>(i)];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+};
+
 struct IndexedPrimitive {
   PrimitiveType mType;
-  std::vector<IndexedVertex> mVertices;
+  rsl::cow_vector<IndexedVertex> mVertices;
 
   IndexedPrimitive() = default;
   IndexedPrimitive(PrimitiveType type, u64 size)
@@ -3,6 +3,7 @@
 #include <core/common.h>
 #include <oishii/reader/binary_reader.hxx>
 #include <oishii/writer/binary_writer.hxx>
+#include <rsl/CowVector.hpp>
 #include <vendor/glm/vec3.hpp>
 
 namespace librii::gx {
@@ -370,7 +371,7 @@ using VBufferKind = VertexBufferKind;
 
 template <typename TB, VBufferKind kind> struct VertexBuffer {
   VQuantization mQuant;
-  std::vector<TB> mData;
+  rsl::cow_vector<TB> mData;
 
   int ComputeComponentCount() const {
     return computeComponentCount(kind, mQuant.comp);
@@ -0,0 +1,111 @@
+#include "VertexQuantize.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace librii::gx {
+
+namespace {
+
+// 1 << divisor must fit an int in the vertex writer.
+constexpr u32 MaxDivisor = 30;
+
+struct Candidate {
+  VertexBufferType::Generic type;
+  f32 lo;
+  f32 hi;
+};
+
+// Ordered by size: the first passing group wins.
+constexpr Candidate Candidates[2][2] = {
+    {{VertexBufferType::Generic::u8, 0.0f, 255.0f},
+     {VertexBufferType::Generic::s8, -128.0f, 127.0f}},
+    {{VertexBufferType::Generic::u16, 0.0f, 65535.0f},
+     {VertexBufferType::Generic::s16, -32768.0f, 32767.0f}},
+};
+
+// Whether [min, max] still rounds into [lo, hi] once scaled.
+bool Fits(const Candidate& c, f32 min, f32 max, f32 scale) {
+  return std::roundf(min * scale) >= c.lo && std::roundf(max * scale) <= c.hi;
+}
+
+// Largest error of the values written and read back as the vertex writer and
+// reader do, or nothing once it exceeds the tolerance.
+std::optional<f32> MeasureError(std::span<const f32> values, u32 stride,
+                                u32 num_components, const Candidate& c,
+                                u32 divisor, f32 tolerance) {
+  const f32 scale = static_cast<f32>(1 << divisor);
+  f32 max_error = 0.0f;
+  for (std::size_t i = 0; i + num_components <= values.size(); i += stride) {
+    for (u32 j = 0; j < num_components; ++j) {
+      const f32 v = values[i + j];
+      const f32 q = std::roundf(v * scale);
+      if (!(q >= c.lo && q <= c.hi))
+        return std::nullopt;
+      const f32 error = std::fabs(q / scale - v);
+      if (!(error <= tolerance))
+        return std::nullopt;
+      max_error = std::max(max_error, error);
+    }
+  }
+  return max_error;
+}
+
+} // namespace
+
+std::pair<f32, f32> FindBounds(std::span<const f32> values, u32 stride,
+                               u32 num_components) {
+  f32 min = std::numeric_limits<f32>::infinity();
+  f32 max = -std::numeric_limits<f32>::infinity();
+  for (std::size_t i = 0; i + num_components <= values.size(); i += stride) {
+    for (u32 j = 0; j < num_components; ++j) {
+      min = std::min(min, values[i + j]);
+      max = std::max(max, values[i + j]);
+    }
+  }
+  return {min, max};
+}
+
+std::optional<FixedPointFormat>
+ChooseFixedPointFormat(std::span<const f32> values, u32 stride,
+                       u32 num_components, f32 min, f32 max, f32 tolerance,
+                       VertexBufferKind kind) {
+  if (!(tolerance > 0.0f) || values.empty() || !std::isfinite(min) ||
+      !std::isfinite(max))
+    return std::nullopt;
+
+  for (const auto& group : Candidates) {
+    std::optional<FixedPointFormat> best;
+    for (const auto& c : group) {
+      u32 divisor = 0;
+      if (kind == VertexBufferKind::normal) {
+        if (c.type == VertexBufferType::Generic::s8)
+          divisor = 6;
+        else if (c.type == VertexBufferType::Generic::s16)
+          divisor = 14;
+        else
+          continue;
+        if (!Fits(c, min, max, static_cast<f32>(1 << divisor)))
+          continue;
+      } else {
+        if (!Fits(c, min, max, 1.0f))
+          continue;
+        while (divisor < MaxDivisor &&
+               Fits(c, min, max, static_cast<f32>(1 << (divisor + 1))))
+          ++divisor;
+      }
+
+      // The bounds only pick the divisor; the error of every value is
+      // measured.
+      const auto error =
+          MeasureError(values, stride, num_components, c, divisor, tolerance);
+      if (error && (!best || *error < best->max_error))
+        best = FixedPointFormat{c.type, static_cast<u8>(divisor), *error};
+    }
+    if (best)
+      return best;
+  }
+  return std::nullopt;
+}
+
+} // namespace librii::gx
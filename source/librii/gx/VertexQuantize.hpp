@@ -0,0 +1,71 @@
+#pragma once
+
+#include <librii/gx.h>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace librii::gx {
+
+// Largest error allowed when exporting float buffers as fixed point, in the
+// units of each attribute. Zero keeps the buffer as f32.
+struct QuantizeTolerance {
+  f32 position = 0.0f;
+  f32 normal = 0.0f;
+  f32 texcoord = 0.0f;
+
+  f32 get(VertexBufferKind kind) const {
+    switch (kind) {
+    case VertexBufferKind::position:
+      return position;
+    case VertexBufferKind::normal:
+      return normal;
+    case VertexBufferKind::textureCoordinate:
+      return texcoord;
+    default:
+      return 0.0f;
+    }
+  }
+
+  bool operator==(const QuantizeTolerance&) const = default;
+};
+
+struct FixedPointFormat {
+  VertexBufferType::Generic type;
+  u8 divisor;
+  // Largest difference between a value and its fixed point encoding
+  f32 max_error;
+
+  // Bytes per component
+  u32 componentSize() const {
+    return type == VertexBufferType::Generic::u8 ||
+                   type == VertexBufferType::Generic::s8
+               ? 1
+               : 2;
+  }
+};
+
+// Smallest and largest of the first `num_components` of every entry
+std::pair<f32, f32> FindBounds(std::span<const f32> values, u32 stride,
+                               u32 num_components);
+
+// Picks the smallest component type, and the finest divisor that type can hold
+// [min, max] with, such that every value is encoded within `tolerance`.
+//
+// Values are `stride` floats apart, of which the first `num_components` are
+// written. Normals only use the layouts GX expects for them: s8 with a divisor
+// of 6, or s16 with 14. Returns nothing if no type is precise enough.
+std::optional<FixedPointFormat>
+ChooseFixedPointFormat(std::span<const f32> values, u32 stride,
+                       u32 num_components, f32 min, f32 max, f32 tolerance,
+                       VertexBufferKind kind);
+
+template <glm::length_t L>
+std::span<const f32> FlattenComponents(std::span<const glm::vec<L, f32>> v) {
+  static_assert(sizeof(glm::vec<L, f32>) == L * sizeof(f32));
+  if (v.empty())
+    return {};
+  return {&v.data()->x, v.size() * L};
+}
+
+} // namespace librii::gx
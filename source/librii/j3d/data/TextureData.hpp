@@ -2,6 +2,7 @@
 
 #include <core/common.h>
 #include <librii/gx.h>
+#include <rsl/CowVector.hpp>
 #include <string>
 #include <vector>
 
@@ -27,7 +28,7 @@ struct TextureData {
   s8 mMaxLod;
   u8 mImageCount = 1;
 
-  std::vector<u8> mData = std::vector<u8>(
+  rsl::cow_vector<u8> mData = rsl::cow_vector<u8>(
       librii::gx::computeImageSize(mWidth, mHeight, mFormat, mImageCount));
 
   bool operator==(const TextureData&) const = default;
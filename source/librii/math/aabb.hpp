@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vendor/glm/common.hpp>
+#include <vendor/glm/mat4x4.hpp>
 #include <vendor/glm/vec3.hpp>
 
 namespace librii::math {
@@ -24,8 +26,22 @@ struct AABB {
 
   bool operator==(const AABB& rhs) const = default;
 
-  glm::vec3 min;
-  glm::vec3 max;
+  glm::vec3 min{0.0f};
+  glm::vec3 max{0.0f};
 };
 
+//! Bounds of a box after an affine transformation (translation included).
+//!
+inline AABB TransformAABB(const AABB& box, const glm::mat4& mtx) {
+  const glm::vec3 center = (box.min + box.max) * 0.5f;
+  const glm::vec3 extent = (box.max - box.min) * 0.5f;
+
+  const glm::vec3 new_center = glm::vec3(mtx * glm::vec4(center, 1.0f));
+  glm::vec3 new_extent{0.0f};
+  for (int i = 0; i < 3; ++i)
+    new_extent += glm::abs(glm::vec3(mtx[i])) * extent[i];
+
+  return {new_center - new_extent, new_center + new_extent};
+}
+
 } // namespace librii::math
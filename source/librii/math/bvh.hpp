@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <core/common.h>
+#include <librii/math/aabb.hpp>
+#include <librii/math/frustum.hpp>
+#include <numeric>
+#include <span>
+#include <vector>
+
+namespace librii::math {
+
+//! Bounding volume hierarchy over a fixed set of boxes. Queries report the
+//! indices of the boxes, as passed to build().
+//!
+class BVH {
+public:
+  static constexpr u32 MaxLeafSize = 4;
+
+  void build(std::span<const AABB> boxes) {
+    mNodes.clear();
+    mBoxes.assign(boxes.begin(), boxes.end());
+    mIndices.resize(boxes.size());
+    std::iota(mIndices.begin(), mIndices.end(), 0);
+
+    if (boxes.empty())
+      return;
+
+    mNodes.reserve(boxes.size() * 2);
+    buildNode(boxes, 0, static_cast<u32>(boxes.size()));
+  }
+
+  bool empty() const { return mNodes.empty(); }
+
+  //! Call `visit(index)` for every box that intersects the frustum.
+  //!
+  template <typename F> void query(const Frustum& frustum, F&& visit) const {
+    if (!mNodes.empty())
+      queryNode(0, frustum, visit, false);
+  }
+
+private:
+  struct Node {
+    AABB bound;
+    // Leaves: range of mIndices
+    u32 first = 0;
+    u32 count = 0;
+    // Interior nodes: the left child directly follows its parent
+    u32 right = 0;
+  };
+
+  u32 buildNode(std::span<const AABB> boxes, u32 first, u32 count) {
+    const auto index = static_cast<u32>(mNodes.size());
+    mNodes.emplace_back();
+
+    AABB bound = boxes[mIndices[first]];
+    for (u32 i = first + 1; i < first + count; ++i)
+      bound.expandBound(boxes[mIndices[i]]);
+
+    if (count <= MaxLeafSize) {
+      mNodes[index] = {.bound = bound, .first = first, .count = count};
+      return index;
+    }
+
+    // Median split along the longest axis
+    const glm::vec3 size = bound.max - bound.min;
+    const int axis = size.x >= size.y && size.x >= size.z ? 0
+                     : size.y >= size.z                   ? 1
+                                                          : 2;
+    const u32 mid = first + count / 2;
+    std::nth_element(mIndices.begin() + first, mIndices.begin() + mid,
+                     mIndices.begin() + first + count, [&](u32 l, u32 r) {
+                       return boxes[l].min[axis] + boxes[l].max[axis] <
+                              boxes[r].min[axis] + boxes[r].max[axis];
+                     });
+
+    buildNode(boxes, first, mid - first);
+    const u32 right = buildNode(boxes, mid, first + count - mid);
+
+    mNodes[index] = {.bound = bound, .right = right};
+    return index;
+  }
+
+  template <typename F>
+  void queryNode(u32 index, const Frustum& frustum, F& visit,
+                 bool inside) const {
+    const Node& node = mNodes[index];
+
+    // Once a node is fully inside, its children need not be tested.
+    if (!inside) {
+      const auto test = frustum.test(node.bound);
+      if (test == Frustum::Test::Outside)
+        return;
+      inside = test == Frustum::Test::Inside;
+    }
+
+    if (node.count != 0) {
+      for (u32 i = node.first; i < node.first + node.count; ++i) {
+        if (inside || frustum.intersects(mBoxes[mIndices[i]]))
+          visit(mIndices[i]);
+      }
+      return;
+    }
+
+    queryNode(index + 1, frustum, visit, inside);
+    queryNode(node.right, frustum, visit, inside);
+  }
+
+  std::vector<Node> mNodes;
+  std::vector<u32> mIndices;
+  std::vector<AABB> mBoxes;
+};
+
+} // namespace librii::math
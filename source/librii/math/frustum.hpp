@@ -0,0 +1,63 @@
+#pragma once
+
+#include <array>
+#include <librii/math/aabb.hpp>
+#include <vendor/glm/geometric.hpp>
+#include <vendor/glm/mat4x4.hpp>
+#include <vendor/glm/vec4.hpp>
+
+namespace librii::math {
+
+//! View frustum, stored as six inward-facing planes.
+//!
+struct Frustum {
+  enum class Test { Outside, Intersects, Inside };
+
+  //! Extract the planes of a combined projection * view matrix (OpenGL clip
+  //! space). Boxes are tested in the space that matrix transforms from.
+  //!
+  static Frustum FromMatrix(const glm::mat4& mtx) {
+    const auto row = [&](int i) {
+      return glm::vec4(mtx[0][i], mtx[1][i], mtx[2][i], mtx[3][i]);
+    };
+
+    Frustum frustum;
+    frustum.planes = {row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                      row(3) - row(1), row(3) + row(2), row(3) - row(2)};
+    for (auto& plane : frustum.planes) {
+      const float len = glm::length(glm::vec3(plane));
+      if (len > 0.0f)
+        plane /= len;
+    }
+    return frustum;
+  }
+
+  Test test(const AABB& box) const {
+    Test result = Test::Inside;
+
+    for (const auto& plane : planes) {
+      const glm::vec3 n{plane};
+      // The corners furthest along and against the plane normal
+      const glm::vec3 front{n.x >= 0.0f ? box.max.x : box.min.x,
+                            n.y >= 0.0f ? box.max.y : box.min.y,
+                            n.z >= 0.0f ? box.max.z : box.min.z};
+      const glm::vec3 back{n.x >= 0.0f ? box.min.x : box.max.x,
+                           n.y >= 0.0f ? box.min.y : box.max.y,
+                           n.z >= 0.0f ? box.min.z : box.max.z};
+
+      if (glm::dot(n, front) + plane.w < 0.0f)
+        return Test::Outside;
+      if (glm::dot(n, back) + plane.w < 0.0f)
+        result = Test::Intersects;
+    }
+
+    return result;
+  }
+
+  bool intersects(const AABB& box) const { return test(box) != Test::Outside; }
+
+  //! xyz: normal, w: distance
+  std::array<glm::vec4, 6> planes;
+};
+
+} // namespace librii::math
@@ -1,5 +1,4 @@
 #include "RHST.hpp"
-#include <cstring> // memcpy
 #include <oishii/reader/binary_reader.hxx>
 #include <rsl/TaggedUnion.hpp>
 
@@ -764,9 +763,8 @@ private:
 
 std::optional<SceneTree> ReadSceneTree(std::span<const u8> file_data,
                                        std::string& error_message) {
-  std::vector<u8> data_vec(file_data.size());
-  memcpy(data_vec.data(), file_data.data(), data_vec.size());
-  oishii::DataProvider provider(std::move(data_vec));
+  // The caller keeps `file_data` alive for the duration of the read.
+  oishii::DataProvider provider(file_data, nullptr);
 
   RHSTReader reader(provider.slice());
 
@@ -2,6 +2,7 @@
 
 #include "types.hxx"
 #include <assert.h>
+#include <memory>
 #include <span>
 #include <string>
 #include <string_view>
@@ -45,12 +46,33 @@ private:
 }; // namespace oishii
 
 //! Manages the data read from a file.
+//!
+//! The bytes are held through shared ownership, so a provider may either own
+//! its buffer outright or borrow a sub-span of another provider's buffer (e.g.
+//! a file inside an archive) without copying it.
 class DataProvider {
 public:
   //! Construct a `DataProvider` from a vector of data.
   DataProvider(std::vector<u8>&& data,
                std::string_view file_path = "<unknown file>")
-      : mData(std::move(data)), mPath(file_path) {}
+      : mPath(file_path) {
+    auto owner = std::make_shared<const std::vector<u8>>(std::move(data));
+    mData = *owner;
+    mOwner = std::move(owner);
+  }
+  //! Construct a `DataProvider` taking ownership of a raw buffer.
+  DataProvider(std::unique_ptr<u8[]>&& data, std::size_t size,
+               std::string_view file_path = "<unknown file>")
+      : mData(data.get(), size), mOwner(std::shared_ptr<const u8[]>(
+                                     std::move(data))),
+        mPath(file_path) {}
+  //! Construct a `DataProvider` over memory kept alive by `owner`.
+  //!
+  //! If `owner` is null, the caller must guarantee the memory outlives the
+  //! provider and every view of it.
+  DataProvider(std::span<const u8> data, std::shared_ptr<const void> owner,
+               std::string_view file_path = "<unknown file>")
+      : mData(data), mOwner(std::move(owner)), mPath(file_path) {}
 
   //! Get a read-only slice of the data.
   ByteView slice(std::size_t start = 0,
@@ -63,6 +85,10 @@ public:
 
   std::string_view getFilePath() const { return mPath; }
 
+  //! Shared owner of the underlying buffer. Children constructed from a
+  //! sub-span of this provider should hold onto it.
+  const std::shared_ptr<const void>& getOwner() const { return mOwner; }
+
   // For ByteView to compute file offsets.
   std::ptrdiff_t computeOffset(const u8* element) const {
     assert(element < mData.data() + mData.size() &&
@@ -73,9 +99,9 @@ public:
   }
 
 private:
-  // We don't keep track of slices, which would hold dangling pointers if mData
-  // reallocated.
-  const std::vector<u8> mData;
+  // We don't keep track of slices; the buffer is never reallocated.
+  std::span<const u8> mData;
+  std::shared_ptr<const void> mOwner;
 
   std::string mPath;
 };
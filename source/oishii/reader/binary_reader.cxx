@@ -8,6 +8,10 @@ namespace oishii {
 
 void BinaryReader::warnAt(const char* msg, u32 selectBegin, u32 selectEnd,
                           bool checkStack) {
+  if (mHoldWarnings && checkStack) {
+    mHeldWarnings.push_back({msg, selectBegin, selectEnd});
+    return;
+  }
 
   if (checkStack) // TODO, unintuitive limitation
   {
@@ -7,6 +7,7 @@
 #include <bit>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace oishii {
@@ -53,6 +54,14 @@ private:
   std::set<ErrorHandler*> mErrorHandlers;
 };
 
+//! A warning a forked reader holds back, to be replayed on the reader it was
+//! forked from.
+struct HeldWarning {
+  std::string msg;
+  u32 selectBegin = 0;
+  u32 selectEnd = 0;
+};
+
 class BinaryReader final : public AbstractStream<BinaryReader>,
                            private ErrorEmitter {
 public:
@@ -73,12 +82,34 @@ public:
   u32 startpos() { return 0; }
   u32 endpos() { return mView.size(); }
   u8* getStreamStart() { return (u8*)mView.data(); }
+  const ByteView& getView() const { return mView; }
 
   bool isInBounds(u32 pos) { return mView.isInBounds(pos); }
 
+  //! A copy that reads the same view on its own, e.g. on another thread.
+  //! Error handlers are not carried over, as they need not be thread-safe;
+  //! instead, the fork holds back its warnings (see takeWarnings).
+  BinaryReader fork() const {
+    BinaryReader out(*this);
+    static_cast<ErrorEmitter&>(out) = ErrorEmitter(*mView.getProvider());
+    out.mHoldWarnings = true;
+    return out;
+  }
+  //! The warnings a fork has held back, in the order they were raised.
+  std::vector<HeldWarning> takeWarnings() {
+    return std::exchange(mHeldWarnings, {});
+  }
+  //! Reports the warnings of a fork, once it has joined.
+  void replayWarnings(const std::vector<HeldWarning>& warnings) {
+    for (const auto& warning : warnings)
+      warnAt(warning.msg.c_str(), warning.selectBegin, warning.selectEnd);
+  }
+
 private:
   u32 mPos = 0;
   ByteView mView;
+  bool mHoldWarnings = false;
+  std::vector<HeldWarning> mHeldWarnings;
 
 public:
   template <typename T, EndianSelect E = EndianSelect::Current>
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <bit>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -85,6 +87,15 @@ public:
     seek<Whence::Current>(sz);
   }
 
+  //! Copy bytes to the stream as they are, growing it as necessary.
+  void writeBytes(std::span<const u8> bytes) {
+    if (tell() + bytes.size() > mBuf.size())
+      mBuf.resize(tell() + bytes.size());
+    breakPointProcess(static_cast<u32>(bytes.size()));
+    std::copy(bytes.begin(), bytes.end(), mBuf.begin() + tell());
+    seek<Whence::Current>(static_cast<u32>(bytes.size()));
+  }
+
   std::string mNameSpace = ""; // set by linker, stored in reservations
   std::string mBlockName = ""; // set by linker, stored in reservations
 
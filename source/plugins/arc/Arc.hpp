@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <span>
 #include <string>
 #include <vector>
@@ -14,21 +15,38 @@ namespace riistudio::arc {
 //! Note: Intended for usage with an archive -- single-ownership.
 class RawBinaryOriginator : public kpi::IMementoOriginator {
 public:
-  RawBinaryOriginator(std::span<const u8> src) : mTransient(src) {}
+  //! Borrow `src` from the buffer kept alive by `owner`. Without an owner, the
+  //! data is copied.
+  RawBinaryOriginator(std::span<const u8> src,
+                      std::shared_ptr<const void> owner = nullptr)
+      : mTransient(src, std::move(owner)) {}
   void setData(std::span<const u8> src) {
     ++mTransient.generation;
-    mTransient.data.resize(src.size());
-    std::copy(src.begin(), src.end(), mTransient.data.begin());
+    mTransient.assign(src);
   }
   std::span<const u8> getData() const { return mTransient.data; }
 
 private:
   struct Data {
     u32 generation = 0;
-    std::vector<u8> data;
+    std::span<const u8> data;
+    std::shared_ptr<const void> owner = nullptr;
 
     Data() = default;
-    Data(std::span<const u8> src) : data(src.begin(), src.end()) {}
+    Data(std::span<const u8> src, std::shared_ptr<const void> src_owner) {
+      if (src_owner == nullptr)
+        assign(src);
+      else {
+        data = src;
+        owner = std::move(src_owner);
+      }
+    }
+    void assign(std::span<const u8> src) {
+      auto buf =
+          std::make_shared<const std::vector<u8>>(src.begin(), src.end());
+      data = *buf;
+      owner = std::move(buf);
+    }
   };
   struct Memento : public kpi::IMemento {
     std::shared_ptr<const Data> data = nullptr;
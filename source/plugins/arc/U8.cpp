@@ -10,13 +10,15 @@
 
 namespace riistudio::arc::u8 {
 
+// `owner` keeps the archive's buffer alive; `data` is borrowed from it.
 static std::unique_ptr<kpi::IMementoOriginator>
-constructFile(const std::string_view path, std::span<const uint8_t> data) {
+constructFile(const std::string_view path, std::span<const uint8_t> data,
+              const std::shared_ptr<const void>& owner) {
   const auto construct_node = [&]() -> std::unique_ptr<kpi::INode> {
     if (data.empty())
       return nullptr;
     // try {
-    oishii::DataProvider provider({data.begin(), data.end()}, path);
+    oishii::DataProvider provider(data, owner, path);
     auto importer = SpawnImporter(std::string(path), provider.slice());
 
     // Don't worry about ambiguous cases for now
@@ -41,12 +43,15 @@ constructFile(const std::string_view path, std::span<const uint8_t> data) {
   if (auto node = construct_node(); node) {
     return node;
   }
-  return std::make_unique<RawBinaryOriginator>(data);
+  return std::make_unique<RawBinaryOriginator>(data, owner);
 }
 
 void readArchive(Archive& dst, oishii::BinaryReader& reader) {
   const auto start = reader.tell();
   const auto* start_ptr = reader.getStreamStart() + start;
+  const auto* provider = reader.getView().getProvider();
+  const std::shared_ptr<const void> owner =
+      provider != nullptr ? provider->getOwner() : nullptr;
 
   reader.skip(4); // skip magic
   const auto fst_start = reader.read<s32>();
@@ -154,7 +159,7 @@ void readArchive(Archive& dst, oishii::BinaryReader& reader) {
     const auto path = create_path(i);
     if (auto* file = entry.asFile(); file != nullptr) {
       DebugReport("Unpacking file %s\n", path.string().c_str());
-      dst.createFile(path, constructFile(path.string(), *file));
+      dst.createFile(path, constructFile(path.string(), *file, owner));
     }
     // Necessary for empty folders
     if (auto* folder = entry.asFolder(); folder != nullptr) {
@@ -4,6 +4,8 @@
 #include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
+#include <librii/gpu/PalettePartition.hpp>
+#include <librii/gpu/Stripify.hpp>
 #include <librii/image/CheckerBoard.hpp>
 #include <llvm/ADT/BitVector.h>
 #include <map>
@@ -31,42 +33,43 @@ int AssImporter::get_bone_id(const aiNode* pNode) {
 }
 // Only call if weighted
 u16 AssImporter::add_weight_matrix_low(const libcube::DrawMatrix& drw) {
-  const auto found = std::find(out_model->mDrawMatrices.begin(),
-                               out_model->mDrawMatrices.end(), drw);
-  if (found != out_model->mDrawMatrices.end()) {
-    return found - out_model->mDrawMatrices.begin();
-  } else {
-    out_model->mDrawMatrices.push_back(drw);
-    return out_model->mDrawMatrices.size() - 1;
+  return drw_pool.add(out_model->mDrawMatrices, drw);
+}
+const glm::mat4& AssImporter::get_inv_bind_mtx(u32 bone_id) {
+  auto [it, inserted] = inv_bind_mtx.try_emplace(bone_id);
+  if (inserted) {
+    const auto& bone = out_model->getBones()[bone_id];
+    it->second = glm::inverse(bone.calcSrtMtx(out_model->getBones()));
   }
+  return it->second;
 }
-u16 AssImporter::add_weight_matrix(int v, const aiMesh* pMesh,
-                                   libcube::DrawMatrix* pDrwOut) {
-  libcube::DrawMatrix drw;
-  for (unsigned j = 0; j < pMesh->mNumBones; ++j) {
-    const auto* pBone = pMesh->mBones[j];
+
+std::vector<libcube::DrawMatrix>
+BuildVertexInfluences(const aiMesh& mesh, std::span<const u32> bone_ids) {
+  std::vector<libcube::DrawMatrix> influences(mesh.mNumVertices);
+  // Last bone to weight each vertex
+  std::vector<unsigned> last_bone(mesh.mNumVertices, ~0u);
+  for (unsigned j = 0; j < mesh.mNumBones; ++j) {
+    const auto* pBone = mesh.mBones[j];
 
     for (unsigned k = 0; k < pBone->mNumWeights; ++k) {
-      const auto* pWeight = &pBone->mWeights[k];
-      if (pWeight->mVertexId == v) {
-        const auto boneid = get_bone_id(pBone->mNode);
-        assert(boneid != -1);
-        drw.mWeights.emplace_back(boneid, pWeight->mWeight);
-        break;
-      }
+      const auto& weight = pBone->mWeights[k];
+      const auto v = weight.mVertexId;
+      if (v >= mesh.mNumVertices || last_bone[v] == j)
+        continue;
+      last_bone[v] = j;
+      influences[v].mWeights.emplace_back(bone_ids[j], weight.mWeight);
     }
   }
-  if (pDrwOut != nullptr)
-    *pDrwOut = drw;
-  return add_weight_matrix_low(drw);
-};
+  return influences;
+}
 
 void AssImporter::ProcessMeshTrianglesStatic(
     const aiNode* singleInfluence, libcube::IndexedPolygon& poly_data,
     std::vector<librii::gx::IndexedVertex>&& vertices) {
   auto& mp = poly_data.getMeshData().mMatrixPrimitives.emplace_back();
   // Copy triangle data
-  // We will do triangle-stripping in a post-process
+  // Triangles are stripped in ProcessMeshTriangles
   auto& tris = mp.mPrimitives.emplace_back();
   tris.mType = librii::gx::PrimitiveType::Triangles;
   tris.mVertices = std::move(vertices);
@@ -81,103 +84,11 @@ void AssImporter::ProcessMeshTrianglesStatic(
 void AssImporter::ProcessMeshTrianglesWeighted(
     libcube::IndexedPolygon& poly_data,
     std::vector<librii::gx::IndexedVertex>&& vertices) {
-
   // At this point, the mtx index of vertices is global.
   // We need to convert it to a local palette index.
-  // Tolerence should be implemented here, eventually.
-
-  std::vector<u16> matrix_indices;
-
-  for (auto& v : vertices) {
-    const auto mtx_idx = v[PNM];
-
-    // Hack: We will come across data as such (assume 3-wide sweep)
-    // (A B B) (C A D)
-    // To prevent this transforming into
-    // (A B C) (D)
-    // Where references to A in the second sweep will fail,
-    // we simply don't compress across sweeps:
-    // (A B B) (C A D)
-    // (A B C) (A D)
-    // It's far from optimal, but the current choice:
-    const std::size_t sweep_id = matrix_indices.size() / 10;
-    const std::size_t sweep_begin = sweep_id * 10;
-    const std::size_t sweep_end =
-        std::min(matrix_indices.size(), (sweep_id + 1) * 10);
-    const auto found = std::find(matrix_indices.begin() + sweep_begin,
-                                 matrix_indices.begin() + sweep_end, mtx_idx);
-
-    if (found == matrix_indices.end()) {
-      matrix_indices.push_back(mtx_idx);
-    }
-  }
-
-  auto vertex_sweep_index = [&](int v, int sweep) -> int {
-    const auto found = std::find(
-        matrix_indices.begin() + sweep * 10,
-        matrix_indices.begin() +
-            std::min(static_cast<int>(matrix_indices.size()), (sweep + 1) * 10),
-        vertices[v][PNM]);
-
-    if (found == matrix_indices.end())
-      return -1;
-    const auto idx = std::distance(matrix_indices.begin(), found);
-    // Old code not based on sweep-specific search
-    // if (idx >= sweep * 10 && idx < (sweep + 1) * 10) {
-    //   // We're inside the sweep;
-    //   return idx - sweep * 10;
-    // }
-    // We're outside the sweep:
-    // return -1;
-    return idx;
-  };
-  assert(vertices.size() % 3 == 0);
-  int sweep_wave = 0;
-  bool reversed = false;
-  int last_sweep_vtx = 0;
-  for (int f = 0; f < vertices.size() / 3; ++f) {
-    const int v0 = f * 3 + 0;
-    const int v1 = f * 3 + 1;
-    const int v2 = f * 3 + 2;
-
-    const int s0 = vertex_sweep_index(v0, sweep_wave);
-    const int s1 = vertex_sweep_index(v1, sweep_wave);
-    const int s2 = vertex_sweep_index(v2, sweep_wave);
-
-    if (s0 < 0 || s1 < 0 || s2 < 0) {
-      assert(s0 != -2 && s1 != -2 && s2 != -2 &&
-             "matrix_indices has not been properly filled");
-
-      // But submit what we have so far, first:
-      auto& mp = poly_data.getMeshData().mMatrixPrimitives.emplace_back();
-      auto& tris = mp.mPrimitives.emplace_back();
-      tris.mType = librii::gx::PrimitiveType::Triangles;
-      std::copy(vertices.begin() + last_sweep_vtx, vertices.begin() + v0,
-                std::back_inserter(tris.mVertices));
-      last_sweep_vtx = v0;
-      mp.mCurrentMatrix = -1;
-      const auto sweep_begin = sweep_wave * 10;
-      const auto sweep_end = std::min((sweep_wave + 1) * 10,
-                                      static_cast<int>(matrix_indices.size()));
-
-      std::copy(matrix_indices.begin() + sweep_begin,
-                matrix_indices.begin() + sweep_end,
-                std::back_inserter(mp.mDrawMatrixIndices));
-
-      // Reverse one step, but in the next wave:
-      assert(!reversed && "matrix_indices is unsorted");
-      --f;
-      ++sweep_wave;
-      reversed = true;
-
-      continue;
-    }
-
-    reversed = false;
-    vertices[v0][PNM] = s0;
-    vertices[v0][PNM] = s1;
-    vertices[v0][PNM] = s2;
-  }
+  auto& mprims = poly_data.getMeshData().mMatrixPrimitives;
+  for (auto& mp : librii::gpu::MakeSkinnedPrimitives(vertices))
+    mprims.push_back(std::move(mp));
 }
 
 void AssImporter::ProcessMeshTriangles(
@@ -193,6 +104,7 @@ void AssImporter::ProcessMeshTriangles(
     ProcessMeshTrianglesStatic(single_influence, poly_data,
                                std::move(vertices));
   }
+  librii::gpu::StripifyTriangles(poly_data.getMeshData());
 }
 
 bool AssImporter::ImportMesh(const aiMesh* pMesh, const aiNode* pNode,
@@ -244,10 +156,7 @@ bool AssImporter::ImportMesh(const aiMesh* pMesh, const aiNode* pNode,
     // This assumes that meshes will not be influenced by their children? This
     // could be a bad assumption..
     if (wt != nullptr && wt->mWeights.size() == 1) {
-      const auto& acting_influence =
-          out_model->getBones()[wt->mWeights[0].boneId];
-      pos = glm::vec4(pos, 0) *
-            glm::inverse(acting_influence.calcSrtMtx(out_model->getBones()));
+      pos = glm::vec4(pos, 0) * get_inv_bind_mtx(wt->mWeights[0].boneId);
     }
 
     return poly.addPos(*out_model, pos);
@@ -284,6 +193,20 @@ bool AssImporter::ImportMesh(const aiMesh* pMesh, const aiNode* pNode,
   vcd.calcVertexDescriptorFromAttributeList();
   poly.initBufsFromVcd(*out_model);
 
+  // Skinning tables. Draw matrices are added in order of first use.
+  std::vector<libcube::DrawMatrix> influences;
+  std::vector<int> vertex_drw;
+  if (pMesh->HasBones()) {
+    std::vector<u32> bone_ids(pMesh->mNumBones);
+    for (unsigned j = 0; j < pMesh->mNumBones; ++j) {
+      const auto boneid = get_bone_id(pMesh->mBones[j]->mNode);
+      assert(boneid != -1);
+      bone_ids[j] = boneid;
+    }
+    influences = BuildVertexInfluences(*pMesh, bone_ids);
+    vertex_drw.resize(pMesh->mNumVertices, -1);
+  }
+
   std::vector<librii::gx::IndexedVertex> vertices;
 
   for (unsigned f = 0; f < pMesh->mNumFaces; ++f) {
@@ -291,15 +214,20 @@ bool AssImporter::ImportMesh(const aiMesh* pMesh, const aiNode* pNode,
       const auto v = pMesh->mFaces[f].mIndices[fv];
 
       librii::gx::IndexedVertex vtx{};
-      libcube::DrawMatrix drw;
-      const auto weightInfo =
-          pMesh->HasBones() ? add_weight_matrix(v, pMesh, &drw) : 0;
+      const libcube::DrawMatrix* drw = nullptr;
+      u16 weightInfo = 0;
+      if (pMesh->HasBones()) {
+        drw = &influences[v];
+        if (vertex_drw[v] < 0)
+          vertex_drw[v] = add_weight_matrix_low(*drw);
+        weightInfo = vertex_drw[v];
+      }
 
       if (multi_mtx) {
-        vtx[PNM] = weightInfo * 3;
+        vtx[PNM] = weightInfo;
       }
 
-      vtx[librii::gx::VertexAttribute::Position] = add_position(v, &drw);
+      vtx[librii::gx::VertexAttribute::Position] = add_position(v, drw);
       if (pMesh->HasNormals())
         vtx[librii::gx::VertexAttribute::Normal] = add_normal(v);
       for (int j = 0; j < 2; ++j) {
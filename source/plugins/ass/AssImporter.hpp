@@ -3,8 +3,11 @@
 #include <core/common.h>
 #include <glm/glm.hpp>
 #include <map>
+#include <plugins/gc/Export/AttributePool.hpp>
 #include <plugins/gc/Export/IndexedPolygon.hpp>
 #include <plugins/j3d/Scene.hpp>
+#include <span>
+#include <unordered_map>
 #include <vector>
 #include <vendor/assimp/scene.h>
 
@@ -21,6 +24,12 @@ struct IdCounter {
   std::map<const aiNode*, u32> nodeToBoneIdMap;
   std::map<u32, u32> matIdToMatIdMap;
 };
+// Influences of every vertex of a mesh, from one pass over its bones.
+// bone_ids holds the model bone of each aiBone. Weights are in the order of
+// the mesh's bones; only the first weight of a bone on a vertex counts.
+std::vector<libcube::DrawMatrix>
+BuildVertexInfluences(const aiMesh& mesh, std::span<const u32> bone_ids);
+
 class AssImporter {
 public:
   bool assimpSuccess() const {
@@ -49,12 +58,14 @@ private:
   libcube::Model* out_model = nullptr;
   aiNode* root;
   std::vector<u8> scratch;
+  libcube::AttributePool<libcube::DrawMatrix> drw_pool;
+  // Bones do not move during an import.
+  std::unordered_map<u32, glm::mat4> inv_bind_mtx;
 
   int get_bone_id(const aiNode* pNode);
   // Only call if weighted
   u16 add_weight_matrix_low(const libcube::DrawMatrix& drw);
-  u16 add_weight_matrix(int v, const aiMesh* pMesh,
-                        libcube::DrawMatrix* pDrwOut = nullptr);
+  const glm::mat4& get_inv_bind_mtx(u32 bone_id);
 
   void
   ProcessMeshTrianglesStatic(const aiNode* singleInfluence,
@@ -1,5 +1,7 @@
 #include "model.hpp"
 #include "polygon.hpp"
+#include <plugins/gc/Export/AttributePool.hpp>
+#include <plugins/gc/Export/MatrixPalette.hpp>
 
 namespace riistudio::g3d {
 
@@ -38,33 +40,60 @@ glm::vec3 Polygon::getNrm(const libcube::Model& mdl, u64 id) const {
   return buf->mEntries[id];
 }
 
-template <typename X, typename Y>
-auto add_to_buffer(const X& entry, Y& buf) -> u16 {
-  const auto found = std::find(buf.mEntries.begin(), buf.mEntries.end(), entry);
-  if (found != buf.mEntries.end()) {
-    return found - buf.mEntries.begin();
+// A buffer of the model, found by name once rather than per vertex, and the
+// pool deduplicating its entries.
+template <typename Buffer, typename T> struct PooledBuffer {
+  const Model* model = nullptr;
+  std::size_t index = 0;
+  libcube::AttributePool<T> pool;
+
+  u16 add(Model& mdl, kpi::MutCollectionRange<Buffer> buffers,
+          const std::string& name, const T& entry) {
+    if (model != &mdl || index >= buffers.size() ||
+        buffers[index].mName != name) {
+      const s32 found = buffers.toConst().indexOf(name);
+      assert(found >= 0);
+      model = &mdl;
+      index = found;
+      pool.reset();
+    }
+    return static_cast<u16>(pool.add(buffers[index].mEntries, entry));
   }
+};
 
-  buf.mEntries.push_back(entry);
-  return buf.mEntries.size() - 1;
+struct Polygon::ImportCache {
+  PooledBuffer<PositionBuffer, glm::vec3> pos;
+  PooledBuffer<NormalBuffer, glm::vec3> nrm;
+  std::array<PooledBuffer<ColorBuffer, librii::gx::Color>, 2> clr;
+  std::array<PooledBuffer<TextureCoordinateBuffer, glm::vec2>, 8> uv;
 };
 
+Polygon::ImportCacheRef::ImportCacheRef() = default;
+Polygon::ImportCacheRef::ImportCacheRef(const ImportCacheRef&) {}
+Polygon::ImportCacheRef&
+Polygon::ImportCacheRef::operator=(const ImportCacheRef&) {
+  mCache = nullptr;
+  return *this;
+}
+Polygon::ImportCacheRef::~ImportCacheRef() = default;
+Polygon::ImportCache& Polygon::ImportCacheRef::get() {
+  if (mCache == nullptr)
+    mCache = std::make_unique<ImportCache>();
+  return *mCache;
+}
+
 u64 Polygon::addPos(libcube::Model& mdl, const glm::vec3& v) {
-  auto* buf =
-      reinterpret_cast<Model&>(mdl).getBuf_Pos().findByName(mPositionBuffer);
-  assert(buf);
-  return add_to_buffer(v, *buf);
+  auto& model = reinterpret_cast<Model&>(mdl);
+  return mImportCache.get().pos.add(model, model.getBuf_Pos(), mPositionBuffer,
+                                    v);
 }
 u64 Polygon::addNrm(libcube::Model& mdl, const glm::vec3& v) {
-  auto* buf =
-      reinterpret_cast<Model&>(mdl).getBuf_Nrm().findByName(mNormalBuffer);
-  assert(buf);
-  return add_to_buffer(v, *buf);
+  auto& model = reinterpret_cast<Model&>(mdl);
+  return mImportCache.get().nrm.add(model, model.getBuf_Nrm(), mNormalBuffer,
+                                    v);
 }
 u64 Polygon::addClr(libcube::Model& mdl, u64 chan, const glm::vec4& v) {
-  auto* buf =
-      reinterpret_cast<Model&>(mdl).getBuf_Clr().findByName(mColorBuffer[chan]);
-  assert(buf);
+  auto& model = reinterpret_cast<Model&>(mdl);
 
   librii::gx::ColorF32 fclr;
   fclr.r = v[0];
@@ -72,63 +101,33 @@ u64 Polygon::addClr(libcube::Model& mdl, u64 chan, const glm::vec4& v) {
   fclr.b = v[2];
   fclr.a = v[3];
   librii::gx::Color c = fclr;
-  return add_to_buffer(c, *buf);
+  return mImportCache.get().clr[chan].add(model, model.getBuf_Clr(),
+                                          mColorBuffer[chan], c);
 }
 u64 Polygon::addUv(libcube::Model& mdl, u64 chan, const glm::vec2& v) {
-  auto* buf = reinterpret_cast<Model&>(mdl).getBuf_Uv().findByName(
-      mTexCoordBuffer[chan]);
-  assert(buf);
-  return add_to_buffer(v, *buf);
-}
-
-glm::mat4 computeBoneMdl(u32 id, kpi::ConstCollectionRange<lib3d::Bone> bones) {
-  glm::mat4 mdl(1.0f);
-
-  auto& bone = bones[id];
-  const auto parent = bone.getBoneParent();
-  if (parent >= 0 && parent != id)
-    mdl = computeBoneMdl(parent, bones);
-
-  return mdl * librii::math::calcXform(bone.getSRT());
+  auto& model = reinterpret_cast<Model&>(mdl);
+  return mImportCache.get().uv[chan].add(model, model.getBuf_Uv(),
+                                         mTexCoordBuffer[chan], v);
 }
 
-std::vector<glm::mat4> Polygon::getPosMtx(const libcube::Model& mdl,
-                                          u64 mpid) const {
-  std::vector<glm::mat4> out;
-
+std::span<const glm::mat4>
+Polygon::getPosMtx(const libcube::MatrixPalette& palette, u64 mpid,
+                   std::span<glm::mat4> out) const {
   const auto& mp = mMatrixPrimitives[mpid];
 
-  const g3d::Model& mdl_ac = reinterpret_cast<const Model&>(mdl);
-
-  const auto handle_drw = [&](const libcube::DrawMatrix& drw) {
-    glm::mat4x4 curMtx(1.0f);
-
-    // Rigid -- bone space
-    if (drw.mWeights.size() == 1) {
-      u32 boneID = drw.mWeights[0].boneId;
-      curMtx = const_cast<Bone&>(mdl_ac.getBones()[boneID])
-                   .calcSrtMtx(mdl_ac.getBones());
-    } else {
-      // already world space
-    }
-    out.push_back(curMtx);
-  };
-
   if (mp.mDrawMatrixIndices.empty()) {
-    if (mdl_ac.mDrawMatrices.size() > mCurrentMatrix) {
-      handle_drw(mdl_ac.mDrawMatrices[mCurrentMatrix]);
-    } else {
-      // todo: is there really no rigging info here..?
-      libcube::DrawMatrix tmp;
-      tmp.mWeights.emplace_back(0, 1.0f);
-      handle_drw(tmp);
-    }
-  } else {
-    for (const auto it : mp.mDrawMatrixIndices) {
-      handle_drw(mdl_ac.mDrawMatrices[it]);
-    }
+    const auto drws = palette.getDrawMatrices();
+    if (drws.size() > mCurrentMatrix)
+      return drws.subspan(mCurrentMatrix, 1);
+    // todo: is there really no rigging info here..?
+    return palette.getBoneMatrices().first(
+        std::min<std::size_t>(1, palette.getBoneMatrices().size()));
   }
-  return out;
+
+  const std::size_t count = std::min(out.size(), mp.mDrawMatrixIndices.size());
+  for (std::size_t i = 0; i < count; ++i)
+    out[i] = palette.getDrawMatrix(mp.mDrawMatrixIndices[i]);
+  return out.first(count);
 }
 
 using namespace librii;
@@ -1,5 +1,6 @@
 #include <core/common.h>
 #include <core/kpi/Node.hpp>
+#include <core/util/profiler.hpp>
 
 #include <oishii/reader/binary_reader.hxx>
 #include <oishii/writer/binary_writer.hxx>
@@ -8,18 +9,22 @@
 #include <plugins/g3d/util/Dictionary.hpp>
 #include <plugins/g3d/util/NameTable.hpp>
 
+#include <optional>
 #include <set>
 #include <string>
 
 #include "Common.hpp"
 
 #include <librii/g3d/io/TextureIO.hpp>
+#include <librii/gx/VertexQuantize.hpp>
+#include <plugins/gc/Export/ExportOptions.hpp>
 
 namespace riistudio::g3d {
 
 // MDL0.cpp
 void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
-                NameTable& names, std::size_t brres_start);
+                NameTable& names, std::size_t brres_start,
+                const librii::gx::QuantizeTolerance& tolerance);
 void ReadModelInfo(oishii::BinaryReader& reader, riistudio::g3d::Model& mdl);
 void readModel(Model& mdl, oishii::BinaryReader& reader,
                kpi::IOTransaction& transaction,
@@ -27,9 +32,109 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
 
 // TEX0.cpp
 void writeTexture(const Texture& data, oishii::Writer& writer,
-                  NameTable& names);
+                  NameTable& names, std::size_t brres_start);
+
+namespace {
+
+// Every subfile begins with its magic, size and revision, then the offset back
+// to the archive.
+constexpr u32 BrresOffsetField = 12;
+
+// A subfile as last saved. Other than its names and the offset to the archive,
+// a subfile only refers to itself, so an unchanged one may be copied as is.
+struct CachedSubfile {
+  std::vector<u8> bytes;
+  // Relative to the start of the subfile
+  struct Name {
+    std::string name;
+    u32 structPos;
+    u32 writePos;
+    bool nonvolatile;
+  };
+  std::vector<Name> names;
+
+  // Copies the subfile written from `start` to the stream position, whose
+  // names were reserved from `first_name` on.
+  void capture(oishii::Writer& writer, const NameTable& table, u32 start,
+               std::size_t first_name) {
+    const u8* data = writer.getDataBlockStart();
+    bytes.assign(data + start, data + writer.tell());
+    names.clear();
+    for (std::size_t i = first_name; i < table.numReservations(); ++i) {
+      const auto r = table.reservationAt(i);
+      names.push_back({r.name, r.structPos - start, r.writePos - start,
+                       r.nonvolatile});
+    }
+  }
+  // Writes the subfile at the stream position.
+  void write(oishii::Writer& writer, NameTable& table,
+             std::size_t brres_start) const {
+    const u32 start = writer.tell();
+    writer.writeBytes(bytes);
+    for (const auto& name : names) {
+      table.reserve(name.name, start + name.structPos, writer,
+                    start + name.writePos, name.nonvolatile);
+    }
+    writer.writeAt<s32>(brres_start - start, start + BrresOffsetField);
+  }
+};
+
+struct CachedModel : public CachedSubfile {
+  // Document record of the model. Records made against it share every part of
+  // the model that is unchanged.
+  std::shared_ptr<const kpi::IMemento> record;
+  librii::g3d::G3DModelDataData info;
+  librii::gx::QuantizeTolerance tolerance;
+  // Texture samplers are listed in the order of the archive's textures.
+  std::vector<std::string> textureNames;
+
+  // Takes the record made against ours.
+  bool isUnchanged(const Model& mdl, const std::vector<std::string>& texNames,
+                   const librii::gx::QuantizeTolerance& quantize,
+                   std::shared_ptr<const kpi::IMemento>& next) const {
+    next = mdl.next(record.get());
+    const auto* a = dynamic_cast<const Model::_Memento*>(next.get());
+    const auto* b = dynamic_cast<const Model::_Memento*>(record.get());
+    return a != nullptr && b != nullptr &&
+           a->mMaterials == b->mMaterials && a->mBones == b->mBones &&
+           a->mMeshes == b->mMeshes && a->mBuf_Pos == b->mBuf_Pos &&
+           a->mBuf_Nrm == b->mBuf_Nrm && a->mBuf_Clr == b->mBuf_Clr &&
+           a->mBuf_Uv == b->mBuf_Uv &&
+           static_cast<const librii::g3d::G3DModelDataData&>(mdl) == info &&
+           quantize == tolerance &&
+           texNames == textureNames;
+  }
+};
+
+struct CachedTexture : public CachedSubfile {
+  // Image data is copy-on-write: this shares it with the document until the
+  // texture is edited, so comparing it is cheap.
+  std::optional<librii::g3d::TextureData> data;
+
+  bool isUnchanged(const Texture& tex) const {
+    return data.has_value() &&
+           *data == static_cast<const librii::g3d::TextureData&>(tex);
+  }
+};
+
+// Subfiles of the archive a writer last saved, by index
+struct SaveCache {
+  const Collection* archive = nullptr;
+  std::vector<CachedModel> models;
+  std::vector<CachedTexture> textures;
+
+  // Forgets the subfiles of any other archive.
+  void reset(const Collection& collection) {
+    if (archive != &collection)
+      *this = {&collection};
+    models.resize(collection.getModels().size());
+    textures.resize(collection.getTextures().size());
+  }
+};
 
-class ArchiveDeserializer {
+} // namespace
+
+class ArchiveDeserializer : public libcube::ConfigurableExporter {
 public:
   std::string canRead(const std::string& file,
                       oishii::BinaryReader& reader) const {
@@ -80,6 +185,7 @@ public:
         for (std::size_t j = 1; j < cdic.mNodes.size(); ++j) {
           const auto& sub = cdic.mNodes[j];
 
+          RII_PROFILE_SCOPE("Read MDL0");
           reader.seekSet(sub.mDataDestination);
           auto& mdl = collection.getModels().add();
           readModel(mdl, reader, transaction,
@@ -89,6 +195,7 @@ public:
         for (std::size_t j = 1; j < cdic.mNodes.size(); ++j) {
           const auto& sub = cdic.mNodes[j];
 
+          RII_PROFILE_SCOPE("Read TEX0");
           reader.seekSet(sub.mDataDestination);
           auto& tex = collection.getTextures().add();
           const bool ok =
@@ -199,16 +306,49 @@ public:
     if (root_dict.hasTextures())
       writer.skip(textures_dict.computeSize());
 
+    auto& cache = mSaveCache;
+    cache.reset(collection);
+    std::vector<std::string> tex_names;
+    for (auto& tex : collection.getTextures())
+      tex_names.push_back(tex.getName());
     for (int i = 0; i < collection.getModels().size(); ++i) {
+      RII_PROFILE_SCOPE("Write MDL0");
       writer.alignTo(32);
       models_dict.mNodes[i + 1].setDataDestination(writer.tell());
+      const auto& mdl = collection.getModels()[i];
+      auto& cached = cache.models[i];
+      std::shared_ptr<const kpi::IMemento> record;
+      if (cached.isUnchanged(mdl, tex_names, mExportOptions.quantize,
+                             record)) {
+        cached.write(writer, names, start);
+        continue;
+      }
+      const u32 mdl_start = writer.tell();
+      const auto first_name = names.numReservations();
       auto mdl_linker = linker.sublet("Models/" + std::to_string(i));
-      writeModel(collection.getModels()[i], writer, mdl_linker, names, start);
+      writeModel(mdl, writer, mdl_linker, names, start,
+                 mExportOptions.quantize);
+      cached.capture(writer, names, mdl_start, first_name);
+      cached.record = std::move(record);
+      cached.info = mdl;
+      cached.tolerance = mExportOptions.quantize;
+      cached.textureNames = tex_names;
     }
     for (int i = 0; i < collection.getTextures().size(); ++i) {
+      RII_PROFILE_SCOPE("Write TEX0");
       writer.alignTo(32);
       textures_dict.mNodes[i + 1].setDataDestination(writer.tell());
-      writeTexture(collection.getTextures()[i], writer, names);
+      const auto& tex = collection.getTextures()[i];
+      auto& cached = cache.textures[i];
+      if (cached.isUnchanged(tex)) {
+        cached.write(writer, names, start);
+        continue;
+      }
+      const u32 tex_start = writer.tell();
+      const auto first_name = names.numReservations();
+      writeTexture(tex, writer, names, start);
+      cached.capture(writer, names, tex_start, first_name);
+      cached.data = tex;
     }
     const auto end = writer.tell();
     writer.seekSet(subdicts_pos);
@@ -222,6 +362,7 @@ public:
     }
     root_dict.write(names);
     {
+      RII_PROFILE_SCOPE("Write names");
       names.poolNames();
       names.resolve(end);
       writer.seekSet(end);
@@ -239,6 +380,11 @@ public:
     writer.write<u32>('bres'); // magic
     writer.write<u16>(0xfeff); // bom
   }
+
+private:
+  // What the last save wrote. A writer kept for a document between saves
+  // copies the subfiles left unchanged; a new writer writes every one.
+  mutable SaveCache mSaveCache;
 };
 
 kpi::Register<ArchiveDeserializer, kpi::Reader | kpi::Writer> ArchiveInstaller;
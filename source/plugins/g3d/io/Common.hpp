@@ -4,11 +4,12 @@
 #include <functional>
 #include <librii/gx.h>
 #include <llvm/ADT/SmallVector.h>
-#include <map>
 #include <oishii/writer/binary_writer.hxx>
 #include <plugins/g3d/util/Dictionary.hpp>
 #include <plugins/g3d/util/NameTable.hpp>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 inline std::span<const u8> SliceStream(oishii::BinaryReader& reader) {
   return {reader.getStreamStart() + reader.tell(),
@@ -41,8 +42,11 @@ namespace riistudio::g3d {
 
 class RelocWriter {
 public:
+  // Labels are interned: a name is hashed once, then referred to by ID.
+  using LabelId = u32;
+
   struct Reloc {
-    std::string from, to;
+    LabelId from, to;
     std::size_t ofs, sz;
   };
 
@@ -54,16 +58,33 @@ public:
     return RelocWriter(mWriter, mPrefix + "/" + path);
   }
 
-  // Define a label, associated with the current stream position
+  LabelId intern(const std::string& name) {
+    const auto [it, inserted] =
+        mLabelIds.try_emplace(name, static_cast<LabelId>(mLabelNames.size()));
+    if (inserted) {
+      mLabelNames.push_back(name);
+      mLabelAddrs.push_back(Unlabeled);
+    }
+    return it->second;
+  }
+
+  // Define a label, associated with the current stream position. The first
+  // definition of a label wins.
+  void label(LabelId id, const std::size_t addr) {
+    if (mLabelAddrs[id] == Unlabeled)
+      mLabelAddrs[id] = addr;
+  }
   void label(const std::string& id, const std::size_t addr) {
-    mLabels.try_emplace(id, addr);
+    label(intern(id), addr);
   }
   void label(const std::string& id) { label(id, mWriter.tell()); }
   // Write a relocation, to be filled in by a resolve() call
   template <typename T>
   void writeReloc(const std::string& from, const std::string& to) {
-    mRelocs.emplace_back(
-        Reloc{.from = from, .to = to, .ofs = mWriter.tell(), .sz = sizeof(T)});
+    mRelocs.emplace_back(Reloc{.from = intern(from),
+                               .to = intern(to),
+                               .ofs = mWriter.tell(),
+                               .sz = sizeof(T)});
     mWriter.write<T>(static_cast<T>(0));
   }
   // Write a relocation, with an associated child frame to be written by
@@ -71,30 +92,35 @@ public:
   template <typename T>
   void writeReloc(const std::string& from, const std::string& to,
                   std::function<void(oishii::Writer&)> write) {
-    mRelocs.emplace_back(
-        Reloc{.from = from, .to = to, .ofs = mWriter.tell(), .sz = sizeof(T)});
+    const LabelId to_id = intern(to);
+    mRelocs.emplace_back(Reloc{.from = intern(from),
+                               .to = to_id,
+                               .ofs = mWriter.tell(),
+                               .sz = sizeof(T)});
     mWriter.write<T>(static_cast<T>(-1));
-    mChildren.emplace_back(to, write);
+    mChildren.emplace_back(to_id, write);
   }
   // Write all child bodies
   void writeChildren() {
     for (auto& child : mChildren) {
-      label(child.first);
+      label(child.first, mWriter.tell());
       child.second(mWriter);
     }
     mChildren.clear();
   }
+  bool isResolvable(const Reloc& reloc) const {
+    return mLabelAddrs[reloc.from] != Unlabeled &&
+           mLabelAddrs[reloc.to] != Unlabeled;
+  }
   // Resolve a single relocation
   void resolve(Reloc& reloc) {
-    const auto from = mLabels.find(reloc.from);
-    const auto to = mLabels.find(reloc.to);
-
     int delta = 0;
-    if (from == mLabels.end() || to == mLabels.end()) {
-      printf("Bad lookup: %s to %s\n", reloc.from.c_str(), reloc.to.c_str());
+    if (!isResolvable(reloc)) {
+      printf("Bad lookup: %s to %s\n", mLabelNames[reloc.from].c_str(),
+             mLabelNames[reloc.to].c_str());
       return; // come back..
     } else {
-      delta = to->second - from->second;
+      delta = mLabelAddrs[reloc.to] - mLabelAddrs[reloc.from];
     }
 
     const auto back = mWriter.tell();
@@ -116,32 +142,42 @@ public:
   void resolve() {
     for (auto& reloc : mRelocs)
       resolve(reloc);
-    mRelocs.erase(
-        std::remove_if(mRelocs.begin(), mRelocs.end(), [&](auto& reloc) {
-          const auto from = mLabels.find(reloc.from);
-          const auto to = mLabels.find(reloc.to);
-
-          return from != mLabels.end() && to != mLabels.end();
-        }));
+    mRelocs.erase(std::remove_if(mRelocs.begin(), mRelocs.end(),
+                                 [&](auto& reloc) {
+                                   return isResolvable(reloc);
+                                 }),
+                  mRelocs.end());
   }
 
-  auto& getLabels() const { return mLabels; }
   void printLabels() const {
-    for (auto& [label, at] : mLabels) {
-      const auto uat = static_cast<unsigned>(at);
-      printf("%s: 0x%x (%u)\n", label.c_str(), uat, uat);
+    std::vector<LabelId> sorted;
+    for (LabelId id = 0; id < mLabelNames.size(); ++id) {
+      if (mLabelAddrs[id] != Unlabeled)
+        sorted.push_back(id);
+    }
+    std::sort(sorted.begin(), sorted.end(), [&](LabelId a, LabelId b) {
+      return mLabelNames[a] < mLabelNames[b];
+    });
+    for (const LabelId id : sorted) {
+      const auto uat = static_cast<unsigned>(mLabelAddrs[id]);
+      printf("%s: 0x%x (%u)\n", mLabelNames[id].c_str(), uat, uat);
     }
   }
 
 private:
+  static constexpr std::size_t Unlabeled = ~std::size_t(0);
+
   std::string mPrefix;
 
   oishii::Writer& mWriter;
-  std::map<std::string, std::size_t> mLabels;
+  std::unordered_map<std::string, LabelId> mLabelIds;
+  std::vector<std::string> mLabelNames;
+  // Address of each label, by ID
+  std::vector<std::size_t> mLabelAddrs;
 
   llvm::SmallVector<Reloc, 64> mRelocs;
-  llvm::SmallVector<
-      std::pair<std::string, std::function<void(oishii::Writer&)>>, 16>
+  llvm::SmallVector<std::pair<LabelId, std::function<void(oishii::Writer&)>>,
+                    16>
       mChildren;
 };
 
@@ -1,13 +1,18 @@
 #include <core/common.h>
+#include <core/util/parallel.hpp>
 #include <plugins/g3d/collection.hpp>
 #include <plugins/g3d/util/NameTable.hpp>
 
 #include "Common.hpp"
 #include <librii/gpu/DLBuilder.hpp>
+#include <librii/gpu/DLMesh.hpp>
 #include <librii/gpu/DLPixShader.hpp>
 #include <librii/gpu/GPUMaterial.hpp>
 #include <librii/gx.h>
+#include <librii/gx/VertexQuantize.hpp>
 #include <plugins/g3d/util/Dictionary.hpp>
+#include <functional>
+#include <unordered_map>
 
 namespace riistudio::g3d {
 
@@ -104,53 +109,110 @@ void readGenericBuffer(GenericBuffer<T, HasMinimum, HasDivisor, kind>& out,
   }
 }
 
+// Quantization and bounds a buffer is written with
+template <typename T> struct BufferLayout {
+  Quantization quant;
+  T min{};
+  T max{};
+};
+
+// Computed once per buffer, as both the buffer and the vertex format of every
+// mesh drawing from it depend on the layout.
+template <typename T, bool HasMinimum, bool HasDivisor,
+          librii::gx::VertexBufferKind kind>
+BufferLayout<T>
+computeBufferLayout(const GenericBuffer<T, HasMinimum, HasDivisor, kind>& buf,
+                    const librii::gx::QuantizeTolerance& tolerances) {
+  BufferLayout<T> layout{buf.mQuantize};
+  if constexpr (kind != librii::gx::VertexBufferKind::color) {
+    // The only pass over the entries for bounds: the header stores them, and
+    // the fixed point format is chosen from them.
+    for (int c = 0; c < T::length(); ++c) {
+      layout.min[c] = +1'000'000'000.0f;
+      layout.max[c] = -1'000'000'000.0f;
+    }
+    for (auto& elem : buf.mEntries) {
+      for (int c = 0; c < elem.length(); ++c) {
+        layout.min[c] = std::min(elem[c], layout.min[c]);
+        layout.max[c] = std::max(elem[c], layout.max[c]);
+      }
+    }
+
+    // Float buffers are stored as fixed point where it is precise enough.
+    const f32 tolerance = tolerances.get(kind);
+    if (tolerance > 0.0f && !buf.mEntries.empty() &&
+        buf.mQuantize.mType.generic ==
+            librii::gx::VertexBufferType::Generic::f32) {
+      const auto nComponents =
+          librii::gx::computeComponentCount(kind, buf.mQuantize.mComp);
+      const auto values =
+          librii::gx::FlattenComponents<T::length()>(buf.mEntries);
+      f32 min = layout.min[0];
+      f32 max = layout.max[0];
+      for (std::size_t c = 1; c < nComponents; ++c) {
+        min = std::min(min, layout.min[c]);
+        max = std::max(max, layout.max[c]);
+      }
+      const auto format = librii::gx::ChooseFixedPointFormat(
+          values, T::length(), nComponents, min, max, tolerance, kind);
+      if (format) {
+        layout.quant.mType = librii::gx::VertexBufferType(format->type);
+        layout.quant.divisor = format->divisor;
+        layout.quant.stride =
+            static_cast<u8>(nComponents * format->componentSize());
+      }
+    }
+  }
+  return layout;
+}
+
+template <typename Buffers>
+auto computeBufferLayouts(const Buffers& buffers,
+                          const librii::gx::QuantizeTolerance& tolerance) {
+  using Buffer = std::remove_cvref_t<decltype(*buffers.begin())>;
+  std::unordered_map<const Buffer*,
+                     decltype(computeBufferLayout(std::declval<const Buffer&>(),
+                                                  tolerance))>
+      layouts;
+  for (const auto& buf : buffers)
+    layouts.emplace(&buf, computeBufferLayout(buf, tolerance));
+  return layouts;
+}
+
 // Does not write size or mdl0 offset
 template <typename T, bool HasMinimum, bool HasDivisor,
           librii::gx::VertexBufferKind kind>
 void writeGenericBuffer(
     const GenericBuffer<T, HasMinimum, HasDivisor, kind>& buf,
-    oishii::Writer& writer, u32 header_start, NameTable& names) {
+    const BufferLayout<T>& layout, oishii::Writer& writer, u32 header_start,
+    NameTable& names) {
+  const auto& quant = layout.quant;
   const auto backpatch_array_ofs = writePlaceholder(writer);
   writeNameForward(names, writer, header_start, buf.getName());
   writer.write<u32>(buf.mId);
-  writer.write<u32>(static_cast<u32>(buf.mQuantize.mComp.position));
-  writer.write<u32>(static_cast<u32>(buf.mQuantize.mType.generic));
+  writer.write<u32>(static_cast<u32>(quant.mComp.position));
+  writer.write<u32>(static_cast<u32>(quant.mType.generic));
   if constexpr (HasDivisor) {
-    writer.write<u8>(buf.mQuantize.divisor);
-    writer.write<u8>(buf.mQuantize.stride);
+    writer.write<u8>(quant.divisor);
+    writer.write<u8>(quant.stride);
   } else {
-    writer.write<u8>(buf.mQuantize.stride);
+    writer.write<u8>(quant.stride);
     writer.write<u8>(0);
   }
   writer.write<u16>(buf.mEntries.size());
-  // TODO: min/max
   if constexpr (HasMinimum) {
-    T min;
-    T max;
-    for (int c = 0; c < T::length(); ++c) {
-      min[c] = +1'000'000'000.0f;
-      max[c] = -1'000'000'000.0f;
-    }
-    for (auto& elem : buf.mEntries) {
-      for (int c = 0; c < elem.length(); ++c) {
-        min[c] = std::min(elem[c], min[c]);
-        max[c] = std::max(elem[c], max[c]);
-      }
-    }
-
-    min >> writer;
-    max >> writer;
+    layout.min >> writer;
+    layout.max >> writer;
   }
 
   writer.alignTo(32);
   writeOffsetBackpatch(writer, backpatch_array_ofs, header_start);
 
-  const auto nComponents =
-      librii::gx::computeComponentCount(kind, buf.mQuantize.mComp);
+  const auto nComponents = librii::gx::computeComponentCount(kind, quant.mComp);
 
   for (auto& entry : buf.mEntries) {
-    librii::gx::writeComponents(writer, entry, buf.mQuantize.mType, nComponents,
-                                buf.mQuantize.divisor);
+    librii::gx::writeComponents(writer, entry, quant.mType, nComponents,
+                                quant.divisor);
   }
   writer.alignTo(32);
 } // namespace riistudio::g3d
@@ -297,10 +359,16 @@ void writeVertexDataDL(const libcube::IndexedPolygon& poly,
     writer.write<u8>(0);
 }
 void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
-                NameTable& names, std::size_t brres_start) {
+                NameTable& names, std::size_t brres_start,
+                const librii::gx::QuantizeTolerance& tolerance) {
   const auto mdl_start = writer.tell();
   int d_cursor = 0;
 
+  const auto pos_layouts = computeBufferLayouts(mdl.getBuf_Pos(), tolerance);
+  const auto nrm_layouts = computeBufferLayouts(mdl.getBuf_Nrm(), tolerance);
+  const auto clr_layouts = computeBufferLayouts(mdl.getBuf_Clr(), tolerance);
+  const auto uv_layouts = computeBufferLayouts(mdl.getBuf_Uv(), tolerance);
+
   //
   // Build render lists
   //
@@ -976,21 +1044,21 @@ void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
               const auto* buf =
                   mdl.getBuf_Pos().findByName(mesh.mPositionBuffer);
               assert(buf);
-              set_quant(buf->mQuantize);
+              set_quant(pos_layouts.at(buf).quant);
               break;
             }
             case VA::Color0: {
               const auto* buf =
                   mdl.getBuf_Clr().findByName(mesh.mColorBuffer[0]);
               assert(buf);
-              set_quant(buf->mQuantize);
+              set_quant(clr_layouts.at(buf).quant);
               break;
             }
             case VA::Color1: {
               const auto* buf =
                   mdl.getBuf_Clr().findByName(mesh.mColorBuffer[1]);
               assert(buf);
-              set_quant(buf->mQuantize);
+              set_quant(clr_layouts.at(buf).quant);
               break;
             }
             case VA::TexCoord0:
@@ -1007,14 +1075,14 @@ void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
               const auto* buf =
                   mdl.getBuf_Uv().findByName(mesh.mTexCoordBuffer[chan]);
               assert(buf);
-              set_quant(buf->mQuantize);
+              set_quant(uv_layouts.at(buf).quant);
               break;
             }
             case VA::Normal:
             case VA::NormalBinormalTangent: {
               const auto* buf = mdl.getBuf_Nrm().findByName(mesh.mNormalBuffer);
               assert(buf);
-              set_quant(buf->mQuantize);
+              set_quant(nrm_layouts.at(buf).quant);
               break;
             }
             default:
@@ -1104,25 +1172,29 @@ void writeModel(const Model& mdl, oishii::Writer& writer, RelocWriter& linker,
   write_dict(
       "Buffer_Position", mdl.getBuf_Pos(),
       [&](const PositionBuffer& buf, std::size_t buf_start) {
-        writeGenericBuffer(buf, writer, buf_start, names);
+        writeGenericBuffer(buf, pos_layouts.at(&buf), writer, buf_start,
+                           names);
       },
       false, 32);
   write_dict(
       "Buffer_Normal", mdl.getBuf_Nrm(),
       [&](const NormalBuffer& buf, std::size_t buf_start) {
-        writeGenericBuffer(buf, writer, buf_start, names);
+        writeGenericBuffer(buf, nrm_layouts.at(&buf), writer, buf_start,
+                           names);
       },
       false, 32);
   write_dict(
       "Buffer_Color", mdl.getBuf_Clr(),
       [&](const ColorBuffer& buf, std::size_t buf_start) {
-        writeGenericBuffer(buf, writer, buf_start, names);
+        writeGenericBuffer(buf, clr_layouts.at(&buf), writer, buf_start,
+                           names);
       },
       false, 32);
   write_dict(
       "Buffer_UV", mdl.getBuf_Uv(),
       [&](const TextureCoordinateBuffer& buf, std::size_t buf_start) {
-        writeGenericBuffer(buf, writer, buf_start, names);
+        writeGenericBuffer(buf, uv_layouts.at(&buf), writer, buf_start,
+                           names);
       },
       false, 32);
 
@@ -1452,7 +1524,7 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
     return;
   }
 
-  MAYBE_UNUSED const u32 fileSize = reader.read<u32>();
+  const u32 fileSize = reader.read<u32>();
   const u32 revision = reader.read<u32>();
   if (revision != 11) {
     transaction.callback(kpi::IOMessageClass::Error, transaction_path,
@@ -1523,35 +1595,92 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
       mdl.getBones()[parent_id].mChildren.push_back(i);
     }
   }
-  readDict(secOfs.ofsBuffers.position, [&](const DictionaryNode& dnode) {
-    readGenericBuffer(mdl.getBuf_Pos().add(), reader);
-  });
-  readDict(secOfs.ofsBuffers.normal, [&](const DictionaryNode& dnode) {
-    readGenericBuffer(mdl.getBuf_Nrm().add(), reader);
-  });
-  readDict(secOfs.ofsBuffers.color, [&](const DictionaryNode& dnode) {
-    readGenericBuffer(mdl.getBuf_Clr().add(), reader);
-  });
-  readDict(secOfs.ofsBuffers.uv, [&](const DictionaryNode& dnode) {
-    readGenericBuffer(mdl.getBuf_Uv().add(), reader);
-  });
-  // TODO: Fur
-
-  readDict(secOfs.ofsMaterials, [&](const DictionaryNode& dnode) {
-    auto& mat = mdl.getMaterials().add();
-    const bool ok = readMaterial(mat, reader);
-
-    if (!ok) {
-      printf("Failed to read material %s\n", dnode.mName.c_str());
+  // The remaining sections are located serially, then decoded in parallel,
+  // each into a slot of its own, so the result does not depend on the order
+  // they are decoded in.
+  auto collectDict = [&](u32 xofs) {
+    std::vector<u32> offsets;
+    if (xofs) {
+      reader.seekSet(start + xofs);
+      Dictionary _dict(reader);
+      for (std::size_t i = 1; i < _dict.mNodes.size(); ++i) {
+        assert(_dict.mNodes[i].mDataDestination);
+        offsets.push_back(_dict.mNodes[i].mDataDestination);
+      }
     }
-  });
+    return offsets;
+  };
+  std::vector<std::function<void(oishii::BinaryReader&)>> tasks;
+  // Adds a slot per section, to be read by `handler(slot, reader, index)`
+  auto addTasks = [&](const std::vector<u32>& offsets, auto collection,
+                      auto handler) {
+    const auto first = collection.size();
+    for (std::size_t i = 0; i < offsets.size(); ++i)
+      collection.add();
+    for (u32 i = 0; i < offsets.size(); ++i) {
+      auto* slot = &collection[first + i];
+      tasks.push_back([slot, ofs = offsets[i], i,
+                       handler](oishii::BinaryReader& slotReader) {
+        slotReader.seekSet(ofs);
+        handler(*slot, slotReader, i);
+      });
+    }
+  };
+  // Warnings are held back by each slot, and replayed in order once all are
+  // read.
+  auto runTasks = [&] {
+    std::vector<std::vector<oishii::HeldWarning>> warnings(tasks.size());
+    util::ParallelFor(
+        static_cast<u32>(tasks.size()),
+        [&](u32 i) {
+          auto slotReader = reader.fork();
+          tasks[i](slotReader);
+          warnings[i] = slotReader.takeWarnings();
+        },
+        fileSize >= util::MinParallelDecodeBytes);
+    for (const auto& slotWarnings : warnings)
+      reader.replayWarnings(slotWarnings);
+    tasks.clear();
+  };
+
+  auto readBuffer = [](auto& buf, oishii::BinaryReader& reader, u32) {
+    readGenericBuffer(buf, reader);
+  };
+  addTasks(collectDict(secOfs.ofsBuffers.position), mdl.getBuf_Pos(),
+           readBuffer);
+  addTasks(collectDict(secOfs.ofsBuffers.normal), mdl.getBuf_Nrm(),
+           readBuffer);
+  addTasks(collectDict(secOfs.ofsBuffers.color), mdl.getBuf_Clr(),
+           readBuffer);
+  addTasks(collectDict(secOfs.ofsBuffers.uv), mdl.getBuf_Uv(), readBuffer);
+  // TODO: Fur
+  // Meshes look up buffers by name.
+  runTasks();
+
+  // What reading a section reported, replayed in order once all are read
+  struct SlotStatus {
+    bool ok = true;
+    // See isValid
+    bool valid = true;
+    kpi::IOMessageClass messageClass = kpi::IOMessageClass::None;
+    std::string message;
+  };
 
-  readDict(secOfs.ofsMeshes, [&](const DictionaryNode& dnode) {
-    auto& poly = mdl.getMeshes().add();
+  const auto matOffsets = collectDict(secOfs.ofsMaterials);
+  std::vector<SlotStatus> matStatus(matOffsets.size());
+  addTasks(matOffsets, mdl.getMaterials(),
+           [&](G3dMaterialData& mat, oishii::BinaryReader& reader, u32 i) {
+             matStatus[i].ok = readMaterial(mat, reader);
+           });
+
+  const auto meshOffsets = collectDict(secOfs.ofsMeshes);
+  std::vector<SlotStatus> meshStatus(meshOffsets.size());
+  auto readMesh = [&](Polygon& poly, oishii::BinaryReader& reader, u32 i) {
+    auto& status = meshStatus[i];
     const auto start = reader.tell();
 
-    isValid &= reader.read<u32>() != 0; // size
-    isValid &= reader.read<s32>() < 0;  // mdl offset
+    status.valid &= reader.read<u32>() != 0; // size
+    status.valid &= reader.read<s32>() < 0;  // mdl offset
 
     poly.mCurrentMatrix = reader.read<s32>();
     reader.skip(12); // cache
@@ -1570,8 +1699,8 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
     poly.mName = readName(reader, start);
     poly.mId = reader.read<u32>();
     // TODO: Verify / cache
-    isValid &= reader.read<u32>() > 0; // nVert
-    isValid &= reader.read<u32>() > 0; // nPoly
+    status.valid &= reader.read<u32>() > 0; // nVert
+    status.valid &= reader.read<u32>() > 0; // nPoly
 
     auto readBufHandle = [&](std::string& out, auto ifExist) {
       const auto hid = reader.read<s16>();
@@ -1593,8 +1722,8 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
       readBufHandle(poly.mTexCoordBuffer[i],
                     [&](s16 hid) { return mdl.getBuf_Uv()[hid].getName(); });
     }
-    isValid &= reader.read<s32>() == -1; // fur
-    reader.read<s32>();                  // matrix usage
+    status.valid &= reader.read<s32>() == -1; // fur
+    reader.read<s32>();                       // matrix usage
 
     primitiveSetup.seekTo(reader);
     librii::gpu::QDisplayListVertexSetupHandler vcdHandler;
@@ -1603,9 +1732,9 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
     for (u32 i = 0; i < (u32)librii::gx::VertexAttribute::Max; ++i) {
       if (poly.mVertexDescriptor.mBitfield & (1 << i)) {
         if (i == 0) {
-          transaction.callback(kpi::IOMessageClass::Error, transaction_path,
-                               "Unsuported attribute");
-          transaction.state = kpi::TransactionState::Failure;
+          status.ok = false;
+          status.messageClass = kpi::IOMessageClass::Error;
+          status.message = "Unsuported attribute";
           return;
         }
         const auto stat = vcdHandler.mGpuMesh.VCD.GetVertexArrayStatus(
@@ -1629,40 +1758,57 @@ void readModel(Model& mdl, oishii::BinaryReader& reader,
             librii::gx::IndexedPrimitive{});
         prim.mType = type;
         prim.mVertices.resize(nverts);
-        for (auto& vert : prim.mVertices) {
-          for (u32 i = 0;
-               i < static_cast<u32>(librii::gx::VertexAttribute::Max); ++i) {
-            if (mPoly.mVertexDescriptor.mBitfield & (1 << i)) {
-              const auto attr = static_cast<librii::gx::VertexAttribute>(i);
-              switch (mPoly.mVertexDescriptor.mAttributes[attr]) {
-              case librii::gx::VertexAttributeType::Direct:
-                mErr = true;
-                return;
-              case librii::gx::VertexAttributeType::None:
-                break;
-              case librii::gx::VertexAttributeType::Byte:
-                vert[attr] = reader.readUnaligned<u8>();
-                break;
-              case librii::gx::VertexAttributeType::Short:
-                vert[attr] = reader.readUnaligned<u16>();
-                break;
-              }
-            }
-          }
+        if (nverts == 0)
+          return;
+        // Direct data is not read into meshes.
+        if (!mLayout || mLayout->direct) {
+          mErr = true;
+          return;
         }
+        auto largest = librii::gpu::ReadVertices(reader, *mLayout, prim);
+        if (!largest) {
+          llvm::consumeError(largest.takeError());
+          mErr = true;
+        }
+      }
+      QDisplayListMeshHandler(Polygon& poly) : mPoly(poly) {
+        auto layout = librii::gpu::MakeVertexLayout(poly.mVertexDescriptor);
+        if (layout)
+          mLayout = *layout;
+        else
+          llvm::consumeError(layout.takeError());
       }
-      QDisplayListMeshHandler(Polygon& poly) : mPoly(poly) {}
       bool mErr = false;
       Polygon& mPoly;
+      std::optional<librii::gpu::VertexLayout> mLayout;
     } meshHandler(poly);
     primitiveData.seekTo(reader);
     librii::gpu::RunDisplayList(reader, meshHandler, primitiveData.buf_size);
     if (meshHandler.mErr) {
-      transaction.callback(kpi::IOMessageClass::Warning, transaction_path,
-                           "Mesh unsupported.");
-      transaction.state = kpi::TransactionState::Failure;
+      status.ok = false;
+      status.messageClass = kpi::IOMessageClass::Warning;
+      status.message = "Mesh unsupported.";
     }
-  });
+  };
+  addTasks(meshOffsets, mdl.getMeshes(), readMesh);
+  runTasks();
+
+  for (std::size_t i = 0; i < matStatus.size(); ++i) {
+    if (!matStatus[i].ok) {
+      printf("Failed to read material %s\n",
+             mdl.getMaterials()[i].name.c_str());
+    }
+  }
+  for (const auto& status : meshStatus) {
+    isValid &= status.valid;
+    if (!status.message.empty()) {
+      transaction.callback(status.messageClass, transaction_path,
+                           status.message);
+    }
+    if (!status.ok)
+      transaction.state = kpi::TransactionState::Failure;
+  }
+
 
   if (transaction.state == kpi::TransactionState::Failure)
     return;
@@ -6,14 +6,14 @@ namespace riistudio::g3d {
 
 
 void writeTexture(const Texture& data, oishii::Writer& writer,
-                  NameTable& names) {
+                  NameTable& names, std::size_t brres_start) {
   const auto start = writer.tell();
 
   writer.write<u32>('TEX0');
   writer.write<u32>(64 + data.getEncodedSize(true));
-  writer.write<u32>(3);      // revision
-  writer.write<s32>(-start); // brres offset
-  writer.write<s32>(64);     // texture offset
+  writer.write<u32>(3);                   // revision
+  writer.write<s32>(brres_start - start); // brres offset
+  writer.write<s32>(64);                  // texture offset
   writeNameForward(names, writer, start, data.name);
   writer.write<u32>(0); // flag, ci
   writer.write<u16>(data.width);
@@ -10,6 +10,7 @@
 #include <librii/g3d/data/ModelData.hpp>
 #include <librii/gx.h>
 #include <plugins/gc/Export/Scene.hpp>
+#include <rsl/CowVector.hpp>
 #include <tuple>
 
 namespace riistudio::g3d {
@@ -35,7 +36,7 @@ struct GenericBuffer : public virtual kpi::IObject {
   std::string getName() const { return mName; }
 
   Quantization mQuantize;
-  std::vector<T> mEntries;
+  rsl::cow_vector<T> mEntries;
 
   bool operator==(const GenericBuffer& rhs) const {
     return mName == rhs.mName && mId == rhs.mId && mQuantize == rhs.mQuantize &&
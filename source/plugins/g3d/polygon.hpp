@@ -2,6 +2,7 @@
 
 #include <core/common.h>
 #include <librii/gx.h>
+#include <memory>
 #include <plugins/gc/Export/IndexedPolygon.hpp>
 #include <vector>
 
@@ -24,8 +25,9 @@ struct Polygon : public librii::g3d::PolygonData,
   MeshData& getMeshData() override { return *this; }
   const MeshData& getMeshData() const { return *this; }
   librii::math::AABB getBounds() const override { return bounds; }
-  std::vector<glm::mat4> getPosMtx(const libcube::Model& mdl,
-                                   u64 mpId) const override;
+  std::span<const glm::mat4> getPosMtx(const libcube::MatrixPalette& palette,
+                                       u64 mpId,
+                                       std::span<glm::mat4> out) const override;
 
   glm::vec2 getUv(const libcube::Model& mdl, u64 chan, u64 id) const override;
   glm::vec4 getClr(const libcube::Model& mdl, u64 chan, u64 id) const override;
@@ -48,6 +50,24 @@ struct Polygon : public librii::g3d::PolygonData,
   }
 
   librii::math::AABB bounds;
+
+private:
+  // Resolved buffers and value -> index lookups for addPos/addNrm/addClr/addUv,
+  // which would otherwise search by name and by value on every call.
+  struct ImportCache;
+  // Not part of the document: copies start out empty.
+  struct ImportCacheRef {
+    ImportCacheRef();
+    ImportCacheRef(const ImportCacheRef&);
+    ImportCacheRef& operator=(const ImportCacheRef&);
+    ~ImportCacheRef();
+
+    ImportCache& get();
+
+  private:
+    std::unique_ptr<ImportCache> mCache;
+  };
+  ImportCacheRef mImportCache;
 };
 
 } // namespace riistudio::g3d
@@ -3,9 +3,11 @@
 #include <core/common.h>
 
 #include <algorithm>
-#include <map>
 #include <string>
 #include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <oishii/reader/binary_reader.hxx>
@@ -13,6 +15,39 @@
 
 namespace riistudio::g3d {
 
+//! @brief Lays out a pool of distinct strings.
+//!
+//! Strings are stored in sorted order as [u32 length][chars][0], padded to 4
+//! bytes ("N method").
+//!
+//! @return The pool and the offset of the first character of each string.
+//!
+inline std::pair<std::vector<u8>, std::vector<u32>>
+poolStrings(const std::vector<std::string>& strings) {
+  std::vector<u32> order(strings.size());
+  for (u32 i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::sort(order.begin(), order.end(),
+            [&](u32 a, u32 b) { return strings[a] < strings[b]; });
+
+  std::vector<u8> pool;
+  std::vector<u32> offsets(strings.size());
+  for (const u32 i : order) {
+    const auto& str = strings[i];
+    const u32 sz = str.size();
+    pool.push_back((sz & 0xff000000) >> 24);
+    pool.push_back((sz & 0x00ff0000) >> 16);
+    pool.push_back((sz & 0x0000ff00) >> 8);
+    pool.push_back((sz & 0x000000ff) >> 0);
+    offsets[i] = pool.size();
+    pool.insert(pool.end(), str.begin(), str.end());
+    pool.push_back(0);
+    while (pool.size() % 4)
+      pool.push_back(0);
+  }
+  return {std::move(pool), std::move(offsets)};
+}
+
 // This class is a relic of the old tool.
 class NameTable {
 public:
@@ -36,87 +71,19 @@ public:
                  bool nonvolatile = false) {
     assert(structPos < 0xffffff);
     const Handle id = mCounter++;
-    mEntries.emplace_back(NameTableEntry{name, structPos, &writeStream,
+    // Names are interned as they are reserved, so pooling never compares
+    // more than distinct names.
+    const auto [it, inserted] = mNameIds.try_emplace(name, mNames.size());
+    if (inserted)
+      mNames.push_back(name);
+    mEntries.emplace_back(NameTableEntry{it->second, structPos, &writeStream,
                                          writePos, nonvolatile, id});
     return id;
   }
 
-  inline std::size_t resolveName(Handle id, u32 structStartOfs, u32 poolOfs) {
-    assert(mMapping.contains(id) && mMapping[id] < 0);
-    const std::size_t poolentry =
-        static_cast<std::size_t>(-mMapping[id] + poolOfs);
-    // printf("Name %u: From %u to %u+%u, delta: %u\n", id, structStartOfs,
-    //        poolOfs, (u32)-mMapping[id], (u32)poolentry - structStartOfs);
-    return poolentry - structStartOfs;
-  }
-
-  //! @brief Construct the string pool.
+  //! @brief Construct the string pool. Each distinct name is stored once.
   //!
-  void poolNames(bool UseNMethod = true) {
-    // Clear the pool
-    mMapping.clear();
-    mPool.clear();
-
-    // Pool names without duplicates
-    // TODO: this can be more efficient, no need for duplicate "pool" vector
-    int size = 0; // size of all names + terminating zeroes
-    std::vector<std::pair<std::string, bool>> pool; // Name, NonVolatile
-
-    std::sort(mEntries.begin(), mEntries.end(),
-              [](const auto& s, const auto& s2) { return s.name < s2.name; });
-
-    for (auto& it : mEntries) {
-      auto pastIt = std::find_if(pool.begin(), pool.end(),
-                                 [it](const std::pair<std::string, bool>& s) {
-                                   return s.first == it.name;
-                                 });
-
-      if (pastIt == pool.end()) {
-        mMapping[it.id] = pool.size();
-        pool.push_back({it.name, it.nonvolatile});
-        size += it.name.size() + 5;
-      } else { // Duplicate
-        // std::cout << "Duplicate name " << it.name
-        //           << " (past Idx: " << std::to_string(pastIt - pool.begin())
-        //           << ")!\n";
-        mMapping[it.id] = pastIt - pool.begin();
-      }
-    }
-
-    // Construct binary pool
-    mPool.reserve(size);
-    int i = 0;
-    for (const auto& [name, nonvolatile] : pool) {
-      if (UseNMethod) {
-        u32 sz = name.size();
-        mPool.push_back((sz & 0xff000000) >> 24);
-        mPool.push_back((sz & 0x00ff0000) >> 16);
-        mPool.push_back((sz & 0x0000ff00) >> 8);
-        mPool.push_back((sz & 0x000000ff) >> 0);
-      }
-      // Resolve indices to offsets
-      for (auto& mapIt : mMapping)
-        if (mapIt.second == i)
-          mapIt.second = -mPool.size();
-      // Push the string
-      for (char c : (nonvolatile ? name : name))
-        mPool.push_back(c);
-      mPool.push_back(0);
-
-      if (UseNMethod) {
-        while (mPool.size() % 4)
-          mPool.push_back(0);
-      }
-
-      ++i;
-    }
-
-    if (mPool.size() != size) {
-      std::cout << "[Warning] Expected string pool of size "
-                << std::to_string(size) << ". Actual size is "
-                << std::to_string(mPool.size()) << "!\n";
-    }
-  }
+  void poolNames() { std::tie(mPool, mOffsets) = poolStrings(mNames); }
   template <typename T> static void writeAt(T& stream, u32 pos, s32 val) {
     auto back = stream.tell();
     stream.seekSet(pos);
@@ -130,16 +97,31 @@ public:
   //! @param[in] Offset of pool in output stream
   //!
   void resolve(u32 pool) {
+    assert(mOffsets.size() == mNames.size());
     for (const auto& entry : mEntries) {
       writeAt(*entry.writeStream, entry.writePos,
-              resolveName(entry.id, entry.structPos, pool));
+              pool + mOffsets[entry.nameId] - entry.structPos);
     }
     mEntries.clear();
   }
 
+  struct Reservation {
+    const std::string& name;
+    u32 structPos;
+    u32 writePos;
+    bool nonvolatile;
+  };
+  //! Reservations not yet resolved, in the order they were made
+  std::size_t numReservations() const { return mEntries.size(); }
+  Reservation reservationAt(std::size_t i) const {
+    const auto& entry = mEntries[i];
+    return {mNames[entry.nameId], entry.structPos, entry.writePos,
+            entry.nonvolatile};
+  }
+
 private:
   struct NameTableEntry {
-    std::string name;
+    u32 nameId;
     u32 structPos;
     oishii::Writer* writeStream;
     u32 writePos;
@@ -149,8 +131,11 @@ private:
   std::size_t mCounter = 0; //!< Necessary as the vector may shrink
   std::vector<NameTableEntry> mEntries;
 
-  // Pool
-  std::map<Handle, s32> mMapping;
+  // Distinct names, by ID
+  std::unordered_map<std::string, u32> mNameIds;
+  std::vector<std::string> mNames;
+  // Pool offset of each name
+  std::vector<u32> mOffsets;
 
 public:
   std::vector<u8> mPool;
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Bone.hpp"
+#include <array>
+#include <bit>
+#include <cmath>
+#include <core/common.h>
+#include <glm/glm.hpp>
+#include <librii/gx/Color.hpp>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace libcube {
+
+//! Deduplicates entries appended to a vertex buffer (or draw matrix list).
+//!
+//! add() returns the index of the first entry equal to the new one (by
+//! operator==), exactly as a linear std::find would, but in O(1).
+//!
+//! The buffer is indexed lazily: entries appended by other means are picked
+//! up by the next add(), and a buffer that shrank is re-indexed. Editing
+//! entries in place requires a reset().
+template <typename T> class AttributePool {
+public:
+  template <typename Container>
+  std::size_t add(Container& entries, const T& entry) {
+    const auto& cur = std::as_const(entries);
+    if (cur.size() < mIndexed)
+      reset();
+    for (; mIndexed < cur.size(); ++mIndexed) {
+      if (isComparable(cur[mIndexed]))
+        mLookup.try_emplace(makeKey(cur[mIndexed]), mIndexed);
+    }
+
+    // NaN is unequal to everything, so is never shared.
+    if (isComparable(entry)) {
+      const auto [it, inserted] =
+          mLookup.try_emplace(makeKey(entry), cur.size());
+      if (!inserted)
+        return it->second;
+    }
+    entries.push_back(entry);
+    return mIndexed++;
+  }
+
+  void reset() {
+    mLookup.clear();
+    mIndexed = 0;
+  }
+
+private:
+  // Bit patterns of the components. Zeroes are normalized, as -0 == +0.
+  template <glm::length_t L>
+  static std::array<u32, L> makeKey(const glm::vec<L, float>& v) {
+    std::array<u32, L> key;
+    for (glm::length_t i = 0; i < L; ++i)
+      key[i] = std::bit_cast<u32>(v[i] + 0.0f);
+    return key;
+  }
+  static std::array<u32, 4> makeKey(const librii::gx::Color& c) {
+    return {c.r, c.g, c.b, c.a};
+  }
+  static std::vector<u32> makeKey(const DrawMatrix& drw) {
+    std::vector<u32> key;
+    key.reserve(drw.mWeights.size() * 2);
+    for (const auto& w : drw.mWeights) {
+      key.push_back(w.boneId);
+      key.push_back(std::bit_cast<u32>(w.weight + 0.0f));
+    }
+    return key;
+  }
+
+  template <glm::length_t L>
+  static bool isComparable(const glm::vec<L, float>& v) {
+    for (glm::length_t i = 0; i < L; ++i) {
+      if (std::isnan(v[i]))
+        return false;
+    }
+    return true;
+  }
+  static bool isComparable(const librii::gx::Color&) { return true; }
+  static bool isComparable(const DrawMatrix& drw) {
+    for (const auto& w : drw.mWeights) {
+      if (std::isnan(w.weight))
+        return false;
+    }
+    return true;
+  }
+
+  using Key = decltype(makeKey(std::declval<T>()));
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const {
+      // FNV-1a
+      u64 hash = 14695981039346656037ull;
+      for (u32 word : key) {
+        hash ^= word;
+        hash *= 1099511628211ull;
+      }
+      return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+  };
+
+  // Index of the first entry with each value
+  std::unordered_map<Key, std::size_t, KeyHash> mLookup;
+  // Entries of the buffer already in mLookup
+  std::size_t mIndexed = 0;
+};
+
+} // namespace libcube
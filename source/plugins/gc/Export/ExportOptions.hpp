@@ -0,0 +1,27 @@
+#pragma once
+
+#include <core/kpi/Plugins.hpp>
+#include <librii/gx/VertexQuantize.hpp>
+
+namespace libcube {
+
+// Choices made when saving a file, rather than properties of its contents
+struct ExportOptions {
+  // Largest error allowed when storing float vertex buffers as fixed point
+  librii::gx::QuantizeTolerance quantize;
+};
+
+// Base of the writers that take ExportOptions
+struct ConfigurableExporter {
+  ExportOptions mExportOptions;
+};
+
+// Configure a writer from SpawnExporter. Writers without options are left as
+// they are.
+inline void SetExportOptions(kpi::IBinarySerializer& exporter,
+                             const ExportOptions& options) {
+  if (auto* configurable = dynamic_cast<ConfigurableExporter*>(&exporter))
+    configurable->mExportOptions = options;
+}
+
+} // namespace libcube
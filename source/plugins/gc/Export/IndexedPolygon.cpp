@@ -1,5 +1,6 @@
 #include "IndexedPolygon.hpp"
 #include <librii/gl/Compiler.hpp>
+#include <librii/glhelper/VertexCache.hpp>
 
 namespace libcube {
 
@@ -75,126 +76,76 @@ void IndexedPolygon::setAttrib(SimpleAttrib attrib, bool v) {
     break;
   }
 }
+std::optional<librii::math::AABB>
+IndexedPolygon::calcPositionBound(const Model& mdl, u32 mp_id) const {
+  if (!getVcd()[gx::VertexAttribute::Position])
+    return std::nullopt;
+  std::optional<librii::math::AABB> bound;
+  for (const auto& prim : getMeshData().mMatrixPrimitives[mp_id].mPrimitives) {
+    for (const auto& vtx : prim.mVertices) {
+      const auto pos = getPos(mdl, vtx[gx::VertexAttribute::Position]);
+      if (bound)
+        bound->expandBound({pos, pos});
+      else
+        bound = {pos, pos};
+    }
+  }
+  return bound;
+}
+
+librii::math::AABB
+IndexedPolygon::transformPositionBound(const librii::math::AABB& positions,
+                                       std::span<const glm::mat4> pos_mtx) {
+  if (pos_mtx.empty())
+    return positions;
+  auto bound = librii::math::TransformAABB(positions, pos_mtx[0]);
+  for (std::size_t i = 1; i < pos_mtx.size(); ++i)
+    bound.expandBound(librii::math::TransformAABB(positions, pos_mtx[i]));
+  return bound;
+}
+
+// Attributes propagate() uploads; other indices do not affect the output.
+static constexpr u32 PropagatedAttributes =
+    (1 << (u32)gx::VertexAttribute::PositionNormalMatrixIndex) |
+    (1 << (u32)gx::VertexAttribute::Position) |
+    (1 << (u32)gx::VertexAttribute::Normal) |
+    (1 << (u32)gx::VertexAttribute::Color0) |
+    (1 << (u32)gx::VertexAttribute::Color1) |
+    (0xFF << (u32)gx::VertexAttribute::TexCoord0);
+// Attributes propVtx() fills in with a default when the mesh has none
+static constexpr u32 DefaultedAttributes =
+    (1 << (u32)gx::VertexAttribute::PositionNormalMatrixIndex) |
+    (1 << (u32)gx::VertexAttribute::Normal) |
+    (1 << (u32)gx::VertexAttribute::Color0) |
+    (1 << (u32)gx::VertexAttribute::TexCoord0) |
+    (1 << (u32)gx::VertexAttribute::TexCoord1);
+
 void IndexedPolygon::propagate(const riistudio::lib3d::Model& mdl, u32 mp_id,
                                librii::glhelper::VBOBuilder& out) const {
   const libcube::Model& gmdl = reinterpret_cast<const libcube::Model&>(mdl);
-  u32 final_bitfield = 0;
+  const u32 final_bitfield = getVcd().mBitfield;
 
-  auto propVtx = [&](const librii::gx::IndexedVertex& vtx) {
-    const auto& vcd = getVcd();
-    out.mIndices.push_back(static_cast<u32>(out.mIndices.size()));
-    assert(final_bitfield == 0 || final_bitfield == vcd.mBitfield);
-    final_bitfield |= vcd.mBitfield;
-    // HACK:
-    if (!(vcd.mBitfield &
-          (1 << (u32)gx::VertexAttribute::PositionNormalMatrixIndex)))
-      out.pushData(1, (float)0);
-    if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::TexCoord0)))
-      out.pushData(7, glm::vec2{});
-    if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::TexCoord1)))
-      out.pushData(8, glm::vec2{});
-    if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::Normal)))
-      out.pushData(4, glm::vec3{});
-    if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::Color0)))
-      out.pushData(5, glm::vec4{1.0f, 1.0f, 1.0f, 1.0f});
-    for (u32 i = 0; i < (u32)gx::VertexAttribute::Max; ++i) {
-      if (!(vcd.mBitfield & (1 << i)))
-        continue;
+  // Weld corners referencing the same data. Only the indices of uploaded
+  // attributes are compared; the rest may hold anything.
+  const auto tris = librii::glhelper::WeldTriangles(
+      getMeshData().mMatrixPrimitives[mp_id],
+      final_bitfield & PropagatedAttributes);
+  out.recordMesh(tris.num_corners, static_cast<u32>(tris.indices.size() / 3),
+                 tris.acmr_before, tris.acmr_after);
 
-      switch (static_cast<gx::VertexAttribute>(i)) {
-      case gx::VertexAttribute::PositionNormalMatrixIndex:
-        out.pushData(
-            1, (float)vtx[gx::VertexAttribute::PositionNormalMatrixIndex]);
-        break;
-      case gx::VertexAttribute::Texture0MatrixIndex:
-      case gx::VertexAttribute::Texture1MatrixIndex:
-      case gx::VertexAttribute::Texture2MatrixIndex:
-      case gx::VertexAttribute::Texture3MatrixIndex:
-      case gx::VertexAttribute::Texture4MatrixIndex:
-      case gx::VertexAttribute::Texture5MatrixIndex:
-      case gx::VertexAttribute::Texture6MatrixIndex:
-      case gx::VertexAttribute::Texture7MatrixIndex:
-        break;
-      case gx::VertexAttribute::Position:
-        out.pushData(0, getPos(gmdl, vtx[gx::VertexAttribute::Position]));
-        break;
-      case gx::VertexAttribute::Color0:
-        out.pushData(5, getClr(gmdl, 0, vtx[gx::VertexAttribute::Color0]));
-        break;
-      case gx::VertexAttribute::Color1:
-        out.pushData(6, getClr(gmdl, 1, vtx[gx::VertexAttribute::Color1]));
-        break;
-      case gx::VertexAttribute::TexCoord0:
-      case gx::VertexAttribute::TexCoord1:
-      case gx::VertexAttribute::TexCoord2:
-      case gx::VertexAttribute::TexCoord3:
-      case gx::VertexAttribute::TexCoord4:
-      case gx::VertexAttribute::TexCoord5:
-      case gx::VertexAttribute::TexCoord6:
-      case gx::VertexAttribute::TexCoord7: {
-        const auto chan = i - static_cast<int>(gx::VertexAttribute::TexCoord0);
-        const auto attr = static_cast<gx::VertexAttribute>(i);
-        const auto data = getUv(gmdl, chan, vtx[attr]);
-        out.pushData(7 + chan, data);
-        break;
-      }
-      case gx::VertexAttribute::Normal:
-        out.pushData(4, getNrm(gmdl, vtx[gx::VertexAttribute::Normal]));
-        break;
-      case gx::VertexAttribute::NormalBinormalTangent:
-        break;
-      default:
-        assert(!"Invalid vtx attrib");
-        break;
-      }
+  // Upload vertices in the order they are first drawn, so fetches are linear.
+  constexpr u32 Unassigned = ~0u;
+  std::vector<u32> remap(tris.vertices.size(), Unassigned);
+  for (const u32 index : tris.indices) {
+    if (remap[index] == Unassigned) {
+      remap[index] = out.beginVertex();
+      propVtx(gmdl, tris.vertices[index], out);
     }
-  };
-
-  auto propPrim = [&](const librii::gx::IndexedPrimitive& idx) {
-    auto propV = [&](int id) { propVtx(idx.mVertices[id]); };
-    if (idx.mVertices.empty())
-      return;
-    switch (idx.mType) {
-    case gx::PrimitiveType::TriangleStrip: {
-      for (int v = 0; v < 3; ++v) {
-        propV(v);
-      }
-      for (int v = 3; v < idx.mVertices.size(); ++v) {
-        propV(v - ((v & 1) ? 1 : 2));
-        propV(v - ((v & 1) ? 2 : 1));
-        propV(v);
-      }
-      break;
-    }
-    case gx::PrimitiveType::Triangles:
-      for (const auto& v : idx.mVertices) {
-        propVtx(v);
-      }
-      break;
-    case gx::PrimitiveType::TriangleFan: {
-      for (int v = 0; v < 3; ++v) {
-        propV(v);
-      }
-      for (int v = 3; v < idx.mVertices.size(); ++v) {
-        propV(0);
-        propV(v - 1);
-        propV(v);
-      }
-      break;
-    }
-    default:
-      assert(!"TODO");
-      return;
-    }
-  };
-
-  auto& mprims = getMeshData().mMatrixPrimitives;
-  for (auto& idx : mprims[mp_id].mPrimitives)
-    propPrim(idx);
+    out.mIndices.push_back(remap[index]);
+  }
 
   for (int i = 0; i < (int)gx::VertexAttribute::Max; ++i) {
-    if (!(final_bitfield & (1 << i)) &&
-        i != (int)gx::VertexAttribute::PositionNormalMatrixIndex)
+    if (!((final_bitfield | DefaultedAttributes) & (1 << i)))
       continue;
     // For now, we just skip it
     if (i == (int)gx::VertexAttribute::NormalBinormalTangent)
@@ -202,11 +153,81 @@ void IndexedPolygon::propagate(const riistudio::lib3d::Model& mdl, u32 mp_id,
 
     const auto def = librii::gl::getVertexAttribGenDef((gx::VertexAttribute)i);
     assert(def.first.name != nullptr);
-    out.mPropogating[def.second].descriptor =
-        librii::glhelper::VAOEntry{.binding_point = (u32)def.second,
-                                   .name = def.first.name,
-                                   .format = def.first.format,
-                                   .size = def.first.size * 4};
+    out.setDescriptor(def.second,
+                      librii::glhelper::VAOEntry{
+                          .binding_point = (u32)def.second,
+                          .name = def.first.name,
+                          .format = def.first.format,
+                          .size = def.first.size * 4});
+  }
+}
+
+void IndexedPolygon::propVtx(const libcube::Model& gmdl,
+                             const gx::IndexedVertex& vtx,
+                             librii::glhelper::VBOBuilder& out) const {
+  const auto& vcd = getVcd();
+  // HACK:
+  if (!(vcd.mBitfield &
+        (1 << (u32)gx::VertexAttribute::PositionNormalMatrixIndex)))
+    out.pushData(1, (float)0);
+  if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::TexCoord0)))
+    out.pushData(7, glm::vec2{});
+  if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::TexCoord1)))
+    out.pushData(8, glm::vec2{});
+  if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::Normal)))
+    out.pushData(4, glm::vec3{});
+  if (!(vcd.mBitfield & (1 << (u32)gx::VertexAttribute::Color0)))
+    out.pushData(5, glm::vec4{1.0f, 1.0f, 1.0f, 1.0f});
+  for (u32 i = 0; i < (u32)gx::VertexAttribute::Max; ++i) {
+    if (!(vcd.mBitfield & (1 << i)))
+      continue;
+
+    switch (static_cast<gx::VertexAttribute>(i)) {
+    case gx::VertexAttribute::PositionNormalMatrixIndex:
+      out.pushData(1,
+                   (float)vtx[gx::VertexAttribute::PositionNormalMatrixIndex]);
+      break;
+    case gx::VertexAttribute::Texture0MatrixIndex:
+    case gx::VertexAttribute::Texture1MatrixIndex:
+    case gx::VertexAttribute::Texture2MatrixIndex:
+    case gx::VertexAttribute::Texture3MatrixIndex:
+    case gx::VertexAttribute::Texture4MatrixIndex:
+    case gx::VertexAttribute::Texture5MatrixIndex:
+    case gx::VertexAttribute::Texture6MatrixIndex:
+    case gx::VertexAttribute::Texture7MatrixIndex:
+      break;
+    case gx::VertexAttribute::Position:
+      out.pushData(0, getPos(gmdl, vtx[gx::VertexAttribute::Position]));
+      break;
+    case gx::VertexAttribute::Color0:
+      out.pushData(5, getClr(gmdl, 0, vtx[gx::VertexAttribute::Color0]));
+      break;
+    case gx::VertexAttribute::Color1:
+      out.pushData(6, getClr(gmdl, 1, vtx[gx::VertexAttribute::Color1]));
+      break;
+    case gx::VertexAttribute::TexCoord0:
+    case gx::VertexAttribute::TexCoord1:
+    case gx::VertexAttribute::TexCoord2:
+    case gx::VertexAttribute::TexCoord3:
+    case gx::VertexAttribute::TexCoord4:
+    case gx::VertexAttribute::TexCoord5:
+    case gx::VertexAttribute::TexCoord6:
+    case gx::VertexAttribute::TexCoord7: {
+      const auto chan = i - static_cast<int>(gx::VertexAttribute::TexCoord0);
+      const auto attr = static_cast<gx::VertexAttribute>(i);
+      const auto data = getUv(gmdl, chan, vtx[attr]);
+      out.pushData(7 + chan, data);
+      break;
+    }
+    case gx::VertexAttribute::Normal:
+      out.pushData(4, getNrm(gmdl, vtx[gx::VertexAttribute::Normal]));
+      break;
+    case gx::VertexAttribute::NormalBinormalTangent:
+      break;
+    default:
+      assert(!"Invalid vtx attrib");
+      break;
+    }
   }
 }
 } // namespace libcube
@@ -3,10 +3,14 @@
 #include <core/3d/i3dmodel.hpp>
 #include <core/common.h>
 #include <librii/gx.h>
+#include <librii/math/aabb.hpp>
+#include <optional>
+#include <span>
 
 namespace libcube {
 
 class Model;
+class MatrixPalette;
 
 struct IndexedPolygon : public riistudio::lib3d::Polygon {
   virtual void setId(u32 id) = 0;
@@ -39,13 +43,39 @@ struct IndexedPolygon : public riistudio::lib3d::Polygon {
     return getMeshData().mVertexDescriptor;
   }
 
-  virtual std::vector<glm::mat4> getPosMtx(const libcube::Model& mdl,
-                                           u64 mpId) const {
+  //! Position matrices of a matrix primitive, looked up in the model's
+  //! palette. Matrices that are not contiguous in the palette are gathered
+  //! into `out`; at most `out.size()` are returned.
+  //!
+  //! @return A span into `palette` or `out`.
+  //!
+  virtual std::span<const glm::mat4> getPosMtx(const MatrixPalette& palette,
+                                               u64 mpId,
+                                               std::span<glm::mat4> out) const {
     return {};
   }
 
+  //! Bounds of the positions of a matrix primitive as stored, before any
+  //! position matrix applies. None if it has no positions.
+  //!
+  std::optional<librii::math::AABB>
+  calcPositionBound(const Model& mdl, u32 mp_id) const;
+
+  //! Bounds of a matrix primitive as drawn, given the bounds of its stored
+  //! positions. Each position is moved by one of `pos_mtx` (see getPosMtx),
+  //! which may differ per vertex, so all of them bound it; none leave it as
+  //! is.
+  //!
+  static librii::math::AABB
+  transformPositionBound(const librii::math::AABB& positions,
+                         std::span<const glm::mat4> pos_mtx);
+
   virtual void init(bool skinned, librii::math::AABB* boundingBox) = 0;
   virtual void initBufsFromVcd(riistudio::lib3d::Model&) {}
+
+private:
+  void propVtx(const Model& mdl, const librii::gx::IndexedVertex& vtx,
+               librii::glhelper::VBOBuilder& out) const;
 };
 
 } // namespace libcube
@@ -90,6 +90,7 @@ struct IGCMaterial : public riistudio::lib3d::Material {
 
   virtual const libcube::Model* getParent() const { return nullptr; }
   std::pair<std::string, std::string> generateShaders() const override;
+  std::string getShaderKey() const override;
 
   virtual kpi::ConstCollectionRange<Texture>
   getTextureSource(const libcube::Scene& scn) const;
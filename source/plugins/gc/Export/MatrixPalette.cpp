@@ -0,0 +1,172 @@
+#include "MatrixPalette.hpp"
+#include "Scene.hpp"
+#include <algorithm>
+#include <glm/gtc/matrix_inverse.hpp>
+
+namespace libcube {
+
+void MatrixPalette::sortBones() {
+  const u32 num_bones = static_cast<u32>(mBones.size());
+
+  // Children of each bone, as ranges of `children`
+  std::vector<u32> offsets(num_bones + 1, 0);
+  auto getParent = [&](u32 bone) -> s64 {
+    const s64 parent = mBones[bone].parent;
+    if (parent < 0 || parent >= num_bones || parent == bone)
+      return -1;
+    return parent;
+  };
+  for (u32 i = 0; i < num_bones; ++i) {
+    if (const s64 parent = getParent(i); parent >= 0)
+      ++offsets[parent + 1];
+  }
+  for (u32 i = 0; i < num_bones; ++i)
+    offsets[i + 1] += offsets[i];
+  std::vector<u32> children(offsets.back());
+  {
+    std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+    for (u32 i = 0; i < num_bones; ++i) {
+      if (const s64 parent = getParent(i); parent >= 0)
+        children[fill[parent]++] = i;
+    }
+  }
+
+  // Breadth first from the roots
+  mOrder.clear();
+  std::vector<u8> visited(num_bones, 0);
+  auto visit = [&](u32 root) {
+    const std::size_t begin = mOrder.size();
+    mOrder.push_back(root);
+    visited[root] = 1;
+    for (std::size_t i = begin; i < mOrder.size(); ++i) {
+      const u32 bone = mOrder[i];
+      for (u32 c = offsets[bone]; c < offsets[bone + 1]; ++c) {
+        if (visited[children[c]])
+          continue;
+        visited[children[c]] = 1;
+        mBones[children[c]].eval_parent = static_cast<s32>(bone);
+        mOrder.push_back(children[c]);
+      }
+    }
+  };
+  for (u32 i = 0; i < num_bones; ++i) {
+    if (getParent(i) < 0) {
+      mBones[i].eval_parent = -1;
+      visit(i);
+    }
+  }
+  // Only cycles remain. Break them where they are first found.
+  for (u32 i = 0; i < num_bones; ++i) {
+    if (!visited[i]) {
+      mBones[i].eval_parent = -1;
+      visit(i);
+    }
+  }
+}
+
+static std::string BoneName(const riistudio::lib3d::Bone& bone) {
+  const auto* obj = dynamic_cast<const kpi::IObject*>(&bone);
+  return obj != nullptr ? obj->getName() : std::string{};
+}
+
+bool MatrixPalette::update(const Model& mdl, bool relink) {
+  const auto bones = mdl.getBones();
+  const std::size_t num_bones = bones.size();
+
+  // Another bone set -- a model replaced by undo, or another model now in
+  // this one's place -- is bound again in its current pose.
+  bool rebind = num_bones != mBones.size();
+  for (std::size_t i = 0; relink && !rebind && i < num_bones; ++i)
+    rebind = BoneName(bones[i]) != mBones[i].name;
+  if (rebind) {
+    mBones.assign(num_bones, {});
+    for (std::size_t i = 0; i < num_bones; ++i)
+      mBones[i].name = BoneName(bones[i]);
+    mDrawMatrices.clear();
+    mDrawMtx.clear();
+  }
+
+  bool resort = rebind;
+  mDirty.assign(num_bones, rebind ? 1 : 0);
+  for (std::size_t i = 0; i < num_bones; ++i) {
+    auto& state = mBones[i];
+    const auto& bone = bones[i];
+    const auto srt = bone.getSRT();
+    const s64 parent = bone.getBoneParent();
+    if (srt != state.srt)
+      mDirty[i] = 1;
+    if (parent != state.parent)
+      resort = true;
+    state.srt = srt;
+    state.parent = parent;
+  }
+  if (resort) {
+    sortBones();
+    mDirty.assign(num_bones, 1);
+  }
+
+  mBoneMtx.resize(num_bones);
+  bool any_dirty = false;
+  for (const u32 i : mOrder) {
+    const s32 parent = mBones[i].eval_parent;
+    if (parent >= 0 && mDirty[parent])
+      mDirty[i] = 1;
+    if (!mDirty[i])
+      continue;
+    any_dirty = true;
+    const auto local = librii::math::calcXform(mBones[i].srt);
+    mBoneMtx[i] = parent >= 0 ? mBoneMtx[parent] * local : local;
+  }
+
+  // Bones are bound in the first pose they are seen in.
+  if (rebind) {
+    mInvBindMtx.resize(num_bones);
+    for (std::size_t i = 0; i < num_bones; ++i)
+      mInvBindMtx[i] = glm::affineInverse(mBoneMtx[i]);
+  }
+
+  const auto& drws = mdl.mDrawMatrices;
+  const bool drws_changed = rebind || (relink && drws != mDrawMatrices);
+  if (!drws_changed && !any_dirty)
+    return false;
+  if (drws_changed) {
+    mDrawMatrices = drws;
+    mDrawMtx.resize(drws.size());
+  }
+
+  bool changed = false;
+  for (std::size_t i = 0; i < drws.size(); ++i) {
+    const auto& weights = drws[i].mWeights;
+    const bool dirty =
+        drws_changed ||
+        std::any_of(weights.begin(), weights.end(), [&](const auto& w) {
+          return w.boneId < num_bones && mDirty[w.boneId];
+        });
+    if (!dirty)
+      continue;
+
+    glm::mat4 mtx{1.0f};
+    if (weights.size() == 1) {
+      // Rigid -- bone space
+      mtx = getBoneMatrix(weights[0].boneId);
+    } else if (!weights.empty()) {
+      // Envelope -- vertices are stored in world space
+      glm::mat4 sum{0.0f};
+      float total = 0.0f;
+      for (const auto& w : weights) {
+        if (w.boneId >= num_bones)
+          continue;
+        sum += (mBoneMtx[w.boneId] * mInvBindMtx[w.boneId]) * w.weight;
+        total += w.weight;
+      }
+      // Quantized weights need not add up to one.
+      if (total > 0.0f)
+        mtx = sum / total;
+    }
+    changed |= mtx != mDrawMtx[i];
+    mDrawMtx[i] = mtx;
+  }
+  return changed || drws_changed;
+}
+
+} // namespace libcube
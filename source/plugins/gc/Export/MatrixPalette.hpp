@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Bone.hpp"
+#include <core/common.h>
+#include <glm/mat4x4.hpp>
+#include <librii/math/srt3.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace libcube {
+
+class Model;
+
+//! World matrices of a model's bones and draw matrices.
+//!
+//! Bones are evaluated parent-first, and only when their SRT (or that of an
+//! ancestor) changed since the last update. Envelope draw matrices blend the
+//! matrices of their bones relative to the pose the palette first saw them
+//! in, so vertices stored in world space stay put until a bone moves. A
+//! palette that sees another set of bones (by count or name) binds them again.
+class MatrixPalette {
+public:
+  //! Bring the palette up to date with the model.
+  //!
+  //! @param relink Whether the model may have been replaced or its draw
+  //!               matrices edited since the last update. Otherwise only the
+  //!               bone count, SRTs and parents are compared.
+  //! @return Whether any draw matrix changed.
+  //!
+  bool update(const Model& mdl, bool relink = true);
+
+  std::span<const glm::mat4> getBoneMatrices() const { return mBoneMtx; }
+  std::span<const glm::mat4> getDrawMatrices() const { return mDrawMtx; }
+
+  //! The identity for out-of-range indices.
+  const glm::mat4& getBoneMatrix(std::size_t i) const {
+    return i < mBoneMtx.size() ? mBoneMtx[i] : sIdentity;
+  }
+  const glm::mat4& getDrawMatrix(std::size_t i) const {
+    return i < mDrawMtx.size() ? mDrawMtx[i] : sIdentity;
+  }
+
+private:
+  struct BoneState {
+    std::string name;
+    librii::math::SRT3 srt{};
+    s64 parent = -1;
+    // The parent evaluated against: -1 for roots and for malformed links
+    // (out of range, or part of a cycle).
+    s32 eval_parent = -1;
+  };
+  void sortBones();
+
+  std::vector<BoneState> mBones;
+  // Bones, parents first
+  std::vector<u32> mOrder;
+  // Per bone: re-evaluated this update
+  std::vector<u8> mDirty;
+  std::vector<glm::mat4> mBoneMtx;
+  std::vector<glm::mat4> mInvBindMtx;
+
+  // The draw matrices mDrawMtx was computed from
+  std::vector<DrawMatrix> mDrawMatrices;
+  std::vector<glm::mat4> mDrawMtx;
+
+  static inline const glm::mat4 sIdentity{1.0f};
+};
+
+} // namespace libcube
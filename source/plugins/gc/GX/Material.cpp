@@ -22,6 +22,10 @@ std::pair<std::string, std::string> IGCMaterial::generateShaders() const {
   return {result->vertex, result->fragment};
 }
 
+std::string IGCMaterial::getShaderKey() const {
+  return librii::gl::MakeShaderKey(getMaterialData());
+}
+
 glm::mat4x4 GCMaterialData::TexMatrix::compute(const glm::mat4& mdl,
                                                const glm::mat4& mvp) const {
   auto texsrt =
@@ -14,7 +14,7 @@ static gx::TexCoordGen postTexGen(const gx::TexCoordGen& gen) {
 }
 void Model::MatCache::propogate(Material& mat) {
   Indirect _ind(mat);
-  indirectInfos.push_back(mat); // one per mat
+  indirectInfos.add(mat); // one per mat
   update_section(cullModes, mat.cullMode);
   for (int i = 0; i < mat.chanData.size(); ++i) {
     auto& chan = mat.chanData[i];
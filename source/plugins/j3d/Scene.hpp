@@ -5,6 +5,7 @@
 #include "Joint.hpp"
 #include "Material.hpp"
 #include "Shape.hpp"
+#include "StructHash.hpp"
 #include "Texture.hpp"
 #include "VertexBuffer.hpp"
 #include <plugins/gc/Export/Scene.hpp>
@@ -66,6 +67,26 @@ struct Tex {
   Tex(const Texture& data, const libcube::GCMaterialData::SamplerData& sampler);
 };
 
+template <> struct FieldHash<TevOrder> {
+  void operator()(StructHasher& h, const TevOrder& o) const {
+    h.add(o.rasOrder, o.texMap, o.texCoord);
+  }
+};
+template <> struct FieldHash<SwapSel> {
+  void operator()(StructHasher& h, const SwapSel& s) const {
+    h.add(s.colorChanSel, s.texSel);
+  }
+};
+template <> struct FieldHash<Tex> {
+  void operator()(StructHasher& h, const Tex& t) const {
+    // ofsTex is not compared.
+    h.add(t.mFormat, t.transparency, t.mWidth, t.mHeight, t.mWrapU, t.mWrapV,
+          t.mPaletteFormat, t.nPalette, t.ofsPalette, t.bMipMap, t.bEdgeLod,
+          t.bBiasClamp, t.mMaxAniso, t.mMinFilter, t.mMagFilter, t.mMinLod,
+          t.mMaxLod, t.mMipmapLevel, t.mLodBias, t.btiId);
+  }
+};
+
 struct ModelData : public virtual kpi::IObject {
   virtual ~ModelData() = default;
   // Shallow comparison
@@ -157,7 +178,7 @@ struct ModelData : public virtual kpi::IObject {
     bool operator==(const Indirect& rhs) const noexcept = default;
   };
   mutable struct MatCache {
-    template <typename T> using Section = std::vector<T>;
+    template <typename T> using Section = HashedVector<T>;
     Section<Indirect> indirectInfos;
     Section<librii::gx::CullMode> cullModes;
     Section<librii::gx::Color> matColors;
@@ -189,14 +210,11 @@ struct ModelData : public virtual kpi::IObject {
     Section<librii::j3d::NBTScale> nbtScales;
 
     void clear() { *this = MatCache{}; }
-    template <typename T>
-    void update_section(std::vector<T>& sec, const T& data) {
-      if (std::find(sec.begin(), sec.end(), data) == sec.end()) {
-        sec.push_back(data);
-      }
+    template <typename T> void update_section(Section<T>& sec, const T& data) {
+      sec.append(data);
     }
     template <typename T, typename U>
-    void update_section_multi(std::vector<T>& sec, const U& source) {
+    void update_section_multi(Section<T>& sec, const U& source) {
       for (int i = 0; i < source.size(); ++i) {
         update_section(sec, source[i]);
       }
@@ -204,7 +222,15 @@ struct ModelData : public virtual kpi::IObject {
     void propogate(Material& mat);
   } mMatCache;
 
-  mutable std::vector<Tex> mTexCache;
+  mutable HashedVector<Tex> mTexCache;
+};
+
+// One entry is written per material and none is searched for, so a cheap hash
+// is enough.
+template <> struct FieldHash<ModelData::Indirect> {
+  void operator()(StructHasher& h, const ModelData::Indirect& ind) const {
+    h.add(ind.enabled, ind.nIndStage);
+  }
 };
 
 } // namespace riistudio::j3d
@@ -1,5 +1,6 @@
 #include "Model.hpp"
 #include "Scene.hpp"
+#include <plugins/gc/Export/MatrixPalette.hpp>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/euler_angles.hpp>
@@ -63,50 +64,15 @@ u64 Shape::addUv(libcube::Model& mdl, u64 chan, const glm::vec2& v) {
   return add_to_buffer(v, reinterpret_cast<Model&>(mdl).mBufs.uv[chan].mData);
 }
 
-glm::mat4 computeBoneMdl(u32 id, kpi::ConstCollectionRange<lib3d::Bone> bones) {
-  glm::mat4 mdl(1.0f);
-
-  auto& bone = bones[id];
-  const auto parent = bone.getBoneParent();
-  if (parent >= 0 && parent != id)
-    mdl = computeBoneMdl(parent, bones);
-
-  return mdl * librii::math::calcXform(bone.getSRT());
-}
-std::vector<glm::mat4> Shape::getPosMtx(const libcube::Model& _mdl,
-                                        u64 mpid) const {
-  std::vector<glm::mat4> out;
-
+std::span<const glm::mat4>
+Shape::getPosMtx(const libcube::MatrixPalette& palette, u64 mpid,
+                 std::span<glm::mat4> out) const {
   const auto& mp = mMatrixPrimitives[mpid];
 
-  auto& mdl = reinterpret_cast<const Model&>(_mdl);
-  // if (!(getVcd().mBitfield &
-  //       (1 << (int)librii::gx::VertexAttribute::PositionNormalMatrixIndex)))
-  //       {
-  //   return {
-  //       mdl_ac.getJoint(0 /* DEBUG
-  //       */).get().calcSrtMtx(&mdl_ac.getJoints())};
-  // }
-  for (const auto it : mp.mDrawMatrixIndices) {
-    const auto& drw = mdl.mDrawMatrices[it];
-    glm::mat4x4 curMtx(1.0f);
-
-    // Rigid -- bone space
-    if (drw.mWeights.size() == 1) {
-      u32 boneID = drw.mWeights[0].boneId;
-      curMtx = mdl.getBones()[boneID].calcSrtMtx(mdl.getBones().toConst());
-    } else {
-      // curMtx = glm::mat4{ 0.0f };
-      // for (const auto& w : drw.mWeights) {
-      //  const auto bindMtx = computeBoneMdl(w.boneId, &mdl_ac.getJoints());
-      //  auto wInv = glm::inverse(bindMtx) * w.weight;
-      //  curMtx = curMtx + wInv;
-      //}
-    }
-    out.push_back(curMtx);
-  }
-
-  return out;
+  const std::size_t count = std::min(out.size(), mp.mDrawMatrixIndices.size());
+  for (std::size_t i = 0; i < count; ++i)
+    out[i] = palette.getDrawMatrix(mp.mDrawMatrixIndices[i]);
+  return out.first(count);
 }
 
 } // namespace riistudio::j3d
@@ -34,8 +34,9 @@ struct Shape : public librii::j3d::ShapeData,
   u64 addClr(libcube::Model& mdl, u64 chan, const glm::vec4& v) override;
   u64 addUv(libcube::Model& mdl, u64 chan, const glm::vec2& v) override;
 
-  std::vector<glm::mat4> getPosMtx(const libcube::Model& mdl,
-                                   u64 mpid) const override;
+  std::span<const glm::mat4> getPosMtx(const libcube::MatrixPalette& palette,
+                                       u64 mpid,
+                                       std::span<glm::mat4> out) const override;
 
   bool isVisible() const override { return visible; }
   void init(bool skinned, librii::math::AABB* boundingBox) override {
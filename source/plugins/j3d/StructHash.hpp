@@ -0,0 +1,234 @@
+#pragma once
+
+#include "Material.hpp"
+#include <bit>
+#include <core/common.h>
+#include <glm/glm.hpp>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace riistudio::j3d {
+
+class StructHasher;
+
+// Feeds the fields of a T to a StructHasher. Only fields that operator==
+// compares may be hashed, so that equal values always hash alike.
+template <typename T> struct FieldHash;
+
+class StructHasher {
+public:
+  template <typename... Ts> StructHasher& add(const Ts&... values) {
+    (addOne(values), ...);
+    return *this;
+  }
+  std::size_t get() const {
+    return static_cast<std::size_t>(mHash ^ (mHash >> 32));
+  }
+
+private:
+  void mix(u64 word) {
+    mHash = (std::rotl(mHash, 5) ^ word) * 0x9e3779b97f4a7c15ull;
+  }
+
+  template <glm::length_t L, typename T, glm::qualifier Q>
+  void addOne(const glm::vec<L, T, Q>& v) {
+    for (glm::length_t i = 0; i < L; ++i)
+      addOne(v[i]);
+  }
+  template <typename T> void addOne(const T& value) {
+    if constexpr (std::is_floating_point_v<T>) {
+      // -0 and +0 compare equal.
+      const f32 f = value == 0 ? 0.0f : static_cast<f32>(value);
+      mix(std::bit_cast<u32>(f));
+    } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+      mix(static_cast<u64>(value));
+    } else if constexpr (requires { value.size(); value[0]; }) {
+      // Containers compare their first size() entries, as array_vector does.
+      mix(value.size());
+      for (std::size_t i = 0; i < value.size(); ++i)
+        addOne(value[i]);
+    } else {
+      FieldHash<T>{}(*this, value);
+    }
+  }
+
+  u64 mHash = 0xcbf29ce484222325ull;
+};
+
+template <typename T> struct StructHash {
+  std::size_t operator()(const T& value) const {
+    return StructHasher{}.add(value).get();
+  }
+};
+
+// A vector that finds its entries by hash, confirming matches with
+// operator==. Entries are only changed through members that keep the index
+// current.
+template <typename T> class HashedVector {
+public:
+  using value_type = T;
+
+  HashedVector() = default;
+  explicit HashedVector(std::vector<T> entries) { assign(std::move(entries)); }
+
+  std::size_t size() const { return mEntries.size(); }
+  bool empty() const { return mEntries.empty(); }
+  const T& operator[](std::size_t idx) const { return mEntries[idx]; }
+  auto begin() const { return mEntries.begin(); }
+  auto end() const { return mEntries.end(); }
+
+  // Index of the first entry equal to `value`, or -1
+  int find(const T& value) const {
+    return find(value, StructHash<T>{}(value));
+  }
+  // Index of an entry equal to `value`, appending it if there is none
+  u32 append(const T& value) {
+    const std::size_t hash = StructHash<T>{}(value);
+    if (const int found = find(value, hash); found >= 0)
+      return found;
+    return add(value, hash);
+  }
+  // Append `value`, even if an equal entry exists
+  u32 add(const T& value) { return add(value, StructHash<T>{}(value)); }
+  // Replace the entry at `idx`
+  void set(std::size_t idx, const T& value) {
+    eraseIndex(idx);
+    mEntries[idx] = value;
+    mIndex.emplace(StructHash<T>{}(value), static_cast<u32>(idx));
+  }
+  // Replace every entry
+  void assign(std::vector<T> entries) {
+    mEntries = std::move(entries);
+    mIndex.clear();
+    for (u32 i = 0; i < mEntries.size(); ++i)
+      mIndex.emplace(StructHash<T>{}(mEntries[i]), i);
+  }
+  void clear() {
+    mEntries.clear();
+    mIndex.clear();
+  }
+
+private:
+  int find(const T& value, std::size_t hash) const {
+    int found = -1;
+    const auto [begin, end] = mIndex.equal_range(hash);
+    for (auto it = begin; it != end; ++it) {
+      const int idx = static_cast<int>(it->second);
+      if ((found < 0 || idx < found) && mEntries[idx] == value)
+        found = idx;
+    }
+    return found;
+  }
+  u32 add(const T& value, std::size_t hash) {
+    const u32 idx = static_cast<u32>(mEntries.size());
+    mEntries.push_back(value);
+    mIndex.emplace(hash, idx);
+    return idx;
+  }
+  void eraseIndex(std::size_t idx) {
+    const auto [begin, end] =
+        mIndex.equal_range(StructHash<T>{}(mEntries[idx]));
+    for (auto it = begin; it != end; ++it) {
+      if (it->second == idx) {
+        mIndex.erase(it);
+        return;
+      }
+    }
+  }
+
+  std::vector<T> mEntries;
+  std::unordered_multimap<std::size_t, u32> mIndex;
+};
+
+template <> struct FieldHash<librii::gx::Color> {
+  void operator()(StructHasher& h, const librii::gx::Color& c) const {
+    h.add(c.r, c.g, c.b, c.a);
+  }
+};
+template <> struct FieldHash<librii::gx::ColorS10> {
+  void operator()(StructHasher& h, const librii::gx::ColorS10& c) const {
+    h.add(c.r, c.g, c.b, c.a);
+  }
+};
+template <> struct FieldHash<librii::gx::ChannelControl> {
+  void operator()(StructHasher& h, const librii::gx::ChannelControl& c) const {
+    h.add(c.enabled, c.Ambient, c.Material, c.lightMask, c.diffuseFn,
+          c.attenuationFn);
+  }
+};
+template <> struct FieldHash<librii::gx::TexCoordGen> {
+  void operator()(StructHasher& h, const librii::gx::TexCoordGen& g) const {
+    h.add(g.func, g.sourceParam, g.matrix, g.normalize, g.postMatrix);
+  }
+};
+template <> struct FieldHash<libcube::GCMaterialData::TexMatrix> {
+  void operator()(StructHasher& h,
+                  const libcube::GCMaterialData::TexMatrix& m) const {
+    h.add(m.projection, m.scale, m.rotate, m.translate, m.effectMatrix,
+          m.transformModel, m.method, m.option, m.camIdx, m.lightIdx);
+  }
+};
+template <> struct FieldHash<libcube::GCMaterialData::SamplerData> {
+  void operator()(StructHasher& h,
+                  const libcube::GCMaterialData::SamplerData& s) const {
+    h.add(s.mTexture, s.mPalette, s.mWrapU, s.mWrapV, s.bEdgeLod,
+          s.bBiasClamp, s.mMaxAniso, s.mMinFilter, s.mMagFilter, s.mLodBias,
+          s.btiId);
+  }
+};
+template <> struct FieldHash<librii::gx::TevStage> {
+  void operator()(StructHasher& h, const librii::gx::TevStage& s) const {
+    const auto& c = s.colorStage;
+    const auto& a = s.alphaStage;
+    const auto& i = s.indirectStage;
+    h.add(s.rasOrder, s.texMap, s.texCoord, s.rasSwap, s.texMapSwap);
+    h.add(c.constantSelection, c.a, c.b, c.c, c.d, c.formula, c.bias, c.scale,
+          c.clamp, c.out);
+    h.add(a.a, a.b, a.c, a.d, a.formula, a.constantSelection, a.bias, a.scale,
+          a.clamp, a.out);
+    h.add(i.indStageSel, i.format, i.bias, i.matrix, i.wrapU, i.wrapV,
+          i.addPrev, i.utcLod, i.alpha);
+  }
+};
+template <> struct FieldHash<librii::gx::SwapTableEntry> {
+  void operator()(StructHasher& h, const librii::gx::SwapTableEntry& e) const {
+    h.add(e.r, e.g, e.b, e.a);
+  }
+};
+template <> struct FieldHash<librii::j3d::Fog> {
+  void operator()(StructHasher& h, const librii::j3d::Fog& f) const {
+    h.add(f.type, f.enabled, f.center, f.startZ, f.endZ, f.nearZ, f.farZ,
+          f.color, f.rangeAdjTable);
+  }
+};
+template <> struct FieldHash<librii::j3d::NBTScale> {
+  void operator()(StructHasher& h, const librii::j3d::NBTScale& s) const {
+    h.add(s.enable, s.scale);
+  }
+};
+template <> struct FieldHash<librii::gx::AlphaComparison> {
+  void operator()(StructHasher& h,
+                  const librii::gx::AlphaComparison& c) const {
+    h.add(c.compLeft, c.refLeft, c.op, c.compRight, c.refRight);
+  }
+};
+template <> struct FieldHash<librii::gx::BlendMode> {
+  void operator()(StructHasher& h, const librii::gx::BlendMode& b) const {
+    h.add(b.type, b.source, b.dest, b.logic);
+  }
+};
+template <> struct FieldHash<librii::gx::ZMode> {
+  void operator()(StructHasher& h, const librii::gx::ZMode& z) const {
+    h.add(z.compare, z.function, z.update);
+  }
+};
+// Materials rarely share a name, so a few fields besides it are enough.
+template <> struct FieldHash<MaterialData> {
+  void operator()(StructHasher& h, const MaterialData& m) const {
+    h.add(m.name, m.flag, m.cullMode, m.chanData.size(), m.texGens.size(),
+          m.samplers.size(), m.mStages, m.zMode, m.alphaCompare, m.blendMode);
+  }
+};
+
+} // namespace riistudio::j3d
@@ -5,14 +5,18 @@
 #include <oishii/writer/binary_writer.hxx>
 #include <oishii/writer/linker.hxx>
 
+#include <algorithm>
+#include <array>
 #include <string>
 
+#include <plugins/gc/Export/ExportOptions.hpp>
 #include <plugins/j3d/Scene.hpp>
 
 #include "Sections.hpp"
 
 #include <librii/gx/validate/MaterialValidate.hpp>
 
+#include <core/util/profiler.hpp>
 #include <core/util/timestamp.hpp>
 
 bool gTestMode = false;
@@ -21,6 +25,221 @@ namespace riistudio::j3d {
 
 using namespace libcube;
 
+namespace {
+
+// Parts of the document a section is written from
+enum SectionInput : u32 {
+  Materials = 1 << 0,
+  Bones = 1 << 1,
+  Meshes = 1 << 2,
+  // Including the tolerance they are quantized to
+  Buffers = 1 << 3,
+  DrawMatrices = 1 << 4,
+  ScalingRule = 1 << 5,
+  Textures = 1 << 6,
+};
+
+struct SectionWriter {
+  std::unique_ptr<oishii::Node> (*make)(BMDExportContext& ctx);
+  // Profiler scope
+  const char* name;
+  u32 inputs;
+  bool bdlOnly = false;
+};
+
+// In file order
+const SectionWriter SectionWriters[] = {
+    {makeINF1Node, "Write INF1",
+     Materials | Bones | Meshes | Buffers | ScalingRule},
+    {makeVTX1Node, "Write VTX1", Buffers},
+    {makeEVP1Node, "Write EVP1", Bones | DrawMatrices},
+    {makeDRW1Node, "Write DRW1", Bones | DrawMatrices},
+    {makeJNT1Node, "Write JNT1", Bones},
+    {makeSHP1Node, "Write SHP1", Meshes | Buffers | DrawMatrices},
+    {makeMAT3Node, "Write MAT3", Materials | Textures},
+    {makeMDL3Node, "Write MDL3", Materials | Textures, true},
+    {makeTEX1Node, "Write TEX1", Materials | Textures},
+};
+constexpr std::size_t NumSections = std::size(SectionWriters);
+
+template <typename T, VBufferKind kind>
+bool SameBuffer(const VertexBuffer<T, kind>& a,
+                const VertexBuffer<T, kind>& b) {
+  const auto& qa = a.mQuant;
+  const auto& qb = b.mQuant;
+  bool same_format = qa.divisor == qb.divisor && qa.stride == qb.stride;
+  if constexpr (kind == VBufferKind::position) {
+    same_format &= qa.comp.position == qb.comp.position &&
+                   qa.type.generic == qb.type.generic;
+  } else if constexpr (kind == VBufferKind::normal) {
+    same_format &= qa.comp.normal == qb.comp.normal &&
+                   qa.type.generic == qb.type.generic;
+  } else if constexpr (kind == VBufferKind::color) {
+    same_format &=
+        qa.comp.color == qb.comp.color && qa.type.color == qb.type.color;
+  } else {
+    same_format &= qa.comp.texcoord == qb.comp.texcoord &&
+                   qa.type.generic == qb.type.generic;
+  }
+  // Buffer data is copy-on-write: this is a pointer comparison until the
+  // buffer is edited.
+  return same_format && a.mData == b.mData;
+}
+
+bool SameBuffers(const ModelData::Bufs& a, const ModelData::Bufs& b) {
+  for (std::size_t i = 0; i < a.color.size(); ++i)
+    if (!SameBuffer(a.color[i], b.color[i]))
+      return false;
+  for (std::size_t i = 0; i < a.uv.size(); ++i)
+    if (!SameBuffer(a.uv[i], b.uv[i]))
+      return false;
+  return SameBuffer(a.pos, b.pos) && SameBuffer(a.norm, b.norm);
+}
+
+// A section as last saved
+struct CachedSection {
+  std::string id;
+  std::vector<u8> bytes;
+};
+
+// The sections of the model a writer last saved, and what they were written
+// from. A section refers only to itself and to the start of the section after
+// it, which stays put while the section does not change, so an unchanged
+// section may be copied as is.
+struct SaveCache {
+  const Collection* collection = nullptr;
+  bool bdl = false;
+  bool testMode = false;
+  // Model record. Records made against it share every part of the model that
+  // is unchanged.
+  std::shared_ptr<const kpi::IMemento> record;
+  ModelData::Bufs bufs;
+  std::vector<libcube::DrawMatrix> drawMatrices;
+  ModelData::Information::ScalingRule scalingRule{};
+  std::vector<librii::j3d::TextureData> textures;
+  librii::gx::QuantizeTolerance tolerance;
+  // By SectionWriters index. Empty until written.
+  std::array<CachedSection, NumSections> sections;
+
+  // The inputs that differ from the last save. Takes the record made against
+  // ours.
+  u32 changes(const Collection& col, bool bdl_,
+              const librii::gx::QuantizeTolerance& quantize,
+              std::shared_ptr<const kpi::IMemento>& next) const {
+    const auto& mdl = col.getModels()[0];
+    next = mdl.next(record.get());
+    const auto* a = dynamic_cast<const Model::_Memento*>(next.get());
+    const auto* b = dynamic_cast<const Model::_Memento*>(record.get());
+    if (a == nullptr || b == nullptr || collection != &col || bdl != bdl_ ||
+        testMode != gTestMode)
+      return ~0u;
+
+    u32 changed = 0;
+    if (a->mMaterials != b->mMaterials)
+      changed |= Materials;
+    if (a->mBones != b->mBones)
+      changed |= Bones;
+    if (a->mMeshes != b->mMeshes)
+      changed |= Meshes;
+    if (!SameBuffers(mdl.mBufs, bufs) || quantize != tolerance)
+      changed |= Buffers;
+    if (mdl.mDrawMatrices != drawMatrices)
+      changed |= DrawMatrices;
+    if (mdl.info.mScalingRule != scalingRule)
+      changed |= ScalingRule;
+    bool same_textures = col.getTextures().size() == textures.size();
+    for (std::size_t i = 0; same_textures && i < textures.size(); ++i) {
+      same_textures = static_cast<const librii::j3d::TextureData&>(
+                          col.getTextures()[i]) == textures[i];
+    }
+    if (!same_textures)
+      changed |= Textures;
+    return changed;
+  }
+
+  // Copies the sections written anew by `linker`, and remembers what they
+  // were written from.
+  void update(const oishii::Linker& linker, oishii::Writer& writer,
+              u32 changed, const Collection& col, bool bdl_,
+              const librii::gx::QuantizeTolerance& quantize,
+              std::shared_ptr<const kpi::IMemento> next) {
+    auto find = [&](const std::string& symbol) {
+      const auto it =
+          std::find_if(linker.mMap.begin(), linker.mMap.end(),
+                       [&](const auto& e) { return e.symbol == symbol; });
+      assert(it != linker.mMap.end());
+      return it->begin;
+    };
+    const u8* data = writer.getDataBlockStart();
+    for (std::size_t i = 0; i < NumSections; ++i) {
+      auto& section = sections[i];
+      if ((SectionWriters[i].inputs & changed) == 0 || section.id.empty())
+        continue;
+      section.bytes.assign(data + find(section.id),
+                           data + find(section.id + "::EndOfChildren"));
+    }
+
+    const auto& mdl = col.getModels()[0];
+    collection = &col;
+    bdl = bdl_;
+    testMode = gTestMode;
+    record = std::move(next);
+    bufs = mdl.mBufs;
+    drawMatrices = mdl.mDrawMatrices;
+    scalingRule = mdl.info.mScalingRule;
+    textures.clear();
+    for (const auto& tex : col.getTextures())
+      textures.push_back(tex);
+    tolerance = quantize;
+  }
+};
+
+// Writes a section as it was last saved
+class ReusedSection final : public oishii::Node {
+public:
+  explicit ReusedSection(const CachedSection& section)
+      : Node(section.id, {.Leaf = true}), mSection(section) {}
+
+  Result write(oishii::Writer& writer) const noexcept override {
+    writer.writeBytes(mSection.bytes);
+    return {};
+  }
+
+private:
+  const CachedSection& mSection;
+};
+
+// Zero-sized nodes around a section, timing the linker writing it
+class ProfileBegin final : public oishii::Node {
+public:
+  explicit ProfileBegin(const char* name)
+      : Node(std::string(name) + " begin", {.Leaf = true}) {}
+
+  Result write(oishii::Writer&) const noexcept override {
+    mBegin = util::ProfilerNow();
+    return {};
+  }
+
+  mutable u64 mBegin = 0;
+};
+class ProfileEnd final : public oishii::Node {
+public:
+  ProfileEnd(const char* name, const ProfileBegin& begin)
+      : Node(std::string(name) + " end", {.Leaf = true}), mName(name),
+        mBegin(begin) {}
+
+  Result write(oishii::Writer&) const noexcept override {
+    util::ProfilerRecord(mName, mBegin.mBegin, util::ProfilerNow());
+    return {};
+  }
+
+private:
+  const char* mName;
+  const ProfileBegin& mBegin;
+};
+
+} // namespace
+
 struct BMDFile : public oishii::Node {
   static const char* getNameId() { return "JSystem Binary Model Data"; }
 
@@ -50,27 +269,39 @@ struct BMDFile : public oishii::Node {
     return {};
   }
   Result gatherChildren(oishii::Node::NodeDelegate& ctx) const {
-    BMDExportContext exp{mCollection->getModels()[0], *mCollection};
+    BMDExportContext exp{mCollection->getModels()[0], *mCollection,
+                         mTolerance};
 
     auto addNode = [&](std::unique_ptr<oishii::Node> node) {
       node->getLinkingRestriction().alignment = 32;
       ctx.addNode(std::move(node));
     };
 
-    addNode(makeINF1Node(exp));
-    addNode(makeVTX1Node(exp));
-    addNode(makeEVP1Node(exp));
-    addNode(makeDRW1Node(exp));
-    addNode(makeJNT1Node(exp));
-    addNode(makeSHP1Node(exp));
-    addNode(makeMAT3Node(exp));
-    if (bBDL)
-      addNode(makeMDL3Node(exp));
-    addNode(makeTEX1Node(exp));
+    for (std::size_t i = 0; i < NumSections; ++i) {
+      const auto& section = SectionWriters[i];
+      if (section.bdlOnly && !bBDL)
+        continue;
+      auto begin = std::make_unique<ProfileBegin>(section.name);
+      auto end = std::make_unique<ProfileEnd>(section.name, *begin);
+      ctx.addNode(std::move(begin));
+      auto& cached = mCache->sections[i];
+      if ((section.inputs & mChanged) == 0 && !cached.id.empty()) {
+        addNode(std::make_unique<ReusedSection>(cached));
+      } else {
+        auto node = section.make(exp);
+        cached.id = node->getId();
+        addNode(std::move(node));
+      }
+      ctx.addNode(std::move(end));
+    }
     return {};
   }
 
   j3d::Collection* mCollection;
+  librii::gx::QuantizeTolerance mTolerance;
+  // Sections unchanged since the last save are copied from it.
+  SaveCache* mCache = nullptr;
+  u32 mChanged = ~0u;
   bool bBDL = true;
   bool bMimic = true;
 };
@@ -85,7 +316,7 @@ void BMD_Pad(char* dst, u32 len) {
   else
     memset(dst, 0, len);
 }
-class BMD {
+class BMD : public ConfigurableExporter {
 public:
   std::string canRead(const std::string& file,
                       oishii::BinaryReader& reader) const {
@@ -115,13 +346,7 @@ public:
           Tex tmp(collection.getTextures()[btiId], *samp);
           tmp.btiId = btiId;
 
-          auto found = std::find(texCache.begin(), texCache.end(), tmp);
-          if (found == texCache.end()) {
-            texCache.push_back(tmp);
-            samp->btiId = texCache.size() - 1;
-          } else {
-            samp->btiId = found - texCache.begin();
-          }
+          samp->btiId = texCache.append(tmp);
         }
       }
       matCache.propogate(mat);
@@ -146,20 +371,37 @@ public:
 
     oishii::Linker linker;
 
+    {
+      RII_PROFILE_SCOPE("Build MAT3/TEX1 tables");
+      processCollectionForWrite(collection);
+    }
+
+    const bool bdl = collection.getModels()[0].isBDL;
+    std::shared_ptr<const kpi::IMemento> record;
+    const u32 changed =
+        mSaveCache.changes(collection, bdl, mExportOptions.quantize, record);
+
     auto bmd = std::make_unique<BMDFile>();
-    bmd->bBDL = collection.getModels()[0].isBDL;
+    bmd->bBDL = bdl;
     bmd->bMimic = true;
     bmd->mCollection = &collection;
+    bmd->mTolerance = mExportOptions.quantize;
+    bmd->mCache = &mSaveCache;
+    bmd->mChanged = changed;
 
     linker.mUserPad = &BMD_Pad;
     writer.mUserPad = &BMD_Pad;
 
-    processCollectionForWrite(collection);
-
     // writer.add_bp(0x37b2c, 4);
 
-    linker.gather(std::move(bmd), "");
+    {
+      RII_PROFILE_SCOPE("Gather sections");
+      linker.gather(std::move(bmd), "");
+    }
     linker.write(writer);
+
+    mSaveCache.update(linker, writer, changed, collection, bdl,
+                      mExportOptions.quantize, std::move(record));
   }
 
   void read(kpi::IOTransaction& transaction) const {
@@ -341,6 +583,11 @@ public:
 
     // Read MDL3
   }
+
+private:
+  // What the last save wrote. A writer kept for a document between saves
+  // copies the sections left unchanged; a new writer writes every one.
+  mutable SaveCache mSaveCache;
 };
 
 kpi::Register<BMD, kpi::Reader | kpi::Writer> BMDInstaller;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <core/common.h>
+#include <librii/gx/VertexQuantize.hpp>
 #include <map>
 #include <oishii/writer/binary_writer.hxx>
 #include <oishii/writer/node.hxx>
@@ -147,6 +148,8 @@ struct LinkNode final : public T, public oishii::Node {
 struct BMDExportContext {
   Model& mdl;
   Collection& col;
+  // Largest error allowed when storing float vertex buffers as fixed point
+  const librii::gx::QuantizeTolerance& tolerance;
   /*
   We need to associate Samplers and TexData
   */
@@ -1,9 +1,11 @@
 #include "../OutputCtx.hpp"
 #include "../Sections.hpp"
+#include <core/util/profiler.hpp>
 
 namespace riistudio::j3d {
 
 void readEVP1DRW1(BMDOutputContext& ctx) {
+  RII_PROFILE_SCOPE("Read EVP1/DRW1");
   auto& reader = ctx.reader;
   // We infer DRW1 -- one bone -> singlebound, else create envelope
   std::vector<libcube::DrawMatrix> envelopes;
@@ -2,9 +2,11 @@
 #include "../OutputCtx.hpp"
 #include "../SceneGraph.hpp"
 #include "../Sections.hpp"
+#include <core/util/profiler.hpp>
 namespace riistudio::j3d {
 
 void readINF1(BMDOutputContext& ctx) {
+  RII_PROFILE_SCOPE("Read INF1");
   auto& reader = ctx.reader;
   if (enterSection(ctx, 'INF1')) {
     ScopedSection g(reader, "Information");
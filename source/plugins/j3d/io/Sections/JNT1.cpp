@@ -3,12 +3,14 @@
 
 #include "../Sections.hpp"
 #include <core/util/glm_io.hpp>
+#include <core/util/profiler.hpp>
 
 namespace riistudio::j3d {
 
 using namespace libcube;
 
 void readJNT1(BMDOutputContext& ctx) {
+  RII_PROFILE_SCOPE("Read JNT1");
   auto& reader = ctx.reader;
   if (!enterSection(ctx, 'JNT1'))
     return;
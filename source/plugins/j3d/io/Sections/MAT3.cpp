@@ -1,4 +1,6 @@
 #include "MaterialData.hpp"
+#include <core/util/parallel.hpp>
+#include <core/util/profiler.hpp>
 
 namespace riistudio::j3d {
 
@@ -300,6 +302,7 @@ template <typename T> void operator<<(T& lhs, oishii::BinaryReader& rhs) {
 }
 
 void readMAT3(BMDOutputContext& ctx) {
+  RII_PROFILE_SCOPE("Read MAT3");
   auto& reader = ctx.reader;
   if (!enterSection(ctx, 'MAT3'))
     return;
@@ -348,9 +351,10 @@ void readMAT3(BMDOutputContext& ctx) {
       if (size <= 0)
         continue;
 
-      auto readCacheEntry = [&](auto& out, std::size_t entry_size) {
+      auto readCacheEntry = [&](auto& cache_out, std::size_t entry_size) {
         const auto nInferred = size / entry_size;
-        out.resize(nInferred);
+        std::vector<typename std::decay_t<decltype(cache_out)>::value_type>
+            out(nInferred);
 
         auto pad_check = [](oishii::BinaryReader& reader,
                             std::size_t search_size) {
@@ -374,6 +378,7 @@ void readMAT3(BMDOutputContext& ctx) {
           ++_it;
         }
         out.resize(_it);
+        cache_out.assign(std::move(out));
       };
 
       switch ((MatSec)i) {
@@ -485,15 +490,26 @@ void readMAT3(BMDOutputContext& ctx) {
   reader.seekSet(ofsStringTable + g.start);
   const auto nameTable = readNameTable(reader);
 
-  for (int i = 0; i < size; ++i) {
-    Material& mat = ctx.mdl.getMaterials()[i];
-    reader.seekSet(g.start + ofsMatData + ctx.materialIdLut[i] * 0x14c);
-    // This was a bug: multiple materials should not share the same ID.
-    // mat.id = ctx.materialIdLut[i];
-    mat.name = nameTable[i];
-
-    readMatEntry(mat, loader, reader, ofsStringTable, i);
-  }
+  // Entries only read the file, so large sections read them in parallel.
+  std::vector<std::vector<oishii::HeldWarning>> warnings(size);
+  util::ParallelFor(
+      size,
+      [&](u32 i) {
+        Material& mat = ctx.mdl.getMaterials()[i];
+        auto matReader = reader.fork();
+        MatLoader matLoader{loader.mSections, loader.start, matReader};
+        matReader.seekSet(g.start + ofsMatData +
+                          ctx.materialIdLut[i] * 0x14c);
+        // This was a bug: multiple materials should not share the same ID.
+        // mat.id = ctx.materialIdLut[i];
+        mat.name = nameTable[i];
+
+        readMatEntry(mat, matLoader, matReader, ofsStringTable, i);
+        warnings[i] = matReader.takeWarnings();
+      },
+      g.size >= util::MinParallelDecodeBytes);
+  for (const auto& entryWarnings : warnings)
+    reader.replayWarnings(entryWarnings);
 }
 template <typename T, u32 bodyAlign = 1, u32 entryAlign = 1,
           bool compress = true>
@@ -533,36 +549,17 @@ public:
   }
 
   u32 append(const T& entry) {
-    const auto found = std::find(mEntries.begin(), mEntries.end(), entry);
-    if (found == mEntries.end() || !compress) {
-      mEntries.push_back(entry);
-      return mEntries.size() - 1;
-    }
-    return found - mEntries.begin();
-  }
-  int find(const T& entry) const {
-    int outIdx = -1;
-    for (int i = 0; i < mEntries.size(); ++i)
-      if (entry == mEntries[i]) {
-        outIdx = i;
-        break;
-      }
-    // Intentionally complete
-    // TODO: rfind
-    return outIdx;
+    return compress ? mEntries.append(entry) : mEntries.add(entry);
   }
+  int find(const T& entry) const { return mEntries.find(entry); }
   u32 getNumEntries() const { return mEntries.size(); }
   const T& getEntry(u32 idx) const {
     assert(idx < mEntries.size());
     return mEntries[idx];
   }
-  T& getEntry(u32 idx) {
-    assert(idx < mEntries.size());
-    return mEntries[idx];
-  }
 
 public:
-  std::vector<T> mEntries;
+  HashedVector<T> mEntries;
 };
 struct MAT3Node;
 struct SerializableMaterial {
@@ -574,16 +571,16 @@ struct SerializableMaterial {
 
   bool operator==(const SerializableMaterial& rhs) const noexcept;
 };
+template <> struct FieldHash<SerializableMaterial> {
+  void operator()(StructHasher& h, const SerializableMaterial& smat) const;
+};
 auto find = [](const auto& buf, const auto x) {
-  auto found = std::find(buf.begin(), buf.end(), x);
-  // if (found == buf.end()) {
-  // 	buf.push_back(x);
-  // }
-  assert(found != buf.end());
-  if (found == buf.end()) {
+  const int found = buf.find(x);
+  assert(found >= 0);
+  if (found < 0) {
     printf("Invalid data entry not cached.\n");
   }
-  return found == buf.end() ? -1 : found - buf.begin();
+  return found;
 };
 template <typename TIdx, typename T, typename TPool>
 void write_array_vec(oishii::Writer& writer, const T& vec, TPool& pool) {
@@ -593,7 +590,7 @@ void write_array_vec(oishii::Writer& writer, const T& vec, TPool& pool) {
     writer.write<TIdx>(-1);
 }
 template <typename T>
-int write_cache(oishii::Writer& writer, const std::vector<T>& cache) {
+int write_cache(oishii::Writer& writer, const HashedVector<T>& cache) {
   // while (writer.tell() % io_wrapper<T>::SizeOf) writer.write(0xff);
   const auto start = writer.tell();
   for (auto& x : cache) {
@@ -777,6 +774,11 @@ bool SerializableMaterial::operator==(
   return mMAT3.mMdl.getMaterials()[mIdx] ==
          rhs.mMAT3.mMdl.getMaterials()[rhs.mIdx];
 }
+void FieldHash<SerializableMaterial>::operator()(
+    StructHasher& h, const SerializableMaterial& smat) const {
+  const MaterialData& m = smat.mMAT3.mMdl.getMaterials()[smat.mIdx];
+  h.add(m);
+}
 void io_wrapper<SerializableMaterial>::onWrite(
     oishii::Writer& writer, const SerializableMaterial& smat) {
   const Material& m = smat.mMAT3.mMdl.getMaterials()[smat.mIdx];
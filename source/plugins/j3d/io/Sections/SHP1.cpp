@@ -1,5 +1,7 @@
 #include "../Sections.hpp"
 #include <core/util/glm_io.hpp>
+#include <core/util/parallel.hpp>
+#include <core/util/profiler.hpp>
 #include <librii/gpu/DLMesh.hpp>
 
 namespace riistudio::j3d {
@@ -7,6 +9,7 @@ namespace riistudio::j3d {
 using namespace libcube;
 
 void readSHP1(BMDOutputContext& ctx) {
+  RII_PROFILE_SCOPE("Read SHP1");
   auto& reader = ctx.reader;
 
   if (!enterSection(ctx, 'SHP1'))
@@ -65,6 +68,14 @@ void readSHP1(BMDOutputContext& ctx) {
   // reader.seekSet(ofsStringTable + g.start);
   // const auto nameTable = readNameTable(reader);
 
+  // Display lists of each shape, decoded once every shape is read: matrix
+  // lists carry over between shapes, but display lists are independent.
+  struct DisplayList {
+    u32 ofs;
+    u32 size;
+  };
+  std::vector<std::vector<DisplayList>> displayLists(size);
+
   std::array<s16, 10> mtxListLast;
   for (int si = 0; si < size; ++si) {
     auto& shape = ctx.mdl.getMeshes()[si];
@@ -142,33 +153,61 @@ void readSHP1(BMDOutputContext& ctx) {
 
       // Mtx Prim Data
       MatrixData mtxPrimHdr = readMatrixData();
-      MatrixPrimitive& mprim = shape.mMatrixPrimitives.emplace_back(
-          mtxPrimHdr.current_matrix, mtxPrimHdr.matrixList);
+      shape.mMatrixPrimitives.emplace_back(mtxPrimHdr.current_matrix,
+                                           mtxPrimHdr.matrixList);
+      displayLists[si].push_back({g.start + ofsDL + dlOfs, dlSz});
+    }
+  }
 
-      struct SHP1_MPrim : librii::gpu::IMeshDLDelegate {
-        librii::gx::IndexedPrimitive&
-        addIndexedPrimitive(gx::PrimitiveType type, u16 nVerts) override {
-          return mprim.mPrimitives.emplace_back(type, nVerts);
+  struct ShapeStatus {
+    std::map<gx::VertexBufferAttribute, u32> maxIndices;
+    std::vector<std::string> errors;
+    std::vector<oishii::HeldWarning> warnings;
+  };
+  std::vector<ShapeStatus> status(size);
+  util::ParallelFor(
+      size,
+      [&](u32 si) {
+        auto& shape = ctx.mdl.getMeshes()[si];
+        auto shapeReader = reader.fork();
+        for (std::size_t i = 0; i < displayLists[si].size(); ++i) {
+          struct SHP1_MPrim : librii::gpu::IMeshDLDelegate {
+            librii::gx::IndexedPrimitive&
+            addIndexedPrimitive(gx::PrimitiveType type, u16 nVerts) override {
+              return mprim.mPrimitives.emplace_back(type, nVerts);
+            }
+            SHP1_MPrim(MatrixPrimitive& mp) : mprim(mp) {}
+
+          private:
+            MatrixPrimitive& mprim;
+          } mprim_del(shape.mMatrixPrimitives[i]);
+          const auto& dl = displayLists[si][i];
+          auto err = DecodeMeshDisplayList(
+              shapeReader, dl.ofs, dl.size, mprim_del,
+              shape.mVertexDescriptor, &status[si].maxIndices);
+
+          if (err) {
+            std::string buf;
+            llvm::raw_string_ostream stream(buf);
+            stream << err;
+            status[si].errors.push_back(stream.str());
+
+            llvm::consumeError(std::move(err));
+          }
         }
-        SHP1_MPrim(MatrixPrimitive& mp) : mprim(mp) {}
-
-      private:
-        MatrixPrimitive& mprim;
-      } mprim_del(mprim);
-      auto err = DecodeMeshDisplayList(reader, g.start + ofsDL + dlOfs, dlSz,
-                                       mprim_del, shape.mVertexDescriptor,
-                                       &ctx.mVertexBufferMaxIndices);
-
-      if (err) {
-        printf("Invalid mesh display list..\n");
-
-        std::string buf;
-        llvm::raw_string_ostream stream(buf);
-        stream << err;
-        printf("%s\n", buf.c_str());
-
-        llvm::consumeError(std::move(err));
-      }
+        status[si].warnings = shapeReader.takeWarnings();
+      },
+      g.size >= util::MinParallelDecodeBytes);
+
+  for (const auto& shapeStatus : status) {
+    reader.replayWarnings(shapeStatus.warnings);
+    for (const auto& error : shapeStatus.errors) {
+      printf("Invalid mesh display list..\n");
+      printf("%s\n", error.c_str());
+    }
+    for (const auto& [attr, maxIndex] : shapeStatus.maxIndices) {
+      auto& max = ctx.mVertexBufferMaxIndices[attr];
+      max = std::max(max, maxIndex);
     }
   }
 }
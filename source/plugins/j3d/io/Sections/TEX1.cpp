@@ -1,4 +1,5 @@
 #include "../Sections.hpp"
+#include <core/util/profiler.hpp>
 #include <map>
 #include <string.h>
 
@@ -89,6 +90,7 @@ Tex::Tex(const Texture& data,
   ofsTex = -1;
 }
 void readTEX1(BMDOutputContext& ctx) {
+  RII_PROFILE_SCOPE("Read TEX1");
   auto& reader = ctx.reader;
   if (!enterSection(ctx, 'TEX1'))
     return;
@@ -141,21 +143,24 @@ void readTEX1(BMDOutputContext& ctx) {
         }
       }
     }
-    for (auto& samp : ctx.mdl.mMatCache.samplers) {
-      if (samp.btiId == i) {
-        samp.mTexture = nameTable[i];
-        samp.mWrapU = tex.mWrapU;
-        samp.mWrapV = tex.mWrapV;
-        // samp.bMipMap = tex.bMipMap;
-        samp.bEdgeLod = tex.bEdgeLod;
-        samp.bBiasClamp = tex.bBiasClamp;
-        samp.mMaxAniso = tex.mMaxAniso;
-        samp.mMinFilter = tex.mMinFilter;
-        samp.mMagFilter = tex.mMagFilter;
-        samp.mLodBias = static_cast<f32>(tex.mLodBias) / 100.0f;
-      }
+    auto& samplers = ctx.mdl.mMatCache.samplers;
+    for (std::size_t k = 0; k < samplers.size(); ++k) {
+      if (samplers[k].btiId != i)
+        continue;
+      auto samp = samplers[k];
+      samp.mTexture = nameTable[i];
+      samp.mWrapU = tex.mWrapU;
+      samp.mWrapV = tex.mWrapV;
+      // samp.bMipMap = tex.bMipMap;
+      samp.bEdgeLod = tex.bEdgeLod;
+      samp.bBiasClamp = tex.bBiasClamp;
+      samp.mMaxAniso = tex.mMaxAniso;
+      samp.mMinFilter = tex.mMinFilter;
+      samp.mMagFilter = tex.mMagFilter;
+      samp.mLodBias = static_cast<f32>(tex.mLodBias) / 100.0f;
+      samplers.set(k, samp);
     }
-    ctx.mdl.mTexCache.push_back(tex);
+    ctx.mdl.mTexCache.add(tex);
     auto& inf = texRaw.emplace_back();
     auto& data = inf.data;
 
@@ -197,8 +202,9 @@ void readTEX1(BMDOutputContext& ctx) {
   int i = 0;
   for (const auto& it : uniques) {
     auto& texpair = texRaw[it.bti_index];
-    reader.readBuffer(texpair.data.mData, texpair.byte_size,
-                      texpair.absolute_file_offset);
+    std::vector<u8> image;
+    reader.readBuffer(image, texpair.byte_size, texpair.absolute_file_offset);
+    texpair.data.mData = std::move(image);
     ctx.col.getTextures().add() = texpair.data;
 
     ++i;
@@ -1,10 +1,14 @@
 #include "../Sections.hpp"
+#include <core/util/profiler.hpp>
+#include <librii/gx/VertexQuantize.hpp>
+#include <optional>
 
 namespace riistudio::j3d {
 
 using namespace libcube;
 
 void readVTX1(BMDOutputContext& ctx) {
+  RII_PROFILE_SCOPE("Read VTX1");
   auto& reader = ctx.reader;
   if (!enterSection(ctx, 'VTX1'))
     return;
@@ -213,8 +217,33 @@ void readVTX1(BMDOutputContext& ctx) {
     }
   }
 }
+// Float buffers are exported as fixed point where it is precise enough.
+template <typename T, VBufferKind kind>
+std::optional<librii::gx::FixedPointFormat>
+chooseExportFormat(const VertexBuffer<T, kind>& buf,
+                   const librii::gx::QuantizeTolerance& tolerances) {
+  const f32 tolerance = tolerances.get(kind);
+  if (!(tolerance > 0.0f) || buf.mData.empty() ||
+      buf.mQuant.type.generic != gx::VertexBufferType::Generic::f32)
+    return std::nullopt;
+  const u32 nComponents = buf.ComputeComponentCount();
+  const auto values = librii::gx::FlattenComponents<T::length()>(buf.mData);
+  const auto [min, max] =
+      librii::gx::FindBounds(values, T::length(), nComponents);
+  return librii::gx::ChooseFixedPointFormat(values, T::length(), nComponents,
+                                            min, max, tolerance, kind);
+}
+
+struct ExportFormats {
+  std::optional<librii::gx::FixedPointFormat> pos;
+  std::optional<librii::gx::FixedPointFormat> norm;
+  std::array<std::optional<librii::gx::FixedPointFormat>, 8> uv;
+};
+
 struct FormatDecl : public oishii::Node {
-  FormatDecl(Model* m) : mdl(m) { mId = "Format"; }
+  FormatDecl(Model* m, const ExportFormats& f) : mdl(m), formats(f) {
+    mId = "Format";
+  }
   struct Entry {
     gx::VertexBufferAttribute attrib;
     u32 cnt = 1;
@@ -235,16 +264,20 @@ struct FormatDecl : public oishii::Node {
     // Positions
     if (!mdl->mBufs.pos.mData.empty()) {
       const auto& q = mdl->mBufs.pos.mQuant;
+      const auto& f = formats.pos;
       Entry{gx::VertexBufferAttribute::Position,
-            static_cast<u32>(q.comp.position), static_cast<u32>(q.type.generic),
-            q.bad_divisor}
+            static_cast<u32>(q.comp.position),
+            static_cast<u32>(f ? f->type : q.type.generic),
+            f ? f->divisor : q.bad_divisor}
           .write(writer);
     }
     // Normals
     if (!mdl->mBufs.norm.mData.empty()) {
       const auto& q = mdl->mBufs.norm.mQuant;
+      const auto& f = formats.norm;
       Entry{gx::VertexBufferAttribute::Normal, static_cast<u32>(q.comp.normal),
-            static_cast<u32>(q.type.generic), q.bad_divisor}
+            static_cast<u32>(f ? f->type : q.type.generic),
+            f ? f->divisor : q.bad_divisor}
           .write(writer);
     }
     // Colors
@@ -268,10 +301,12 @@ struct FormatDecl : public oishii::Node {
       for (const auto& buf : mdl->mBufs.uv) {
         if (!buf.mData.empty()) {
           const auto& q = buf.mQuant;
+          const auto& f = formats.uv[i];
           Entry{gx::VertexBufferAttribute(
                     (int)gx::VertexBufferAttribute::TexCoord0 + i),
                 static_cast<u32>(q.comp.texcoord),
-                static_cast<u32>(q.type.generic), q.bad_divisor}
+                static_cast<u32>(f ? f->type : q.type.generic),
+                f ? f->divisor : q.bad_divisor}
               .write(writer);
         }
         ++i;
@@ -281,6 +316,7 @@ struct FormatDecl : public oishii::Node {
     return {};
   }
   Model* mdl;
+  ExportFormats formats;
 };
 
 struct VTX1Node {
@@ -341,14 +377,27 @@ struct VTX1Node {
   }
 
   template <typename T> struct VertexAttribBuf : public oishii::Node {
-    VertexAttribBuf(const Model& m, const std::string& id, const T& data)
+    using Buffer = std::remove_cvref_t<T>;
+
+    VertexAttribBuf(const Model& m, const std::string& id, const T& data,
+                    const std::optional<librii::gx::FixedPointFormat>& format)
         : Node(id), mdl(m), mData(data) {
       getLinkingRestriction().setLeaf();
       getLinkingRestriction().alignment = 32;
+
+      if (format) {
+        const auto& q = mData.mQuant;
+        const u32 nComponents = mData.ComputeComponentCount();
+        mQuantized.emplace(VQuantization(
+            q.comp, gx::VertexBufferType(format->type), format->divisor,
+            format->divisor, nComponents * format->componentSize()));
+        mQuantized->mData = mData.mData;
+      }
     }
 
     Result write(oishii::Writer& writer) const noexcept {
-      if (mData.writeData(writer))
+      const Buffer& buf = mQuantized ? *mQuantized : mData;
+      if (buf.writeData(writer))
         return eResult::Success;
 
       return eResult::Fatal;
@@ -356,26 +405,30 @@ struct VTX1Node {
 
     const Model& mdl;
     const T& mData;
+    // mData as it is exported, if quantized
+    std::optional<Buffer> mQuantized;
   };
 
   void gatherChildren(oishii::Node::NodeDelegate& ctx) const {
 
-    ctx.addNode(std::make_unique<FormatDecl>(mdl));
+    ctx.addNode(std::make_unique<FormatDecl>(mdl, mFormats));
 
     int i = 0;
 
-    auto push_buf = [&](auto& buf) {
+    auto push_buf = [&](auto& buf,
+                        const std::optional<librii::gx::FixedPointFormat>&
+                            format = std::nullopt) {
       ctx.addNode(std::make_unique<VertexAttribBuf<decltype(buf)>>(
-          *mdl, "Buf" + std::to_string(i++), buf));
+          *mdl, "Buf" + std::to_string(i++), buf, format));
     };
 
     // Positions
     if (!mdl->mBufs.pos.mData.empty())
-      push_buf(mdl->mBufs.pos);
+      push_buf(mdl->mBufs.pos, mFormats.pos);
 
     // Normals
     if (!mdl->mBufs.norm.mData.empty())
-      push_buf(mdl->mBufs.norm);
+      push_buf(mdl->mBufs.norm, mFormats.norm);
 
     // Colors
     for (auto& c : mdl->mBufs.color)
@@ -383,13 +436,20 @@ struct VTX1Node {
         push_buf(c);
 
     // UV
-    for (auto& c : mdl->mBufs.uv)
-      if (!c.mData.empty())
-        push_buf(c);
+    for (std::size_t j = 0; j < mdl->mBufs.uv.size(); ++j)
+      if (!mdl->mBufs.uv[j].mData.empty())
+        push_buf(mdl->mBufs.uv[j], mFormats.uv[j]);
   }
 
-  VTX1Node(BMDExportContext& ctx) : mdl(&ctx.mdl) {}
+  VTX1Node(BMDExportContext& ctx) : mdl(&ctx.mdl) {
+    mFormats.pos = chooseExportFormat(mdl->mBufs.pos, ctx.tolerance);
+    mFormats.norm = chooseExportFormat(mdl->mBufs.norm, ctx.tolerance);
+    for (std::size_t i = 0; i < mdl->mBufs.uv.size(); ++i)
+      mFormats.uv[i] = chooseExportFormat(mdl->mBufs.uv[i], ctx.tolerance);
+  }
   Model* mdl = nullptr;
+  // Formats the float buffers are quantized to, chosen once per export
+  ExportFormats mFormats;
 };
 
 std::unique_ptr<oishii::Node> makeVTX1Node(BMDExportContext& ctx) {
@@ -2,6 +2,7 @@
 #include <imgui/imgui.h>
 #include <imgui/imgui_internal.h>
 #include <plugins/gc/Export/Material.hpp>
+#include <plugins/gc/Export/MatrixPalette.hpp>
 #include <vendor/fa5/IconsFontAwesome5.h>
 
 #include <plugins/j3d/Joint.hpp>
@@ -167,12 +168,15 @@ void drawProperty(kpi::PropertyDelegate<Shape>& dl, ShapeJ3DSurface) {
   bool vis = shape.visible;
   ImGui::Checkbox("Visible", &vis);
   KPI_PROPERTY_EX(dl, visible, vis);
+  libcube::MatrixPalette palette;
+  palette.update(*dynamic_cast<libcube::Model*>(shape.childOf));
+  std::vector<glm::mat4> scratch;
   int i = 0;
   for (auto& mp : shape.mMatrixPrimitives) {
     ImGui::Text("Matrix Primitive: %i", i);
 
-    const auto matrices =
-        shape.getPosMtx(*dynamic_cast<libcube::Model*>(shape.childOf), i);
+    scratch.resize(mp.mDrawMatrixIndices.size());
+    const auto matrices = shape.getPosMtx(palette, i, scratch);
     int j = 0;
     for (auto& elem : mp.mDrawMatrixIndices) {
       ImGui::Text("DRW %i: %i", j, elem);
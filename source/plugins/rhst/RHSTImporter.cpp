@@ -1,6 +1,7 @@
 #include <core/3d/i3dmodel.hpp>
 #include <core/kpi/Plugins.hpp>
 #include <filesystem>
+#include <librii/gpu/Stripify.hpp>
 #include <librii/hx/CullMode.hpp>
 #include <librii/hx/PixMode.hpp>
 #include <librii/rhst/RHST.hpp>
@@ -15,7 +16,8 @@
 #include <vendor/thread_pool.hpp>
 
 // XXX: Hack, though we'll refactor all of this way soon
-std::string rebuild_dest;
+// Per-thread so batch conversions may rebuild several files at once.
+thread_local std::string rebuild_dest;
 
 namespace riistudio::rhst {
 
@@ -236,6 +238,7 @@ void compileMesh(libcube::IndexedPolygon& dst, const librii::rhst::Mesh& src,
     compileMatrixPrim(data.mMatrixPrimitives.emplace_back(), matrix_prim, 0,
                       dst, model);
   }
+  librii::gpu::StripifyTriangles(data);
 }
 
 struct RHSTReader {
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace rsl {
+
+// A std::vector-like container whose storage is shared between copies until one
+// of them is modified (copy-on-write).
+//
+// Intended for large document payloads (vertex buffers, image data, primitive
+// lists): copying a document or taking a history snapshot only bumps a
+// reference count, and equality between copies that still share storage is a
+// pointer comparison.
+//
+// Any non-const access detaches the storage first, so references obtained
+// through a non-const accessor are only valid until the container is copied.
+// The reference count is not a synchronization primitive: a container and its
+// copies must not be modified concurrently.
+template <typename T> class cow_vector {
+  using storage_t = std::vector<T>;
+
+public:
+  using value_type = T;
+  using size_type = typename storage_t::size_type;
+  using difference_type = typename storage_t::difference_type;
+  using reference = T&;
+  using const_reference = const T&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = typename storage_t::iterator;
+  using const_iterator = typename storage_t::const_iterator;
+
+  cow_vector() = default;
+  explicit cow_vector(size_type count)
+      : mData(std::make_shared<storage_t>(count)) {}
+  cow_vector(size_type count, const T& value)
+      : mData(std::make_shared<storage_t>(count, value)) {}
+  cow_vector(std::initializer_list<T> init)
+      : mData(std::make_shared<storage_t>(init)) {}
+  template <typename It>
+  cow_vector(It first, It last)
+      : mData(std::make_shared<storage_t>(first, last)) {}
+  cow_vector(const storage_t& vec) : mData(std::make_shared<storage_t>(vec)) {}
+  cow_vector(storage_t&& vec)
+      : mData(std::make_shared<storage_t>(std::move(vec))) {}
+
+  cow_vector(const cow_vector&) = default;
+  cow_vector(cow_vector&&) noexcept = default;
+  cow_vector& operator=(const cow_vector&) = default;
+  cow_vector& operator=(cow_vector&&) noexcept = default;
+
+  cow_vector& operator=(const storage_t& vec) {
+    mData = std::make_shared<storage_t>(vec);
+    return *this;
+  }
+  cow_vector& operator=(storage_t&& vec) {
+    mData = std::make_shared<storage_t>(std::move(vec));
+    return *this;
+  }
+
+  // Read-only access never copies.
+  size_type size() const { return mData ? mData->size() : 0; }
+  bool empty() const { return size() == 0; }
+  size_type capacity() const { return mData ? mData->capacity() : 0; }
+
+  const T* data() const { return mData ? mData->data() : nullptr; }
+  const T& operator[](size_type i) const { return (*mData)[i]; }
+  const T& at(size_type i) const { return get().at(i); }
+  const T& front() const { return mData->front(); }
+  const T& back() const { return mData->back(); }
+  const_iterator begin() const { return get().begin(); }
+  const_iterator end() const { return get().end(); }
+  const_iterator cbegin() const { return get().begin(); }
+  const_iterator cend() const { return get().end(); }
+
+  const storage_t& get() const { return mData ? *mData : sEmpty; }
+  operator std::span<const T>() const { return {data(), size()}; }
+
+  // Mutable access detaches shared storage.
+  T* data() { return mut().data(); }
+  T& operator[](size_type i) { return mut()[i]; }
+  T& at(size_type i) { return mut().at(i); }
+  T& front() { return mut().front(); }
+  T& back() { return mut().back(); }
+  iterator begin() { return mut().begin(); }
+  iterator end() { return mut().end(); }
+
+  void push_back(const T& value) { mut().push_back(value); }
+  void push_back(T&& value) { mut().push_back(std::move(value)); }
+  template <typename... Args> T& emplace_back(Args&&... args) {
+    return mut().emplace_back(std::forward<Args>(args)...);
+  }
+  void pop_back() { mut().pop_back(); }
+  void resize(size_type count) {
+    if (count != size())
+      mut().resize(count);
+  }
+  void resize(size_type count, const T& value) {
+    if (count != size())
+      mut().resize(count, value);
+  }
+  void reserve(size_type count) {
+    if (count > capacity())
+      mut().reserve(count);
+  }
+  // Dropping our reference is enough; other owners keep their data.
+  void clear() { mData = nullptr; }
+  template <typename It> void assign(It first, It last) {
+    mData = std::make_shared<storage_t>(first, last);
+  }
+  template <typename... Args>
+  iterator insert(const_iterator pos, Args&&... args) {
+    const auto index = pos - get().begin();
+    auto& vec = mut();
+    return vec.insert(vec.begin() + index, std::forward<Args>(args)...);
+  }
+  iterator erase(const_iterator first, const_iterator last) {
+    const auto index = first - get().begin();
+    const auto count = last - first;
+    auto& vec = mut();
+    return vec.erase(vec.begin() + index, vec.begin() + index + count);
+  }
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  //! Do two containers still reference the same storage?
+  bool shares(const cow_vector& rhs) const {
+    return mData != nullptr && mData == rhs.mData;
+  }
+
+  bool operator==(const cow_vector& rhs) const {
+    if (mData == rhs.mData)
+      return true;
+    return get() == rhs.get();
+  }
+
+private:
+  storage_t& mut() {
+    if (!mData)
+      mData = std::make_shared<storage_t>();
+    else if (mData.use_count() > 1)
+      mData = std::make_shared<storage_t>(*mData);
+    return *mData;
+  }
+
+  std::shared_ptr<storage_t> mData;
+  static inline const storage_t sEmpty{};
+};
+
+} // namespace rsl
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace rsl {
+
+// Stable LSD radix sort of (key, value) pairs by their 64-bit key, one byte
+// per pass. Passes where every element shares the same digit are skipped, so
+// keys that only use a few bits cost a few passes.
+//
+// `scratch` is working memory; keeping it around avoids reallocating it every
+// sort.
+template <typename T>
+void radix_sort(std::vector<std::pair<uint64_t, T>>& items,
+                std::vector<std::pair<uint64_t, T>>& scratch) {
+  if (items.size() < 2)
+    return;
+
+  scratch.resize(items.size());
+
+  for (int shift = 0; shift < 64; shift += 8) {
+    std::array<std::size_t, 256> offsets{};
+    for (const auto& item : items)
+      ++offsets[(item.first >> shift) & 0xFF];
+
+    if (offsets[(items[0].first >> shift) & 0xFF] == items.size())
+      continue;
+
+    std::size_t total = 0;
+    for (auto& offset : offsets)
+      total += std::exchange(offset, total);
+
+    for (auto& item : items)
+      scratch[offsets[(item.first >> shift) & 0xFF]++] = std::move(item);
+
+    items.swap(scratch);
+  }
+}
+
+} // namespace rsl
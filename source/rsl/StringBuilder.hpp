@@ -1,34 +1,58 @@
 #pragma once
 
-#include <algorithm>        // std::fill
+#include <charconv>         // std::to_chars
 #include <core/common.h>    // assert
 #include <llvm/ADT/Twine.h> // llvm::Twine
+#include <string>           // std::string
 #include <string_view>      // std::string_view
 
 namespace rsl {
 
 class StringBuilder {
 public:
+  // The buffer is kept null-terminated, so it may be read as a C string at
+  // any point.
   StringBuilder(char* buf, std::size_t size)
       : mBuf(buf), mIt(buf), mEnd(buf + size) {
-    std::fill(mBuf, mEnd, '\0');
+    assert(size > 0);
+    *mIt = '\0';
   }
 
   void append(std::string_view string) {
     assert(mIt + string.length() < mEnd);
     std::memcpy(mIt, string.data(), string.length());
     mIt += string.length();
+    *mIt = '\0';
+  }
+  void append(char c) {
+    assert(mIt + 1 < mEnd);
+    *mIt++ = c;
+    *mIt = '\0';
+  }
+  void appendInt(int value) {
+    const auto [end, ec] = std::to_chars(mIt, mEnd - 1, value);
+    assert(ec == std::errc{});
+    mIt = end;
+    *mIt = '\0';
   }
   void appendTwine(const llvm::Twine& string) { append(string.str()); }
   void reset() {
-    std::fill(mBuf, mIt, '\0');
     mIt = mBuf;
+    *mIt = '\0';
   }
 
+  std::size_t size() const { return mIt - mBuf; }
+  std::string_view view() const { return {mBuf, size()}; }
+  std::string str() const { return std::string(view()); }
+
   StringBuilder& operator+=(std::string_view string) {
     append(string);
     return *this;
   }
+  StringBuilder& operator+=(char c) {
+    append(c);
+    return *this;
+  }
   StringBuilder& operator<<(const llvm::Twine& string) {
     appendTwine(string);
     return *this;
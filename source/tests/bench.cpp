@@ -0,0 +1,644 @@
+//
+// Benchmarks
+//
+// Each times an optimized path against the one it replaced, or reports the
+// sizes and counts it improves. They only measure: the checks in checks.cpp
+// assert that each path is correct.
+//
+
+#include "fixtures.hpp"
+#include "helpers.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <core/3d/i3dmodel.hpp>
+#include <core/api.hpp>
+#include <core/util/parallel.hpp>
+#include <filesystem>
+#include <librii/gpu/PalettePartition.hpp>
+#include <librii/gpu/Stripify.hpp>
+#include <librii/gx/VertexQuantize.hpp>
+#include <plugins/ass/AssImporter.hpp>
+#include <plugins/g3d/util/NameTable.hpp>
+#include <plugins/gc/Export/AttributePool.hpp>
+#include <plugins/gc/Export/IndexedPolygon.hpp>
+#include <plugins/gc/Export/Scene.hpp>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// Open a file with models, or report that it has none
+std::unique_ptr<kpi::INode> OpenScene(const std::string& path) {
+  auto data = open(path);
+  if (dynamic_cast<libcube::Scene*>(data.get()) == nullptr) {
+    fprintf(stderr, "Error: %s has no models\n", path.c_str());
+    return nullptr;
+  }
+  return data;
+}
+
+//
+// Shader benchmark
+//
+// Generates GLSL for every material of the given files, without a GL context,
+// and reports the cost per material. The first pass matches opening a scene;
+// later passes match regenerating shaders after edits.
+//
+
+int shaderBench(const std::vector<std::string>& paths) {
+  constexpr int NumPasses = 10;
+
+  for (const auto& path : paths) {
+    auto data = open(path);
+    const auto* scene =
+        dynamic_cast<const riistudio::lib3d::Scene*>(data.get());
+    if (scene == nullptr) {
+      fprintf(stderr, "Error: %s has no models\n", path.c_str());
+      return 1;
+    }
+
+    std::vector<const riistudio::lib3d::Material*> materials;
+    for (auto& model : scene->getModels())
+      for (auto& mat : model.getMaterials())
+        materials.push_back(&mat);
+    if (materials.empty())
+      continue;
+
+    auto generate = [&] {
+      for (const auto* mat : materials)
+        mat->generateShaders();
+    };
+    const double first_ms = TimeMs(generate);
+    double repeat_ms = 0.0;
+    for (int pass = 1; pass < NumPasses; ++pass)
+      repeat_ms += TimeMs(generate);
+
+    printf("%s: %zu materials, %.2f us/material (first pass), %.2f "
+           "us/material (repeated)\n",
+           path.c_str(), materials.size(),
+           first_ms * 1000.0 / materials.size(),
+           repeat_ms * 1000.0 / (materials.size() * (NumPasses - 1)));
+  }
+
+  return 0;
+}
+
+//
+// Attribute pool benchmark
+//
+// Appends synthetic vertex attributes -- mostly repeats, as in an indexed
+// import -- through libcube::AttributePool and through the linear search the
+// importers used before.
+//
+
+template <typename T, typename Gen>
+void poolBenchOne(const char* name, std::size_t count, Gen gen) {
+  std::vector<T> input(count);
+  for (auto& entry : input)
+    entry = gen();
+
+  std::vector<T> linear_buf, pool_buf;
+  const double linear_ms = TimeMs([&] {
+    for (const auto& entry : input)
+      LinearAppend(linear_buf, entry);
+  });
+  libcube::AttributePool<T> pool;
+  const double pool_ms = TimeMs([&] {
+    for (const auto& entry : input)
+      pool.add(pool_buf, entry);
+  });
+
+  printf("%s: %zu adds, %zu unique, linear %.2f ms, pooled %.2f ms\n", name,
+         count, pool_buf.size(), linear_ms, pool_ms);
+}
+
+int poolBench(std::size_t count) {
+  std::mt19937 rng(0x5EED);
+  // A quarter of the attributes are unique; the rest index earlier ones.
+  auto pick = [&](int range) {
+    return static_cast<float>(std::uniform_int_distribution(0, range)(rng)) /
+           4.0f;
+  };
+  const int range = static_cast<int>(std::cbrt(count / 4.0)) + 1;
+
+  poolBenchOne<glm::vec3>("Positions", count, [&] {
+    return glm::vec3(pick(range), pick(range), pick(range));
+  });
+  poolBenchOne<glm::vec2>("UVs", count, [&] {
+    const int uv_range = static_cast<int>(std::sqrt(count / 4.0)) + 1;
+    return glm::vec2(pick(uv_range), pick(uv_range));
+  });
+  poolBenchOne<librii::gx::Color>("Colors", count, [&] {
+    const auto channel = [&] {
+      return static_cast<u8>(std::uniform_int_distribution(0, 15)(rng) * 17);
+    };
+    return librii::gx::Color(channel(), channel(), channel(), 255);
+  });
+  return 0;
+}
+
+//
+// Skinning benchmark
+//
+// Builds the draw matrix of every vertex of a synthetic skinned mesh, as the
+// Assimp importer does, and times a sample of the per-vertex scan of all bone
+// weights it replaced.
+//
+
+int skinBench(unsigned num_bones, unsigned num_vertices) {
+  std::mt19937 rng(0x5EED);
+
+  // One to four influences per vertex
+  std::vector<std::vector<aiVertexWeight>> bone_weights(num_bones);
+  for (unsigned v = 0; v < num_vertices; ++v) {
+    const int num_influences = std::uniform_int_distribution(1, 4)(rng);
+    const unsigned first_bone =
+        std::uniform_int_distribution(0u, num_bones - 1)(rng);
+    for (int i = 0; i < num_influences; ++i) {
+      // Few distinct weights, so that combinations repeat
+      const float weight =
+          static_cast<float>(std::uniform_int_distribution(1, 4)(rng)) / 4.0f;
+      bone_weights[(first_bone + i) % num_bones].emplace_back(v, weight);
+    }
+  }
+  aiMesh mesh;
+  mesh.mNumVertices = num_vertices;
+  mesh.mNumBones = num_bones;
+  mesh.mBones = new aiBone*[num_bones];
+  std::vector<u32> bone_ids(num_bones);
+  for (unsigned j = 0; j < num_bones; ++j) {
+    auto* bone = mesh.mBones[j] = new aiBone;
+    bone->mNumWeights = static_cast<unsigned>(bone_weights[j].size());
+    bone->mWeights = new aiVertexWeight[bone->mNumWeights];
+    std::copy(bone_weights[j].begin(), bone_weights[j].end(), bone->mWeights);
+    bone_ids[j] = j;
+  }
+
+  std::vector<libcube::DrawMatrix> drws;
+  const double table_ms = TimeMs([&] {
+    const auto influences =
+        riistudio::ass::BuildVertexInfluences(mesh, bone_ids);
+    libcube::AttributePool<libcube::DrawMatrix> pool;
+    for (unsigned v = 0; v < num_vertices; ++v)
+      pool.add(drws, influences[v]);
+  });
+
+  // The scan is quadratic; time a sample and extrapolate.
+  const unsigned num_sampled = std::min(num_vertices, 1000u);
+  const double scan_ms = TimeMs([&] {
+    for (unsigned v = 0; v < num_sampled; ++v) {
+      libcube::DrawMatrix drw;
+      for (unsigned j = 0; j < mesh.mNumBones; ++j) {
+        const auto* pBone = mesh.mBones[j];
+        for (unsigned k = 0; k < pBone->mNumWeights; ++k) {
+          if (pBone->mWeights[k].mVertexId == v) {
+            drw.mWeights.emplace_back(bone_ids[j],
+                                      pBone->mWeights[k].mWeight);
+            break;
+          }
+        }
+      }
+    }
+  });
+
+  printf("%u bones, %u vertices, %zu draw matrices: tables %.2f ms, scan "
+         "~%.0f ms (extrapolated from %u vertices)\n",
+         num_bones, num_vertices, drws.size(), table_ms,
+         scan_ms * num_vertices / num_sampled, num_sampled);
+  return 0;
+}
+
+//
+// Stripifier benchmark
+//
+// Flattens every matrix primitive of the given files into a triangle list,
+// strips it again and reports the index counts.
+//
+
+int stripBench(const std::vector<std::string>& paths) {
+  for (const auto& path : paths) {
+    auto data = OpenScene(path);
+    if (!data)
+      return 1;
+    const auto& scene = dynamic_cast<const libcube::Scene&>(*data);
+
+    std::size_t num_tris = 0, file_indices = 0, stripped_indices = 0;
+    double time_ms = 0.0;
+    for (auto& model : scene.getModels()) {
+      for (auto& mesh : model.getMeshes()) {
+        for (const auto& mprim : mesh.getMeshData().mMatrixPrimitives) {
+          librii::gx::MatrixPrimitive list = mprim;
+          list.mPrimitives.clear();
+          auto& tris = list.mPrimitives.emplace_back();
+          tris.mType = librii::gx::PrimitiveType::Triangles;
+          for (const auto& prim : mprim.mPrimitives) {
+            file_indices += prim.mVertices.size();
+            librii::gpu::ForEachTriangle(
+                prim, [&](const auto& a, const auto& b, const auto& c) {
+                  tris.mVertices.push_back(a);
+                  tris.mVertices.push_back(b);
+                  tris.mVertices.push_back(c);
+                });
+          }
+          num_tris += tris.mVertices.size() / 3;
+
+          time_ms += TimeMs([&] { librii::gpu::StripifyTriangles(list); });
+          for (const auto& prim : list.mPrimitives)
+            stripped_indices += prim.mVertices.size();
+        }
+      }
+    }
+
+    printf("%s: %zu triangles, %zu indices as a list, %zu in the file, %zu "
+           "stripped (%.1f%% fewer than the list) in %.2f ms\n",
+           path.c_str(), num_tris, num_tris * 3, file_indices,
+           stripped_indices,
+           num_tris ? 100.0 - 100.0 * stripped_indices / (num_tris * 3) : 0.0,
+           time_ms);
+  }
+  return 0;
+}
+
+//
+// Matrix palette benchmark
+//
+// Splits generated skinned meshes into matrix primitives, with the greedy
+// sweep the Assimp importer used before and with the palette partitioner,
+// and counts the primitives of each.
+//
+
+// Triangles in order, starting a new palette whenever one is full
+std::vector<librii::gx::MatrixPrimitive>
+SweepPalettes(std::span<const librii::gx::IndexedVertex> vertices) {
+  constexpr auto PNM = librii::gx::VertexAttribute::PositionNormalMatrixIndex;
+  auto addCorners = [&](std::vector<s16>& palette, std::size_t t) {
+    for (std::size_t i = t; i < t + 3; ++i) {
+      const s16 mtx = vertices[i][PNM];
+      if (std::find(palette.begin(), palette.end(), mtx) == palette.end())
+        palette.push_back(mtx);
+    }
+  };
+
+  std::vector<librii::gx::MatrixPrimitive> mprims;
+  for (std::size_t t = 0; t + 2 < vertices.size(); t += 3) {
+    std::vector<s16> palette;
+    if (!mprims.empty())
+      palette = mprims.back().mDrawMatrixIndices;
+    addCorners(palette, t);
+    if (mprims.empty() || palette.size() > librii::gpu::MaxPaletteSize) {
+      mprims.emplace_back().mPrimitives.emplace_back().mType =
+          librii::gx::PrimitiveType::Triangles;
+      palette.clear();
+      addCorners(palette, t);
+    }
+    auto& mp = mprims.back();
+    mp.mDrawMatrixIndices = palette;
+    for (std::size_t i = t; i < t + 3; ++i) {
+      auto vtx = vertices[i];
+      const auto slot = std::find(palette.begin(), palette.end(), vtx[PNM]);
+      vtx[PNM] = (slot - palette.begin()) * 3;
+      mp.mPrimitives[0].mVertices.push_back(vtx);
+    }
+  }
+  return mprims;
+}
+
+int paletteBench() {
+  const std::pair<const char*, std::vector<librii::gx::IndexedVertex>>
+      meshes[] = {
+          {"Tube, 20 bones", SkinnedTube(20, 4, 16)},
+          {"Tube, 60 bones", SkinnedTube(60, 2, 24)},
+          {"Soup, 40 matrices", SkinnedSoup(40, 4000)},
+          {"Soup, 200 matrices", SkinnedSoup(200, 20000)},
+      };
+  for (const auto& [name, vertices] : meshes) {
+    const auto before = SweepPalettes(vertices);
+    std::vector<librii::gx::MatrixPrimitive> after;
+    const double time_ms =
+        TimeMs([&] { after = librii::gpu::MakeSkinnedPrimitives(vertices); });
+    printf("%s: %zu triangles, %zu -> %zu matrix primitives, in %.2f ms\n",
+           name, vertices.size() / 3, before.size(), after.size(), time_ms);
+  }
+  return 0;
+}
+
+//
+// Vertex quantization benchmark
+//
+// Saves each file with float buffers kept, and quantized to the given
+// tolerance, and reports both sizes.
+//
+
+int quantBench(f32 tolerance, const std::vector<std::string>& paths) {
+  const libcube::ExportOptions options{{tolerance, tolerance, tolerance}};
+  for (const auto& path : paths) {
+    auto data = OpenScene(path);
+    if (!data)
+      return 1;
+
+    const std::size_t float_size = WrittenBytes(*data).size();
+    std::size_t quantized_size = 0;
+    const double time_ms = TimeMs(
+        [&] { quantized_size = WrittenBytes(*data, options).size(); });
+
+    printf("%s: %zu bytes -> %zu bytes quantized (%.1f%% smaller, tolerance "
+           "%g), saved in %.2f ms\n",
+           path.c_str(), float_size, quantized_size,
+           float_size ? 100.0 - 100.0 * quantized_size / float_size : 0.0,
+           tolerance, time_ms);
+  }
+  return 0;
+}
+
+//
+// String pool benchmark
+//
+// Pools the names of each archive as BRRES stores them, and reports the size
+// against storing every reference on its own.
+//
+
+int namePoolBench(const std::vector<std::string>& paths) {
+  for (const auto& path : paths) {
+    auto data = open(path);
+    const auto* archive =
+        dynamic_cast<const riistudio::g3d::Collection*>(data.get());
+    if (archive == nullptr) {
+      fprintf(stderr, "Error: %s is not a BRRES archive\n", path.c_str());
+      return 1;
+    }
+
+    const auto names = CollectNames(*archive);
+    std::vector<std::string> distinct;
+    std::unordered_map<std::string_view, u32> seen;
+    std::size_t unpooled = 0;
+    for (const auto& name : names) {
+      if (name.empty())
+        continue;
+      // Length, characters, terminator and padding
+      unpooled += (4 + name.size() + 1 + 3) / 4 * 4;
+      if (seen.try_emplace(name, distinct.size()).second)
+        distinct.push_back(name);
+    }
+
+    std::size_t pooled = 0;
+    const double time_ms = TimeMs(
+        [&] { pooled = riistudio::g3d::poolStrings(distinct).first.size(); });
+
+    printf("%s: %zu names (%zu distinct): %zu bytes unpooled, %zu pooled "
+           "(%.1f%% smaller) in %.3f ms\n",
+           path.c_str(), names.size(), distinct.size(), unpooled, pooled,
+           unpooled ? 100.0 - 100.0 * pooled / unpooled : 0.0, time_ms);
+  }
+  return 0;
+}
+
+//
+// Material deduplication benchmark
+//
+// Builds synthetic BMD materials -- a quarter of them distinct -- and appends
+// their MAT3 entries through the hashed tables and through the linear search
+// the writer used before.
+//
+
+template <typename T> void matBenchOne(const char* name, std::vector<T> input) {
+  std::vector<T> linear_buf;
+  const double linear_ms = TimeMs([&] {
+    for (const auto& entry : input)
+      LinearAppend(linear_buf, entry);
+  });
+  riistudio::j3d::HashedVector<T> hashed_buf;
+  const double hashed_ms = TimeMs([&] {
+    for (const auto& entry : input)
+      hashed_buf.append(entry);
+  });
+  printf("%s: %zu adds, %zu unique, linear %.2f ms, hashed %.2f ms\n", name,
+         input.size(), hashed_buf.size(), linear_ms, hashed_ms);
+}
+
+int matBench(std::size_t count) {
+  std::mt19937 rng(0x5EED);
+  const u32 num_distinct = std::max(static_cast<u32>(count / 4), 1u);
+  std::vector<riistudio::j3d::Material> mats;
+  mats.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+    mats.push_back(MakeMaterial(
+        std::uniform_int_distribution<u32>(0, num_distinct - 1)(rng)));
+
+  std::vector<riistudio::j3d::MaterialData> materials;
+  std::vector<librii::gx::TevStage> stages;
+  std::vector<libcube::GCMaterialData::TexMatrix> matrices;
+  std::vector<libcube::GCMaterialData::SamplerData> samplers;
+  std::vector<librii::gx::Color> colors;
+  std::vector<librii::j3d::Fog> fogs;
+  for (const auto& mat : mats) {
+    materials.push_back(mat);
+    stages.insert(stages.end(), mat.mStages.begin(),
+                  mat.mStages.begin() + mat.mStages.size());
+    matrices.insert(matrices.end(), mat.texMatrices.begin(),
+                    mat.texMatrices.begin() + mat.texMatrices.size());
+    samplers.insert(samplers.end(), mat.samplers.begin(),
+                    mat.samplers.begin() + mat.samplers.size());
+    colors.insert(colors.end(), mat.tevKonstColors.begin(),
+                  mat.tevKonstColors.end());
+    fogs.push_back(mat.fogInfo);
+  }
+
+  matBenchOne("Materials", std::move(materials));
+  matBenchOne("TEV stages", std::move(stages));
+  matBenchOne("Texture matrices", std::move(matrices));
+  matBenchOne("Samplers", std::move(samplers));
+  matBenchOne("Colors", std::move(colors));
+  matBenchOne("Fogs", std::move(fogs));
+
+  // The whole MAT3 table pass of the writer
+  riistudio::j3d::Model::MatCache cache;
+  const double time_ms = TimeMs([&] {
+    for (auto& mat : mats)
+      cache.propogate(mat);
+  });
+  printf("MAT3 tables of %zu materials: %.2f ms (%zu TEV stages, %zu texture "
+         "matrices)\n",
+         mats.size(), time_ms, cache.tevStages.size(),
+         cache.texMatrices.size());
+  return 0;
+}
+
+//
+// Display list decoding benchmark
+//
+// Writes the primitives of every mesh back to a display list, and decodes it
+// with the vertex layout decoders and with the per-attribute reader they
+// replaced.
+//
+
+int dlBench(const std::vector<std::string>& paths) {
+  // Display lists are short; repeat them to time them.
+  constexpr int Repeats = 50;
+
+  struct Collector : librii::gpu::IMeshDLDelegate {
+    librii::gx::IndexedPrimitive&
+    addIndexedPrimitive(librii::gx::PrimitiveType type, u16 nVerts) override {
+      return prims.emplace_back(type, nVerts);
+    }
+    std::vector<librii::gx::IndexedPrimitive> prims;
+  };
+
+  for (const auto& path : paths) {
+    auto data = OpenScene(path);
+    if (!data)
+      return 1;
+    const auto& scene = dynamic_cast<const libcube::Scene&>(*data);
+
+    std::size_t num_prims = 0, num_verts = 0;
+    double reference_ms = 0.0, layout_ms = 0.0;
+    for (auto& model : scene.getModels()) {
+      for (auto& mesh : model.getMeshes()) {
+        const auto& mesh_data = mesh.getMeshData();
+        for (const auto& mprim : mesh_data.mMatrixPrimitives) {
+          auto bytes = EncodeDisplayList(mesh_data, mprim);
+          const u32 size = static_cast<u32>(bytes.size());
+          oishii::DataProvider provider(std::move(bytes), path);
+          oishii::BinaryReader reader(provider.slice());
+          const auto& descriptor = mesh_data.mVertexDescriptor;
+
+          std::vector<librii::gx::IndexedPrimitive> reference;
+          UsageMap reference_usage, layout_usage;
+          reference_ms += TimeMs([&] {
+            for (int i = 0; i < Repeats; ++i) {
+              reference.clear();
+              reader.seekSet(0);
+              DecodeDisplayListReference(reader, size, descriptor, reference,
+                                         reference_usage);
+            }
+          });
+          Collector layout;
+          layout_ms += TimeMs([&] {
+            for (int i = 0; i < Repeats; ++i) {
+              layout.prims.clear();
+              llvm::consumeError(librii::gpu::DecodeMeshDisplayList(
+                  reader, 0, size, layout, descriptor, &layout_usage));
+            }
+          });
+
+          num_prims += reference.size();
+          for (const auto& prim : reference)
+            num_verts += prim.mVertices.size();
+        }
+      }
+    }
+
+    printf("%s: %zu primitives, %zu vertices, per-attribute %.3f ms, vertex "
+           "layouts %.3f ms\n",
+           path.c_str(), num_prims, num_verts, reference_ms / Repeats,
+           layout_ms / Repeats);
+  }
+  return 0;
+}
+
+//
+// Parallel load benchmark
+//
+// Opens each file with 1, 2, 4 and 8 read threads.
+//
+
+int loadBench(const std::vector<std::string>& paths) {
+  // Best of a few loads, as the first warms the file cache.
+  constexpr int Repeats = 5;
+
+  for (const auto& path : paths) {
+    for (const u32 num_threads : {1u, 2u, 4u, 8u}) {
+      riistudio::util::ParallelLimit limit(num_threads);
+      bool opened = true;
+      const double time_ms =
+          BestMs(Repeats, [&] { opened &= open(path) != nullptr; });
+      if (!opened) {
+        fprintf(stderr, "Error: Cannot open %s\n", path.c_str());
+        return 1;
+      }
+      printf("%s: %u threads: %.3f ms\n", path.c_str(), num_threads, time_ms);
+    }
+  }
+  return 0;
+}
+
+//
+// Incremental save benchmark
+//
+// Saves each file, edits one material and saves it again with the same writer,
+// which reuses the sections the edit left alone, and compares that to a full
+// save with a new writer.
+//
+
+int saveBench(const std::vector<std::string>& paths) {
+  for (const auto& path : paths) {
+    auto data = open(path);
+    if (data == nullptr) {
+      fprintf(stderr, "Error: cannot open %s\n", path.c_str());
+      return 1;
+    }
+    auto exporter = SpawnExporter(*data);
+    WrittenBytes(*exporter, *data);
+    if (!EditFirstMaterial(*data)) {
+      fprintf(stderr, "Error: %s has no materials\n", path.c_str());
+      return 1;
+    }
+
+    std::size_t size = 0;
+    const double incremental_ms =
+        TimeMs([&] { WrittenBytes(*exporter, *data); });
+    const double full_ms = TimeMs([&] { size = WrittenBytes(*data).size(); });
+
+    printf("%s: %zu bytes, full save %.3f ms, incremental %.3f ms (%.1fx)\n",
+           path.c_str(), size, full_ms, incremental_ms,
+           incremental_ms > 0.0 ? full_ms / incremental_ms : 0.0);
+  }
+  return 0;
+}
+
+} // namespace
+
+const char* BenchUsage = "tests.exe --shader-bench <file>...\n"
+                         "tests.exe --pool-bench [count]\n"
+                         "tests.exe --skin-bench [bones] [vertices]\n"
+                         "tests.exe --strip-bench <file>...\n"
+                         "tests.exe --palette-bench\n"
+                         "tests.exe --quant-bench <tolerance> <file>...\n"
+                         "tests.exe --name-pool-bench <file.brres>...\n"
+                         "tests.exe --mat-bench [count]\n"
+                         "tests.exe --dl-bench <file>...\n"
+                         "tests.exe --load-bench <file>...\n"
+                         "tests.exe --save-bench <file>...\n";
+
+std::optional<int> runBench(int argc, const char** argv) {
+  if (argc < 2)
+    return std::nullopt;
+  const std::string_view name = argv[1];
+  const std::vector<std::string> files(argv + std::min(argc, 2), argv + argc);
+  if (name == "--shader-bench" && argc >= 3)
+    return shaderBench(files);
+  if (name == "--pool-bench")
+    return poolBench(argc >= 3 ? std::atoll(argv[2]) : 65536);
+  if (name == "--skin-bench") {
+    const unsigned num_bones = argc >= 3 ? std::atoi(argv[2]) : 100;
+    const unsigned num_vertices = argc >= 4 ? std::atoi(argv[3]) : 50000;
+    return skinBench(std::max(num_bones, 1u), num_vertices);
+  }
+  if (name == "--strip-bench" && argc >= 3)
+    return stripBench(files);
+  if (name == "--palette-bench")
+    return paletteBench();
+  if (name == "--quant-bench" && argc >= 4)
+    return quantBench(std::strtof(argv[2], nullptr), {argv + 3, argv + argc});
+  if (name == "--name-pool-bench" && argc >= 3)
+    return namePoolBench(files);
+  if (name == "--mat-bench")
+    return matBench(argc >= 3 ? std::atoll(argv[2]) : 20000);
+  if (name == "--dl-bench" && argc >= 3)
+    return dlBench(files);
+  if (name == "--load-bench" && argc >= 3)
+    return loadBench(files);
+  if (name == "--save-bench" && argc >= 3)
+    return saveBench(files);
+  return std::nullopt;
+}
@@ -0,0 +1,1162 @@
+//
+// Checks
+//
+// Each check compares an optimized path against a simpler reference, on
+// generated data or on the samples, and fails on any difference.
+// `tests.exe --check <samples>` runs them all; tests.py runs it after the
+// rebuild tests.
+//
+
+#include "fixtures.hpp"
+#include "helpers.hpp"
+#include <atomic>
+#include <cmath>
+#include <core/3d/i3dmodel.hpp>
+#include <core/3d/renderer/GlStateTracker.hpp>
+#include <core/api.hpp>
+#include <core/util/parallel.hpp>
+#include <core/util/profiler.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <glm/gtc/matrix_transform.hpp>
+#include <librii/glhelper/VertexCache.hpp>
+#include <librii/gpu/PalettePartition.hpp>
+#include <librii/gpu/Stripify.hpp>
+#include <librii/gx/VertexQuantize.hpp>
+#include <librii/math/bvh.hpp>
+#include <limits>
+#include <optional>
+#include <plugins/ass/AssImporter.hpp>
+#include <plugins/g3d/util/NameTable.hpp>
+#include <plugins/gc/Export/AttributePool.hpp>
+#include <plugins/gc/Export/IndexedPolygon.hpp>
+#include <plugins/gc/Export/MatrixPalette.hpp>
+#include <plugins/gc/Export/Scene.hpp>
+#include <random>
+#include <rsl/RadixSort.hpp>
+#include <thread>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace {
+
+// Failures of one check
+struct Checker {
+  const char* name;
+  int failures = 0;
+
+  // Report a failure unless `ok`. Returns `ok`.
+  template <typename... Args>
+  bool expect(bool ok, const char* format, Args... args) {
+    if (ok)
+      return true;
+    ++failures;
+    printf("Error: %s: ", name);
+    printf(format, args...);
+    printf("\n");
+    return false;
+  }
+};
+
+// Open a sample with models, failing the check if it has none
+std::unique_ptr<kpi::INode> OpenScene(Checker& c, const std::string& path) {
+  auto data = open(path);
+  if (!c.expect(dynamic_cast<libcube::Scene*>(data.get()) != nullptr,
+                "%s has no models", path.c_str()))
+    return nullptr;
+  return data;
+}
+
+std::vector<std::string> SceneSamples(const std::string& dir) {
+  return FindSamples(dir, {".bdl", ".bmd", ".brres"});
+}
+
+//
+// Attribute pool: appends mostly repeated attributes through
+// libcube::AttributePool and through a linear search. Both must produce the
+// same buffers and indices.
+//
+
+template <typename T, typename Gen>
+void CheckPoolOne(Checker& c, const char* name, std::size_t count, Gen gen) {
+  std::vector<T> input(count);
+  for (auto& entry : input)
+    entry = gen();
+
+  std::vector<T> linear_buf, pool_buf;
+  std::vector<std::size_t> linear_idx, pool_idx;
+  for (const auto& entry : input)
+    linear_idx.push_back(LinearAppend(linear_buf, entry));
+  libcube::AttributePool<T> pool;
+  for (const auto& entry : input)
+    pool_idx.push_back(pool.add(pool_buf, entry));
+
+  // Compare bit patterns: NaN entries must be appended, not shared.
+  c.expect(linear_idx == pool_idx && linear_buf.size() == pool_buf.size() &&
+               std::memcmp(linear_buf.data(), pool_buf.data(),
+                           linear_buf.size() * sizeof(T)) == 0,
+           "%s differ from a linear search", name);
+}
+
+void CheckAttributePool(Checker& c, const std::string&) {
+  constexpr std::size_t Count = 8192;
+  std::mt19937 rng(0x5EED);
+  // A quarter of the attributes are unique; the rest index earlier ones.
+  auto pick = [&](int range) {
+    return static_cast<float>(std::uniform_int_distribution(0, range)(rng)) /
+           4.0f;
+  };
+  const int range = static_cast<int>(std::cbrt(Count / 4.0)) + 1;
+  auto special = [&](float f) {
+    // Signed zeroes compare equal; NaN compares unequal even to itself.
+    switch (std::uniform_int_distribution(0, 63)(rng)) {
+    case 0:
+      return -0.0f;
+    case 1:
+      return std::numeric_limits<float>::quiet_NaN();
+    default:
+      return f;
+    }
+  };
+
+  CheckPoolOne<glm::vec3>(c, "Positions", Count, [&] {
+    return glm::vec3(special(pick(range)), pick(range), pick(range));
+  });
+  CheckPoolOne<glm::vec2>(c, "UVs", Count, [&] {
+    const int uv_range = static_cast<int>(std::sqrt(Count / 4.0)) + 1;
+    return glm::vec2(special(pick(uv_range)), pick(uv_range));
+  });
+  CheckPoolOne<librii::gx::Color>(c, "Colors", Count, [&] {
+    const auto channel = [&] {
+      return static_cast<u8>(std::uniform_int_distribution(0, 15)(rng) * 17);
+    };
+    return librii::gx::Color(channel(), channel(), channel(), 255);
+  });
+}
+
+//
+// Skinning: the draw matrix of every vertex of a generated skinned mesh must
+// match a per-vertex scan of all bone weights.
+//
+
+void CheckSkinning(Checker& c, const std::string&) {
+  constexpr unsigned NumBones = 40, NumVertices = 4000;
+  std::mt19937 rng(0x5EED);
+
+  // One to four influences per vertex
+  std::vector<std::vector<aiVertexWeight>> bone_weights(NumBones);
+  for (unsigned v = 0; v < NumVertices; ++v) {
+    const int num_influences = std::uniform_int_distribution(1, 4)(rng);
+    const unsigned first_bone =
+        std::uniform_int_distribution(0u, NumBones - 1)(rng);
+    for (int i = 0; i < num_influences; ++i) {
+      // Few distinct weights, so that combinations repeat
+      const float weight =
+          static_cast<float>(std::uniform_int_distribution(1, 4)(rng)) / 4.0f;
+      bone_weights[(first_bone + i) % NumBones].emplace_back(v, weight);
+    }
+  }
+  aiMesh mesh;
+  mesh.mNumVertices = NumVertices;
+  mesh.mNumBones = NumBones;
+  mesh.mBones = new aiBone*[NumBones];
+  std::vector<u32> bone_ids(NumBones);
+  for (unsigned j = 0; j < NumBones; ++j) {
+    auto* bone = mesh.mBones[j] = new aiBone;
+    bone->mNumWeights = static_cast<unsigned>(bone_weights[j].size());
+    bone->mWeights = new aiVertexWeight[bone->mNumWeights];
+    std::copy(bone_weights[j].begin(), bone_weights[j].end(), bone->mWeights);
+    bone_ids[j] = j;
+  }
+
+  const auto influences = riistudio::ass::BuildVertexInfluences(mesh, bone_ids);
+  std::vector<libcube::DrawMatrix> drws;
+  libcube::AttributePool<libcube::DrawMatrix> pool;
+  unsigned num_wrong = 0;
+  for (unsigned v = 0; v < NumVertices; ++v) {
+    const auto id = pool.add(drws, influences[v]);
+    libcube::DrawMatrix drw;
+    for (unsigned j = 0; j < mesh.mNumBones; ++j) {
+      const auto* pBone = mesh.mBones[j];
+      for (unsigned k = 0; k < pBone->mNumWeights; ++k) {
+        if (pBone->mWeights[k].mVertexId == v) {
+          drw.mWeights.emplace_back(bone_ids[j], pBone->mWeights[k].mWeight);
+          break;
+        }
+      }
+    }
+    if (!(drw == drws[id]))
+      ++num_wrong;
+  }
+  c.expect(num_wrong == 0, "%u of %u vertices have the wrong draw matrix",
+           num_wrong, NumVertices);
+}
+
+//
+// Stripifier: the strips of every matrix primitive of the samples, flattened
+// to a list, must hold the same triangles as the list, with the same winding.
+//
+
+constexpr u64 NumAttributes = (u64)librii::gx::VertexAttribute::Max;
+using StripTriangle = std::array<u16, 3 * NumAttributes>;
+
+std::vector<StripTriangle>
+SortedTriangles(const librii::gx::MatrixPrimitive& mprim) {
+  std::vector<StripTriangle> tris;
+  for (const auto& prim : mprim.mPrimitives) {
+    librii::gpu::ForEachTriangle(prim, [&](const auto& a, const auto& b,
+                                           const auto& c) {
+      // Each rotation is the same triangle; keep the smallest.
+      std::optional<StripTriangle> best;
+      const std::array<const librii::gx::IndexedVertex*, 3> corners{&a, &b,
+                                                                    &c};
+      for (int rot = 0; rot < 3; ++rot) {
+        StripTriangle tri;
+        for (u64 i = 0; i < tri.size(); ++i) {
+          const auto& corner = *corners[(rot + i / NumAttributes) % 3];
+          tri[i] = corner[(librii::gx::VertexAttribute)(i % NumAttributes)];
+        }
+        if (!best || tri < *best)
+          best = tri;
+      }
+      tris.push_back(*best);
+    });
+  }
+  std::sort(tris.begin(), tris.end());
+  return tris;
+}
+
+void CheckStripifier(Checker& c, const std::string& samples) {
+  for (const auto& path : SceneSamples(samples)) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+    const auto& scene = dynamic_cast<const libcube::Scene&>(*data);
+    u32 num_wrong = 0;
+    for (auto& model : scene.getModels()) {
+      for (auto& mesh : model.getMeshes()) {
+        for (const auto& mprim : mesh.getMeshData().mMatrixPrimitives) {
+          librii::gx::MatrixPrimitive list = mprim;
+          list.mPrimitives.clear();
+          auto& tris = list.mPrimitives.emplace_back();
+          tris.mType = librii::gx::PrimitiveType::Triangles;
+          for (const auto& prim : mprim.mPrimitives) {
+            librii::gpu::ForEachTriangle(
+                prim, [&](const auto& a, const auto& b, const auto& c) {
+                  tris.mVertices.push_back(a);
+                  tris.mVertices.push_back(b);
+                  tris.mVertices.push_back(c);
+                });
+          }
+
+          auto stripped = list;
+          librii::gpu::StripifyTriangles(stripped);
+          if (SortedTriangles(list) != SortedTriangles(stripped))
+            ++num_wrong;
+        }
+      }
+    }
+    c.expect(num_wrong == 0, "%s: %u matrix primitives changed when stripped",
+             path.c_str(), num_wrong);
+  }
+}
+
+//
+// Vertex cache: the welded, reordered triangle list of every matrix primitive
+// of the samples must hold the same triangles, minus degenerates, with the
+// same winding, and must not miss the cache more often than the input order.
+//
+
+void CheckVertexCache(Checker& c, const std::string& samples) {
+  using namespace librii::gx;
+  for (const auto& path : SceneSamples(samples)) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+    const auto& scene = dynamic_cast<const libcube::Scene&>(*data);
+    u32 num_wrong = 0, num_worse = 0;
+    for (auto& model : scene.getModels()) {
+      for (auto& mesh : model.getMeshes()) {
+        const u32 attributes = mesh.getVcd().mBitfield;
+        auto mask = [&](const IndexedVertex& vtx) {
+          IndexedVertex out{};
+          for (u32 i = 0; i < (u32)VertexAttribute::Max; ++i) {
+            if (attributes & (1 << i))
+              out[(VertexAttribute)i] = vtx[(VertexAttribute)i];
+          }
+          return out;
+        };
+        for (const auto& mprim : mesh.getMeshData().mMatrixPrimitives) {
+          MatrixPrimitive expected, welded;
+          auto& expected_tris = expected.mPrimitives.emplace_back();
+          expected_tris.mType = PrimitiveType::Triangles;
+          for (const auto& prim : mprim.mPrimitives) {
+            librii::gpu::ForEachTriangle(
+                prim, [&](const auto& a, const auto& b, const auto& c) {
+                  const auto ma = mask(a), mb = mask(b), mc = mask(c);
+                  if (ma == mb || mb == mc || ma == mc)
+                    return;
+                  expected_tris.mVertices.push_back(ma);
+                  expected_tris.mVertices.push_back(mb);
+                  expected_tris.mVertices.push_back(mc);
+                });
+          }
+
+          const auto tris = librii::glhelper::WeldTriangles(mprim, attributes);
+          auto& welded_tris = welded.mPrimitives.emplace_back();
+          welded_tris.mType = PrimitiveType::Triangles;
+          for (const u32 index : tris.indices)
+            welded_tris.mVertices.push_back(tris.vertices[index]);
+
+          if (SortedTriangles(expected) != SortedTriangles(welded))
+            ++num_wrong;
+          // The input order, numbered independently of WeldTriangles
+          std::unordered_map<IndexedVertex, u32, IndexedVertexHash> numbers;
+          std::vector<u32> input;
+          for (const auto& vtx : expected_tris.mVertices) {
+            input.push_back(
+                numbers.emplace(vtx, static_cast<u32>(numbers.size()))
+                    .first->second);
+          }
+          const u32 num_verts = static_cast<u32>(tris.vertices.size());
+          if (librii::glhelper::CalcACMR(tris.indices, num_verts) >
+              librii::glhelper::CalcACMR(input, num_verts))
+            ++num_worse;
+        }
+      }
+    }
+    c.expect(num_wrong == 0, "%s: %u matrix primitives changed when welded",
+             path.c_str(), num_wrong);
+    c.expect(num_worse == 0,
+             "%s: %u matrix primitives miss the vertex cache more often",
+             path.c_str(), num_worse);
+  }
+}
+
+//
+// Matrix palettes: every corner of the generated skinned meshes, split into
+// matrix primitives by the palette partitioner, must still resolve to its
+// draw matrix.
+//
+
+// Every triangle as {position, draw matrix} corners, sorted
+using SkinnedTriangle = std::array<std::pair<u16, s16>, 3>;
+std::vector<SkinnedTriangle>
+ResolveTriangles(std::span<const librii::gx::IndexedVertex> list) {
+  using namespace librii::gx;
+  std::vector<SkinnedTriangle> tris;
+  for (std::size_t i = 0; i + 2 < list.size(); i += 3) {
+    SkinnedTriangle tri;
+    for (int j = 0; j < 3; ++j) {
+      tri[j] = {list[i + j][VertexAttribute::Position],
+                list[i + j][VertexAttribute::PositionNormalMatrixIndex]};
+    }
+    tris.push_back(tri);
+  }
+  std::sort(tris.begin(), tris.end());
+  return tris;
+}
+std::vector<SkinnedTriangle>
+ResolveTriangles(std::span<const librii::gx::MatrixPrimitive> mprims) {
+  using namespace librii::gx;
+  std::vector<SkinnedTriangle> tris;
+  for (const auto& mp : mprims) {
+    auto resolve = [&](const IndexedVertex& v) -> std::pair<u16, s16> {
+      const u32 slot = v[VertexAttribute::PositionNormalMatrixIndex] / 3;
+      if (slot >= mp.mDrawMatrixIndices.size())
+        return {v[VertexAttribute::Position], -1};
+      return {v[VertexAttribute::Position], mp.mDrawMatrixIndices[slot]};
+    };
+    for (const auto& prim : mp.mPrimitives) {
+      librii::gpu::ForEachTriangle(
+          prim, [&](const auto& a, const auto& b, const auto& c) {
+            tris.push_back({resolve(a), resolve(b), resolve(c)});
+          });
+    }
+  }
+  std::sort(tris.begin(), tris.end());
+  return tris;
+}
+
+void CheckMatrixPalettes(Checker& c, const std::string&) {
+  for (const u16 num_matrices : {8, 40, 200}) {
+    const auto vertices = SkinnedSoup(num_matrices, 4000);
+    const auto mprims = librii::gpu::MakeSkinnedPrimitives(vertices);
+    bool fits = true;
+    for (const auto& mp : mprims)
+      fits &= mp.mDrawMatrixIndices.size() <= librii::gpu::MaxPaletteSize;
+    c.expect(fits, "%u matrices: a palette is over the limit",
+             (u32)num_matrices);
+    c.expect(ResolveTriangles(vertices) == ResolveTriangles(mprims),
+             "%u matrices: corners resolve to other draw matrices",
+             (u32)num_matrices);
+  }
+}
+
+//
+// Palette updates: after a bone of each sample model is moved, an update that
+// only compares bones (no relink) must give the bone matrices a new palette
+// computes.
+//
+
+void CheckPaletteUpdates(Checker& c, const std::string& samples) {
+  for (const auto& path : SceneSamples(samples)) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+    auto& scene = dynamic_cast<libcube::Scene&>(*data);
+    u32 num_wrong = 0;
+    for (auto& model : scene.getModels()) {
+      auto bones = model.getBones();
+      if (bones.empty())
+        continue;
+      libcube::MatrixPalette palette;
+      palette.update(model);
+      auto& bone = bones[bones.size() - 1];
+      auto srt = bone.getSRT();
+      srt.translation.x += 1.0f;
+      bone.setSRT(srt);
+      palette.update(model, false);
+
+      libcube::MatrixPalette reference;
+      reference.update(model);
+      const auto a = palette.getBoneMatrices();
+      const auto b = reference.getBoneMatrices();
+      if (!std::equal(a.begin(), a.end(), b.begin(), b.end()))
+        ++num_wrong;
+    }
+    c.expect(num_wrong == 0, "%s: %u palettes miss a moved bone",
+             path.c_str(), num_wrong);
+  }
+}
+
+//
+// Vertex quantization: quantizing the samples' vertex buffers must keep every
+// attribute within the tolerance, and the quantized file must read back and
+// save to the same bytes.
+//
+
+struct VertexError {
+  f32 position = 0.0f;
+  f32 normal = 0.0f;
+  f32 texcoord = 0.0f;
+};
+
+// Largest difference between the vertices of two scenes with the same meshes
+std::optional<VertexError> CompareVertices(const libcube::Scene& a,
+                                           const libcube::Scene& b) {
+  using namespace librii::gx;
+  auto models_a = a.getModels();
+  auto models_b = b.getModels();
+  if (models_a.size() != models_b.size())
+    return std::nullopt;
+  VertexError error;
+  auto diff = [](auto u, auto v) {
+    f32 d = 0.0f;
+    for (int i = 0; i < u.length(); ++i)
+      d = std::max(d, std::fabs(u[i] - v[i]));
+    return d;
+  };
+  for (std::size_t m = 0; m < models_a.size(); ++m) {
+    const auto& mdl_a = models_a[m];
+    const auto& mdl_b = models_b[m];
+    auto meshes_a = mdl_a.getMeshes();
+    auto meshes_b = mdl_b.getMeshes();
+    if (meshes_a.size() != meshes_b.size())
+      return std::nullopt;
+    for (std::size_t i = 0; i < meshes_a.size(); ++i) {
+      const auto& mesh_a = meshes_a[i];
+      const auto& mesh_b = meshes_b[i];
+      const auto& vcd = mesh_a.getVcd();
+      for (const auto& mprim : mesh_a.getMeshData().mMatrixPrimitives) {
+        for (const auto& prim : mprim.mPrimitives) {
+          for (const auto& vtx : prim.mVertices) {
+            if (vcd[VertexAttribute::Position]) {
+              const u16 idx = vtx[VertexAttribute::Position];
+              error.position = std::max(
+                  error.position, diff(mesh_a.getPos(mdl_a, idx),
+                                       mesh_b.getPos(mdl_b, idx)));
+            }
+            if (vcd[VertexAttribute::Normal]) {
+              const u16 idx = vtx[VertexAttribute::Normal];
+              error.normal = std::max(error.normal,
+                                      diff(mesh_a.getNrm(mdl_a, idx),
+                                           mesh_b.getNrm(mdl_b, idx)));
+            }
+            for (u32 chan = 0; chan < 8; ++chan) {
+              const auto attr = VertexAttribute::TexCoord0 + chan;
+              if (!vcd[attr])
+                continue;
+              const u16 idx = vtx[attr];
+              error.texcoord = std::max(
+                  error.texcoord, diff(mesh_a.getUv(mdl_a, chan, idx),
+                                       mesh_b.getUv(mdl_b, chan, idx)));
+            }
+          }
+        }
+      }
+    }
+  }
+  return error;
+}
+
+// Open `bytes` as if they were the file `name`
+std::unique_ptr<kpi::INode> Reopen(const std::string& name,
+                                   std::span<const u8> bytes) {
+  const auto path =
+      (std::filesystem::temp_directory_path() /
+       ("check_" + std::filesystem::path(name).filename().string()))
+          .string();
+  std::ofstream(path, std::ios::binary)
+      .write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  auto data = open(path);
+  std::filesystem::remove(path);
+  return data;
+}
+
+// Bytes of the second save of `data`. The first save of a sample applies
+// normalizations its original writer did not (tests.py records both hashes),
+// so round trips are compared from the second on.
+std::vector<u8> ResavedBytes(const std::string& path, kpi::INode& data,
+                             const libcube::ExportOptions& options = {}) {
+  auto reread = Reopen(path, WrittenBytes(data, options));
+  return reread ? WrittenBytes(*reread, options) : std::vector<u8>{};
+}
+
+// Whether `bytes` save to the same bytes after reading them back
+bool SavesStably(const std::string& path, const std::vector<u8>& bytes,
+                 const libcube::ExportOptions& options = {}) {
+  auto reread = Reopen(path, bytes);
+  return reread &&
+         HashBytes(WrittenBytes(*reread, options)) == HashBytes(bytes);
+}
+
+void CheckQuantization(Checker& c, const std::string& samples) {
+  constexpr f32 Tolerance = 1.0f / 64.0f;
+  const libcube::ExportOptions options{{Tolerance, Tolerance, Tolerance}};
+  for (const auto& path : SceneSamples(samples)) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+
+    const auto quantized = WrittenBytes(*data, options);
+    const auto resaved = ResavedBytes(path, *data, options);
+    c.expect(SavesStably(path, resaved, options),
+             "%s: the quantized file saves to other bytes", path.c_str());
+
+    auto reread = Reopen(path, quantized);
+    const auto* reread_scene =
+        dynamic_cast<const libcube::Scene*>(reread.get());
+    const auto error =
+        reread_scene != nullptr
+            ? CompareVertices(dynamic_cast<const libcube::Scene&>(*data),
+                              *reread_scene)
+            : std::nullopt;
+    if (!c.expect(error.has_value(), "%s did not survive quantization",
+                  path.c_str()))
+      continue;
+    c.expect(error->position <= Tolerance && error->normal <= Tolerance &&
+                 error->texcoord <= Tolerance,
+             "%s: error of %g position, %g normal, %g uv is over %g",
+             path.c_str(), error->position, error->normal, error->texcoord,
+             Tolerance);
+  }
+
+  // The samples are fixed point already. With float buffers, as importers
+  // leave them, the archive must shrink.
+  for (const auto& path : FindSamples(samples, {".brres"})) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+    using namespace librii::gx;
+    auto toFloat = [](auto&& buffers, VertexBufferKind kind) {
+      for (auto& buf : buffers) {
+        auto& quant = buf.mQuantize;
+        quant.mType.generic = VertexBufferType::Generic::f32;
+        quant.divisor = 0;
+        quant.stride =
+            static_cast<u8>(computeComponentCount(kind, quant.mComp) * 4);
+      }
+    };
+    for (auto& mdl :
+         dynamic_cast<riistudio::g3d::Collection&>(*data).getModels()) {
+      toFloat(mdl.getBuf_Pos(), VertexBufferKind::position);
+      toFloat(mdl.getBuf_Nrm(), VertexBufferKind::normal);
+      toFloat(mdl.getBuf_Uv(), VertexBufferKind::textureCoordinate);
+    }
+    const auto floats = WrittenBytes(*data);
+    const auto quantized = WrittenBytes(*data, options);
+    c.expect(quantized.size() < floats.size(),
+             "%s: %zu bytes with float buffers, %zu quantized", path.c_str(),
+             floats.size(), quantized.size());
+  }
+}
+
+//
+// Name pool: every name of the BRRES samples must read back from its offset
+// in the pool, and survive a save; the saved file must save to the same
+// bytes again.
+//
+
+void CheckNamePool(Checker& c, const std::string& samples) {
+  for (const auto& path : FindSamples(samples, {".brres"})) {
+    auto data = open(path);
+    const auto* archive =
+        dynamic_cast<const riistudio::g3d::Collection*>(data.get());
+    if (!c.expect(archive != nullptr, "%s is not a BRRES archive",
+                  path.c_str()))
+      continue;
+
+    const auto names = CollectNames(*archive);
+    std::vector<std::string> distinct;
+    std::unordered_map<std::string_view, u32> seen;
+    for (const auto& name : names) {
+      if (!name.empty() && seen.try_emplace(name, distinct.size()).second)
+        distinct.push_back(name);
+    }
+    const auto [pool, offsets] = riistudio::g3d::poolStrings(distinct);
+    u32 num_wrong = 0;
+    for (std::size_t i = 0; i < distinct.size(); ++i) {
+      const u32 ofs = offsets[i];
+      const auto& str = distinct[i];
+      const bool valid =
+          ofs >= 4 && ofs + str.size() < pool.size() &&
+          pool[ofs + str.size()] == 0 &&
+          std::equal(str.begin(), str.end(), pool.begin() + ofs) &&
+          ((pool[ofs - 4] << 24) | (pool[ofs - 3] << 16) |
+           (pool[ofs - 2] << 8) | pool[ofs - 1]) == str.size();
+      if (!valid)
+        ++num_wrong;
+    }
+    c.expect(num_wrong == 0, "%s: %u names do not read back from the pool",
+             path.c_str(), num_wrong);
+
+    const auto saved = WrittenBytes(*data);
+    auto reread = Reopen(path, saved);
+    const auto* reread_archive =
+        dynamic_cast<const riistudio::g3d::Collection*>(reread.get());
+    if (!c.expect(reread_archive != nullptr, "%s: cannot read back",
+                  path.c_str()))
+      continue;
+    c.expect(CollectNames(*reread_archive) == names, "%s: names changed",
+             path.c_str());
+    c.expect(WrittenBytes(*reread) == saved,
+             "%s: the saved file saves to other bytes", path.c_str());
+  }
+}
+
+//
+// Material tables: MAT3 entries appended through the hashed tables must match
+// a linear search, and the BMD samples must save to the same bytes after a
+// round trip.
+//
+
+template <typename T>
+void CheckTable(Checker& c, const char* name, const std::vector<T>& input) {
+  std::vector<T> linear_buf;
+  std::vector<u32> linear_idx, hashed_idx;
+  for (const auto& entry : input)
+    linear_idx.push_back(LinearAppend(linear_buf, entry));
+  riistudio::j3d::HashedVector<T> hashed_buf;
+  for (const auto& entry : input)
+    hashed_idx.push_back(hashed_buf.append(entry));
+
+  c.expect(linear_idx == hashed_idx &&
+               std::equal(linear_buf.begin(), linear_buf.end(),
+                          hashed_buf.begin(), hashed_buf.end()),
+           "%s differ from a linear search", name);
+}
+
+void CheckMaterialTables(Checker& c, const std::string& samples) {
+  constexpr std::size_t Count = 2000;
+  std::mt19937 rng(0x5EED);
+  std::vector<riistudio::j3d::Material> mats;
+  for (std::size_t i = 0; i < Count; ++i)
+    mats.push_back(
+        MakeMaterial(std::uniform_int_distribution<u32>(0, Count / 4)(rng)));
+
+  std::vector<riistudio::j3d::MaterialData> materials;
+  std::vector<librii::gx::TevStage> stages;
+  std::vector<libcube::GCMaterialData::TexMatrix> matrices;
+  std::vector<libcube::GCMaterialData::SamplerData> samplers;
+  std::vector<librii::gx::Color> colors;
+  std::vector<librii::j3d::Fog> fogs;
+  for (const auto& mat : mats) {
+    materials.push_back(mat);
+    stages.insert(stages.end(), mat.mStages.begin(),
+                  mat.mStages.begin() + mat.mStages.size());
+    matrices.insert(matrices.end(), mat.texMatrices.begin(),
+                    mat.texMatrices.begin() + mat.texMatrices.size());
+    samplers.insert(samplers.end(), mat.samplers.begin(),
+                    mat.samplers.begin() + mat.samplers.size());
+    colors.insert(colors.end(), mat.tevKonstColors.begin(),
+                  mat.tevKonstColors.end());
+    fogs.push_back(mat.fogInfo);
+  }
+  CheckTable(c, "Materials", materials);
+  CheckTable(c, "TEV stages", stages);
+  CheckTable(c, "Texture matrices", matrices);
+  CheckTable(c, "Samplers", samplers);
+  CheckTable(c, "Colors", colors);
+  CheckTable(c, "Fogs", fogs);
+
+  for (const auto& path : FindSamples(samples, {".bdl", ".bmd"})) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+    c.expect(SavesStably(path, ResavedBytes(path, *data)),
+             "%s: the saved file saves to other bytes", path.c_str());
+  }
+}
+
+//
+// Display lists: every matrix primitive of the samples, written back to a
+// display list, must decode to the same primitives and largest indices with
+// the vertex layout decoders and with a per-attribute reader.
+//
+
+void CheckDisplayLists(Checker& c, const std::string& samples) {
+  struct Collector : librii::gpu::IMeshDLDelegate {
+    librii::gx::IndexedPrimitive&
+    addIndexedPrimitive(librii::gx::PrimitiveType type, u16 nVerts) override {
+      return prims.emplace_back(type, nVerts);
+    }
+    std::vector<librii::gx::IndexedPrimitive> prims;
+  };
+
+  for (const auto& path : SceneSamples(samples)) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+    const auto& scene = dynamic_cast<const libcube::Scene&>(*data);
+    u32 num_wrong = 0;
+    for (auto& model : scene.getModels()) {
+      for (auto& mesh : model.getMeshes()) {
+        const auto& mesh_data = mesh.getMeshData();
+        for (const auto& mprim : mesh_data.mMatrixPrimitives) {
+          auto bytes = EncodeDisplayList(mesh_data, mprim);
+          const u32 size = static_cast<u32>(bytes.size());
+          oishii::DataProvider provider(std::move(bytes), path);
+          oishii::BinaryReader reader(provider.slice());
+
+          const auto& descriptor = mesh_data.mVertexDescriptor;
+          std::vector<librii::gx::IndexedPrimitive> reference;
+          UsageMap reference_usage, layout_usage;
+          DecodeDisplayListReference(reader, size, descriptor, reference,
+                                     reference_usage);
+          Collector layout;
+          auto err = librii::gpu::DecodeMeshDisplayList(
+              reader, 0, size, layout, descriptor, &layout_usage);
+          const bool failed = static_cast<bool>(err);
+          llvm::consumeError(std::move(err));
+          if (failed || reference != layout.prims ||
+              reference != mprim.mPrimitives ||
+              reference_usage != layout_usage)
+            ++num_wrong;
+        }
+      }
+    }
+    c.expect(num_wrong == 0, "%s: %u display lists decode differently",
+             path.c_str(), num_wrong);
+  }
+}
+
+//
+// Parallel load: every sample must save to the same bytes whether its
+// sections were decoded serially or in parallel.
+//
+
+void CheckParallelLoad(Checker& c, const std::string& samples) {
+  for (const auto& path : SceneSamples(samples)) {
+    std::unique_ptr<kpi::INode> serial;
+    {
+      riistudio::util::ParallelLimit limit(1);
+      serial = open(path);
+    }
+    auto parallel = open(path);
+    if (!c.expect(serial && parallel, "%s: cannot open", path.c_str()))
+      continue;
+    c.expect(WrittenBytes(*serial) == WrittenBytes(*parallel),
+             "%s: a parallel load saves to other bytes", path.c_str());
+  }
+}
+
+//
+// Forked warnings: warnings raised by readers forked for a parallel decode
+// must reach the parent's handlers once joined, in the order of the tasks.
+//
+
+void CheckForkedWarnings(Checker& c, const std::string&) {
+  struct Recorder : oishii::ErrorHandler {
+    void onErrorBegin(const oishii::DataProvider&) override {}
+    void onErrorDescribe(const oishii::DataProvider&, const char*,
+                         const char* brief, const char*) override {
+      briefs.push_back(brief);
+    }
+    void onErrorAddStackTrace(const oishii::DataProvider&, std::streampos,
+                              std::streamsize, const char*) override {}
+    void onErrorEnd(const oishii::DataProvider&) override {}
+    std::vector<std::string> briefs;
+  } recorder;
+
+  constexpr u32 NumTasks = 8;
+  oishii::DataProvider provider(std::vector<u8>(NumTasks * 16), "<forks>");
+  oishii::BinaryReader reader(provider.slice());
+  reader.addErrorHandler(&recorder);
+  std::vector<std::vector<oishii::HeldWarning>> warnings(NumTasks);
+  riistudio::util::ParallelFor(NumTasks, [&](u32 i) {
+    auto fork = reader.fork();
+    fork.warnAt(std::to_string(i).c_str(), i * 16, i * 16 + 1);
+    warnings[i] = fork.takeWarnings();
+  });
+  c.expect(recorder.briefs.empty(), "%u warnings reported before the join",
+           static_cast<u32>(recorder.briefs.size()));
+  for (const auto& taskWarnings : warnings)
+    reader.replayWarnings(taskWarnings);
+
+  u32 num_wrong = recorder.briefs.size() == NumTasks ? 0 : NumTasks;
+  for (u32 i = 0; i < recorder.briefs.size() && i < NumTasks; ++i)
+    num_wrong += recorder.briefs[i] == std::to_string(i) ? 0 : 1;
+  c.expect(num_wrong == 0, "%u of %u warnings lost or out of order",
+           num_wrong, NumTasks);
+}
+
+//
+// Incremental save: saving a sample again after editing one material must
+// give the same bytes whether the writer reuses the sections it saved before
+// or a new writer rewrites all of them. A writer kept across documents must
+// not reuse one document's sections in another.
+//
+
+void CheckIncrementalSave(Checker& c, const std::string& samples) {
+  std::unique_ptr<kpi::INode> last;
+  std::unique_ptr<kpi::IBinarySerializer> last_exporter;
+  for (const auto& path : FindSamples(samples, {".brres", ".bmd", ".bdl"})) {
+    auto data = open(path);
+    if (!c.expect(data != nullptr, "%s: cannot open", path.c_str()))
+      continue;
+    auto exporter = SpawnExporter(*data);
+    const auto first_bytes = WrittenBytes(*exporter, *data);
+    c.expect(WrittenBytes(*exporter, *data) == first_bytes,
+             "%s: saving again without edits changes the file", path.c_str());
+    if (!c.expect(EditFirstMaterial(*data), "%s has no materials",
+                  path.c_str()))
+      continue;
+    const auto incremental_bytes = WrittenBytes(*exporter, *data);
+    c.expect(incremental_bytes == WrittenBytes(*data),
+             "%s: an incremental save differs from a full save",
+             path.c_str());
+    c.expect(incremental_bytes != first_bytes,
+             "%s: the edit is not saved", path.c_str());
+
+    if (last_exporter && typeid(*last) == typeid(*data)) {
+      c.expect(WrittenBytes(*last_exporter, *data) == incremental_bytes,
+               "%s: a writer reuses sections of another document",
+               path.c_str());
+    }
+    last = std::move(data);
+    last_exporter = std::move(exporter);
+  }
+}
+
+//
+// Bounding volumes: a BVH query must report exactly the boxes a brute force
+// frustum test does, and TransformAABB must match the bounds of the eight
+// transformed corners.
+//
+
+librii::math::AABB RandomBox(std::mt19937& rng, f32 range, f32 max_size) {
+  std::uniform_real_distribution<f32> pos(-range, range), size(0.0f, max_size);
+  const glm::vec3 min{pos(rng), pos(rng), pos(rng)};
+  return {min, min + glm::vec3(size(rng), size(rng), size(rng))};
+}
+
+void CheckBVH(Checker& c, const std::string&) {
+  constexpr u32 NumBoxes = 2000, NumViews = 64;
+  std::mt19937 rng(0x5EED);
+  std::vector<librii::math::AABB> boxes;
+  for (u32 i = 0; i < NumBoxes; ++i)
+    boxes.push_back(RandomBox(rng, 100.0f, 10.0f));
+  librii::math::BVH bvh;
+  bvh.build(boxes);
+
+  std::uniform_real_distribution<f32> pos(-150.0f, 150.0f);
+  for (u32 v = 0; v < NumViews; ++v) {
+    const glm::vec3 eye{pos(rng), pos(rng), pos(rng)};
+    const glm::vec3 target{pos(rng) / 4, pos(rng) / 4, pos(rng) / 4};
+    const auto frustum = librii::math::Frustum::FromMatrix(
+        glm::perspective(glm::radians(60.0f), 1.5f, 1.0f, 200.0f) *
+        glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+
+    std::vector<u32> expected, found;
+    for (u32 i = 0; i < NumBoxes; ++i)
+      if (frustum.intersects(boxes[i]))
+        expected.push_back(i);
+    bvh.query(frustum, [&](u32 i) { found.push_back(i); });
+    std::sort(found.begin(), found.end());
+    c.expect(found == expected,
+             "view %u: the BVH reports %zu boxes, brute force %zu", v,
+             found.size(), expected.size());
+  }
+}
+
+void CheckTransformAABB(Checker& c, const std::string&) {
+  constexpr u32 NumBoxes = 256;
+  std::mt19937 rng(0x5EED);
+  std::uniform_real_distribution<f32> unit(-1.0f, 1.0f);
+  for (u32 i = 0; i < NumBoxes; ++i) {
+    const auto box = RandomBox(rng, 50.0f, 20.0f);
+    // Rotated about a random axis, scaled (mirrored for some) and translated
+    glm::vec3 axis{unit(rng), unit(rng), unit(rng)};
+    if (glm::length(axis) < 0.01f)
+      axis = glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::vec3 offset{unit(rng) * 100, unit(rng) * 100, unit(rng) * 100};
+    const glm::vec3 scale{unit(rng) * 4.0f, 1.0f + unit(rng) * 0.5f, 2.0f};
+    glm::mat4 mtx = glm::translate(glm::mat4(1.0f), offset);
+    mtx = glm::rotate(mtx, unit(rng) * 3.14159f, glm::normalize(axis));
+    mtx = glm::scale(mtx, scale);
+
+    librii::math::AABB expected{glm::vec3(INFINITY), glm::vec3(-INFINITY)};
+    for (int corner = 0; corner < 8; ++corner) {
+      const glm::vec3 p{corner & 1 ? box.max.x : box.min.x,
+                        corner & 2 ? box.max.y : box.min.y,
+                        corner & 4 ? box.max.z : box.min.z};
+      const glm::vec3 q{mtx * glm::vec4(p, 1.0f)};
+      expected.expandBound({q, q});
+    }
+    const auto actual = librii::math::TransformAABB(box, mtx);
+
+    const f32 error = std::max(glm::length(actual.min - expected.min),
+                               glm::length(actual.max - expected.max));
+    c.expect(error <= 1e-3f, "box %u: bounds are off by %g", i, error);
+  }
+}
+
+//
+// Draw bounds: a camera looking at any vertex of a sample draw, moved by its
+// position matrix as the vertex shader does, must not cull the draw by the
+// bound the renderer gives it.
+//
+
+void CheckDrawBounds(Checker& c, const std::string& samples) {
+  using librii::gx::VertexAttribute;
+  const auto proj = glm::perspective(glm::radians(10.0f), 1.0f, 0.1f, 10.0f);
+  for (const auto& path : SceneSamples(samples)) {
+    auto data = OpenScene(c, path);
+    if (!data)
+      continue;
+    const auto& scene = dynamic_cast<const libcube::Scene&>(*data);
+    u32 num_draws = 0, num_culled = 0;
+    for (auto& model : scene.getModels()) {
+      libcube::MatrixPalette palette;
+      palette.update(model);
+      for (auto& mesh : model.getMeshes()) {
+        const auto& mprims = mesh.getMeshData().mMatrixPrimitives;
+        for (u32 mp = 0; mp < mprims.size(); ++mp) {
+          const auto positions = mesh.calcPositionBound(model, mp);
+          if (!positions)
+            continue;
+          std::array<glm::mat4, 10> scratch;
+          const auto mtx = mesh.getPosMtx(palette, mp, scratch);
+          const auto bound = libcube::IndexedPolygon::transformPositionBound(
+              *positions, mtx);
+
+          bool culled = false;
+          for (const auto& prim : mprims[mp].mPrimitives) {
+            for (const auto& vtx : prim.mVertices) {
+              glm::mat4 m{1.0f};
+              if (!mtx.empty()) {
+                const u32 pnm =
+                    mesh.getVcd()[VertexAttribute::PositionNormalMatrixIndex]
+                        ? vtx[VertexAttribute::PositionNormalMatrixIndex] / 3
+                        : 0;
+                m = mtx[std::min<std::size_t>(pnm, mtx.size() - 1)];
+              }
+              const auto stored =
+                  mesh.getPos(model, vtx[VertexAttribute::Position]);
+              const glm::vec3 pos{m * glm::vec4(stored, 1.0f)};
+              const auto view = glm::lookAt(pos + glm::vec3(0.0f, 0.0f, 1.0f),
+                                            pos, glm::vec3(0.0f, 1.0f, 0.0f));
+              const auto frustum =
+                  librii::math::Frustum::FromMatrix(proj * view);
+              culled |= !frustum.intersects(bound);
+            }
+          }
+          ++num_draws;
+          num_culled += culled ? 1 : 0;
+        }
+      }
+    }
+    c.expect(num_culled == 0, "%s: %u of %u draws are culled while in view",
+             path.c_str(), num_culled, num_draws);
+  }
+}
+
+//
+// Radix sort: must order like std::stable_sort by key, keeping the input
+// order of equal keys, for keys using few bits, all bits or only high bits.
+//
+
+void CheckRadixSort(Checker& c, const std::string&) {
+  constexpr u32 Count = 10000;
+  std::mt19937_64 rng(0x5EED);
+  const std::pair<const char*, std::function<u64()>> key_sets[] = {
+      {"small keys", [&] { return rng() % 16; }},
+      {"full keys", [&] { return rng() % 4096 * 0x0101010101010101ull; }},
+      {"high keys", [&] { return (rng() % 64) << 56; }},
+      {"equal keys", [&] { return u64(42); }},
+  };
+
+  // The scratch buffer is shared to check that reusing it is safe.
+  std::vector<std::pair<u64, u32>> scratch;
+  for (const auto& [name, key] : key_sets) {
+    std::vector<std::pair<u64, u32>> items;
+    for (u32 i = 0; i < Count; ++i)
+      items.emplace_back(key(), i);
+    auto expected = items;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto& l, const auto& r) {
+                       return l.first < r.first;
+                     });
+    rsl::radix_sort(items, scratch);
+    c.expect(items == expected, "%s: order differs from std::stable_sort",
+             name);
+  }
+}
+
+//
+// GL state tracker: replays a known sequence of draws and expects every
+// redundant change, and only those, to be skipped.
+//
+
+void CheckStateTracker(Checker& c, const std::string&) {
+  using riistudio::lib3d::TextureObj;
+  struct Draw {
+    bool reset; // As at the start of a frame
+    u32 program, vao;
+    librii::gfx::MegaState state;
+    std::vector<TextureObj> textures;
+  };
+  const librii::gfx::MegaState opaque{.cullMode = 1, .depthWrite = 1};
+  const librii::gfx::MegaState blended{.cullMode = 1, .blendMode = 1};
+  // Image 5 is sampled by two units with different filters.
+  const TextureObj linear{.active_id = 0, .image_id = 5, .glMinFilter = 1};
+  const TextureObj nearest{.active_id = 1, .image_id = 5, .glMinFilter = 2};
+  // Units past the tracked ones are always bound.
+  const TextureObj untracked{.active_id = 8, .image_id = 6};
+  const Draw draws[] = {
+      {false, 1, 10, opaque, {linear}},
+      {false, 1, 11, opaque, {linear}},
+      {false, 2, 11, blended, {linear, nearest}},
+      // Both units must reconfigure image 5.
+      {false, 2, 11, blended, {linear, nearest}},
+      {true, 2, 11, blended, {linear, nearest, untracked}},
+  };
+  // Changes issued and skipped of programs, VAOs, textures and states
+  const std::array<u32, 8> expected{3, 2, 3, 2, 7, 2, 3, 2};
+
+  riistudio::lib3d::GlStateTracker tracker;
+  std::array<u32, 8> returned{};
+  auto count = [&](bool changed, int kind) {
+    ++returned[kind * 2 + (changed ? 0 : 1)];
+  };
+  for (const auto& draw : draws) {
+    if (draw.reset)
+      tracker.reset();
+    count(tracker.setProgram(draw.program), 0);
+    count(tracker.setVertexArray(draw.vao), 1);
+    for (const auto& tex : draw.textures)
+      count(tracker.setTexture(tex), 2);
+    count(tracker.setMegaState(draw.state), 3);
+    tracker.onDraw();
+  }
+
+  const auto& stats = tracker.getStats();
+  const std::array<u32, 8> counted{
+      stats.program_binds, stats.program_skips, stats.vao_binds,
+      stats.vao_skips,     stats.texture_binds, stats.texture_skips,
+      stats.state_changes, stats.state_skips};
+  c.expect(stats.draws == std::size(draws), "%u draws counted", stats.draws);
+  c.expect(counted == expected,
+           "counted %u/%u program, %u/%u VAO, %u/%u texture, %u/%u state "
+           "binds/skips",
+           counted[0], counted[1], counted[2], counted[3], counted[4],
+           counted[5], counted[6], counted[7]);
+  c.expect(returned == counted,
+           "the setters' results disagree with the statistics");
+}
+
+//
+// Profiler: snapshots taken while a thread records must never contain an
+// event mixed from two records.
+//
+
+void CheckProfiler(Checker& c, const std::string&) {
+  static const char* const Names[] = {"Check even", "Check odd"};
+  constexpr u64 NumEvents = 1 << 21;
+  std::atomic<bool> done{false};
+  std::thread recorder([&] {
+    // Event i is named by the parity of i and lasts one nanosecond.
+    for (u64 i = 0; i < NumEvents; ++i)
+      riistudio::util::ProfilerRecord(Names[i % 2], 2 * i, 2 * i + 1);
+    done = true;
+  });
+
+  u32 torn = 0, snapshots = 0;
+  while (!done || snapshots == 0) {
+    ++snapshots;
+    for (const auto& thread : riistudio::util::ProfilerCollect(1e9)) {
+      for (const auto& e : thread.events) {
+        if (e.name != Names[0] && e.name != Names[1])
+          continue;
+        const bool whole =
+            e.end_ns == e.begin_ns + 1 && e.name == Names[e.begin_ns / 2 % 2];
+        torn += whole ? 0 : 1;
+      }
+    }
+  }
+  recorder.join();
+  c.expect(torn == 0, "%u torn events in %u snapshots", torn, snapshots);
+}
+
+const struct {
+  const char* name;
+  void (*run)(Checker& c, const std::string& samples);
+} Checks[] = {
+    {"Attribute pool", CheckAttributePool},
+    {"Skinning", CheckSkinning},
+    {"Stripifier", CheckStripifier},
+    {"Vertex cache", CheckVertexCache},
+    {"Matrix palettes", CheckMatrixPalettes},
+    {"Palette updates", CheckPaletteUpdates},
+    {"Vertex quantization", CheckQuantization},
+    {"Name pool", CheckNamePool},
+    {"Material tables", CheckMaterialTables},
+    {"Display lists", CheckDisplayLists},
+    {"Parallel load", CheckParallelLoad},
+    {"Forked warnings", CheckForkedWarnings},
+    {"Incremental save", CheckIncrementalSave},
+    {"BVH", CheckBVH},
+    {"Bounding box transforms", CheckTransformAABB},
+    {"Draw bounds", CheckDrawBounds},
+    {"Radix sort", CheckRadixSort},
+    {"GL state tracker", CheckStateTracker},
+    {"Profiler", CheckProfiler},
+};
+
+} // namespace
+
+int runChecks(const std::string& samples_dir) {
+  int num_failed = 0;
+  for (const auto& [name, run] : Checks) {
+    Checker checker{name};
+    run(checker, samples_dir);
+    if (checker.failures != 0)
+      ++num_failed;
+    else
+      printf("%s: Success\n", name);
+  }
+  return num_failed != 0 ? 1 : 0;
+}
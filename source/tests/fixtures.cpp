@@ -0,0 +1,198 @@
+#include "fixtures.hpp"
+#include <random>
+
+riistudio::j3d::Material MakeMaterial(u32 id) {
+  using namespace librii::gx;
+  std::mt19937 rng(id);
+  auto pick = [&](int range) {
+    return std::uniform_int_distribution(0, range - 1)(rng);
+  };
+  auto color = [&] {
+    const auto channel = [&] { return static_cast<u8>(pick(4) * 85); };
+    return Color(channel(), channel(), channel(), 255);
+  };
+
+  riistudio::j3d::Material mat;
+  mat.name = "mat_" + std::to_string(id);
+  mat.cullMode = static_cast<CullMode>(pick(4));
+  mat.chanData.push_back({color(), color()});
+  mat.mStages.resize(1 + pick(4));
+  for (auto& stage : mat.mStages) {
+    stage.texMap = stage.texCoord = static_cast<u8>(pick(3));
+    stage.colorStage.a = static_cast<TevColorArg>(pick(8));
+    stage.colorStage.d = static_cast<TevColorArg>(pick(8));
+    stage.alphaStage.a = static_cast<TevAlphaArg>(pick(8));
+  }
+  for (int i = 0; i < 1 + pick(3); ++i) {
+    mat.texGens.push_back({});
+    mat.texGens[i].sourceParam = static_cast<TexGenSrc>(pick(4));
+    auto& mtx = mat.texMatrices.emplace_back();
+    mtx.scale = glm::vec2(pick(3) + 1.0f, 1.0f);
+    // Signed zeroes must share an entry.
+    mtx.translate = glm::vec2(pick(2) ? -0.0f : 0.0f, pick(3) * 0.5f);
+    auto& samp = mat.samplers.emplace_back();
+    samp.mTexture = "tex_" + std::to_string(pick(8));
+    samp.btiId = static_cast<u16>(pick(8));
+  }
+  for (auto& c : mat.tevKonstColors)
+    c = color();
+  mat.fogInfo.enabled = pick(4) == 0;
+  mat.fogInfo.color = color();
+  mat.blendMode.type = static_cast<BlendModeType>(pick(2));
+  return mat;
+}
+
+std::vector<librii::gx::IndexedVertex> SkinnedTube(u16 num_bones,
+                                                   u16 rings_per_bone,
+                                                   u16 ring_size) {
+  using namespace librii::gx;
+  std::vector<IndexedVertex> vertices;
+  const u16 num_rings = num_bones * rings_per_bone;
+  auto vertex = [&](u16 ring, u16 i) {
+    IndexedVertex vtx{};
+    vtx[VertexAttribute::Position] = ring * ring_size + i % ring_size;
+    const u16 bone = ring / rings_per_bone;
+    // Draw matrices: one per bone, then one per joint
+    const bool joint = ring % rings_per_bone == 0 && bone > 0;
+    vtx[VertexAttribute::PositionNormalMatrixIndex] =
+        joint ? num_bones + bone - 1 : bone;
+    return vtx;
+  };
+  for (u16 r = 0; r + 1 < num_rings; ++r) {
+    for (u16 i = 0; i < ring_size; ++i) {
+      for (const auto& [ring, j] :
+           {std::pair{r, i}, {u16(r + 1), i}, {r, u16(i + 1)},
+            {r, u16(i + 1)}, {u16(r + 1), i}, {u16(r + 1), u16(i + 1)}})
+        vertices.push_back(vertex(ring, j));
+    }
+  }
+  return vertices;
+}
+
+std::vector<librii::gx::IndexedVertex> SkinnedSoup(u16 num_matrices,
+                                                   u32 num_tris) {
+  using namespace librii::gx;
+  std::mt19937 rng(0x5EED);
+  std::vector<IndexedVertex> vertices;
+  for (u32 t = 0; t < num_tris; ++t) {
+    const u16 base = std::uniform_int_distribution(0, num_matrices - 4)(rng);
+    for (int i = 0; i < 3; ++i) {
+      IndexedVertex vtx{};
+      vtx[VertexAttribute::Position] = t * 3 + i;
+      vtx[VertexAttribute::PositionNormalMatrixIndex] =
+          base + std::uniform_int_distribution(0, 3)(rng);
+      vertices.push_back(vtx);
+    }
+  }
+  return vertices;
+}
+
+std::vector<u8> EncodeDisplayList(const librii::gx::MeshData& mesh,
+                                  const librii::gx::MatrixPrimitive& mprim) {
+  using namespace librii::gx;
+  std::vector<u8> out;
+  auto write = [&](u16 val, u32 size) {
+    if (size == 2)
+      out.push_back(static_cast<u8>(val >> 8));
+    out.push_back(static_cast<u8>(val));
+  };
+  for (const auto& prim : mprim.mPrimitives) {
+    write(EncodeDrawPrimitiveCommand(prim.mType), 1);
+    write(static_cast<u16>(prim.mVertices.size()), 2);
+    for (const auto& v : prim.mVertices) {
+      for (u32 a = 0; a < (u32)VertexAttribute::Max; ++a) {
+        const auto attr = static_cast<VertexAttribute>(a);
+        if (!mesh.mVertexDescriptor[attr])
+          continue;
+        const auto type = mesh.mVertexDescriptor.mAttributes.at(attr);
+        if (type != VertexAttributeType::None)
+          write(v[attr], type == VertexAttributeType::Short ? 2 : 1);
+      }
+    }
+  }
+  return out;
+}
+
+void DecodeDisplayListReference(oishii::BinaryReader& reader, u32 size,
+                                const librii::gx::VertexDescriptor& descriptor,
+                                std::vector<librii::gx::IndexedPrimitive>& out,
+                                UsageMap& usage) {
+  using namespace librii::gx;
+  constexpr auto BE = oishii::EndianSelect::Big;
+  const u32 end = reader.tell() + size;
+  while (reader.tell() < end) {
+    const u8 tag = reader.readUnaligned<u8>();
+    if (tag == 0)
+      continue;
+    const u16 nVerts = reader.readUnaligned<u16, BE>();
+    auto& prim = out.emplace_back(DecodeDrawPrimitiveCommand(tag), nVerts);
+    for (u16 vi = 0; vi < nVerts; ++vi) {
+      for (int a = 0; a < (int)VertexAttribute::Max; ++a) {
+        if (!(descriptor.mBitfield & (1 << a)))
+          continue;
+        const auto attr = static_cast<VertexAttribute>(a);
+        u16 val = 0;
+        switch (descriptor.mAttributes.at(attr)) {
+        case VertexAttributeType::Short:
+          val = reader.read<u16, BE, true>();
+          break;
+        case VertexAttributeType::Byte:
+        case VertexAttributeType::Direct:
+          val = reader.read<u8, BE, true>();
+          break;
+        default:
+          break;
+        }
+        prim.mVertices[vi][attr] = val;
+        auto& largest = usage[static_cast<VertexBufferAttribute>(a)];
+        if (largest <= val)
+          largest = val;
+      }
+    }
+  }
+}
+
+std::vector<std::string> CollectNames(const riistudio::g3d::Collection& c) {
+  std::vector<std::string> names{"3DModels(NW4R)", "Textures(NW4R)"};
+  for (const auto& mdl : c.getModels()) {
+    names.push_back(mdl.getName());
+    names.insert(names.end(), {"NodeTree", "DrawOpa", "DrawXlu"});
+    for (const auto& bone : mdl.getBones())
+      names.push_back(bone.getName());
+    for (const auto& mat : mdl.getMaterials())
+      names.push_back(mat.IGCMaterial::getName());
+    for (const auto& mesh : mdl.getMeshes())
+      names.push_back(mesh.getName());
+    for (const auto& buf : mdl.getBuf_Pos())
+      names.push_back(buf.getName());
+    for (const auto& buf : mdl.getBuf_Nrm())
+      names.push_back(buf.getName());
+    for (const auto& buf : mdl.getBuf_Clr())
+      names.push_back(buf.getName());
+    for (const auto& buf : mdl.getBuf_Uv())
+      names.push_back(buf.getName());
+  }
+  for (const auto& tex : c.getTextures())
+    names.push_back(tex.getName());
+  return names;
+}
+
+bool EditFirstMaterial(kpi::INode& root) {
+  if (auto* g3d = dynamic_cast<riistudio::g3d::Collection*>(&root)) {
+    if (g3d->getModels().empty() ||
+        g3d->getModels()[0].getMaterials().empty())
+      return false;
+    auto& mat = g3d->getModels()[0].getMaterials()[0];
+    mat.fogIndex = mat.fogIndex == 0 ? 1 : 0;
+    return true;
+  }
+  if (auto* j3d = dynamic_cast<riistudio::j3d::Collection*>(&root)) {
+    if (j3d->getModels().empty() ||
+        j3d->getModels()[0].getMaterials().empty())
+      return false;
+    auto& mat = j3d->getModels()[0].getMaterials()[0];
+    mat.flag = mat.flag == 1 ? 4 : 1;
+    return true;
+  }
+  return false;
+}
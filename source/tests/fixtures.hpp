@@ -0,0 +1,59 @@
+#pragma once
+
+// Generated data and reference implementations shared by checks.cpp and
+// bench.cpp
+
+#include <algorithm>
+#include <core/common.h>
+#include <librii/gpu/DLMesh.hpp>
+#include <librii/gx.h>
+#include <map>
+#include <oishii/reader/binary_reader.hxx>
+#include <plugins/g3d/collection.hpp>
+#include <plugins/j3d/Scene.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+// Index of `entry` in `buf`, appended if absent: the linear search the pooled
+// and hashed tables replaced
+template <typename T> u32 LinearAppend(std::vector<T>& buf, const T& entry) {
+  const auto found = std::find(buf.begin(), buf.end(), entry);
+  if (found != buf.end())
+    return static_cast<u32>(found - buf.begin());
+  buf.push_back(entry);
+  return static_cast<u32>(buf.size() - 1);
+}
+
+// Synthetic BMD material. Equal ids make equal materials, drawn from a small
+// set of colors, stages and matrices.
+riistudio::j3d::Material MakeMaterial(u32 id);
+
+// Skinned triangle lists whose PNMTXIDX holds draw matrix indices:
+//
+// A tube around a chain of bones. Rings at the joints blend two bones.
+std::vector<librii::gx::IndexedVertex> SkinnedTube(u16 num_bones,
+                                                   u16 rings_per_bone,
+                                                   u16 ring_size);
+// Triangles between random neighbouring draw matrices
+std::vector<librii::gx::IndexedVertex> SkinnedSoup(u16 num_matrices,
+                                                   u32 num_tris);
+
+// Big endian display list of a matrix primitive, as the BMD writer lays it out
+std::vector<u8> EncodeDisplayList(const librii::gx::MeshData& mesh,
+                                  const librii::gx::MatrixPrimitive& mprim);
+
+using UsageMap = std::map<librii::gx::VertexBufferAttribute, u32>;
+
+// The display list decoder before vertex layouts, minus its error handling
+void DecodeDisplayListReference(oishii::BinaryReader& reader, u32 size,
+                                const librii::gx::VertexDescriptor& descriptor,
+                                std::vector<librii::gx::IndexedPrimitive>& out,
+                                UsageMap& usage);
+
+// Names an archive references, in the order its dictionaries hold them
+std::vector<std::string> CollectNames(const riistudio::g3d::Collection& c);
+
+// Changes one field of the first material of a BRRES or BMD document. Returns
+// false if it has none.
+bool EditFirstMaterial(kpi::INode& root);
@@ -0,0 +1,125 @@
+#include "helpers.hpp"
+#include <core/api.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <oishii/reader/binary_reader.hxx>
+#include <oishii/writer/binary_writer.hxx>
+#include <plate/Platform.hpp>
+#include <vendor/llvm/ADT/ArrayRef.h>
+#include <vendor/llvm/ADT/SmallString.h>
+#include <vendor/llvm/Support/MD5.h>
+
+void save(const std::string_view path, kpi::INode& root,
+          const libcube::ExportOptions& options) {
+  printf("Writing to %s\n", std::string(path).c_str());
+  oishii::Writer writer(1024);
+
+  auto ex = SpawnExporter(root);
+  libcube::SetExportOptions(*ex, options);
+  ex->write_(root, writer);
+
+  plate::Platform::writeFile({writer.getDataBlockStart(), writer.getBufSize()},
+                             path);
+}
+
+std::unique_ptr<kpi::INode> open(const std::string_view path,
+                                 std::vector<ImportMessage>* messages) {
+  std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+  std::vector<u8> vec(file.tellg());
+  file.seekg(0, std::ios::beg);
+
+  if (!file.read(reinterpret_cast<char*>(vec.data()), vec.size())) {
+    std::cout << "Failed to read file!\n";
+    return nullptr;
+  }
+
+  oishii::DataProvider provider(std::move(vec), path);
+  oishii::BinaryReader reader(provider.slice());
+  auto importer = SpawnImporter(std::string(path), provider.slice());
+
+  if (!importer.second) {
+    printf("Cannot spawn importer..\n");
+    return nullptr;
+  }
+  if (!IsConstructible(importer.first)) {
+    printf("Non constructable state.. find parents\n");
+
+    const auto children = GetChildrenOfType(importer.first);
+    if (children.empty()) {
+      printf("No children. Cannot construct.\n");
+      return nullptr;
+    }
+    assert(/*children.size() == 1 &&*/ IsConstructible(children[0])); // TODO
+    importer.first = children[0];
+  }
+
+  std::unique_ptr<kpi::INode> fileState{
+      dynamic_cast<kpi::INode*>(SpawnState(importer.first).release())};
+  if (!fileState.get()) {
+    printf("Cannot spawn file state %s.\n", importer.first.c_str());
+    return nullptr;
+  }
+  auto message_handler = [&](kpi::IOMessageClass message_class,
+                             const std::string_view domain,
+                             const std::string_view message_body) {
+    if (messages != nullptr)
+      messages->push_back({message_class, std::string(domain),
+                           std::string(message_body)});
+  };
+  kpi::IOTransaction transaction{*fileState, provider.slice(),
+                                 message_handler};
+  importer.second->read_(transaction);
+
+  if (transaction.state == kpi::TransactionState::Failure)
+    return nullptr;
+
+  return fileState;
+}
+
+std::vector<u8> WrittenBytes(kpi::INode& root,
+                             const libcube::ExportOptions& options) {
+  auto ex = SpawnExporter(root);
+  libcube::SetExportOptions(*ex, options);
+  return WrittenBytes(*ex, root);
+}
+
+std::vector<u8> WrittenBytes(kpi::IBinarySerializer& exporter,
+                             kpi::INode& root) {
+  oishii::Writer writer(1024);
+  exporter.write_(root, writer);
+  return {writer.getDataBlockStart(),
+          writer.getDataBlockStart() + writer.getBufSize()};
+}
+
+std::string HashBytes(std::span<const u8> bytes) {
+  llvm::MD5 hash;
+  hash.update(llvm::ArrayRef<u8>(bytes.data(), bytes.size()));
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+  return std::string(result.digest().str());
+}
+
+std::string HashFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return "";
+  std::vector<u8> buf((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  return HashBytes(buf);
+}
+
+std::vector<std::string>
+FindSamples(const std::string& dir,
+            std::initializer_list<std::string_view> extensions) {
+  std::vector<std::string> paths;
+  for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+    const auto ext = entry.path().extension().string();
+    if (entry.is_regular_file() &&
+        std::find(extensions.begin(), extensions.end(), ext) !=
+            extensions.end())
+      paths.push_back(entry.path().string());
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
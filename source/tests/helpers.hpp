@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <core/kpi/Node.hpp>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <plugins/gc/Export/ExportOptions.hpp>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Messages reported by an importer through IOTransaction::callback
+struct ImportMessage {
+  kpi::IOMessageClass message_class;
+  std::string domain;
+  std::string body;
+};
+
+// Read a file with the importer registered for it. Returns nullptr if it
+// cannot be read.
+std::unique_ptr<kpi::INode>
+open(const std::string_view path,
+     std::vector<ImportMessage>* messages = nullptr);
+
+// Export `root` to `path`.
+void save(const std::string_view path, kpi::INode& root,
+          const libcube::ExportOptions& options = {});
+
+// The bytes `root` exports to
+std::vector<u8> WrittenBytes(kpi::INode& root,
+                             const libcube::ExportOptions& options = {});
+// The bytes `exporter` writes `root` to. A writer keeps what it last saved, so
+// saving again with the same one only rewrites what was edited since.
+std::vector<u8> WrittenBytes(kpi::IBinarySerializer& exporter,
+                             kpi::INode& root);
+
+// MD5 digest, in hex
+std::string HashBytes(std::span<const u8> bytes);
+std::string HashFile(const std::string& path);
+
+// Regular files of `dir` with one of `extensions`, sorted by path
+std::vector<std::string>
+FindSamples(const std::string& dir,
+            std::initializer_list<std::string_view> extensions);
+
+// Milliseconds `f()` takes
+template <typename F> double TimeMs(F&& f) {
+  const auto begin = std::chrono::steady_clock::now();
+  f();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// Fewest milliseconds `f()` takes over `repeats` calls, as the first call
+// warms caches
+template <typename F> double BestMs(int repeats, F&& f) {
+  double best = TimeMs(f);
+  for (int i = 1; i < repeats; ++i)
+    best = std::min(best, TimeMs(f));
+  return best;
+}
+
+// checks.cpp: Runs every check over the samples in `samples_dir`. Returns
+// non-zero if any fails.
+int runChecks(const std::string& samples_dir);
+
+// bench.cpp: Runs the benchmark named by argv[1], or returns std::nullopt if
+// there is none of that name.
+std::optional<int> runBench(int argc, const char** argv);
+extern const char* BenchUsage;
@@ -1,76 +1,242 @@
+#include "helpers.hpp"
 #include <core/api.hpp>
+#include <core/util/parallel.hpp>
+#include <filesystem>
 #include <fstream>
-#include <oishii/reader/binary_reader.hxx>
-#include <oishii/writer/binary_writer.hxx>
-#include <plate/Platform.hpp>
+#include <iostream>
+#include <nlohmann/json.hpp>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vendor/llvm/Support/InitLLVM.h>
+#include <vendor/thread_pool.hpp>
 
-void save(const std::string_view path, kpi::INode& root) {
-  printf("Writing to %s\n", std::string(path).c_str());
-  oishii::Writer writer(1024);
+#if defined(_WIN32)
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
 
-  auto ex = SpawnExporter(root);
-  ex->write_(root, writer);
+// XXX: Hack, though we'll refactor all of this way soon
+extern thread_local std::string rebuild_dest;
+
+void rebuild(const std::string_view from, const std::string_view to) {
+  rebuild_dest = to;
 
-  plate::Platform::writeFile({writer.getDataBlockStart(), writer.getBufSize()},
-                             path);
+  auto data = open(from);
+  if (!data) {
+    printf("Cannot rebuild!\n");
+    return;
+  }
+  save(to, *data);
 }
 
-std::unique_ptr<kpi::INode> open(const std::string_view path) {
-  std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
-  std::vector<u8> vec(file.tellg());
-  file.seekg(0, std::ios::beg);
+//
+// Batch mode
+//
+// Rebuilds many files in one process. Plugins and reflection data are
+// initialized once by main() and shared by every job.
+//
+
+// Peak resident set size of the whole process, in bytes.
+static u64 GetPeakMemory() {
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters{};
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    return 0;
+  return counters.PeakWorkingSetSize;
+#else
+  rusage usage{};
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  // ru_maxrss is reported in kilobytes
+  return static_cast<u64>(usage.ru_maxrss) * 1024;
+#endif
+}
 
-  if (!file.read(reinterpret_cast<char*>(vec.data()), vec.size())) {
-    std::cout << "Failed to read file!\n";
-    return nullptr;
+static const char* MessageClassName(kpi::IOMessageClass c) {
+  switch (c) {
+  case kpi::IOMessageClass::Information:
+    return "information";
+  case kpi::IOMessageClass::Warning:
+    return "warning";
+  case kpi::IOMessageClass::Error:
+    return "error";
+  default:
+    return "none";
   }
+}
+
+struct BatchJob {
+  std::string from;
+  std::string to;
+
+  // Results
+  bool success = false;
+  std::string error;
+  double open_ms = 0.0;
+  double save_ms = 0.0;
+  std::string input_md5;
+  std::string output_md5;
+  u64 peak_memory = 0;
+  std::vector<ImportMessage> messages;
+};
 
-  oishii::DataProvider provider(std::move(vec), path);
-  oishii::BinaryReader reader(provider.slice());
-  auto importer = SpawnImporter(std::string(path), provider.slice());
+static void RunBatchJob(BatchJob& job) {
+  using clock = std::chrono::steady_clock;
+  rebuild_dest = job.to;
 
-  if (!importer.second) {
-    printf("Cannot spawn importer..\n");
-    return nullptr;
+  job.input_md5 = HashFile(job.from);
+
+  const auto open_begin = clock::now();
+  auto data = open(job.from, &job.messages);
+  const auto open_end = clock::now();
+  job.open_ms =
+      std::chrono::duration<double, std::milli>(open_end - open_begin).count();
+
+  if (!data) {
+    job.error = "Cannot open file";
+    job.peak_memory = GetPeakMemory();
+    return;
   }
-  if (!IsConstructible(importer.first)) {
-    printf("Non constructable state.. find parents\n");
 
-    const auto children = GetChildrenOfType(importer.first);
-    if (children.empty()) {
-      printf("No children. Cannot construct.\n");
-      return nullptr;
+  const auto save_begin = clock::now();
+  save(job.to, *data);
+  const auto save_end = clock::now();
+  job.save_ms =
+      std::chrono::duration<double, std::milli>(save_end - save_begin).count();
+
+  job.output_md5 = HashFile(job.to);
+  job.success = !job.output_md5.empty();
+  if (!job.success)
+    job.error = "Rebuilding did not produce any file";
+  job.peak_memory = GetPeakMemory();
+}
+
+//! Accepts either a directory (every regular file is rebuilt) or a manifest:
+//! a text file listing one input path per line.
+static std::vector<std::string> CollectBatchInputs(const std::string& source) {
+  std::vector<std::string> inputs;
+
+  if (std::filesystem::is_directory(source)) {
+    for (const auto& entry : std::filesystem::directory_iterator(source)) {
+      if (entry.is_regular_file())
+        inputs.push_back(entry.path().string());
     }
-    assert(/*children.size() == 1 &&*/ IsConstructible(children[0])); // TODO
-    importer.first = children[0];
+    std::sort(inputs.begin(), inputs.end());
+    return inputs;
   }
 
-  std::unique_ptr<kpi::INode> fileState{
-      dynamic_cast<kpi::INode*>(SpawnState(importer.first).release())};
-  if (!fileState.get()) {
-    printf("Cannot spawn file state %s.\n", importer.first.c_str());
-    return nullptr;
+  std::ifstream manifest(source);
+  std::string line;
+  while (std::getline(manifest, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    if (line.empty() || line[0] == '#')
+      continue;
+    inputs.push_back(line);
+  }
+  return inputs;
+}
+
+static nlohmann::json BatchJobToJson(const BatchJob& job) {
+  nlohmann::json messages = nlohmann::json::array();
+  for (const auto& msg : job.messages) {
+    messages.push_back({{"class", MessageClassName(msg.message_class)},
+                        {"domain", msg.domain},
+                        {"message", msg.body}});
   }
-  kpi::IOTransaction transaction{*fileState, provider.slice(), [](...) {}};
-  importer.second->read_(transaction);
 
-  return fileState;
+  return {{"input", job.from},
+          {"output", job.to},
+          {"success", job.success},
+          {"error", job.error},
+          {"open_ms", job.open_ms},
+          {"save_ms", job.save_ms},
+          {"input_md5", job.input_md5},
+          {"output_md5", job.output_md5},
+          {"peak_memory", job.peak_memory},
+          {"messages", messages}};
 }
 
-// XXX: Hack, though we'll refactor all of this way soon
-extern std::string rebuild_dest;
+int batch(const std::string& source, const std::string& out_dir,
+          const std::string& report_path, unsigned num_threads) {
+  const auto inputs = CollectBatchInputs(source);
+  if (inputs.empty()) {
+    fprintf(stderr, "Error: No inputs found in %s\n", source.c_str());
+    return 1;
+  }
+  std::filesystem::create_directories(out_dir);
 
-void rebuild(const std::string_view from, const std::string_view to) {
-  rebuild_dest = to;
+  // A manifest may list files of the same name from different directories.
+  // Their outputs are told apart by their index in the batch.
+  std::unordered_map<std::string, int> name_counts;
+  for (const auto& input : inputs)
+    ++name_counts[std::filesystem::path(input).filename().string()];
 
-  auto data = open(from);
-  if (!data) {
-    printf("Cannot rebuild!\n");
-    return;
+  std::vector<BatchJob> jobs(inputs.size());
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    const std::filesystem::path from(inputs[i]);
+    auto name = from.filename().string();
+    if (name_counts[name] > 1)
+      name = from.stem().string() + "_" + std::to_string(i) +
+             from.extension().string();
+    jobs[i].from = inputs[i];
+    jobs[i].to = (std::filesystem::path(out_dir) / name).string();
   }
-  save(to, *data);
+
+  // Schedule the largest files first so one big archive does not end up
+  // running alone at the end of the batch.
+  std::vector<BatchJob*> schedule;
+  for (auto& job : jobs)
+    schedule.push_back(&job);
+  std::stable_sort(schedule.begin(), schedule.end(), [](auto* l, auto* r) {
+    std::error_code ec;
+    return std::filesystem::file_size(l->from, ec) >
+           std::filesystem::file_size(r->from, ec);
+  });
+
+  const auto begin = std::chrono::steady_clock::now();
+  {
+    thread_pool pool(num_threads);
+    // Each job already has a core to itself, so decodes serially instead of
+    // competing with the other jobs for workers.
+    const u32 job_threads = num_threads > 1 ? 1 : ~0u;
+    for (auto* job : schedule) {
+      pool.push_task([job, job_threads] {
+        riistudio::util::ParallelLimit limit(job_threads);
+        RunBatchJob(*job);
+      });
+    }
+    pool.wait_for_tasks();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  int num_failed = 0;
+  nlohmann::json files = nlohmann::json::array();
+  for (const auto& job : jobs) {
+    if (!job.success)
+      ++num_failed;
+    files.push_back(BatchJobToJson(job));
+  }
+
+  nlohmann::json report = {
+      {"threads", num_threads},
+      {"total_ms",
+       std::chrono::duration<double, std::milli>(end - begin).count()},
+      {"num_files", jobs.size()},
+      {"num_failed", num_failed},
+      {"files", files}};
+
+  if (report_path.empty()) {
+    std::cout << report.dump(2) << std::endl;
+  } else {
+    std::ofstream stream(report_path);
+    stream << report.dump(2) << std::endl;
+  }
+
+  return num_failed != 0 ? 1 : 0;
 }
 
 extern bool gTestMode;
@@ -87,12 +253,31 @@ int main(int argc, const char** argv) {
   InitAPI();
 
   ANNOUNCE("Performing tasks");
-  if (argc < 3) {
-    fprintf(stderr, "Error: Too few arguments:\ntests.exe <from> <to>\n");
+  int result = 0;
+  if (argc >= 4 && std::string_view(argv[1]) == "--batch") {
+    // tests.exe --batch <manifest|dir> <out_dir> [report.json] [threads]
+    const std::string report_path = argc >= 5 ? argv[4] : "";
+    unsigned num_threads = std::thread::hardware_concurrency();
+    if (argc >= 6)
+      num_threads = static_cast<unsigned>(std::atoi(argv[5]));
+    result = batch(argv[2], argv[3], report_path, num_threads);
+  } else if (argc >= 3 && std::string_view(argv[1]) == "--check") {
+    // tests.exe --check <samples_dir>
+    result = runChecks(argv[2]);
+  } else if (auto bench = runBench(argc, argv)) {
+    result = *bench;
+  } else if (argc < 3) {
+    fprintf(stderr, "Error: Too few arguments:\ntests.exe <from> <to>\n"
+                    "tests.exe --batch <manifest|dir> <out_dir> "
+                    "[report.json] [threads]\n"
+                    "tests.exe --check <samples_dir>\n%s",
+            BenchUsage);
+    result = 1;
   } else {
     rebuild(argv[1], argv[2]);
   }
 
   ANNOUNCE("Done!");
   DeinitAPI();
+  return result;
 }
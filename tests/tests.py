@@ -60,14 +60,6 @@ def rebuild(test_exec, input_path, output_path):
 		raise RuntimeError(err)
 
 def run_test(test_exec, path, out_path):
-	md5 = hash(path)
-	expected = "<None>"
-	if md5 not in TEST_DATA:
-		print("Warning: %s is not part of the testing set" % pretty_path(path))
-		print("--> Input Hash: %s" % md5)
-	else:
-		expected = TEST_DATA[md5]
-
 	rebuild_path = out_path
 	rebuild(test_exec, path, rebuild_path)
 
@@ -75,7 +67,18 @@ def run_test(test_exec, path, out_path):
 		print("Error: %s Rebuilding did not produce any file" % pretty_path(path))
 		return
 
-	actual = hash(rebuild_path)
+	check_result(path, hash(rebuild_path))
+
+	# os.remove(rebuild_path)
+
+def check_result(path, actual):
+	md5 = hash(path)
+	expected = "<None>"
+	if md5 not in TEST_DATA:
+		print("Warning: %s is not part of the testing set" % pretty_path(path))
+		print("--> Input Hash: %s" % md5)
+	else:
+		expected = TEST_DATA[md5]
 
 	if expected != actual:
 		print("Error: %s: Rebuild does not match!" % pretty_path(path))
@@ -84,15 +87,65 @@ def run_test(test_exec, path, out_path):
 	else:
 		print("%s: Success" % pretty_path(path))
 
-	# os.remove(rebuild_path)
+def run_tests_batch(test_exec, data, out):
+	'''
+	Rebuild every file in a single process.
+	The executable writes a JSON report with the md5 of each output.
+	'''
+	import json
+	from subprocess import Popen, PIPE
+
+	report_path = os.path.join(out, "report.json")
+	if os.path.isfile(report_path):
+		os.remove(report_path)
+
+	process = Popen([test_exec, "--batch", data, out, report_path], stdout=PIPE)
+	(output, err) = process.communicate()
+	process.wait()
+
+	if not os.path.isfile(report_path):
+		raise RuntimeError("Batch mode did not produce a report")
+
+	with open(report_path, "r") as file:
+		report = json.load(file)
+
+	for entry in report["files"]:
+		if not entry["success"]:
+			print("Error: %s failed to rebuild: %s" % (pretty_path(entry["input"]), entry["error"]))
+			continue
+		check_result(entry["input"], entry["output_md5"])
+
+def run_checks(test_exec, data):
+	'''
+	Run the checks of the optimized code paths over the samples.
+	The executable prints an error for each failure and exits non-zero.
+	'''
+	from subprocess import Popen, PIPE
+
+	process = Popen([test_exec, "--check", data], stdout=PIPE)
+	(output, err) = process.communicate()
+	exit_code = process.wait()
+
+	for line in output.decode(errors="replace").splitlines():
+		if line.startswith("Error:") or line.endswith(": Success"):
+			print(line)
 
-def run_tests(test_exec, data, out):
+	if exit_code:
+		raise RuntimeError("Checks failed")
+
+def run_tests(test_exec, data, out, batch=False):
 	assert os.path.isdir(data)
 	assert not os.path.isfile(out)
 
 	if not os.path.isdir(out):
 		os.mkdir(out)
 
+	run_checks(test_exec, data)
+
+	if batch:
+		run_tests_batch(test_exec, data, out)
+		return
+
 	fs_dir = os.fsencode(data)
 	    
 	for fs_file in os.listdir(fs_dir):
@@ -102,12 +155,12 @@ def run_tests(test_exec, data, out):
 
 import sys
 
-if len(sys.argv) < 3:
-	print("Usage: tests.py <tests.exe> <input_folder> <output_folder>")
+if len(sys.argv) < 4:
+	print("Usage: tests.py <tests.exe> <input_folder> <output_folder> [--batch]")
 	sys.exit(1)
 
 try:
-	run_tests(sys.argv[1], sys.argv[2], sys.argv[3])
+	run_tests(sys.argv[1], sys.argv[2], sys.argv[3], "--batch" in sys.argv[4:])
 except:
 	print("Error: tests.py encountered a critical error")
 	raise
\ No newline at end of file